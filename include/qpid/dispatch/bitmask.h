@@ -19,6 +19,8 @@
  * under the License.
  */
 
+#include <qpid/dispatch/error.h>
+
 /**@file
  * Large bit-sets.
 
@@ -33,6 +35,13 @@ typedef struct qd_bitmask_t qd_bitmask_t;
 /** Number of bits in a bitmask. */
 int qd_bitmask_width();
 
+/** Set the number of bits in every bitmask.  The width is rounded up to a
+ * multiple of 64 and must be set before the first bitmask is created.
+ * The default width is 128.
+ *@return QD_ERROR_CONFIG if bitmasks already exist with a different width.
+ */
+qd_error_t qd_bitmask_set_width(int width);
+
 /** Create a bitmask.
  *@param initial if non-zero set all bits, else clear all bits.
  */
@@ -36,10 +36,13 @@ DEQ_DECLARE(qd_buffer_t, qd_buffer_list_t);
 struct qd_buffer_t {
     DEQ_LINKS(qd_buffer_t);
     unsigned int size;          ///< Size of data content
+    unsigned int capacity;      ///< Size of the storage that follows this header
 };
 
 /**
- * Set the initial buffer capacity to be allocated by future calls to qp_buffer.
+ * Set the initial buffer capacity to be allocated by future calls to qp_buffer.  The
+ * larger buffer classes used by qd_buffer_sized() are fixed multiples (8 and 128) of
+ * this size.
  */
 void qd_buffer_set_size(size_t size);
 
@@ -49,6 +52,15 @@ void qd_buffer_set_size(size_t size);
  */
 qd_buffer_t *qd_buffer(void);
 
+/**
+ * Create a buffer from the largest size class whose capacity does not exceed size, or
+ * from the smallest class if size is less than the configured buffer size.  Buffers of
+ * different classes may be mixed freely in a buffer list.
+ *
+ * @param size The number of octets the caller expects to store
+ */
+qd_buffer_t *qd_buffer_sized(size_t size);
+
 /**
  * Free a buffer
  * @param buf A pointer to an allocated buffer
@@ -25,6 +25,18 @@
 /** A linked list of buffers composing a sequence of AMQP data objects. */
 typedef struct qd_composed_field_t qd_composed_field_t;
 
+/** A single AMQP data object encoded in advance, to be inserted into fields by copying. */
+typedef struct qd_composed_fragment_t {
+    const uint8_t *encoded;
+    uint32_t       length;
+} qd_composed_fragment_t;
+
+/** The router annotation keys, encoded as symbols. */
+extern const qd_composed_fragment_t QD_MA_INGRESS_KEY;
+extern const qd_composed_fragment_t QD_MA_TRACE_KEY;
+extern const qd_composed_fragment_t QD_MA_TO_KEY;
+extern const qd_composed_fragment_t QD_MA_PHASE_KEY;
+
 
 /**@file
  * Composing AMQP data trees.
@@ -210,6 +222,41 @@ void qd_compose_insert_symbol(qd_composed_field_t *field, const char *value);
  */
 void qd_compose_insert_typed_iterator(qd_composed_field_t *field, qd_iterator_t *iter);
 
+/**
+ * Insert a sequence of type-tagged values into the field from an iterator.  The octets of
+ * the iterator's view, such as the raw content of a parsed list, are copied as-is.
+ *
+ * @param field A field created by qd_compose.
+ * @param iter An iterator over count completely encoded values.  The caller is
+ *        responsible for freeing this iterator after the call is complete.
+ * @param count The number of values in the iterator's view.
+ */
+void qd_compose_insert_encoded_iterator(qd_composed_field_t *field, qd_iterator_t *iter, uint32_t count);
+
+/**
+ * Insert a pre-encoded value into the field.
+ *
+ * @param field A field created by qd_compose.
+ * @param fragment A fragment holding a single completely encoded value.
+ */
+void qd_compose_insert_fragment(qd_composed_field_t *field, const qd_composed_fragment_t *fragment);
+
+/**
+ * Take the encoding of a composed field as a fragment so that it can be inserted into other
+ * fields without being composed again.  The field is left empty.
+ *
+ * @param field A field holding a single completely encoded value.
+ * @param fragment The fragment to be filled in.  Release it with qd_compose_free_fragment.
+ */
+void qd_compose_take_fragment(qd_composed_field_t *field, qd_composed_fragment_t *fragment);
+
+/**
+ * Release the encoding held by a fragment taken with qd_compose_take_fragment.
+ *
+ * @param fragment The fragment to be released.
+ */
+void qd_compose_free_fragment(qd_composed_fragment_t *fragment);
+
 /**
  * Begin composing a new sub field that can be appended to a composed field.
  *
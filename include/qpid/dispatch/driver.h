@@ -23,6 +23,7 @@
  */
 
 #include <qpid/dispatch/log.h>
+#include <sys/socket.h>
 
 #include <proton/error.h>
 #include <proton/sasl.h>
@@ -170,6 +171,8 @@ qdpn_listener_t *qdpn_listener_next(qdpn_listener_t *listener);
 /** Accept a connection that is pending on the listener.
  *
  * @param[in] listener the listener to accept the connection on
+ * @param[in] driver the driver that will own the new connector, or NULL
+ *            to use the listener's own driver
  * @param[in] policy policy that holds absolute connection limits
  * @param[in] policy_fn function that accepts remote host name and returns
  *            decision to allow or deny this connection
@@ -178,6 +181,7 @@ qdpn_listener_t *qdpn_listener_next(qdpn_listener_t *listener);
  * @return a new connector for the remote, or NULL on error
  */
 qdpn_connector_t *qdpn_listener_accept(qdpn_listener_t *listener,
+                                       qdpn_driver_t *driver,
                                        void *policy,
                                        bool (*policy_fn)(void *, const char *),
                                        bool *counted);
@@ -228,6 +232,33 @@ qdpn_connector_t *qdpn_connector(qdpn_driver_t *driver,
                                  const char *protocol_family,
                                  void* context);
 
+/** Create a non-blocking socket and start connecting it to an address.
+ *
+ * This touches no driver state and may be called without any lock held.
+ *
+ * @param[in] driver used only for logging errors.
+ * @param[in] addr the resolved remote address.
+ * @param[in] addrlen the length of addr.
+ * @return the socket, or -1 (with errno set) on error.
+ */
+int qdpn_connect_socket(qdpn_driver_t *driver, const struct sockaddr *addr, socklen_t addrlen);
+
+/** Construct a connector from a socket made by qdpn_connect_socket().
+ *
+ * @param[in] driver owner of this connection.
+ * @param[in] sock the connecting socket; owned by the connector from now on.
+ * @param[in] host remote host, used for the connector's name.
+ * @param[in] port remote port, used for the connector's name.
+ * @param[in] context application supplied, can be accessed via
+ *                    qdpn_connector_context()
+ * @return a new connector, or NULL on error.
+ */
+qdpn_connector_t *qdpn_connector_socket(qdpn_driver_t *driver,
+                                        int sock,
+                                        const char *host,
+                                        const char *port,
+                                        void *context);
+
 /** Access the head connector for a driver.
  *
  * @param[in] driver the driver whose head connector will be returned
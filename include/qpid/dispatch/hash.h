@@ -42,6 +42,7 @@ qd_error_t qd_hash_remove(qd_hash_t *h, qd_iterator_t *key);
 
 void qd_hash_handle_free(qd_hash_handle_t *handle);
 const unsigned char *qd_hash_key_by_handle(const qd_hash_handle_t *handle);
+uint32_t qd_hash_hash_by_handle(const qd_hash_handle_t *handle);
 qd_error_t qd_hash_remove_by_handle(qd_hash_t *h, qd_hash_handle_t *handle);
 qd_error_t qd_hash_remove_by_handle2(qd_hash_t *h, qd_hash_handle_t *handle, unsigned char **key);
 
@@ -45,6 +45,16 @@
  */
 typedef struct qd_iterator_t qd_iterator_t;
 
+/**
+ * A position in the data underlying an iterator and the number of octets that follow it.
+ * It records where a field lies without creating an iterator for the field.
+ */
+typedef struct {
+    qd_buffer_t   *buffer;
+    unsigned char *cursor;
+    uint32_t       remaining;
+} qd_iterator_pointer_t;
+
 
 /**
  * qd_iterator_view_t
@@ -240,11 +250,30 @@ bool qd_iterator_end(const qd_iterator_t *iter);
  */
 qd_iterator_t *qd_iterator_sub(const qd_iterator_t *iter, uint32_t length);
 
+/**
+ * Return a sub-iterator of length octets that starts at a recorded position.  The
+ * sub-iterator has the supplied view but, as with qd_iterator_sub, the view is not
+ * applied to its data.
+ */
+qd_iterator_t *qd_iterator_sub_pointer(const qd_iterator_pointer_t *pointer, uint32_t length, qd_iterator_view_t view);
+
 /**
  * Move the iterator's cursor forward up to length bytes
  */
 void qd_iterator_advance(qd_iterator_t *iter, uint32_t length);
 
+/**
+ * Record the iterator's current position and the number of octets remaining in its view.
+ * The iterator must be past any annotation octets of its view.
+ */
+void qd_iterator_get_view_cursor(const qd_iterator_t *iter, qd_iterator_pointer_t *pointer);
+
+/**
+ * Move the iterator to a position previously recorded from it, limiting the rest of the
+ * view to pointer->remaining octets.
+ */
+void qd_iterator_set_view_cursor(qd_iterator_t *iter, const qd_iterator_pointer_t *pointer);
+
 /**
  * Return the remaining length (in octets) for the iterator.
  *
@@ -282,6 +311,14 @@ bool qd_iterator_prefix(qd_iterator_t *iter, const char *prefix);
  */
 int qd_iterator_ncopy(qd_iterator_t *iter, unsigned char* buffer, int n);
 
+/**
+ * Copy up to n octets from the current position of the iterator's view into buffer,
+ * advancing the cursor past them.  Unlike qd_iterator_ncopy, the iterator is not reset
+ * first.  Contiguous runs of octets are copied in bulk.
+ * @return number of octets copied.
+ */
+uint32_t qd_iterator_ncopy_octets(qd_iterator_t *iter, unsigned char *buffer, uint32_t n);
+
 /**
  * Return a new copy of the iterator's view, with a trailing '\0' added.  The
  * cursor is advanced to the end of the view.
@@ -361,7 +398,8 @@ void qd_iterator_annotate_space(qd_iterator_t *iter, const char* space, int spac
  */
 
 /**
- * Generate the hash of the view of the iterator.
+ * Generate the hash of the view of the iterator.  The value is kept in the iterator
+ * and reused until the view or its annotations change.
  *
  * @param iter A field iterator
  * @return The hash value of the iterator's view
@@ -62,6 +62,14 @@ typedef enum {
 } qd_message_depth_t;
 
 
+/** Result of checking a message to a depth.  */
+typedef enum {
+    QD_MESSAGE_DEPTH_INVALID,     // corrupt or malformed message detected
+    QD_MESSAGE_DEPTH_OK,          // valid up to depth, including 'no match'
+    QD_MESSAGE_DEPTH_INCOMPLETE   // have not received up to depth
+} qd_message_depth_status_t;
+
+
 /** Message fields */
 typedef enum {
     QD_FIELD_NONE,   // reserved
@@ -203,28 +211,87 @@ void qd_message_set_ingress_annotation(qd_message_t *msg, qd_composed_field_t *i
 
 /**
  * Receive message data via a delivery.  This function may be called more than once on the same
- * delivery if the message spans multiple frames.  Once a complete message has been received, this
- * function shall return the message.
+ * delivery if the message spans multiple frames.  Each call appends the newly arrived data to the
+ * message and returns the message so that it may be forwarded before the last frame is received
+ * (see qd_message_receive_complete).
+ *
+ * The message is attached to the delivery until the last frame has been received.  Until then, the
+ * returned pointer is owned by the delivery and must not be freed by the caller (use qd_message_copy
+ * to hold a reference).  Once the message is complete, ownership is handed to the caller.
  *
  * @param delivery An incoming delivery from a link
- * @return A pointer to the complete message or 0 if the message is not yet complete.
+ * @return A pointer to the (possibly partial) message.
  */
 qd_message_t *qd_message_receive(pn_delivery_t *delivery);
 
 /**
- * Send the message outbound on an outgoing link.
+ * Return the message that is being received on a delivery, if any.  The returned pointer is
+ * owned by the delivery.
+ *
+ * @param delivery An incoming delivery from a link
+ * @return A pointer to the partially received message or 0 if there is none.
+ */
+qd_message_t *qd_get_message_context(pn_delivery_t *delivery);
+
+/**
+ * Abandon the reception of a message.  The message is marked as aborted so that any
+ * cut-through senders finish with what they have, and it is detached from the delivery.
+ *
+ * @param delivery An incoming delivery from a link
+ * @return The message that was being received (the caller owns the reference) or 0.
+ */
+qd_message_t *qd_message_receive_abort(pn_delivery_t *delivery);
+
+/**
+ * Test whether the last frame of the message has been received.
+ *
+ * @param msg A pointer to a message.
+ * @return true iff the entire message content is present.
+ */
+bool qd_message_receive_complete(const qd_message_t *msg);
+
+/**
+ * Test whether the reception of the message was abandoned before it completed.
+ *
+ * @param msg A pointer to a message.
+ * @return true iff the message will never be completed.
+ */
+bool qd_message_aborted(const qd_message_t *msg);
+
+/**
+ * Send the message outbound on an outgoing link.  If the message is not yet completely
+ * received, everything that is available is sent and the send may be resumed later by
+ * calling this function again with the same message reference.
  *
  * @param msg A pointer to a message to be sent.
  * @param link The outgoing link on which to send the message.
  */
 void qd_message_send(qd_message_t *msg, qd_link_t *link, bool strip_outbound_annotations);
 
+/**
+ * Test whether the entire message has been sent by qd_message_send.
+ *
+ * @param msg A pointer to a message being sent.
+ * @return true iff nothing remains to be sent for this message reference.
+ */
+bool qd_message_send_complete(const qd_message_t *msg);
+
 /**
  * Check that the message is well-formed up to a certain depth.  Any part of the message that is
  * beyond the specified depth is not checked for validity.
  */
 int qd_message_check(qd_message_t *msg, qd_message_depth_t depth);
 
+/**
+ * Check the message up to a certain depth, distinguishing between a message that is invalid
+ * and one for which not enough data has been received yet.
+ *
+ * @param msg A pointer to a message.
+ * @param depth The depth to which the message is to be checked.
+ * @return The result of the check.
+ */
+qd_message_depth_status_t qd_message_check_depth(const qd_message_t *msg, qd_message_depth_t depth);
+
 /**
  * Return an iterator for the requested message field.  If the field is not in the message,
  * return NULL.
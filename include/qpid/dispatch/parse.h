@@ -35,7 +35,20 @@
 typedef struct qd_parsed_field_t qd_parsed_field_t;
 
 /**
- * Parse a field delimited by a field iterator.
+ * The router's own message annotations, which are indexed when a map is parsed so that
+ * they can be found without searching the map.
+ */
+typedef enum {
+    QD_MA_KEY_INGRESS,   ///< QD_MA_INGRESS
+    QD_MA_KEY_TRACE,     ///< QD_MA_TRACE
+    QD_MA_KEY_TO,        ///< QD_MA_TO
+    QD_MA_KEY_PHASE,     ///< QD_MA_PHASE
+    QD_MA_KEY_COUNT
+} qd_ma_key_t;
+
+/**
+ * Parse a field delimited by a field iterator.  The fields of the tree are allocated
+ * together, and the iterators for a field are created when first requested.
  *
  * @param iter Field iterator for the field being parsed
  * @return A pointer to the newly created field.
@@ -229,6 +242,24 @@ int qd_parse_is_scalar(qd_parsed_field_t *field);
  */
 qd_parsed_field_t *qd_parse_value_by_key(qd_parsed_field_t *field, const char *key);
 
+/**
+ * Return the value of one of the router's annotations from a map returned by qd_parse.
+ * If the key appears more than once, the last value is returned.
+ *
+ * @param field The field pointer returned by qd_parse.
+ * @param key The annotation to look up.
+ * @return The value field for the annotation or NULL.
+ */
+qd_parsed_field_t *qd_parse_ma_value(qd_parsed_field_t *field, qd_ma_key_t key);
+
+/**
+ * Check whether a map key is in the router's annotation namespace (QD_MA_PREFIX).
+ *
+ * @param field The field pointer returned by qd_parse_sub_key.
+ * @return True if the key is a string or symbol beginning with QD_MA_PREFIX.
+ */
+bool qd_parse_is_router_annotation(qd_parsed_field_t *field);
+
 ///@}
 
 #endif
@@ -48,6 +48,16 @@ typedef enum {
 } qd_router_mode_t;
 ENUM_DECLARE(qd_router_mode);
 
+/**
+ * What to discard when a presettled delivery is forwarded to an outgoing link whose
+ * queue of undelivered deliveries is at capacity.
+ */
+typedef enum {
+    QDR_PRESETTLED_DROP_FLUSH,   ///< Discard all the presettled deliveries queued on the link
+    QDR_PRESETTLED_DROP_OLDEST,  ///< Discard the oldest presettled deliveries queued on the link
+    QDR_PRESETTLED_DROP_NEWEST   ///< Discard the arriving delivery
+} qdr_presettled_drop_t;
+
 /**
  * Allocate and start an instance of the router core module.
  */
@@ -74,6 +84,13 @@ void qdr_core_set_valid_origins(qdr_core_t *core, int router_maskbit, qd_bitmask
 void qdr_core_map_destination(qdr_core_t *core, int router_maskbit, const char *address_hash);
 void qdr_core_unmap_destination(qdr_core_t *core, int router_maskbit, const char *address_hash);
 
+/**
+ * Map or unmap a list of address hashes for one remote router.  The hashes are copied.
+ * The core applies a large list in slices so that forwarding is not held up by it.
+ */
+void qdr_core_map_destinations(qdr_core_t *core, int router_maskbit, int count, const char **address_hashes);
+void qdr_core_unmap_destinations(qdr_core_t *core, int router_maskbit, int count, const char **address_hashes);
+
 typedef void (*qdr_mobile_added_t)   (void *context, const char *address_hash);
 typedef void (*qdr_mobile_removed_t) (void *context, const char *address_hash);
 typedef void (*qdr_link_lost_t)      (void *context, int link_maskbit);
@@ -84,6 +101,74 @@ void qdr_core_route_table_handlers(qdr_core_t           *core,
                                    qdr_mobile_removed_t  mobile_removed,
                                    qdr_link_lost_t       link_lost);
 
+/**
+ ******************************************************************************
+ * Path computation (Router Control)
+ *
+ * The path engine holds the link state of every known router, keyed by mask
+ * bit, and keeps a shortest-path tree rooted at each of them.  Mask bit 0 is
+ * the local router.  When link states change, only the parts of the trees
+ * that the changes can affect are recomputed.  Ties between equal-cost paths
+ * are broken by router id, so the result matches the trees that every other
+ * router in the network computes.
+ *
+ * The engine is not thread-safe; it is used by the router control thread only.
+ ******************************************************************************
+ */
+typedef struct qdr_path_engine_t qdr_path_engine_t;
+
+/**
+ * A route that changed since the previous calculation.  Fields that did not
+ * change are -1 (next_hop, cost) or null (valid_origins).  A next hop is
+ * never reported for a neighbor router, which is its own next hop.  The
+ * valid_origins bitmask belongs to the engine and does not include the local
+ * router.
+ */
+typedef struct {
+    int           router_maskbit;
+    int           next_hop;
+    int           cost;
+    qd_bitmask_t *valid_origins;
+} qdr_path_route_t;
+
+qdr_path_engine_t *qdr_path_engine(void);
+void qdr_path_engine_free(qdr_path_engine_t *engine);
+
+/**
+ * Replace the link state of a router.  The router is added to the engine
+ * the first time its link state is set.
+ *
+ * @param engine Pointer to the path engine
+ * @param router_maskbit Mask bit of the router
+ * @param id Router id, used to order equal-cost paths
+ * @param peer_count Number of entries in peers and costs
+ * @param peers Mask bits of the router's peers
+ * @param costs Cost of the link to each peer
+ */
+void qdr_path_set_link_state(qdr_path_engine_t *engine, int router_maskbit, const char *id,
+                             int peer_count, const int *peers, const int *costs);
+
+/**
+ * Remove a router and its link state from the engine.
+ */
+void qdr_path_del_router(qdr_path_engine_t *engine, int router_maskbit);
+
+/**
+ * Forget the next hop last reported for a router, so it is reported again
+ * by the next calculation.
+ */
+void qdr_path_reset_next_hop(qdr_path_engine_t *engine, int router_maskbit);
+
+/**
+ * Bring the shortest-path trees up to date with the link states and report
+ * the routes of reachable routers that changed since the last calculation.
+ *
+ * @param engine Pointer to the path engine
+ * @param routes Set to an array of changed routes, valid until the next call
+ * @return The number of entries in routes
+ */
+int qdr_path_calculate(qdr_path_engine_t *engine, qdr_path_route_t **routes);
+
 /**
  ******************************************************************************
  * In-process messaging functions
@@ -217,6 +302,27 @@ const char *qdr_connection_get_tenant_space(const qdr_connection_t *conn, int *l
  */
 int qdr_connection_process(qdr_connection_t *conn);
 
+/**
+ * qdr_action_batch_begin
+ *
+ * Start collecting the actions that the calling thread submits to the core.
+ * The collected actions are handed to the core together, in order, when the
+ * matching qdr_action_batch_end is called.  Batches may be nested; only the
+ * outermost end publishes.
+ *
+ * @param core Pointer to the core object
+ */
+void qdr_action_batch_begin(qdr_core_t *core);
+
+/**
+ * qdr_action_batch_end
+ *
+ * Publish the actions collected since the matching qdr_action_batch_begin.
+ *
+ * @param core Pointer to the core object
+ */
+void qdr_action_batch_end(qdr_core_t *core);
+
 /**
  * qdr_connection_activate_t callback
  *
@@ -519,6 +625,9 @@ void qdr_link_detach(qdr_link_t *link, qd_detach_type_t dt, qdr_error_t *error);
  * the link contains all the information needed for proper message routing (i.e. non-anonymous
  * inbound links).
  *
+ * Within an action batch (see qdr_action_batch_begin), consecutive deliveries on the same link
+ * are carried to the core in one action and the link's credit is replenished once for them.
+ *
  * @param link Pointer to the link over which the message arrived.
  * @param msg Pointer to the delivered message.  The sender is giving this reference to the router
  *            core.  The sender _must not_ free or otherwise use the message after invoking this function.
@@ -539,6 +648,27 @@ qdr_delivery_t *qdr_link_deliver_to(qdr_link_t *link, qd_message_t *msg,
 qdr_delivery_t *qdr_link_deliver_to_routed_link(qdr_link_t *link, qd_message_t *msg, bool settled,
                                                 const uint8_t *tag, int tag_length);
 
+/**
+ * qdr_link_deliver_direct
+ *
+ * Try to forward a completely received, pre-settled message on the calling IO thread,
+ * without handing it to the router core.  This succeeds only when the core's published
+ * forwarding snapshot says the destination is served by local consumers alone and the
+ * link has no earlier deliveries still with the core.  Otherwise nothing is done and the
+ * caller must use qdr_link_deliver or qdr_link_deliver_to as usual.
+ *
+ * On success the caller must replenish one credit on the link and settle the delivery.
+ *
+ * @param link Pointer to the link over which the message arrived.
+ * @param msg Pointer to the delivered message.  Taken over (and freed) on success.
+ * @param addr The destination address for an anonymous link, or 0 for an addressed link.
+ *             Taken over on success.
+ * @param link_exclusion Bitmask of excluded inter-router links, if any.  Taken over on success.
+ * @return True iff the message was forwarded.
+ */
+bool qdr_link_deliver_direct(qdr_link_t *link, qd_message_t *msg, qd_iterator_t *addr,
+                             qd_bitmask_t *link_exclusion);
+
 void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit);
 
 void qdr_link_flow(qdr_core_t *core, qdr_link_t *link, int credit, bool drain_mode);
@@ -585,6 +715,19 @@ void qdr_delivery_decref(qdr_core_t *core, qdr_delivery_t *delivery);
 void qdr_delivery_tag(const qdr_delivery_t *delivery, const char **tag, int *length);
 qd_message_t *qdr_delivery_message(const qdr_delivery_t *delivery);
 qdr_error_t *qdr_delivery_error(const qdr_delivery_t *delivery);
+bool qdr_delivery_is_settled(const qdr_delivery_t *delivery);
+
+/**
+ * qdr_delivery_continue
+ *
+ * Notify the core that more of the message of an incoming delivery has been received.
+ * Outgoing links that are cutting the message through are woken up to send the new data.
+ * This must be called one last time after the message is complete (or aborted).
+ *
+ * @param core Pointer to the core object
+ * @param delivery The incoming delivery whose message is being received
+ */
+void qdr_delivery_continue(qdr_core_t *core, qdr_delivery_t *delivery);
 
 /**
  ******************************************************************************
@@ -678,16 +821,22 @@ void qdr_manage_update(qdr_core_t *core, void *context, qd_router_entity_type_t
  * 4) Start the body map, add the "attributeNames" key
  * 5) Call qdr_query_add_attribute_names.  This will add the attribute names list
  * 6) Add the "results" key, start the outer list
- * 7) Call qdr_query_get_first.  This will asynchronously add the first inner list.
+ * 7) Call qdr_query_get_first with the offset and count of the request (count <= 0 for all
+ *    records).  This will asynchronously add the first page of inner lists.  A page holds as
+ *    many records as the core could write in one action within its time budget.
  * 8) When the qdr_manage_response_t callback is invoked:
- *    a) if more is true and count is not exceeded, call qdr_query_get_next
- *    b) if more is false or count is exceeded, call qdr_query_free, close the outer list, close the map
+ *    a) if more is true, call qdr_query_get_next to add the next page
+ *    b) if more is false, close the outer list, close the map.  The core frees the query.
+ *
+ * Between pages the query keeps a cursor on its next record rather than an offset, so
+ * continuing costs the same however far into the table the query is, and records removed
+ * in the meantime are skipped.
  */
 
 qdr_query_t *qdr_manage_query(qdr_core_t *core, void *context, qd_router_entity_type_t type,
                               qd_parsed_field_t *attribute_names, qd_composed_field_t *body);
 void qdr_query_add_attribute_names(qdr_query_t *query);
-void qdr_query_get_first(qdr_query_t *query, int offset);
+void qdr_query_get_first(qdr_query_t *query, int offset, int count);
 void qdr_query_get_next(qdr_query_t *query);
 void qdr_query_free(qdr_query_t *query);
 
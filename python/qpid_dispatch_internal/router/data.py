@@ -17,12 +17,23 @@
 # under the License.
 #
 
+import zlib
+
 ##
 ## Define the current protocol version.  Any messages that do not contain version
 ## information shall be considered to be coming from routers using version 0.
 ##
 ProtocolVersion = 1L
 
+##
+## Encodings for the address list of an absolute MAU.  A router names the encodings it
+## can decode in the 'enc' field of its MARs.  The absolute MAUs sent in reply may then use
+## one of them and may be split into several parts.  Routers that send no 'enc' field are
+## sent a single MAU with a plain 'exist' list.
+##
+MAU_ENCODING_FRONT_ZLIB = 'fcz'
+MAU_ENCODINGS           = [MAU_ENCODING_FRONT_ZLIB]
+
 def getMandatory(data, key, cls=None):
     """
     Get the value mapped to the requested key.    If it's not present, raise an exception.
@@ -47,6 +58,62 @@ def getOptional(data, key, default=None, cls=None):
     return default
 
 
+def _append_varint(out, value):
+    while value >= 0x80:
+        out.append(chr((value & 0x7f) | 0x80))
+        value >>= 7
+    out.append(chr(value))
+
+
+def _read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        octet = ord(data[pos])
+        pos += 1
+        value |= (octet & 0x7f) << shift
+        if octet < 0x80:
+            return value, pos
+        shift += 7
+
+
+def encode_addresses(addrs):
+    """
+    Encode a list of addresses as MAU_ENCODING_FRONT_ZLIB.  The addresses are sorted and each
+    is stored as the length of the prefix it shares with the previous one, the length of the
+    remainder and the remainder.  The result is compressed with zlib.
+    """
+    out  = []
+    prev = ''
+    for addr in sorted(addrs):
+        limit  = min(len(prev), len(addr))
+        shared = 0
+        while shared < limit and prev[shared] == addr[shared]:
+            shared += 1
+        _append_varint(out, shared)
+        _append_varint(out, len(addr) - shared)
+        out.append(addr[shared:])
+        prev = addr
+    return zlib.compress(''.join(out))
+
+
+def decode_addresses(data):
+    """
+    Decode a list of addresses encoded by encode_addresses.
+    """
+    data  = zlib.decompress(data)
+    addrs = []
+    prev  = ''
+    pos   = 0
+    while pos < len(data):
+        shared, pos = _read_varint(data, pos)
+        length, pos = _read_varint(data, pos)
+        prev = prev[:shared] + data[pos:pos + length]
+        pos += length
+        addrs.append(prev)
+    return addrs
+
+
 class LinkState(object):
     """
     The link-state of a single router.  The link state consists of a list of neighbor routers reachable from
@@ -239,8 +306,15 @@ class MessageLSR(object):
 
 class MessageMAU(object):
     """
+    Mobile Address Update (MAU) Message
+    A differential MAU carries the 'add' and 'del' lists; an absolute MAU carries the whole
+    'exist' list, either plain or encoded ('enc' and 'exist_data').  An encoded absolute MAU
+    may be one of 'parts' messages, numbered from zero by 'part', whose lists together make up
+    the address set.
     """
-    def __init__(self, body, _id=None, _seq=None, _add_list=None, _del_list=None, _exist_list=None):
+    def __init__(self, body, _id=None, _seq=None, _add_list=None, _del_list=None, _exist_list=None,
+                 _encoding=None, _part=0, _parts=1):
+        self._exist_data = None
         if body:
             self.id = getMandatory(body, 'id', str)
             self.version = getOptional(body, 'pv', 0, long)
@@ -249,6 +323,13 @@ class MessageMAU(object):
             self.add_list = getOptional(body, 'add', None, list)
             self.del_list = getOptional(body, 'del', None, list)
             self.exist_list = getOptional(body, 'exist', None, list)
+            self.encoding = getOptional(body, 'enc', None, str)
+            self.part = getOptional(body, 'part', 0, long)
+            self.parts = getOptional(body, 'parts', 1, long)
+            if self.encoding != None:
+                if self.encoding not in MAU_ENCODINGS:
+                    raise Exception("Unsupported MAU address encoding: '%s'" % self.encoding)
+                self.exist_list = decode_addresses(getMandatory(body, 'exist_data', str))
         else:
             self.id = _id
             self.version = ProtocolVersion
@@ -257,6 +338,9 @@ class MessageMAU(object):
             self.add_list = _add_list
             self.del_list = _del_list
             self.exist_list = _exist_list
+            self.encoding = _encoding
+            self.part = long(_part)
+            self.parts = long(_parts)
 
     def get_opcode(self):
         return 'MAU'
@@ -265,11 +349,17 @@ class MessageMAU(object):
         _add = ''
         _del = ''
         _exist = ''
+        _part = ''
         if self.add_list != None:   _add   = ' add=%r'   % self.add_list
         if self.del_list != None:   _del   = ' del=%r'   % self.del_list
-        if self.exist_list != None: _exist = ' exist=%r' % self.exist_list
-        return "MAU(id=%s pv=%d area=%s mobile_seq=%d%s%s%s)" % \
-                (self.id, self.version, self.area, self.mobile_seq, _add, _del, _exist)
+        if self.exist_list != None:
+            if self.encoding != None:
+                _exist = ' enc=%s exist=<%d addresses>' % (self.encoding, len(self.exist_list))
+            else:
+                _exist = ' exist=%r' % self.exist_list
+        if self.parts > 1:          _part  = ' part=%d/%d' % (self.part, self.parts)
+        return "MAU(id=%s pv=%d area=%s mobile_seq=%d%s%s%s%s)" % \
+                (self.id, self.version, self.area, self.mobile_seq, _add, _del, _exist, _part)
 
     def to_dict(self):
         body = {'id'         : self.id,
@@ -278,33 +368,67 @@ class MessageMAU(object):
                 'mobile_seq' : self.mobile_seq }
         if self.add_list != None:   body['add']   = self.add_list
         if self.del_list != None:   body['del']   = self.del_list
-        if self.exist_list != None: body['exist'] = self.exist_list
+        if self.exist_list != None:
+            if self.encoding != None:
+                ##
+                ## Encode once; the same message may be sent to several peers.
+                ##
+                if self._exist_data == None:
+                    self._exist_data = bytearray(encode_addresses(self.exist_list))
+                body['enc']        = self.encoding
+                body['exist_data'] = self._exist_data
+            else:
+                body['exist'] = self.exist_list
+        if self.parts > 1:
+            body['part']  = self.part
+            body['parts'] = self.parts
         return body
 
 
 class MessageMAR(object):
     """
+    Mobile Address Request (MAR) Message
+    Asks a router for the updates after 'have_seq'.  The optional 'enc' lists the address
+    encodings the requester accepts.  If the requester holds the first parts of a multi-part
+    absolute MAU, 'resume_seq' and 'resume_part' say where to continue.
     """
-    def __init__(self, body, _id=None, _have_seq=None):
+    def __init__(self, body, _id=None, _have_seq=None, _encodings=None, _resume_seq=None, _resume_part=None):
         if body:
             self.id = getMandatory(body, 'id', str)
             self.version = getOptional(body, 'pv', 0, long)
             self.area = '0'
             self.have_seq = getMandatory(body, 'have_seq', long)
+            self.encodings = getOptional(body, 'enc', [], list)
+            self.resume_seq = getOptional(body, 'resume_seq', None, long)
+            self.resume_part = getOptional(body, 'resume_part', None, long)
         else:
             self.id = _id
             self.version = ProtocolVersion
             self.area = '0'
             self.have_seq = long(_have_seq)
+            self.encodings = _encodings or []
+            self.resume_seq = _resume_seq
+            self.resume_part = _resume_part
 
     def get_opcode(self):
         return 'MAR'
 
     def __repr__(self):
-        return "MAR(id=%s pv=%d area=%s have_seq=%d)" % (self.id, self.version, self.area, self.have_seq)
+        _enc    = ''
+        _resume = ''
+        if self.encodings:          _enc    = ' enc=%r' % self.encodings
+        if self.resume_seq != None: _resume = ' resume=%d/%d' % (self.resume_seq, self.resume_part)
+        return "MAR(id=%s pv=%d area=%s have_seq=%d%s%s)" % \
+                (self.id, self.version, self.area, self.have_seq, _enc, _resume)
 
     def to_dict(self):
-        return {'id'       : self.id,
+        body = {'id'       : self.id,
                 'pv'       : self.version,
                 'area'     : self.area,
                 'have_seq' : self.have_seq}
+        if self.encodings:
+            body['enc'] = self.encodings
+        if self.resume_seq != None:
+            body['resume_seq']  = long(self.resume_seq)
+            body['resume_part'] = long(self.resume_part)
+        return body
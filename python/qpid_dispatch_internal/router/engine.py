@@ -71,7 +71,6 @@ class RouterEngine:
         self.node_tracker          = NodeTracker(self, self.max_routers)
         self.hello_protocol        = HelloProtocol(self, self.node_tracker)
         self.link_state_engine     = LinkStateEngine(self)
-        self.path_engine           = PathEngine(self)
         self.mobile_address_engine = MobileAddressEngine(self, self.node_tracker)
 
 
@@ -169,6 +168,7 @@ class RouterEngine:
         This is the IoAdapter message-receive handler
         """
         try:
+            self.router_adapter.count_control_message(message.properties['opcode'], message.body_size or 0, False)
             self.handleControlMessage(message.properties['opcode'], message.body, link_id, cost)
         except Exception:
             self.log(LOG_ERROR, "Exception in raw message processing: properties=%r body=%r\n%s" %
@@ -233,7 +233,8 @@ class RouterEngine:
         Send a control message to another router.
         """
         app_props = {'opcode' : msg.get_opcode() }
-        self.io_adapter[0].send(Message(address=dest, properties=app_props, body=msg.to_dict()), True, True)
+        octets = self.io_adapter[0].send(Message(address=dest, properties=app_props, body=msg.to_dict()), True, True)
+        self.router_adapter.count_control_message(msg.get_opcode(), octets or 0, True)
 
 
     def node_updated(self, addr, reachable, neighbor):
@@ -31,12 +31,14 @@ class Message(object):
     @ivar reply_to: The reply-to address for the message.
     @ivar correlation_id: Correlation ID for replying to the message.
     @ivar properties: Application properties.
+    @ivar body_size: Octets in the encoded body of a received message.
     """
 
     _fields = ['address', 'properties', 'body', 'reply_to', 'correlation_id']
 
     def __init__(self, **kwds):
         """All instance variables can be set as keywords. See L{Message}"""
+        self.body_size = None
         for f in self._fields:
             setattr(self, f, kwds.get(f, None))
         for k in kwds:
@@ -17,11 +17,28 @@
 # under the License.
 #
 
-from data import MessageMAR, MessageMAU
+from data import MessageMAR, MessageMAU, MAU_ENCODINGS, MAU_ENCODING_FRONT_ZLIB
 from ..dispatch import LOG_TRACE
 
 MAX_KEPT_DELTAS = 10
 
+##
+## The number of addresses carried by each part of an encoded absolute MAU
+##
+MAX_ADDRS_PER_MAU = 10000
+
+
+class PartialMAU(object):
+    """
+    The parts of a multi-part absolute MAU received so far from one router.
+    """
+    def __init__(self, mobile_seq, parts):
+        self.mobile_seq = mobile_seq
+        self.parts      = parts
+        self.next_part  = 0
+        self.addrs      = []
+
+
 class MobileAddressEngine(object):
     """
     This module is responsible for maintaining an up-to-date list of mobile addresses in the domain.
@@ -38,6 +55,7 @@ class MobileAddressEngine(object):
         self.added_addrs   = []
         self.deleted_addrs = []
         self.sent_deltas   = {}
+        self.sent_parts    = None
 
 
     def tick(self, now):
@@ -102,8 +120,13 @@ class MobileAddressEngine(object):
             ##
             if msg.mobile_seq == node.mobile_address_sequence:
                 return
+            exist_list = msg.exist_list
+            if msg.parts > 1:
+                exist_list = self._assemble_parts(node, msg)
+                if exist_list == None:
+                    return
             node.mobile_address_sequence = msg.mobile_seq
-            node.overwrite_addresses(msg.exist_list)
+            node.overwrite_addresses(exist_list)
         else:
             ##
             ## Differential MAU
@@ -113,10 +136,8 @@ class MobileAddressEngine(object):
                 ## This message represents the next expected sequence, incorporate the deltas
                 ##
                 node.mobile_address_sequence += 1
-                for a in msg.add_list:
-                    node.map_address(a)
-                for a in msg.del_list:
-                    node.unmap_address(a)
+                node.map_addresses(msg.add_list)
+                node.unmap_addresses(msg.del_list)
 
             elif node.mobile_address_sequence == msg.mobile_seq:
                 ##
@@ -149,13 +170,73 @@ class MobileAddressEngine(object):
         ##
         ## The peer needs to be sent an absolute update with the whole address list
         ##
+        if MAU_ENCODING_FRONT_ZLIB in msg.encodings:
+            parts = self._absolute_parts()
+            first = 0
+            if msg.resume_seq == self.mobile_seq and msg.resume_part < len(parts):
+                first = msg.resume_part
+            for smsg in parts[first:]:
+                self.container.send('amqp:/_topo/0/%s/qdrouter.ma' % msg.id, smsg)
+                self.container.log_ma(LOG_TRACE, "SENT: %r" % smsg)
+            return
+
         smsg = MessageMAU(None, self.id, self.mobile_seq, None, None, self.local_addrs)
         self.container.send('amqp:/_topo/0/%s/qdrouter.ma' % msg.id, smsg)
         self.container.log_ma(LOG_TRACE, "SENT: %r" % smsg)
 
 
+    def _absolute_parts(self):
+        """
+        The encoded absolute MAU for the current sequence, split into parts.  The parts are
+        kept until the sequence changes so that every peer catching up is sent the same parts
+        and each part is encoded only once.
+        """
+        if self.sent_parts == None or self.sent_parts[0] != self.mobile_seq:
+            addrs  = sorted(self.local_addrs)
+            chunks = [addrs[i:i + MAX_ADDRS_PER_MAU] for i in range(0, len(addrs), MAX_ADDRS_PER_MAU)] or [[]]
+            parts  = [MessageMAU(None, self.id, self.mobile_seq, None, None, chunk,
+                                 MAU_ENCODING_FRONT_ZLIB, idx, len(chunks))
+                      for idx, chunk in enumerate(chunks)]
+            self.sent_parts = (self.mobile_seq, parts)
+        return self.sent_parts[1]
+
+
+    def _assemble_parts(self, node, msg):
+        """
+        Add one part of a multi-part absolute MAU to those received from the node.  Returns the
+        whole address list once the last part is in, otherwise None.
+        """
+        partial = node.partial_mau
+        if msg.part == 0:
+            partial = node.partial_mau = PartialMAU(msg.mobile_seq, msg.parts)
+        elif partial == None or partial.mobile_seq != msg.mobile_seq or msg.part > partial.next_part:
+            ##
+            ## A part is missing.  Ask for the update again; the request says where to resume.
+            ##
+            node.mobile_address_request()
+            return None
+        elif msg.part < partial.next_part:
+            ##
+            ## A part already received, resent in reply to an earlier request
+            ##
+            return None
+
+        partial.addrs.extend(msg.exist_list)
+        partial.next_part += 1
+        if partial.next_part < partial.parts:
+            return None
+        node.partial_mau = None
+        return partial.addrs
+
+
     def send_mar(self, node_id, seq):
-        msg = MessageMAR(None, self.id, seq)
+        resume_seq  = None
+        resume_part = None
+        partial     = self.node_tracker.router_node(node_id).partial_mau
+        if partial != None:
+            resume_seq  = partial.mobile_seq
+            resume_part = partial.next_part
+        msg = MessageMAR(None, self.id, seq, MAU_ENCODINGS, resume_seq, resume_part)
         self.container.send('amqp:/_topo/0/%s/qdrouter.ma' % node_id, msg)
         self.container.log_ma(LOG_TRACE, "SENT: %r" % msg)
 
@@ -145,25 +145,20 @@ class NodeTracker(object):
         ##
         if self.recompute_topology:
             self.recompute_topology = False
-            collection = {self.my_id : self.link_state}
-            for node_id, node in self.nodes.items():
-                collection[node_id] = node.link_state
-            next_hops, costs, valid_origins = self.container.path_engine.calculate_routes(collection)
-            self.container.log_ls(LOG_TRACE, "Computed next hops: %r" % next_hops)
-            self.container.log_ls(LOG_TRACE, "Computed costs: %r" % costs)
-            self.container.log_ls(LOG_TRACE, "Computed valid origins: %r" % valid_origins)
+            next_hops, costs, valid_origins = self._calculate_routes()
+            self.container.log_ls(LOG_TRACE, "Changed next hops: %r" % next_hops)
+            self.container.log_ls(LOG_TRACE, "Changed costs: %r" % costs)
+            self.container.log_ls(LOG_TRACE, "Changed valid origins: %r" % valid_origins)
 
             ##
-            ## Update the next hops and valid origins for each node
+            ## Record the changed next hops, valid origins, and costs for each node
             ##
             for node_id, next_hop_id in next_hops.items():
-                node     = self.nodes[node_id]
-                next_hop = self.nodes[next_hop_id]
-                vo       = valid_origins[node_id]
-                cost     = costs[node_id]
-                node.set_next_hop(next_hop)
-                node.set_valid_origins(vo)
-                node.set_cost(cost)
+                self.nodes[node_id].set_next_hop(self.nodes[next_hop_id])
+            for node_id, vo in valid_origins.items():
+                self.nodes[node_id].set_valid_origins(vo)
+            for node_id, cost in costs.items():
+                self.nodes[node_id].set_cost(cost)
 
         ##
         ## Send link-state requests and mobile-address requests to the nodes
@@ -189,6 +184,35 @@ class NodeTracker(object):
             self.container.link_state_engine.send_ra(now)
 
 
+    def _calculate_routes(self):
+        """
+        Pass the link state of every known router to the path engine in the router
+        core and recompute the routes.  The engine updates the core's route table
+        itself and returns only the routes that changed, keyed by mask bit; they are
+        mapped back to router ids here.
+        """
+        maskbits   = {self.my_id : 0}
+        by_maskbit = {0 : self.my_id}
+        collection = {self.my_id : self.link_state}
+        for node_id, node in self.nodes.items():
+            maskbits[node_id]        = node.maskbit
+            by_maskbit[node.maskbit] = node_id
+            collection[node_id]      = node.link_state
+
+        adapter = self.container.router_adapter
+        for node_id, ls in collection.items():
+            peers = {}
+            for peer, cost in ls.peers.items():
+                if peer in maskbits:
+                    peers[maskbits[peer]] = cost
+            adapter.set_link_state(maskbits[node_id], node_id, peers)
+
+        next_hops, costs, valid_origins = adapter.calculate_routes()
+        return (dict((by_maskbit[n], by_maskbit[h]) for n, h in next_hops.items()),
+                dict((by_maskbit[n], c) for n, c in costs.items()),
+                dict((by_maskbit[n], [by_maskbit[o] for o in vo]) for n, vo in valid_origins.items()))
+
+
     def neighbor_refresh(self, node_id, version, instance, link_id, cost, now):
         """
         Invoked when the hello protocol has received positive confirmation
@@ -392,8 +416,9 @@ class RouterNode(object):
         self.next_hop_router         = None
         self.cost                    = None
         self.valid_origins           = None
-        self.mobile_addresses        = []
+        self.mobile_addresses        = set()
         self.mobile_address_sequence = 0
+        self.partial_mau             = None
         self.need_ls_request         = True
         self.need_mobile_request     = False
         self.keep_alive_count        = 0
@@ -450,13 +475,17 @@ class RouterNode(object):
         self.log(LOG_TRACE, "Node %s deleted" % self.id)
 
 
+    ##
+    ## The route computed for this node has already been applied to the router core
+    ## by the path engine.  These record it for management and for deciding whether
+    ## the node is reachable.
+    ##
     def set_next_hop(self, next_hop):
         if self.id == next_hop.id:
             return
         if self.next_hop_router and self.next_hop_router.id == next_hop.id:
             return
         self.next_hop_router = next_hop
-        self.adapter.set_next_hop(self.maskbit, next_hop.maskbit)
         self.log(LOG_TRACE, "Node %s next hop set: %s" % (self.id, next_hop.id))
 
 
@@ -464,8 +493,6 @@ class RouterNode(object):
         if self.valid_origins == valid_origins:
             return
         self.valid_origins = valid_origins
-        vo_mb = [self.parent.nodes[N].maskbit for N in valid_origins]
-        self.adapter.set_valid_origins(self.maskbit, vo_mb)
         self.log(LOG_TRACE, "Node %s valid origins: %r" % (self.id, valid_origins))
 
 
@@ -473,7 +500,6 @@ class RouterNode(object):
         if self.cost == cost:
             return
         self.cost = cost
-        self.adapter.set_cost(self.maskbit, cost)
         self.log(LOG_TRACE, "Node %s cost: %d" % (self.id, cost))
 
 
@@ -519,37 +545,38 @@ class RouterNode(object):
         return False
 
 
-    def map_address(self, addr):
-        self.mobile_addresses.append(addr)
-        self.adapter.map_destination(addr, self.maskbit)
-        self.log(LOG_DEBUG, "Remote destination %s mapped to router %s" % (self._logify(addr), self.id))
+    def map_addresses(self, addrs):
+        added = []
+        for addr in addrs:
+            if addr not in self.mobile_addresses:
+                self.mobile_addresses.add(addr)
+                added.append(addr)
+        if added:
+            self.adapter.map_destinations(added, self.maskbit)
+            self.log(LOG_DEBUG, "%d remote destinations mapped to router %s" % (len(added), self.id))
 
 
-    def unmap_address(self, addr):
-        self.mobile_addresses.remove(addr)
-        self.adapter.unmap_destination(addr, self.maskbit)
-        self.log(LOG_DEBUG, "Remote destination %s unmapped from router %s" % (self._logify(addr), self.id))
+    def unmap_addresses(self, addrs):
+        deleted = []
+        for addr in addrs:
+            if addr in self.mobile_addresses:
+                self.mobile_addresses.remove(addr)
+                deleted.append(addr)
+        if deleted:
+            self.adapter.unmap_destinations(deleted, self.maskbit)
+            self.log(LOG_DEBUG, "%d remote destinations unmapped from router %s" % (len(deleted), self.id))
 
 
     def unmap_all_addresses(self):
         self.mobile_address_sequence = 0
-        for addr in self.mobile_addresses:
-            self.unmap_address(addr)
+        self.partial_mau             = None
+        self.unmap_addresses(list(self.mobile_addresses))
 
 
     def overwrite_addresses(self, addrs):
-        added   = []
-        deleted = []
-        for a in addrs:
-            if a not in self.mobile_addresses:
-                added.append(a)
-        for a in self.mobile_addresses:
-            if a not in addrs:
-                deleted.append(a)
-        for a in added:
-            self.map_address(a)
-        for a in deleted:
-            self.unmap_address(a)
+        addrs = set(addrs)
+        self.map_addresses(list(addrs - self.mobile_addresses))
+        self.unmap_addresses(list(self.mobile_addresses - addrs))
 
 
     def update_instance(self, instance, version):
@@ -22,6 +22,9 @@ class PathEngine(object):
     """
     This module is responsible for computing the next-hop for every router in the domain
     based on the collection of link states that have been gathered.
+
+    The router itself uses the native path engine in src/router_core/path_engine.c,
+    which must produce the same trees.  This implementation is kept as the reference.
     """
     def __init__(self, container):
         self.container = container
@@ -58,9 +58,39 @@ struct qd_alloc_item_t {
 DEQ_DECLARE(qd_alloc_item_t, qd_alloc_item_list_t);
 
 
+//
+// A batch (magazine) is a chain of exactly transfer_batch_size items linked through
+// their 'next' pointers.  While a batch is held outside of a thread pool, the 'prev'
+// pointer of its first item is free and is used to chain batches together.
+//
+#define BATCH_NEXT(b) DEQ_PREV(b)
+
+//
+// The depot holds full batches that have been released by threads.  Batches are
+// exchanged through a fixed array of slots using single-word atomic operations: a
+// batch is parked by swinging an empty slot to point at it and claimed by swapping
+// the slot back to empty.  Because a claim is a plain exchange that does not depend
+// on the contents of the batch, the depot is not exposed to the ABA problem.
+//
+// If all the slots are taken, batches spill over onto a mutex-protected overflow
+// stack.  This only happens when the depot is deep, i.e. when memory is plentiful.
+//
+#define QD_ALLOC_DEPOT_SLOTS 32
+
+struct qd_alloc_depot_t {
+    qd_alloc_item_t *slots[QD_ALLOC_DEPOT_SLOTS] __attribute__((aligned(64)));
+    uint32_t         batches                     __attribute__((aligned(64)));
+    qd_alloc_item_t *overflow;
+    uint32_t         overflow_batches;
+};
+
 struct qd_alloc_pool_t {
     DEQ_LINKS(qd_alloc_pool_t);
     qd_alloc_item_list_t free_list;
+    uint32_t             depot_hint;
+#if QD_MEMORY_STATS
+    qd_alloc_stats_t     stats;
+#endif
 };
 
 qd_alloc_config_t qd_alloc_default_config_big   = {16,  32, 0};
@@ -71,11 +101,17 @@ static sys_mutex_t          *init_lock = 0;
 static qd_alloc_type_list_t  type_list;
 static char *debug_dump = 0;
 
+#if QD_MEMORY_STATS
+#define POOL_STAT(pool, field, delta) (pool)->stats.field += (delta)
+#else
+#define POOL_STAT(pool, field, delta) do {} while (0)
+#endif
+
 static void qd_alloc_init(qd_alloc_type_desc_t *desc)
 {
     sys_mutex_lock(init_lock);
 
-    if (!desc->global_pool) {
+    if (!desc->depot) {
         desc->total_size = desc->type_size;
         if (desc->additional_size)
             desc->total_size += *desc->additional_size;
@@ -86,8 +122,9 @@ static void qd_alloc_init(qd_alloc_type_desc_t *desc)
 
         assert (desc->config->local_free_list_max >= desc->config->transfer_batch_size);
 
-        desc->global_pool = NEW(qd_alloc_pool_t);
-        DEQ_INIT(desc->global_pool->free_list);
+        qd_alloc_depot_t *depot;
+        NEW_CACHE_ALIGNED(qd_alloc_depot_t, depot);
+        memset(depot, 0, sizeof(qd_alloc_depot_t));
         desc->lock = sys_mutex();
         DEQ_INIT(desc->tpool_list);
 #if QD_MEMORY_STATS
@@ -100,6 +137,7 @@ static void qd_alloc_init(qd_alloc_type_desc_t *desc)
         type_item->desc = desc;
         DEQ_INSERT_TAIL(type_list, type_item);
 
+        desc->depot = depot;
         desc->header  = PATTERN_FRONT;
         desc->trailer = PATTERN_BACK;
         qd_entity_cache_add(QD_ALLOCATOR_TYPE, type_item);
@@ -109,31 +147,127 @@ static void qd_alloc_init(qd_alloc_type_desc_t *desc)
 }
 
 
-/* coverity[+alloc] */
-void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
+static qd_alloc_pool_t *qd_alloc_pool(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
 {
-    int idx;
-
-    //
-    // If the descriptor is not initialized, set it up now.
-    //
-    if (desc->header != PATTERN_FRONT)
-        qd_alloc_init(desc);
-
     //
     // If this is the thread's first pass through here, allocate the
     // thread-local pool for this type.
     //
     if (*tpool == 0) {
         NEW_CACHE_ALIGNED(qd_alloc_pool_t, *tpool);
+        memset(*tpool, 0, sizeof(qd_alloc_pool_t));
         DEQ_ITEM_INIT(*tpool);
         DEQ_INIT((*tpool)->free_list);
+        (*tpool)->depot_hint = ((uintptr_t) *tpool >> 6) % QD_ALLOC_DEPOT_SLOTS;
         sys_mutex_lock(desc->lock);
         DEQ_INSERT_TAIL(desc->tpool_list, *tpool);
         sys_mutex_unlock(desc->lock);
     }
 
-    qd_alloc_pool_t *pool = *tpool;
+    return *tpool;
+}
+
+
+//
+// Free a batch of items back to the heap.
+//
+static void qd_alloc_free_batch(qd_alloc_item_t *batch)
+{
+    while (batch) {
+        qd_alloc_item_t *next = DEQ_NEXT(batch);
+        free(batch);
+        batch = next;
+    }
+}
+
+
+//
+// Offer a full batch to the depot.  Returns false if the depot is at its limit, in which
+// case the caller keeps ownership of the batch.
+//
+static bool qd_alloc_depot_put(qd_alloc_type_desc_t *desc, qd_alloc_pool_t *pool, qd_alloc_item_t *batch)
+{
+    qd_alloc_depot_t *depot = desc->depot;
+    int               max   = desc->config->global_free_list_max;
+
+    if (max != 0) {
+        uint32_t batches = __atomic_add_fetch(&depot->batches, 1, __ATOMIC_RELAXED);
+        if ((int) batches * desc->config->transfer_batch_size > max) {
+            __atomic_sub_fetch(&depot->batches, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } else
+        __atomic_add_fetch(&depot->batches, 1, __ATOMIC_RELAXED);
+
+    BATCH_NEXT(batch) = 0;
+    for (int i = 0; i < QD_ALLOC_DEPOT_SLOTS; i++) {
+        int              slot  = (pool->depot_hint + i) % QD_ALLOC_DEPOT_SLOTS;
+        qd_alloc_item_t *empty = 0;
+        if (__atomic_load_n(&depot->slots[slot], __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&depot->slots[slot], &empty, batch, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            pool->depot_hint = slot;
+            return true;
+        }
+    }
+
+    sys_mutex_lock(desc->lock);
+    BATCH_NEXT(batch) = depot->overflow;
+    depot->overflow   = batch;
+    __atomic_add_fetch(&depot->overflow_batches, 1, __ATOMIC_RELAXED);
+    sys_mutex_unlock(desc->lock);
+    return true;
+}
+
+
+//
+// Claim a full batch from the depot.  Returns 0 if the depot is empty.
+//
+static qd_alloc_item_t *qd_alloc_depot_get(qd_alloc_type_desc_t *desc, qd_alloc_pool_t *pool)
+{
+    qd_alloc_depot_t *depot = desc->depot;
+    qd_alloc_item_t  *batch = 0;
+
+    if (__atomic_load_n(&depot->batches, __ATOMIC_RELAXED) == 0)
+        return 0;
+
+    for (int i = 0; i < QD_ALLOC_DEPOT_SLOTS && !batch; i++) {
+        int slot = (pool->depot_hint + i) % QD_ALLOC_DEPOT_SLOTS;
+        if (__atomic_load_n(&depot->slots[slot], __ATOMIC_RELAXED) != 0) {
+            batch = __atomic_exchange_n(&depot->slots[slot], 0, __ATOMIC_ACQUIRE);
+            if (batch)
+                pool->depot_hint = slot;
+        }
+    }
+
+    if (!batch && __atomic_load_n(&depot->overflow_batches, __ATOMIC_RELAXED) != 0) {
+        sys_mutex_lock(desc->lock);
+        batch = depot->overflow;
+        if (batch) {
+            depot->overflow = BATCH_NEXT(batch);
+            __atomic_sub_fetch(&depot->overflow_batches, 1, __ATOMIC_RELAXED);
+        }
+        sys_mutex_unlock(desc->lock);
+    }
+
+    if (batch)
+        __atomic_sub_fetch(&depot->batches, 1, __ATOMIC_RELAXED);
+    return batch;
+}
+
+
+/* coverity[+alloc] */
+void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
+{
+    int idx;
+
+    //
+    // If the descriptor is not initialized, set it up now.
+    //
+    if (desc->header != PATTERN_FRONT)
+        qd_alloc_init(desc);
+
+    qd_alloc_pool_t *pool = qd_alloc_pool(desc, tpool);
 
     //
     // Fast case: If there's an item on the local free list, take it off the
@@ -152,21 +286,20 @@ void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
     }
 
     //
-    // The local free list is empty, we need to either rebalance a batch
-    // of items from the global list or go to the heap to get new memory.
+    // The local free list is empty, we need to either claim a full batch
+    // from the depot or go to the heap to get new memory.
     //
-    sys_mutex_lock(desc->lock);
-    if (DEQ_SIZE(desc->global_pool->free_list) >= desc->config->transfer_batch_size) {
+    qd_alloc_item_t *batch = qd_alloc_depot_get(desc, pool);
+    if (batch) {
         //
-        // Rebalance a full batch from the global free list to the thread list.
+        // Move the batch from the depot onto the thread list.
         //
-#if QD_MEMORY_STATS
-        desc->stats->batches_rebalanced_to_threads++;
-        desc->stats->held_by_threads += desc->config->transfer_batch_size;
-#endif
-        for (idx = 0; idx < desc->config->transfer_batch_size; idx++) {
-            item = DEQ_HEAD(desc->global_pool->free_list);
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
+        POOL_STAT(pool, batches_rebalanced_to_threads, 1);
+        POOL_STAT(pool, held_by_threads, desc->config->transfer_batch_size);
+        while (batch) {
+            item  = batch;
+            batch = DEQ_NEXT(batch);
+            DEQ_ITEM_INIT(item);
             DEQ_INSERT_TAIL(pool->free_list, item);
         }
     } else {
@@ -184,13 +317,10 @@ void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
                 break;
             DEQ_ITEM_INIT(item);
             DEQ_INSERT_TAIL(pool->free_list, item);
-#if QD_MEMORY_STATS
-            desc->stats->held_by_threads++;
-            desc->stats->total_alloc_from_heap++;
-#endif
+            POOL_STAT(pool, held_by_threads, 1);
+            POOL_STAT(pool, total_alloc_from_heap, 1);
         }
     }
-    sys_mutex_unlock(desc->lock);
 
     item = DEQ_HEAD(pool->free_list);
     if (item) {
@@ -223,20 +353,7 @@ void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p)
     item->desc = 0;
 #endif
 
-    //
-    // If this is the thread's first pass through here, allocate the
-    // thread-local pool for this type.
-    //
-    if (*tpool == 0) {
-        *tpool = NEW(qd_alloc_pool_t);
-        DEQ_ITEM_INIT(*tpool);
-        DEQ_INIT((*tpool)->free_list);
-        sys_mutex_lock(desc->lock);
-        DEQ_INSERT_TAIL(desc->tpool_list, *tpool);
-        sys_mutex_unlock(desc->lock);
-    }
-
-    qd_alloc_pool_t *pool = *tpool;
+    qd_alloc_pool_t *pool = qd_alloc_pool(desc, tpool);
 
     DEQ_INSERT_TAIL(pool->free_list, item);
 
@@ -244,36 +361,64 @@ void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p)
         return;
 
     //
-    // We've exceeded the maximum size of the local free list.  A batch must be
-    // rebalanced back to the global list.
+    // We've exceeded the maximum size of the local free list.  A batch is
+    // cut from the head of the list and handed to the depot.
     //
-    sys_mutex_lock(desc->lock);
-#if QD_MEMORY_STATS
-    desc->stats->batches_rebalanced_to_global++;
-    desc->stats->held_by_threads -= desc->config->transfer_batch_size;
-#endif
-    for (idx = 0; idx < desc->config->transfer_batch_size; idx++) {
-        item = DEQ_HEAD(pool->free_list);
-        DEQ_REMOVE_HEAD(pool->free_list);
-        DEQ_INSERT_TAIL(desc->global_pool->free_list, item);
+    qd_alloc_item_t *batch = DEQ_HEAD(pool->free_list);
+    item = batch;
+    for (idx = 1; idx < desc->config->transfer_batch_size; idx++)
+        item = DEQ_NEXT(item);
+
+    pool->free_list.head = DEQ_NEXT(item);
+    if (pool->free_list.head)
+        DEQ_PREV(pool->free_list.head) = 0;
+    else
+        pool->free_list.tail = 0;
+    pool->free_list.size -= desc->config->transfer_batch_size;
+    DEQ_NEXT(item) = 0;
+
+    POOL_STAT(pool, batches_rebalanced_to_global, 1);
+    POOL_STAT(pool, held_by_threads, -desc->config->transfer_batch_size);
+    if (!qd_alloc_depot_put(desc, pool, batch)) {
+        //
+        // The depot is at its size limit, return the batch to the heap.
+        //
+        qd_alloc_free_batch(batch);
+        POOL_STAT(pool, total_free_to_heap, desc->config->transfer_batch_size);
     }
+}
+
+
+qd_alloc_stats_t *qd_alloc_stats(qd_alloc_type_desc_t *desc)
+{
+#if QD_MEMORY_STATS
+    if (!desc->stats)
+        return 0;
 
     //
-    // If there's a global_free_list size limit, remove items until the limit is
-    // not exceeded.
+    // Each thread pool keeps its own counters.  Sum them into the type's statistics.
+    // The counters are read without synchronization, the result is a snapshot.
     //
-    if (desc->config->global_free_list_max != 0) {
-        while (DEQ_SIZE(desc->global_pool->free_list) > desc->config->global_free_list_max) {
-            item = DEQ_HEAD(desc->global_pool->free_list);
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
-            free(item);
-#if QD_MEMORY_STATS
-            desc->stats->total_free_to_heap++;
-#endif
-        }
-    }
+    qd_alloc_stats_t sum;
+    memset(&sum, 0, sizeof(sum));
 
+    sys_mutex_lock(desc->lock);
+    qd_alloc_pool_t *pool = DEQ_HEAD(desc->tpool_list);
+    while (pool) {
+        sum.total_alloc_from_heap         += pool->stats.total_alloc_from_heap;
+        sum.total_free_to_heap            += pool->stats.total_free_to_heap;
+        sum.held_by_threads               += pool->stats.held_by_threads;
+        sum.batches_rebalanced_to_threads += pool->stats.batches_rebalanced_to_threads;
+        sum.batches_rebalanced_to_global  += pool->stats.batches_rebalanced_to_global;
+        pool = DEQ_NEXT(pool);
+    }
+    *desc->stats = sum;
     sys_mutex_unlock(desc->lock);
+
+    return desc->stats;
+#else
+    return 0;
+#endif
 }
 
 
@@ -314,19 +459,31 @@ void qd_alloc_finalize(void)
         qd_alloc_type_desc_t *desc = type_item->desc;
 
         //
-        // Reclaim the items on the global free pool
+        // Snapshot the per-thread statistics before the thread pools are released.
+        //
+        qd_alloc_stats(desc);
+
         //
-        item = DEQ_HEAD(desc->global_pool->free_list);
-        while (item) {
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
-            free(item);
+        // Reclaim the batches in the depot
+        //
+        qd_alloc_depot_t *depot = desc->depot;
+        for (int i = 0; i < QD_ALLOC_DEPOT_SLOTS; i++) {
+#if QD_MEMORY_STATS
+            if (depot->slots[i])
+                desc->stats->total_free_to_heap += desc->config->transfer_batch_size;
+#endif
+            qd_alloc_free_batch(depot->slots[i]);
+        }
+        while (depot->overflow) {
+            qd_alloc_item_t *batch = depot->overflow;
+            depot->overflow = BATCH_NEXT(batch);
+            qd_alloc_free_batch(batch);
 #if QD_MEMORY_STATS
-            desc->stats->total_free_to_heap++;
+            desc->stats->total_free_to_heap += desc->config->transfer_batch_size;
 #endif
-            item = DEQ_HEAD(desc->global_pool->free_list);
         }
-        free(desc->global_pool);
-        desc->global_pool = 0;
+        free(depot);
+        desc->depot = 0;
 
         //
         // Reclaim the items on thread pools
@@ -381,6 +538,9 @@ void qd_alloc_finalize(void)
 
 qd_error_t qd_entity_refresh_allocator(qd_entity_t* entity, void *impl) {
     qd_alloc_type_t *alloc_type = (qd_alloc_type_t*) impl;
+#if QD_MEMORY_STATS
+    qd_alloc_stats(alloc_type->desc);
+#endif
     if (qd_entity_set_string(entity, "typeName", alloc_type->desc->type_name) == 0 &&
         qd_entity_set_long(entity, "typeSize", alloc_type->desc->total_size) == 0 &&
         qd_entity_set_long(entity, "transferBatchSize", alloc_type->desc->config->transfer_batch_size) == 0 &&
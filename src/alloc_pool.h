@@ -36,6 +36,9 @@
 /** Allocation pool */
 typedef struct qd_alloc_pool_t qd_alloc_pool_t;
 
+/** Depot of full batches shared by the threads */
+typedef struct qd_alloc_depot_t qd_alloc_depot_t;
+
 DEQ_DECLARE(qd_alloc_pool_t, qd_alloc_pool_list_t);
 
 /** Allocation configuration. */
@@ -45,7 +48,7 @@ typedef struct {
     int  global_free_list_max;
 } qd_alloc_config_t;
 
-/** Allocation statistics. */
+/** Allocation statistics.  Counted per thread and summed by qd_alloc_stats. */
 typedef struct {
     uint64_t total_alloc_from_heap;
     uint64_t total_free_to_heap;
@@ -63,7 +66,7 @@ typedef struct {
     size_t                total_size;
     qd_alloc_config_t    *config;
     qd_alloc_stats_t     *stats           __attribute__((aligned(64)));
-    qd_alloc_pool_t      *global_pool;
+    qd_alloc_depot_t     *depot;
     sys_mutex_t          *lock;
     qd_alloc_pool_list_t  tpool_list;
     uint32_t              trailer;
@@ -73,6 +76,8 @@ typedef struct {
 void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool);
 /** De-allocate from a thread pool. Use via ALLOC_DECLARE */
 void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p);
+/** Sum the per-thread statistics for a type.  Use via alloc_stats_T */
+qd_alloc_stats_t *qd_alloc_stats(qd_alloc_type_desc_t *desc);
 
 /**
  * Declare functions new_T and alloc_T
@@ -91,7 +96,7 @@ void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p);
     __thread qd_alloc_pool_t *__local_pool_##T = 0;                     \
     T *new_##T(void) { return (T*) qd_alloc(&__desc_##T, &__local_pool_##T); }  \
     void free_##T(T *p) { qd_dealloc(&__desc_##T, &__local_pool_##T, (void*) p); } \
-    qd_alloc_stats_t *alloc_stats_##T(void) { return __desc_##T.stats; }
+    qd_alloc_stats_t *alloc_stats_##T(void) { return qd_alloc_stats(&__desc_##T); }
 
 /**
  * Define functions new_T and alloc_T
@@ -24,17 +24,27 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
-#define QD_BITMASK_LONGS 2
-#define QD_BITMASK_BITS  (QD_BITMASK_LONGS * 64)
+//
+// The width of all bitmasks is fixed at startup, before the first bitmask is
+// allocated.  The words are stored after the structure, sized by the allocator.
+//
+#define QD_BITMASK_DEFAULT_BITS 128
+
+static int    bitmask_longs = QD_BITMASK_DEFAULT_BITS / 64;
+static size_t bitmask_array_size = (QD_BITMASK_DEFAULT_BITS / 64) * sizeof(uint64_t);
+static int    width_locked = 0;
+
+#define QD_BITMASK_LONGS bitmask_longs
+#define QD_BITMASK_BITS  (bitmask_longs * 64)
 
 struct qd_bitmask_t {
-    uint64_t array[QD_BITMASK_LONGS];
     int      first_set;
     int      cardinality;
+    uint64_t array[];
 };
 
 ALLOC_DECLARE(qd_bitmask_t);
-ALLOC_DEFINE(qd_bitmask_t);
+ALLOC_DEFINE_CONFIG(qd_bitmask_t, sizeof(qd_bitmask_t), &bitmask_array_size, 0);
 
 #define MASK_INDEX(num)  (num / 64)
 #define MASK_ONEHOT(num) (((uint64_t) 1) << (num % 64))
@@ -42,6 +52,22 @@ ALLOC_DEFINE(qd_bitmask_t);
 #define FIRST_UNKNOWN -2
 
 
+qd_error_t qd_bitmask_set_width(int width)
+{
+    if (width < 64)
+        width = 64;
+    int longs = (width + 63) / 64;
+    if (longs == bitmask_longs)
+        return QD_ERROR_NONE;
+    if (width_locked)
+        return qd_error(QD_ERROR_CONFIG, "Bitmask width can't change to %d after bitmasks are in use", width);
+
+    bitmask_longs      = longs;
+    bitmask_array_size = bitmask_longs * sizeof(uint64_t);
+    return QD_ERROR_NONE;
+}
+
+
 int qd_bitmask_width()
 {
     return QD_BITMASK_BITS;
@@ -50,6 +76,7 @@ int qd_bitmask_width()
 
 qd_bitmask_t *qd_bitmask(int initial)
 {
+    width_locked = 1;
     qd_bitmask_t *b = new_qd_bitmask_t();
     if (initial)
         qd_bitmask_set_all(b);
@@ -94,7 +121,7 @@ int qd_bitmask_set_bit(qd_bitmask_t *b, int bitnum)
     }
 
     b->array[MASK_INDEX(bitnum)] |= MASK_ONEHOT(bitnum);
-    if (b->first_set > bitnum || b->first_set < 0)
+    if (b->first_set == FIRST_NONE || b->first_set > bitnum)
         b->first_set = bitnum;
 
     return old_value;
@@ -130,11 +157,7 @@ int qd_bitmask_first_set(qd_bitmask_t *b, int *bitnum)
         b->first_set = FIRST_NONE;
         for (int i = 0; i < QD_BITMASK_LONGS; i++)
             if (b->array[i]) {
-                for (int j = 0; j < 64; j++)
-                    if ((((uint64_t) 1) << j) & b->array[i]) {
-                        b->first_set = i * 64 + j;
-                        break;
-                    }
+                b->first_set = i * 64 + __builtin_ctzll(b->array[i]);
                 break;
             }
     }
@@ -163,30 +186,25 @@ int _qdbm_start(qd_bitmask_t *b)
 
 void _qdbm_next(qd_bitmask_t *b, int *v)
 {
-    if (*v == QD_BITMASK_BITS - 1) {
+    int next = *v + 1;
+    if (next >= QD_BITMASK_BITS) {
         *v = -1;
         return;
     }
 
-    int      idx  = MASK_INDEX(*v);
-    uint64_t bits = MASK_ONEHOT(*v);
-    int      next = *v;
-
-    while (1) {
-        next++;
-        if (bits & 0x8000000000000000LL) {
-            if (++idx == QD_BITMASK_LONGS) {
-                *v = -1;
-                return;
-            }
-            bits = 1;
-        } else
-            bits = bits << 1;
+    //
+    // Look at the rest of the current word, then skip whole empty words.
+    //
+    int      idx  = MASK_INDEX(next);
+    uint64_t word = b->array[idx] & (~((uint64_t) 0) << (next % 64));
 
-        if (b->array[idx] & bits) {
-            *v = next;
+    while (!word) {
+        if (++idx == QD_BITMASK_LONGS) {
+            *v = -1;
             return;
         }
+        word = b->array[idx];
     }
-}
 
+    *v = idx * 64 + __builtin_ctzll(word);
+}
@@ -24,17 +24,40 @@
 #include <string.h>
 
 
-static size_t buffer_size = 512;
-static int    size_locked = 0;
+//
+// Buffers come in three size classes, each with its own allocation pool.  The medium and
+// large classes are fixed multiples of the configured buffer size.
+//
+#define MEDIUM_FACTOR 8
+#define LARGE_FACTOR  128
+
+static size_t buffer_size        = 512;
+static size_t buffer_size_medium = 512 * MEDIUM_FACTOR;
+static size_t buffer_size_large  = 512 * LARGE_FACTOR;
+static int    size_locked        = 0;
+
+typedef qd_buffer_t qd_buffer_medium_t;
+typedef qd_buffer_t qd_buffer_large_t;
+
+//
+// Keep fewer large buffers cached per thread; each one is 128 small buffers' worth.
+//
+static qd_alloc_config_t large_config = {4, 8, 0};
 
 ALLOC_DECLARE(qd_buffer_t);
 ALLOC_DEFINE_CONFIG(qd_buffer_t, sizeof(qd_buffer_t), &buffer_size, 0);
+ALLOC_DECLARE(qd_buffer_medium_t);
+ALLOC_DEFINE_CONFIG(qd_buffer_medium_t, sizeof(qd_buffer_t), &buffer_size_medium, 0);
+ALLOC_DECLARE(qd_buffer_large_t);
+ALLOC_DEFINE_CONFIG(qd_buffer_large_t, sizeof(qd_buffer_t), &buffer_size_large, &large_config);
 
 
 void qd_buffer_set_size(size_t size)
 {
     assert(!size_locked);
-    buffer_size = size;
+    buffer_size        = size;
+    buffer_size_medium = size * MEDIUM_FACTOR;
+    buffer_size_large  = size * LARGE_FACTOR;
 }
 
 
@@ -44,7 +67,32 @@ qd_buffer_t *qd_buffer(void)
     qd_buffer_t *buf = new_qd_buffer_t();
 
     DEQ_ITEM_INIT(buf);
-    buf->size = 0;
+    buf->size     = 0;
+    buf->capacity = buffer_size;
+    return buf;
+}
+
+
+qd_buffer_t *qd_buffer_sized(size_t size)
+{
+    qd_buffer_t *buf;
+    size_t       capacity;
+
+    size_locked = 1;
+    if (size >= buffer_size_large) {
+        buf      = new_qd_buffer_large_t();
+        capacity = buffer_size_large;
+    } else if (size >= buffer_size_medium) {
+        buf      = new_qd_buffer_medium_t();
+        capacity = buffer_size_medium;
+    } else {
+        buf      = new_qd_buffer_t();
+        capacity = buffer_size;
+    }
+
+    DEQ_ITEM_INIT(buf);
+    buf->size     = 0;
+    buf->capacity = capacity;
     return buf;
 }
 
@@ -52,7 +100,12 @@ qd_buffer_t *qd_buffer(void)
 void qd_buffer_free(qd_buffer_t *buf)
 {
     if (!buf) return;
-    free_qd_buffer_t(buf);
+    if (buf->capacity == buffer_size)
+        free_qd_buffer_t(buf);
+    else if (buf->capacity == buffer_size_medium)
+        free_qd_buffer_medium_t(buf);
+    else
+        free_qd_buffer_large_t(buf);
 }
 
 
@@ -70,7 +123,7 @@ unsigned char *qd_buffer_cursor(qd_buffer_t *buf)
 
 size_t qd_buffer_capacity(qd_buffer_t *buf)
 {
-    return buffer_size - buf->size;
+    return buf->capacity - buf->size;
 }
 
 
@@ -83,7 +136,7 @@ size_t qd_buffer_size(qd_buffer_t *buf)
 void qd_buffer_insert(qd_buffer_t *buf, size_t len)
 {
     buf->size += len;
-    assert(buf->size <= buffer_size);
+    assert(buf->size <= buf->capacity);
 }
 
 unsigned int qd_buffer_list_clone(qd_buffer_list_t *dst, const qd_buffer_list_t *src)
@@ -96,10 +149,10 @@ unsigned int qd_buffer_list_clone(qd_buffer_list_t *dst, const qd_buffer_list_t
         unsigned char *src = qd_buffer_base(buf);
         len += to_copy;
         while (to_copy) {
-            qd_buffer_t *newbuf = qd_buffer();
+            qd_buffer_t *newbuf = qd_buffer_sized(to_copy);
             size_t count = qd_buffer_capacity(newbuf);
-            // default buffer capacity may have changed,
-            // so don't assume it will fit:
+            // the source buffer may be larger than any buffer
+            // of the chosen class, so don't assume it will fit:
             if (count > to_copy) count = to_copy;
             memcpy(qd_buffer_cursor(newbuf), src, count);
             qd_buffer_insert(newbuf, count);
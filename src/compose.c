@@ -28,6 +28,13 @@
 ALLOC_DEFINE(qd_composite_t);
 ALLOC_DEFINE(qd_composed_field_t);
 
+#define SYM8_FRAGMENT(text) { (const uint8_t*) text, sizeof(text) - 1 }
+
+const qd_composed_fragment_t QD_MA_INGRESS_KEY = SYM8_FRAGMENT("\xa3\x10" "x-opt-qd.ingress");
+const qd_composed_fragment_t QD_MA_TRACE_KEY   = SYM8_FRAGMENT("\xa3\x0e" "x-opt-qd.trace");
+const qd_composed_fragment_t QD_MA_TO_KEY      = SYM8_FRAGMENT("\xa3\x0b" "x-opt-qd.to");
+const qd_composed_fragment_t QD_MA_PHASE_KEY   = SYM8_FRAGMENT("\xa3\x0e" "x-opt-qd.phase");
+
 
 static void bump_count(qd_composed_field_t *field)
 {
@@ -71,6 +78,31 @@ static void qd_insert(qd_composed_field_t *field, const uint8_t *seq, size_t len
 }
 
 
+//
+// Copy the rest of an iterator's view into the field, straight into the free space of
+// the tail buffer.
+//
+static void qd_insert_iterator(qd_composed_field_t *field, qd_iterator_t *iter)
+{
+    qd_buffer_t    *buf  = DEQ_TAIL(field->buffers);
+    qd_composite_t *comp = DEQ_HEAD(field->fieldStack);
+
+    while (!qd_iterator_end(iter)) {
+        if (buf == 0 || qd_buffer_capacity(buf) == 0) {
+            buf = qd_buffer();
+            if (buf == 0)
+                return;
+            DEQ_INSERT_TAIL(field->buffers, buf);
+        }
+
+        uint32_t copied = qd_iterator_ncopy_octets(iter, qd_buffer_cursor(buf), qd_buffer_capacity(buf));
+        qd_buffer_insert(buf, copied);
+        if (comp)
+            comp->length += copied;
+    }
+}
+
+
 static void qd_insert_8(qd_composed_field_t *field, uint8_t value)
 {
     qd_insert(field, &value, 1);
@@ -470,10 +502,7 @@ void qd_compose_insert_string_iterator(qd_composed_field_t *field, qd_iterator_t
         qd_insert_32(field, len);
     }
 
-    while (!qd_iterator_end(iter)) {
-        uint8_t octet = qd_iterator_octet(iter);
-        qd_insert_8(field, octet);
-    }
+    qd_insert_iterator(field, iter);
 
     bump_count(field);
 }
@@ -497,15 +526,58 @@ void qd_compose_insert_symbol(qd_composed_field_t *field, const char *value)
 
 void qd_compose_insert_typed_iterator(qd_composed_field_t *field, qd_iterator_t *iter)
 {
-    while (!qd_iterator_end(iter)) {
-        uint8_t octet = qd_iterator_octet(iter);
-        qd_insert_8(field, octet);
-    }
+    qd_insert_iterator(field, iter);
+    bump_count(field);
+}
+
 
+void qd_compose_insert_encoded_iterator(qd_composed_field_t *field, qd_iterator_t *iter, uint32_t count)
+{
+    qd_iterator_reset(iter);
+    qd_insert_iterator(field, iter);
+
+    qd_composite_t *comp = DEQ_HEAD(field->fieldStack);
+    if (comp)
+        comp->count += count;
+}
+
+
+void qd_compose_insert_fragment(qd_composed_field_t *field, const qd_composed_fragment_t *fragment)
+{
+    qd_insert(field, fragment->encoded, fragment->length);
     bump_count(field);
 }
 
 
+void qd_compose_take_fragment(qd_composed_field_t *field, qd_composed_fragment_t *fragment)
+{
+    assert(DEQ_SIZE(field->fieldStack) == 0);
+    uint32_t  length  = qd_buffer_list_length(&field->buffers);
+    uint8_t  *encoded = (uint8_t*) malloc(length);
+    uint8_t  *cursor  = encoded;
+
+    qd_buffer_t *buf = DEQ_HEAD(field->buffers);
+    while (buf) {
+        DEQ_REMOVE_HEAD(field->buffers);
+        memcpy(cursor, qd_buffer_base(buf), qd_buffer_size(buf));
+        cursor += qd_buffer_size(buf);
+        qd_buffer_free(buf);
+        buf = DEQ_HEAD(field->buffers);
+    }
+
+    fragment->encoded = encoded;
+    fragment->length  = length;
+}
+
+
+void qd_compose_free_fragment(qd_composed_fragment_t *fragment)
+{
+    free((void*) fragment->encoded);
+    fragment->encoded = 0;
+    fragment->length  = 0;
+}
+
+
 qd_buffer_list_t *qd_compose_buffers(qd_composed_field_t *field)
 {
     return &field->buffers;
@@ -411,7 +411,18 @@ qd_error_t qd_entity_refresh_listener(qd_entity_t* entity, void *impl)
 
 qd_error_t qd_entity_refresh_connector(qd_entity_t* entity, void *impl)
 {
-    return QD_ERROR_NONE;
+    qd_config_connector_t *cc    = (qd_config_connector_t*) impl;
+    qd_connector_stats_t   stats = {0, 0, 0, 0};
+
+    if (cc->connector)
+        qd_connector_get_stats(cc->connector, &stats);
+
+    if (qd_entity_set_long(entity, "connectAttempts", stats.connect_attempts) == 0 &&
+        qd_entity_set_long(entity, "connectFailures", stats.connect_failures) == 0 &&
+        qd_entity_set_long(entity, "resolveFailures", stats.resolve_failures) == 0 &&
+        qd_entity_set_long(entity, "connectionsOpened", stats.connections_opened) == 0)
+        return QD_ERROR_NONE;
+    return qd_error_code();
 }
 
 
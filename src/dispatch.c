@@ -39,7 +39,7 @@
 /**
  * Private Function Prototypes
  */
-qd_server_t    *qd_server(qd_dispatch_t *qd, int tc, const char *container_name,
+qd_server_t    *qd_server(qd_dispatch_t *qd, int tc, int lc, const char *container_name,
                           const char *sasl_config_path, const char *sasl_config_name);
 void            qd_server_free(qd_server_t *server);
 qd_container_t *qd_container(qd_dispatch_t *qd);
@@ -173,6 +173,13 @@ qd_error_t qd_dispatch_configure_router(qd_dispatch_t *qd, qd_entity_t *entity)
     assert(qd->router_id);
     qd->router_mode = qd_entity_get_long(entity, "mode"); QD_ERROR_RET();
     qd->thread_count = qd_entity_opt_long(entity, "workerThreads", 4); QD_ERROR_RET();
+    qd->loop_count = qd_entity_opt_long(entity, "eventLoops", 1); QD_ERROR_RET();
+    long max_routers = qd_entity_opt_long(entity, "maxRouters", 128); QD_ERROR_RET();
+    qd_bitmask_set_width(max_routers); QD_ERROR_RET();
+    qd->presettled_drop = qd_entity_opt_long(entity, "presettledDropPolicy", QDR_PRESETTLED_DROP_FLUSH); QD_ERROR_RET();
+    qd->presettled_drop_count = qd_entity_opt_long(entity, "presettledDropCount", 1); QD_ERROR_RET();
+    if (qd->presettled_drop_count < 1)
+        return qd_error(QD_ERROR_CONFIG, "presettledDropCount must be at least 1, not %d", qd->presettled_drop_count);
 
     if (! qd->sasl_config_path) {
         qd->sasl_config_path = qd_entity_opt_string(entity, "saslConfigPath", 0); QD_ERROR_RET();
@@ -267,7 +274,7 @@ void qd_dispatch_policy_c_counts_refresh(long ccounts, qd_entity_t *entity)
 
 qd_error_t qd_dispatch_prepare(qd_dispatch_t *qd)
 {
-    qd->server             = qd_server(qd, qd->thread_count, qd->router_id, qd->sasl_config_path, qd->sasl_config_name);
+    qd->server             = qd_server(qd, qd->thread_count, qd->loop_count, qd->router_id, qd->sasl_config_path, qd->sasl_config_name);
     qd->container          = qd_container(qd);
     qd->router             = qd_router(qd, qd->router_mode, qd->router_area, qd->router_id);
     qd->connection_manager = qd_connection_manager(qd);
@@ -308,6 +315,7 @@ void qd_dispatch_free(qd_dispatch_t *qd)
     qd_router_free(qd->router);
     qd_container_free(qd->container);
     qd_server_free(qd->server);
+    qd_message_finalize();
     qd_log_finalize();
     qd_alloc_finalize();
     qd_python_finalize();
@@ -54,11 +54,14 @@ struct qd_dispatch_t {
     void                    *dl_handle;
 
     int    thread_count;
+    int    loop_count;
     char  *sasl_config_path;
     char  *sasl_config_name;
     char  *router_area;
     char  *router_id;
     qd_router_mode_t  router_mode;
+    qdr_presettled_drop_t presettled_drop;
+    int    presettled_drop_count;
 };
 
 /**
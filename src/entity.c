@@ -168,7 +168,7 @@ qd_error_t qd_entity_set_map(qd_entity_t *entity, const char *attribute) {
     return qd_entity_set_py(entity, attribute, PyDict_New());
 }
 
-qd_error_t qd_entity_set_map_key_value_int(qd_entity_t *entity, const char *attribute, const char *key, int value)
+qd_error_t qd_entity_set_map_key_value_long(qd_entity_t *entity, const char *attribute, const char *key, long value)
 {
     if (!key)
         return  QD_ERROR_VALUE;
@@ -194,6 +194,11 @@ qd_error_t qd_entity_set_map_key_value_int(qd_entity_t *entity, const char *attr
     return ret;
 }
 
+qd_error_t qd_entity_set_map_key_value_int(qd_entity_t *entity, const char *attribute, const char *key, int value)
+{
+    return qd_entity_set_map_key_value_long(entity, attribute, key, (long) value);
+}
+
 qd_error_t qd_entity_set_map_key_value_string(qd_entity_t *entity, const char *attribute, const char *key, const char *value)
 {
     if (!key)
@@ -112,6 +112,8 @@ qd_error_t qd_entity_set_map_key_value_string(qd_entity_t *entity, const char *a
 
 qd_error_t qd_entity_set_map_key_value_int(qd_entity_t *entity, const char *attribute, const char *key, int value);
 
+qd_error_t qd_entity_set_map_key_value_long(qd_entity_t *entity, const char *attribute, const char *key, long value);
+
 
 /// @}
 
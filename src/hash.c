@@ -16,38 +16,58 @@
  * specific language governing permissions and limitations
  * under the License.
  */
-
-
-
 #include <stdio.h>
 #include <string.h>
 #include "alloc.h"
 #include <qpid/dispatch/hash.h>
 #include <qpid/dispatch/ctools.h>
 
+//
+// The table is open-addressed with linear probing.  Each slot holds the full hash of its
+// key next to the item pointer, so a probe only touches an item when the hashes match.
+// Items are allocated separately so that handles and key pointers stay valid while the
+// table moves its slots around.  Short keys are stored inside the item.
+//
+// The table doubles when it becomes three-quarters full.  Rather than rehashing all at
+// once, the previous table is kept and a few of its slots are moved into the new table on
+// each insert or remove.  Lookups look in both tables until the move is finished.  Nothing
+// is inserted into the previous table, so moves and removals there leave a tombstone.
+//
+#define QD_HASH_INLINE_KEY    40
+#define QD_HASH_MIN_EXPONENT  3
+#define QD_HASH_MIGRATE_SLOTS 16
+
 typedef struct qd_hash_item_t {
-    DEQ_LINKS(struct qd_hash_item_t);
+    uint32_t       hash;
     unsigned char *key;
     union {
         void       *val;
         const void *val_const;
     } v;
+    unsigned char  inline_key[QD_HASH_INLINE_KEY];
 } qd_hash_item_t;
 
 ALLOC_DECLARE(qd_hash_item_t);
 ALLOC_DEFINE(qd_hash_item_t);
-DEQ_DECLARE(qd_hash_item_t, items_t);
 
 
-typedef struct bucket_t {
-    items_t items;
-} bucket_t;
+typedef struct slot_t {
+    uint32_t        hash;
+    qd_hash_item_t *item;
+} slot_t;
+
+
+typedef struct table_t {
+    slot_t   *slots;
+    uint32_t  mask;
+    int       exponent;
+} table_t;
 
 
 struct qd_hash_t {
-    bucket_t     *buckets;
-    unsigned int  bucket_count;
-    unsigned int  bucket_mask;
+    table_t       table;       // The current table; all inserts go here
+    table_t       old;         // The previous table while its items are being moved
+    uint32_t      migrate_pos; // The next slot of the previous table to be moved
     int           batch_size;
     size_t        size;
     int           is_const;
@@ -55,61 +75,218 @@ struct qd_hash_t {
 
 
 struct qd_hash_handle_t {
-    bucket_t    *bucket;
     qd_hash_item_t *item;
 };
 
 ALLOC_DECLARE(qd_hash_handle_t);
 ALLOC_DEFINE(qd_hash_handle_t);
 
+static qd_hash_item_t tombstone;
+#define TOMBSTONE (&tombstone)
+
+
+static inline uint32_t slot_home(const table_t *t, uint32_t hash)
+{
+    //
+    // Fibonacci hashing spreads the high bits of the hash over the index, so keys with
+    // similar hashes don't end up in the same run of slots.
+    //
+    return (hash * 2654435769u) >> (32 - t->exponent);
+}
+
+
+static void table_init(table_t *t, int exponent)
+{
+    t->exponent = exponent;
+    t->mask     = (1u << exponent) - 1;
+    t->slots    = NEW_ARRAY(slot_t, 1u << exponent);
+    memset(t->slots, 0, sizeof(slot_t) << exponent);
+}
+
+
+static inline uint32_t table_capacity(const table_t *t)
+{
+    return t->mask + 1;
+}
+
+
+//
+// Find the slot holding key, or return -1.
+//
+static long table_find(const table_t *t, uint32_t hash, qd_iterator_t *key)
+{
+    uint32_t idx = slot_home(t, hash);
+
+    while (1) {
+        const slot_t *slot = &t->slots[idx];
+        if (!slot->item)
+            return -1;
+        if (slot->hash == hash && slot->item != TOMBSTONE && qd_iterator_equal(key, slot->item->key))
+            return idx;
+        idx = (idx + 1) & t->mask;
+    }
+}
+
+
+//
+// Find the slot holding item, or return -1.
+//
+static long table_find_item(const table_t *t, const qd_hash_item_t *item)
+{
+    uint32_t idx = slot_home(t, item->hash);
+
+    while (1) {
+        const slot_t *slot = &t->slots[idx];
+        if (!slot->item)
+            return -1;
+        if (slot->item == item)
+            return idx;
+        idx = (idx + 1) & t->mask;
+    }
+}
+
+
+static void table_place(table_t *t, uint32_t hash, qd_hash_item_t *item)
+{
+    uint32_t idx = slot_home(t, hash);
+    while (t->slots[idx].item)
+        idx = (idx + 1) & t->mask;
+    t->slots[idx].hash = hash;
+    t->slots[idx].item = item;
+}
+
+
+//
+// Empty a slot of the current table.  The items after it in the same run are shifted
+// back so that no tombstone is needed.
+//
+static void table_remove_at(table_t *t, uint32_t idx)
+{
+    uint32_t hole = idx;
+    uint32_t next = idx;
+
+    while (1) {
+        next = (next + 1) & t->mask;
+        if (!t->slots[next].item)
+            break;
+
+        //
+        // The item at 'next' may fill the hole only if its home slot is not in the
+        // (cyclic) range between the hole and 'next'.
+        //
+        uint32_t home = slot_home(t, t->slots[next].hash);
+        if (((next - home) & t->mask) >= ((next - hole) & t->mask)) {
+            t->slots[hole] = t->slots[next];
+            hole = next;
+        }
+    }
+
+    t->slots[hole].item = 0;
+}
+
+
+//
+// Move up to 'count' slots of the previous table into the current table.
+//
+static void qd_hash_migrate(qd_hash_t *h, uint32_t count)
+{
+    if (!h->old.slots)
+        return;
+
+    uint32_t capacity = table_capacity(&h->old);
+    while (count-- > 0 && h->migrate_pos < capacity) {
+        slot_t *slot = &h->old.slots[h->migrate_pos++];
+        if (slot->item && slot->item != TOMBSTONE) {
+            table_place(&h->table, slot->hash, slot->item);
+            slot->item = TOMBSTONE;
+        }
+    }
+
+    if (h->migrate_pos == capacity) {
+        free(h->old.slots);
+        h->old.slots = 0;
+    }
+}
+
+
+//
+// Double the table if the next insert would take it past three-quarters full.
+//
+static void qd_hash_grow(qd_hash_t *h)
+{
+    if (h->size + 1 <= (table_capacity(&h->table) / 4) * 3)
+        return;
+
+    //
+    // Growth runs ahead of the incremental move only if the table is being filled much
+    // faster than it is modified; finish the move before starting another.
+    //
+    if (h->old.slots)
+        qd_hash_migrate(h, table_capacity(&h->old));
+
+    h->old         = h->table;
+    h->migrate_pos = 0;
+    table_init(&h->table, h->old.exponent + 1);
+}
+
 
 qd_hash_t *qd_hash(int bucket_exponent, int batch_size, int value_is_const)
 {
-    int i;
     qd_hash_t *h = NEW(qd_hash_t);
 
     if (!h)
         return 0;
 
-    h->bucket_count = 1 << bucket_exponent;
-    h->bucket_mask  = h->bucket_count - 1;
-    h->batch_size   = batch_size;
-    h->size         = 0;
-    h->is_const     = value_is_const;
-    h->buckets = NEW_ARRAY(bucket_t, h->bucket_count);
-    for (i = 0; i < h->bucket_count; i++) {
-        DEQ_INIT(h->buckets[i].items);
-    }
+    if (bucket_exponent < QD_HASH_MIN_EXPONENT)
+        bucket_exponent = QD_HASH_MIN_EXPONENT;
+
+    table_init(&h->table, bucket_exponent);
+    h->old.slots   = 0;
+    h->migrate_pos = 0;
+    h->batch_size  = batch_size;
+    h->size        = 0;
+    h->is_const    = value_is_const;
 
     return h;
 }
 
-//remove the given item from the given bucket of the given hash
-//return the key if non-null key pointer given, otherwise, free the memory
-static void qd_hash_internal_remove_item(qd_hash_t *h, bucket_t *bucket, qd_hash_item_t *item, unsigned char **key) {
-    if (key)
-        *key = item->key;
-    else
+
+static void qd_hash_item_free(qd_hash_item_t *item, unsigned char **key)
+{
+    if (key) {
+        if (item->key == item->inline_key) {
+            size_t length = strlen((const char*) item->key) + 1;
+            *key = (unsigned char*) malloc(length);
+            memcpy(*key, item->key, length);
+        } else
+            *key = item->key;
+    } else if (item->key != item->inline_key)
         free(item->key);
-    DEQ_REMOVE(bucket->items, item);
     free_qd_hash_item_t(item);
-    h->size--;
 }
 
+
+static void table_free_items(table_t *t)
+{
+    if (!t->slots)
+        return;
+
+    for (uint32_t idx = 0; idx < table_capacity(t); idx++) {
+        qd_hash_item_t *item = t->slots[idx].item;
+        if (item && item != TOMBSTONE)
+            qd_hash_item_free(item, 0);
+    }
+    free(t->slots);
+    t->slots = 0;
+}
+
+
 void qd_hash_free(qd_hash_t *h)
 {
     if (!h) return;
-    qd_hash_item_t *item;
-    int             idx;
 
-    for (idx = 0; idx < h->bucket_count; idx++) {
-        item = DEQ_HEAD(h->buckets[idx].items);
-        while (item) {
-            qd_hash_internal_remove_item(h, &h->buckets[idx], item, 0);
-            item = DEQ_HEAD(h->buckets[idx].items);
-        }
-    }
-    free(h->buckets);
+    table_free_items(&h->old);
+    table_free_items(&h->table);
     free(h);
 }
 
@@ -120,17 +297,34 @@ size_t qd_hash_size(qd_hash_t *h)
 }
 
 
-static qd_hash_item_t *qd_hash_internal_insert(qd_hash_t *h, qd_iterator_t *key, int *exists, qd_hash_handle_t **handle)
+static qd_hash_item_t *qd_hash_internal_retrieve_with_hash(qd_hash_t *h, uint32_t hash, qd_iterator_t *key)
 {
-    unsigned long   idx  = qd_iterator_hash_view(key) & h->bucket_mask;
-    qd_hash_item_t *item = DEQ_HEAD(h->buckets[idx].items);
-
-    while (item) {
-        if (qd_iterator_equal(key, item->key))
-            break;
-        item = DEQ_NEXT(item);
+    long idx = table_find(&h->table, hash, key);
+    if (idx >= 0)
+        return h->table.slots[idx].item;
+
+    if (h->old.slots) {
+        idx = table_find(&h->old, hash, key);
+        if (idx >= 0)
+            return h->old.slots[idx].item;
     }
 
+    return 0;
+}
+
+
+static qd_hash_item_t *qd_hash_internal_retrieve(qd_hash_t *h, qd_iterator_t *key)
+{
+    uint32_t hash = qd_iterator_hash_view(key);
+    return qd_hash_internal_retrieve_with_hash(h, hash, key);
+}
+
+
+static qd_hash_item_t *qd_hash_internal_insert(qd_hash_t *h, qd_iterator_t *key, int *exists, qd_hash_handle_t **handle)
+{
+    uint32_t        hash = qd_iterator_hash_view(key);
+    qd_hash_item_t *item = qd_hash_internal_retrieve_with_hash(h, hash, key);
+
     if (item) {
         *exists = 1;
         if (handle)
@@ -142,10 +336,18 @@ static qd_hash_item_t *qd_hash_internal_insert(qd_hash_t *h, qd_iterator_t *key,
     if (!item)
         return 0;
 
-    DEQ_ITEM_INIT(item);
-    item->key = qd_iterator_copy(key);
-
-    DEQ_INSERT_TAIL(h->buckets[idx].items, item);
+    item->hash = hash;
+    int length = qd_iterator_length(key);
+    if (length < QD_HASH_INLINE_KEY) {
+        int copied = qd_iterator_ncopy(key, item->inline_key, length + 1);
+        item->inline_key[copied] = '\0';
+        item->key = item->inline_key;
+    } else
+        item->key = qd_iterator_copy(key);
+
+    qd_hash_grow(h);
+    qd_hash_migrate(h, QD_HASH_MIGRATE_SLOTS);
+    table_place(&h->table, hash, item);
     h->size++;
     *exists = 0;
 
@@ -154,8 +356,7 @@ static qd_hash_item_t *qd_hash_internal_insert(qd_hash_t *h, qd_iterator_t *key,
     //
     if (handle) {
         *handle = new_qd_hash_handle_t();
-        (*handle)->bucket = &h->buckets[idx];
-        (*handle)->item   = item;
+        (*handle)->item = item;
     }
 
     return item;
@@ -198,46 +399,24 @@ qd_error_t qd_hash_insert_const(qd_hash_t *h, qd_iterator_t *key, const void *va
 }
 
 
-static qd_hash_item_t *qd_hash_internal_retrieve_with_hash(qd_hash_t *h, uint32_t hash, qd_iterator_t *key)
+void qd_hash_retrieve_prefix(qd_hash_t *h, qd_iterator_t *iter, void **val)
 {
-    uint32_t        idx  = hash & h->bucket_mask;
-	qd_hash_item_t *item = DEQ_HEAD(h->buckets[idx].items);
-
-	while (item) {
-		if (qd_iterator_equal(key, item->key))
-			break;
-		item = DEQ_NEXT(item);
-	}
-
-	return item;
-}
-
+    //Hash individual segments by iterating thru the octets in the iterator.
+    qd_iterator_hash_view_segments(iter);
 
-static qd_hash_item_t *qd_hash_internal_retrieve(qd_hash_t *h, qd_iterator_t *key)
-{
-    uint32_t hash = qd_iterator_hash_view(key);
-    return qd_hash_internal_retrieve_with_hash(h, hash, key);
-}
+    uint32_t hash = 0;
 
+    qd_hash_item_t *item = 0;
+    while (qd_iterator_next_segment(iter, &hash)) {
+        item = qd_hash_internal_retrieve_with_hash(h, hash, iter);
+        if (item)
+            break;
+    }
 
-void qd_hash_retrieve_prefix(qd_hash_t *h, qd_iterator_t *iter, void **val)
-{
-	//Hash individual segments by iterating thru the octets in the iterator.
-	qd_iterator_hash_view_segments(iter);
-
-	uint32_t hash = 0;
-
-	qd_hash_item_t *item;
-	while (qd_iterator_next_segment(iter, &hash)) {
-		item = qd_hash_internal_retrieve_with_hash(h, hash, iter);
-		if (item)
-			break;
-	}
-
-	if (item)
-		*val = item->v.val;
-	else
-		*val = 0;
+    if (item)
+        *val = item->v.val;
+    else
+        *val = 0;
 }
 
 
@@ -250,7 +429,7 @@ void qd_hash_retrieve_prefix_const(qd_hash_t *h, qd_iterator_t *iter, const void
 
     uint32_t hash = 0;
 
-    qd_hash_item_t *item;
+    qd_hash_item_t *item = 0;
 
     while (qd_iterator_next_segment(iter, &hash)) {
         item = qd_hash_internal_retrieve_with_hash(h, hash, iter);
@@ -291,16 +470,35 @@ qd_error_t qd_hash_retrieve_const(qd_hash_t *h, qd_iterator_t *key, const void *
 }
 
 
+//
+// Take an item out of whichever table holds it.
+//
+static void qd_hash_internal_remove_item(qd_hash_t *h, qd_hash_item_t *item, unsigned char **key)
+{
+    long idx = table_find_item(&h->table, item);
+    if (idx >= 0)
+        table_remove_at(&h->table, idx);
+    else {
+        assert(h->old.slots);
+        idx = table_find_item(&h->old, item);
+        assert(idx >= 0);
+        if (idx >= 0)
+            h->old.slots[idx].item = TOMBSTONE;
+    }
+
+    qd_hash_item_free(item, key);
+    h->size--;
+    qd_hash_migrate(h, QD_HASH_MIGRATE_SLOTS);
+}
+
+
 qd_error_t qd_hash_remove(qd_hash_t *h, qd_iterator_t *key)
 {
-    //the retrieve function will re-apply the bucket_mask, but that is ok
-    //we apply it here because we need the bucket index to do the remove
-    uint32_t        idx  = qd_iterator_hash_view(key) & h->bucket_mask;
-    qd_hash_item_t *item = qd_hash_internal_retrieve_with_hash(h, idx, key);
+    qd_hash_item_t *item = qd_hash_internal_retrieve(h, key);
     if (!item)
         return QD_ERROR_NOT_FOUND;
 
-    qd_hash_internal_remove_item(h, &h->buckets[idx], item, 0);
+    qd_hash_internal_remove_item(h, item, 0);
     return QD_ERROR_NONE;
 }
 
@@ -320,13 +518,20 @@ const unsigned char *qd_hash_key_by_handle(const qd_hash_handle_t *handle)
 }
 
 
+uint32_t qd_hash_hash_by_handle(const qd_hash_handle_t *handle)
+{
+    if (handle)
+        return handle->item->hash;
+    return 0;
+}
+
+
 qd_error_t qd_hash_remove_by_handle(qd_hash_t *h, qd_hash_handle_t *handle)
 {
-    unsigned char *key   = 0;
-    qd_error_t     error = qd_hash_remove_by_handle2(h, handle, &key);
-    if (key)
-        free(key);
-    return error;
+    if (!handle)
+        return QD_ERROR_NOT_FOUND;
+    qd_hash_internal_remove_item(h, handle->item, 0);
+    return QD_ERROR_NONE;
 }
 
 
@@ -334,6 +539,6 @@ qd_error_t qd_hash_remove_by_handle2(qd_hash_t *h, qd_hash_handle_t *handle, uns
 {
     if (!handle)
         return QD_ERROR_NOT_FOUND;
-    qd_hash_internal_remove_item(h, handle->bucket, handle->item, key);
+    qd_hash_internal_remove_item(h, handle->item, key);
     return QD_ERROR_NONE;
 }
@@ -33,10 +33,12 @@
 #include <string.h>
 #include <time.h>
 #include <syslog.h>
+#include <pthread.h>
 
 #define TEXT_MAX QD_LOG_TEXT_MAX
 #define LOG_MAX (QD_LOG_TEXT_MAX+128)
 #define LIST_MAX 1000
+#define RING_SIZE QD_LOG_RING_SIZE
 
 const char *QD_LOG_STATS_TYPE = "logStats";
 
@@ -49,6 +51,8 @@ typedef struct qd_log_entry_t qd_log_entry_t;
 
 struct qd_log_entry_t {
     DEQ_LINKS(qd_log_entry_t);
+    qd_log_source_t *source;
+    uint64_t        sequence;
     const char     *module;
     int             level;
     char           *file;
@@ -167,6 +171,7 @@ struct qd_log_source_t {
     bool syslog;
     log_sink_t *sink;
     uint64_t severity_histogram[N_LEVEL_INDICES];
+    uint64_t dropped;           /* entries lost to a full ring */
 };
 
 DEQ_DECLARE(qd_log_source_t, qd_log_source_list_t);
@@ -175,6 +180,40 @@ static sys_mutex_t          *log_lock = 0;
 static sys_mutex_t          *log_source_lock = 0;
 static qd_log_source_list_t  source_list = {0};
 
+//
+// Log entries are formatted by the thread that logs them and placed on that thread's
+// ring.  Each ring has a single producer (its thread) and a single consumer (whoever
+// holds log_lock), so neither side takes a lock to move entries.  The writer thread
+// drains the rings in sequence order and writes the entries to their sinks.  If a ring
+// is full the entry is dropped and counted against its source rather than blocking.
+// When a thread exits its ring is marked orphaned and freed once it has been drained.
+//
+typedef struct log_ring_t {
+    DEQ_LINKS(struct log_ring_t);
+    qd_log_entry_t *slots[RING_SIZE];
+    uint32_t        head;       /* Next slot to drain, advanced by the drainer */
+    uint32_t        tail;       /* Next slot to fill, advanced by the owning thread */
+    bool            orphaned;   /* The owning thread has exited, guarded by log_lock */
+} log_ring_t;
+
+DEQ_DECLARE(log_ring_t, log_ring_list_t);
+
+static log_ring_list_t       ring_list = {0};   /* Guarded by log_lock */
+static int                   ring_generation = 0;
+static uint64_t              log_sequence = 0;
+static sys_mutex_t          *writer_lock = 0;
+static sys_cond_t           *writer_cond = 0;
+static sys_thread_t         *writer_thread = 0;
+static bool                  writer_running = false;
+static int                   writer_sleeping = 0;
+static bool                  writer_held = false;
+static pthread_key_t         ring_key;
+static pthread_once_t        ring_key_once = PTHREAD_ONCE_INIT;
+
+static __thread log_ring_t  *thread_ring = 0;
+static __thread int          thread_ring_generation = 0;
+static __thread bool         thread_draining = false;
+
 
 typedef struct level_t {
     const char* name;
@@ -280,6 +319,7 @@ static bool default_bool(int value, int default_value) {
     return value == -1 ? default_value : value;
 }
 
+/// Caller must hold log_source_lock
 static void write_log(qd_log_source_t *log_source, qd_log_entry_t *entry)
 {
     log_sink_t* sink = log_source->sink ? log_source->sink : default_log_source->sink;
@@ -314,7 +354,6 @@ static void write_log(qd_log_source_t *log_source, qd_log_entry_t *entry)
             perror(msg);
             exit(1);
         };
-        fflush(sink->file);
     }
     if (sink->syslog) {
         int syslog_level = level->syslog;
@@ -380,6 +419,148 @@ bool qd_log_enabled(qd_log_source_t *source, qd_log_level_t level) {
     return level & mask;
 }
 
+/// Hand the ring of an exiting thread over to the drainer to free.
+static void log_thread_exit(void *unused)
+{
+    sys_mutex_lock(log_lock);
+    if (thread_ring && thread_ring_generation == ring_generation)
+        thread_ring->orphaned = true;
+    sys_mutex_unlock(log_lock);
+    thread_ring = 0;
+}
+
+static void log_ring_key_create(void)
+{
+    pthread_key_create(&ring_key, log_thread_exit);
+}
+
+/// Return the calling thread's ring, creating it on first use.
+static log_ring_t *log_thread_ring(void)
+{
+    if (thread_ring && thread_ring_generation == ring_generation)
+        return thread_ring;
+
+    log_ring_t *ring = NEW(log_ring_t);
+    memset(ring, 0, sizeof(log_ring_t));
+    DEQ_ITEM_INIT(ring);
+    sys_mutex_lock(log_lock);
+    DEQ_INSERT_TAIL(ring_list, ring);
+    sys_mutex_unlock(log_lock);
+
+    thread_ring            = ring;
+    thread_ring_generation = ring_generation;
+    pthread_once(&ring_key_once, log_ring_key_create);
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+/// Return false if the ring is full.  Called only by the ring's thread.
+static bool log_ring_push(log_ring_t *ring, qd_log_entry_t *entry)
+{
+    uint32_t tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == RING_SIZE)
+        return false;
+    ring->slots[tail & (RING_SIZE - 1)] = entry;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/// Caller must hold log_lock
+static bool log_rings_empty_lh(void)
+{
+    for (log_ring_t *ring = DEQ_HEAD(ring_list); ring; ring = DEQ_NEXT(ring))
+        if (ring->head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+            return false;
+    return true;
+}
+
+/// Write everything on the rings to the sinks, oldest first.  Caller must hold log_lock.
+static void log_drain_lh(void)
+{
+    thread_draining = true;
+    sys_mutex_lock(log_source_lock);
+
+    while (true) {
+        log_ring_t     *next_ring = 0;
+        qd_log_entry_t *next      = 0;
+        for (log_ring_t *ring = DEQ_HEAD(ring_list); ring; ring = DEQ_NEXT(ring)) {
+            if (ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+                continue;
+            qd_log_entry_t *entry = ring->slots[ring->head & (RING_SIZE - 1)];
+            if (!next || entry->sequence < next->sequence) {
+                next_ring = ring;
+                next      = entry;
+            }
+        }
+        if (!next)
+            break;
+        __atomic_store_n(&next_ring->head, next_ring->head + 1, __ATOMIC_RELEASE);
+
+        write_log(next->source, next);
+
+        // Bounded buffer of log entries, keep most recent.
+        DEQ_INSERT_TAIL(entries, next);
+        if (DEQ_SIZE(entries) > LIST_MAX)
+            qd_log_entry_free_lh(DEQ_HEAD(entries));
+    }
+
+    for (log_sink_t *sink = DEQ_HEAD(sink_list); sink; sink = DEQ_NEXT(sink))
+        if (sink->file)
+            fflush(sink->file);
+
+    sys_mutex_unlock(log_source_lock);
+    thread_draining = false;
+
+    //
+    // The rings of threads that have exited are empty now and won't be filled again.
+    //
+    log_ring_t *ring = DEQ_HEAD(ring_list);
+    while (ring) {
+        log_ring_t *next = DEQ_NEXT(ring);
+        if (ring->orphaned) {
+            DEQ_REMOVE(ring_list, ring);
+            free(ring);
+        }
+        ring = next;
+    }
+}
+
+/// Write all buffered log entries before returning.
+static void log_flush(void)
+{
+    if (!log_lock || thread_draining)
+        return;
+    sys_mutex_lock(log_lock);
+    log_drain_lh();
+    sys_mutex_unlock(log_lock);
+}
+
+static void *log_writer_run(void *unused)
+{
+    sys_mutex_lock(writer_lock);
+    while (writer_running) {
+        if (!writer_held) {
+            sys_mutex_unlock(writer_lock);
+            log_flush();
+            sys_mutex_lock(writer_lock);
+        }
+
+        //
+        // Announce that the writer is going to sleep before the final check of the rings,
+        // so that a thread which logs after the check sees the flag and signals.
+        //
+        __atomic_store_n(&writer_sleeping, 1, __ATOMIC_SEQ_CST);
+        sys_mutex_lock(log_lock);
+        bool empty = writer_held || log_rings_empty_lh();
+        sys_mutex_unlock(log_lock);
+        if (empty && writer_running)
+            sys_cond_wait(writer_cond, writer_lock);
+        __atomic_store_n(&writer_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+    sys_mutex_unlock(writer_lock);
+    return 0;
+}
+
 void qd_vlog_impl(qd_log_source_t *source, qd_log_level_t level, const char *file, int line, const char *fmt, va_list ap)
 {
     /*-----------------------------------------------
@@ -398,20 +579,35 @@ void qd_vlog_impl(qd_log_source_t *source, qd_log_level_t level, const char *fil
 
     qd_log_entry_t *entry = new_qd_log_entry_t();
     DEQ_ITEM_INIT(entry);
-    entry->module = source->module;
-    entry->level  = level;
-    entry->file   = file ? strdup(file) : 0;
-    entry->line   = line;
+    entry->source   = source;
+    entry->sequence = __atomic_fetch_add(&log_sequence, 1, __ATOMIC_RELAXED);
+    entry->module   = source->module;
+    entry->level    = level;
+    entry->file     = file ? strdup(file) : 0;
+    entry->line     = line;
     time(&entry->time);
     vsnprintf(entry->text, TEXT_MAX, fmt, ap);
-    write_log(source, entry);
 
-    // Bounded buffer of log entries, keep most recent.
-    sys_mutex_lock(log_lock);
-    DEQ_INSERT_TAIL(entries, entry);
-    if (DEQ_SIZE(entries) > LIST_MAX)
-        qd_log_entry_free_lh(DEQ_HEAD(entries));
-    sys_mutex_unlock(log_lock);
+    if (!log_ring_push(log_thread_ring(), entry)) {
+        __atomic_add_fetch(&source->dropped, 1, __ATOMIC_RELAXED);
+        free(entry->file);
+        free_qd_log_entry_t(entry);
+        return;
+    }
+
+    //
+    // Critical entries are written before returning since the process may be about to
+    // end.  Otherwise wake the writer if it is asleep, or write the entry here if there
+    // is no writer.
+    //
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (level == QD_LOG_CRITICAL || !writer_thread)
+        log_flush();
+    else if (__atomic_load_n(&writer_sleeping, __ATOMIC_SEQ_CST)) {
+        sys_mutex_lock(writer_lock);
+        sys_cond_signal(writer_cond);
+        sys_mutex_unlock(writer_lock);
+    }
 }
 
 void qd_log_impl(qd_log_source_t *source, qd_log_level_t level, const char *file, int line, const char *fmt, ...)
@@ -430,6 +626,8 @@ PyObject *qd_log_recent_py(long limit) {
     PyObject *list = PyList_New(0);
     PyObject *py_entry = NULL;
     if (!list) goto error;
+    sys_mutex_lock(log_lock);
+    log_drain_lh();
     qd_log_entry_t *entry = DEQ_TAIL(entries);
     while (entry && limit) {
         const int ENTRY_SIZE=6;
@@ -451,18 +649,30 @@ PyObject *qd_log_recent_py(long limit) {
         if (limit > 0) --limit;
         entry = DEQ_PREV(entry);
     }
+    sys_mutex_unlock(log_lock);
     return list;
  error:
+    sys_mutex_unlock(log_lock);
     Py_XDECREF(list);
     Py_XDECREF(py_entry);
     return NULL;
 }
 
+/// Write out whatever is still buffered if the process exits.
+static void log_atexit(void)
+{
+    log_flush();
+}
+
 void qd_log_initialize(void)
 {
+    static bool atexit_registered = false;
+
     DEQ_INIT(entries);
     DEQ_INIT(source_list);
     DEQ_INIT(sink_list);
+    DEQ_INIT(ring_list);
+    ring_generation++;
 
     // Set up level_names for use in error messages.
     char *begin = level_names, *end = level_names+sizeof(level_names);
@@ -479,10 +689,39 @@ void qd_log_initialize(void)
     default_log_source->source = 0;
     default_log_source->sink = log_sink_lh(SINK_STDERR);
     logging_log_source = qd_log_source(SOURCE_LOGGING);
+
+    writer_lock    = sys_mutex();
+    writer_cond    = sys_cond();
+    writer_running = true;
+    writer_thread  = sys_thread(log_writer_run, 0);
+    if (!atexit_registered) {
+        atexit(log_atexit);
+        atexit_registered = true;
+    }
 }
 
 
 void qd_log_finalize(void) {
+    sys_mutex_lock(writer_lock);
+    writer_running = false;
+    sys_cond_signal(writer_cond);
+    sys_mutex_unlock(writer_lock);
+    sys_thread_join(writer_thread);
+    sys_thread_free(writer_thread);
+    writer_thread = 0;
+    sys_cond_free(writer_cond);
+    sys_mutex_free(writer_lock);
+
+    sys_mutex_lock(log_lock);
+    log_drain_lh();
+    while (DEQ_HEAD(ring_list)) {
+        log_ring_t *ring = DEQ_HEAD(ring_list);
+        DEQ_REMOVE_HEAD(ring_list);
+        free(ring);
+    }
+    ring_generation++;
+    sys_mutex_unlock(log_lock);
+
     while (DEQ_HEAD(source_list))
         qd_log_source_free_lh(DEQ_HEAD(source_list));
     while (DEQ_HEAD(entries))
@@ -565,8 +804,44 @@ qd_error_t qd_entity_refresh_logStats(qd_entity_t* entity, void *impl)
     qd_entity_set_long(entity,   "warningCount",  log->severity_histogram[LEVEL_INDEX(WARNING)]);
     qd_entity_set_long(entity,   "errorCount",    log->severity_histogram[LEVEL_INDEX(ERROR)]);
     qd_entity_set_long(entity,   "criticalCount", log->severity_histogram[LEVEL_INDEX(CRITICAL)]);
+    qd_entity_set_long(entity,   "droppedCount",  __atomic_load_n(&log->dropped, __ATOMIC_RELAXED));
     qd_entity_set_string(entity, "name",          log->module);
     qd_entity_set_string(entity, "identity",      identity_str);
 
     return QD_ERROR_NONE;
 }
+
+
+void qd_log_hold(bool hold)
+{
+    sys_mutex_lock(writer_lock);
+    writer_held = hold;
+    sys_cond_signal(writer_cond);
+    sys_mutex_unlock(writer_lock);
+}
+
+
+uint64_t qd_log_dropped(qd_log_source_t *source)
+{
+    return __atomic_load_n(&source->dropped, __ATOMIC_RELAXED);
+}
+
+
+int qd_log_recent_text(const char *module, char **text, int max)
+{
+    int count = 0;
+
+    sys_mutex_lock(log_lock);
+    log_drain_lh();
+    for (qd_log_entry_t *entry = DEQ_TAIL(entries); entry && count < max; entry = DEQ_PREV(entry))
+        if (strcmp(entry->module, module) == 0)
+            text[count++] = strdup(entry->text);
+    sys_mutex_unlock(log_lock);
+
+    for (int i = 0; i < count / 2; i++) {
+        char *swap          = text[i];
+        text[i]             = text[count - 1 - i];
+        text[count - 1 - i] = swap;
+    }
+    return count;
+}
@@ -20,9 +20,21 @@
  */
 
 #include <qpid/dispatch/log.h>
+#include <stdint.h>
 
 void qd_log_initialize(void);
 void qd_log_finalize(void);
 
 #define QD_LOG_TEXT_MAX 2048
+#define QD_LOG_RING_SIZE 1024   // Log entries buffered per thread, must be a power of two
+
+/// For tests only: while held, the writer thread leaves entries on the rings
+void qd_log_hold(bool hold);
+
+/// For tests only: the number of entries of a source dropped because a ring was full
+uint64_t qd_log_dropped(qd_log_source_t *source);
+
+/// For tests only: copy the text of up to max of the most recent entries of a module,
+/// oldest first.  Returns the number copied; the caller frees the copies.
+int qd_log_recent_text(const char *module, char **text, int max);
 #endif
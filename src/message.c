@@ -31,6 +31,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <limits.h>
+#include <sys/uio.h>
 
 static const unsigned char * const MSG_HDR_LONG                 = (unsigned char*) "\x00\x80\x00\x00\x00\x00\x00\x00\x00\x70";
 static const unsigned char * const MSG_HDR_SHORT                = (unsigned char*) "\x00\x53\x70";
@@ -61,15 +62,50 @@ PN_HANDLE(PN_DELIVERY_CTX);
 
 ALLOC_DEFINE_CONFIG(qd_message_t, sizeof(qd_message_pvt_t), 0, 0);
 ALLOC_DEFINE(qd_message_content_t);
+ALLOC_DEFINE(qd_message_annotations_t);
 
 typedef void (*buffer_process_t) (void *context, const unsigned char *base, int length);
 
 static qd_log_source_t* log_source = 0;
 
+//
+// Message content is touched by more than one thread only while a message is sent
+// before it has been completely received, so contents don't carry a mutex of their own.
+// Instead they share a fixed table of locks, picked by address.  Each lock is created
+// the first time it is needed.
+//
+#define CONTENT_LOCK_STRIPES 128
+
+static sys_mutex_t *content_locks[CONTENT_LOCK_STRIPES];
+
+static sys_mutex_t *content_lock(const qd_message_content_t *content)
+{
+    uintptr_t    idx  = ((uintptr_t) content / sizeof(qd_message_content_t)) % CONTENT_LOCK_STRIPES;
+    sys_mutex_t *lock = __atomic_load_n(&content_locks[idx], __ATOMIC_ACQUIRE);
+
+    if (!lock) {
+        sys_mutex_t *fresh = sys_mutex();
+        if (__atomic_compare_exchange_n(&content_locks[idx], &lock, fresh, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            lock = fresh;
+        else
+            sys_mutex_free(fresh);
+    }
+    return lock;
+}
+
 void qd_message_initialize() {
     log_source = qd_log_source("MESSAGE");
 }
 
+void qd_message_finalize() {
+    for (int idx = 0; idx < CONTENT_LOCK_STRIPES; idx++) {
+        if (content_locks[idx])
+            sys_mutex_free(content_locks[idx]);
+        content_locks[idx] = 0;
+    }
+}
+
 int qd_message_repr_len() { return qd_log_max_len(); }
 
 // Quote non-printable characters suitable for log messages. Output in buffer.
@@ -103,6 +139,7 @@ static const char REPR_END[] = "}\0";
 
 /* TODO aconway 2014-05-13: more detailed message representation. */
 char* qd_message_repr(qd_message_t *msg, char* buffer, size_t len) {
+    buffer[0] = '\0';
     if (qd_message_check(msg, QD_DEPTH_BODY)) {
         char *begin = buffer;
         char *end = buffer + len - sizeof(REPR_END); /* Save space for ending */
@@ -115,7 +152,12 @@ char* qd_message_repr(qd_message_t *msg, char* buffer, size_t len) {
     return buffer;
 }
 
-static void advance(unsigned char **cursor, qd_buffer_t **buffer, int consume, buffer_process_t handler, void *context)
+//
+// Advance the cursor by 'consume' octets, passing the traversed octets to the handler.
+// Return the number of octets that could not be consumed because the end of the buffer
+// chain was reached.
+//
+static int advance(unsigned char **cursor, qd_buffer_t **buffer, int consume, buffer_process_t handler, void *context)
 {
     unsigned char *local_cursor = *cursor;
     qd_buffer_t   *local_buffer = *buffer;
@@ -143,6 +185,17 @@ static void advance(unsigned char **cursor, qd_buffer_t **buffer, int consume, b
 
     *cursor = local_cursor;
     *buffer = local_buffer;
+    return consume;
+}
+
+
+//
+// Return true if there is no data at the cursor.  While a message is being received, the
+// cursor may rest at the start of an empty tail buffer that has not been filled yet.
+//
+static inline bool end_of_data(const unsigned char *cursor, qd_buffer_t *buffer)
+{
+    return !cursor || cursor == qd_buffer_base(buffer) + qd_buffer_size(buffer);
 }
 
 
@@ -154,44 +207,101 @@ static unsigned char next_octet(unsigned char **cursor, qd_buffer_t **buffer)
 }
 
 
-static int traverse_field(unsigned char **cursor, qd_buffer_t **buffer, qd_field_location_t *field)
-{
-    qd_buffer_t   *start_buffer = *buffer;
-    unsigned char *start_cursor = *cursor;
+//
+// The longest tag-and-size header of an encoded field: a tag followed by a four-octet size.
+//
+#define FIELD_HEADER_MAX 5
 
-    unsigned char tag = next_octet(cursor, buffer);
-    if (!(*cursor)) return 0;
+//
+// Return the number of octets at the cursor that lie in the cursor's buffer.
+//
+static inline size_t contiguous_octets(const unsigned char *cursor, qd_buffer_t *buffer)
+{
+    return cursor ? qd_buffer_base(buffer) + qd_buffer_size(buffer) - cursor : 0;
+}
 
-    int    consume    = 0;
-    size_t hdr_length = 1;
 
-    switch (tag & 0xF0) {
-    case 0x40 : consume = 0;  break;
-    case 0x50 : consume = 1;  break;
-    case 0x60 : consume = 2;  break;
-    case 0x70 : consume = 4;  break;
-    case 0x80 : consume = 8;  break;
-    case 0x90 : consume = 16; break;
+//
+// Decode the header of a field whose FIELD_HEADER_MAX first octets are contiguous in
+// memory.  Set *consume to the number of octets following the header and return the
+// length of the header.
+//
+static inline int decode_field_header(const unsigned char *data, int *consume)
+{
+    switch (data[0] & 0xF0) {
+    case 0x50 : *consume = 1;  return 1;
+    case 0x60 : *consume = 2;  return 1;
+    case 0x70 : *consume = 4;  return 1;
+    case 0x80 : *consume = 8;  return 1;
+    case 0x90 : *consume = 16; return 1;
 
     case 0xB0 :
     case 0xD0 :
     case 0xF0 :
-        hdr_length += 3;
-        consume |= ((int) next_octet(cursor, buffer)) << 24;
-        if (!(*cursor)) return 0;
-        consume |= ((int) next_octet(cursor, buffer)) << 16;
-        if (!(*cursor)) return 0;
-        consume |= ((int) next_octet(cursor, buffer)) << 8;
-        if (!(*cursor)) return 0;
-        // Fall through to the next case...
+        *consume = ((int) data[1] << 24) | ((int) data[2] << 16) | ((int) data[3] << 8) | (int) data[4];
+        return 5;
 
     case 0xA0 :
     case 0xC0 :
     case 0xE0 :
-        hdr_length++;
-        consume |= (int) next_octet(cursor, buffer);
+        *consume = (int) data[1];
+        return 2;
+
+    default :
+        *consume = 0;
+        return 1;
+    }
+}
+
+
+static int traverse_field(unsigned char **cursor, qd_buffer_t **buffer, qd_field_location_t *field)
+{
+    qd_buffer_t   *start_buffer = *buffer;
+    unsigned char *start_cursor = *cursor;
+
+    unsigned char tag        = **cursor;
+    int           consume    = 0;
+    size_t        hdr_length = 1;
+
+    if (contiguous_octets(*cursor, *buffer) >= FIELD_HEADER_MAX) {
+        //
+        // The header lies within this buffer, decode it in place.
+        //
+        hdr_length = decode_field_header(*cursor, &consume);
+        advance(cursor, buffer, hdr_length, 0, 0);
         if (!(*cursor)) return 0;
-        break;
+    } else {
+        next_octet(cursor, buffer);
+        if (!(*cursor)) return 0;
+
+        switch (tag & 0xF0) {
+        case 0x40 : consume = 0;  break;
+        case 0x50 : consume = 1;  break;
+        case 0x60 : consume = 2;  break;
+        case 0x70 : consume = 4;  break;
+        case 0x80 : consume = 8;  break;
+        case 0x90 : consume = 16; break;
+
+        case 0xB0 :
+        case 0xD0 :
+        case 0xF0 :
+            hdr_length += 3;
+            consume |= ((int) next_octet(cursor, buffer)) << 24;
+            if (!(*cursor)) return 0;
+            consume |= ((int) next_octet(cursor, buffer)) << 16;
+            if (!(*cursor)) return 0;
+            consume |= ((int) next_octet(cursor, buffer)) << 8;
+            if (!(*cursor)) return 0;
+            // Fall through to the next case...
+
+        case 0xA0 :
+        case 0xC0 :
+        case 0xE0 :
+            hdr_length++;
+            consume |= (int) next_octet(cursor, buffer);
+            if (!(*cursor)) return 0;
+            break;
+        }
     }
 
     if (field && !field->parsed) {
@@ -210,6 +320,36 @@ static int traverse_field(unsigned char **cursor, qd_buffer_t **buffer, qd_field
 
 static int start_list(unsigned char **cursor, qd_buffer_t **buffer)
 {
+    //
+    // A list32 header is nine octets: the tag, the size and the count.  If that much lies
+    // within this buffer, decode the header in place.
+    //
+    if (contiguous_octets(*cursor, *buffer) >= 9) {
+        const unsigned char *data   = *cursor;
+        int                  count  = 0;
+        int                  header = 0;
+
+        switch (data[0]) {
+        case 0x45 :     // list0
+            advance(cursor, buffer, 1, 0, 0);
+            return 0;
+        case 0xd0 :     // list32
+            count  = ((int) data[5] << 24) | ((int) data[6] << 16) | ((int) data[7] << 8) | (int) data[8];
+            header = 9;
+            break;
+        case 0xc0 :     // list8
+            count  = (int) data[2];
+            header = 3;
+            break;
+        default :
+            advance(cursor, buffer, 1, 0, 0);
+            return 0;
+        }
+
+        advance(cursor, buffer, header, 0, 0);
+        return *cursor ? count : 0;
+    }
+
     unsigned char tag = next_octet(cursor, buffer);
     if (!(*cursor)) return 0;
     int length = 0;
@@ -260,25 +400,64 @@ static int start_list(unsigned char **cursor, qd_buffer_t **buffer)
 //
 // If there is no match, don't advance the cursor.
 //
-// Return 0 if the pattern matches but the following tag is unexpected
-// Return 0 if the pattern matches and the location already has a pointer (duplicate section)
-// Return 1 if the pattern matches and we've advanced the cursor/buffer
-// Return 1 if the pattern does not match
+// Return INVALID if the pattern matches but the following tag is unexpected
+// Return INVALID if the pattern matches and the location already has a pointer (duplicate section)
+// Return OK if the pattern matches and we've advanced the cursor/buffer
+// Return OK if the pattern does not match
+// Return INCOMPLETE if the message is not complete and the data ran out before the
+//        section could be matched and consumed
 //
-static int qd_check_and_advance(qd_buffer_t         **buffer,
-                                unsigned char       **cursor,
-                                const unsigned char  *pattern,
-                                int                   pattern_length,
-                                const unsigned char  *expected_tags,
-                                qd_field_location_t  *location)
+static qd_message_depth_status_t qd_check_and_advance(qd_buffer_t         **buffer,
+                                                      unsigned char       **cursor,
+                                                      const unsigned char  *pattern,
+                                                      int                   pattern_length,
+                                                      const unsigned char  *expected_tags,
+                                                      qd_field_location_t  *location,
+                                                      bool                  complete)
 {
+    const qd_message_depth_status_t short_data = complete ? QD_MESSAGE_DEPTH_INVALID : QD_MESSAGE_DEPTH_INCOMPLETE;
     qd_buffer_t   *test_buffer = *buffer;
     unsigned char *test_cursor = *cursor;
 
-    if (!test_cursor)
-        return 1; // no match
+    if (end_of_data(test_cursor, test_buffer))
+        return complete ? QD_MESSAGE_DEPTH_OK : QD_MESSAGE_DEPTH_INCOMPLETE; // no match
 
     unsigned char *end_of_buffer = qd_buffer_base(test_buffer) + qd_buffer_size(test_buffer);
+
+    //
+    // If the pattern and the section's header lie within this buffer, as they usually do,
+    // match and decode them in place.
+    //
+    if (end_of_buffer - test_cursor >= pattern_length + FIELD_HEADER_MAX) {
+        if (memcmp(test_cursor, pattern, pattern_length) != 0)
+            return QD_MESSAGE_DEPTH_OK; // Pattern didn't match
+
+        const unsigned char *tag = test_cursor + pattern_length;
+        while (*expected_tags && *tag != *expected_tags)
+            expected_tags++;
+        if (*expected_tags == 0)
+            return QD_MESSAGE_DEPTH_INVALID;  // Unexpected tag
+
+        if (location->parsed)
+            return QD_MESSAGE_DEPTH_INVALID;  // Duplicate section
+
+        int consume;
+        int pre_consume = decode_field_header(tag, &consume);
+
+        location->parsed     = 1;
+        location->buffer     = *buffer;
+        location->offset     = *cursor - qd_buffer_base(*buffer);
+        location->length     = pre_consume + consume;
+        location->hdr_length = pattern_length;
+
+        if (advance(&test_cursor, &test_buffer, pattern_length + location->length, 0, 0) > 0 && !complete)
+            return QD_MESSAGE_DEPTH_INCOMPLETE;
+
+        *cursor = test_cursor;
+        *buffer = test_buffer;
+        return QD_MESSAGE_DEPTH_OK;
+    }
+
     int idx = 0;
 
     while (idx < pattern_length && *test_cursor == pattern[idx]) {
@@ -286,15 +465,15 @@ static int qd_check_and_advance(qd_buffer_t         **buffer,
         test_cursor++;
         if (test_cursor == end_of_buffer) {
             test_buffer = test_buffer->next;
-            if (test_buffer == 0)
-                return 1; // Pattern didn't match
+            if (test_buffer == 0 || qd_buffer_size(test_buffer) == 0)
+                return complete ? QD_MESSAGE_DEPTH_OK : QD_MESSAGE_DEPTH_INCOMPLETE; // Pattern didn't match
             test_cursor = qd_buffer_base(test_buffer);
             end_of_buffer = test_cursor + qd_buffer_size(test_buffer);
         }
     }
 
     if (idx < pattern_length)
-        return 1; // Pattern didn't match
+        return QD_MESSAGE_DEPTH_OK; // Pattern didn't match
 
     //
     // Pattern matched, check the tag
@@ -302,10 +481,10 @@ static int qd_check_and_advance(qd_buffer_t         **buffer,
     while (*expected_tags && *test_cursor != *expected_tags)
         expected_tags++;
     if (*expected_tags == 0)
-        return 0;  // Unexpected tag
+        return QD_MESSAGE_DEPTH_INVALID;  // Unexpected tag
 
     if (location->parsed)
-        return 0;  // Duplicate section
+        return QD_MESSAGE_DEPTH_INVALID;  // Duplicate section
 
     //
     // Pattern matched and tag is expected.  Mark the beginning of the section.
@@ -324,8 +503,8 @@ static int qd_check_and_advance(qd_buffer_t         **buffer,
     unsigned char tag = next_octet(&test_cursor, &test_buffer);
 
     unsigned char tag_subcat = tag & 0xF0;
-    if (!test_cursor && tag_subcat != 0x40)
-        return 0;
+    if (end_of_data(test_cursor, test_buffer) && tag_subcat != 0x40)
+        return short_data;
 
     switch (tag_subcat) {
     case 0x40:               break;
@@ -340,11 +519,11 @@ static int qd_check_and_advance(qd_buffer_t         **buffer,
     case 0xF0:
         pre_consume += 3;
         consume |= ((int) next_octet(&test_cursor, &test_buffer)) << 24;
-        if (!test_cursor) return 0;
+        if (end_of_data(test_cursor, test_buffer)) return short_data;
         consume |= ((int) next_octet(&test_cursor, &test_buffer)) << 16;
-        if (!test_cursor) return 0;
+        if (end_of_data(test_cursor, test_buffer)) return short_data;
         consume |= ((int) next_octet(&test_cursor, &test_buffer)) << 8;
-        if (!test_cursor) return 0;
+        if (end_of_data(test_cursor, test_buffer)) return short_data;
         // Fall through to the next case...
 
     case 0xA0:
@@ -352,17 +531,17 @@ static int qd_check_and_advance(qd_buffer_t         **buffer,
     case 0xE0:
         pre_consume += 1;
         consume |= (int) next_octet(&test_cursor, &test_buffer);
-        if (!test_cursor) return 0;
+        if (!test_cursor) return short_data;
         break;
     }
 
     location->length = pre_consume + consume;
-    if (consume)
-        advance(&test_cursor, &test_buffer, consume, 0, 0);
+    if (consume && advance(&test_cursor, &test_buffer, consume, 0, 0) > 0 && !complete)
+        return QD_MESSAGE_DEPTH_INCOMPLETE;
 
     *cursor = test_cursor;
     *buffer = test_buffer;
-    return 1;
+    return QD_MESSAGE_DEPTH_OK;
 }
 
 
@@ -423,6 +602,7 @@ static qd_field_location_t *qd_message_properties_field(qd_message_t *msg, qd_me
         (intptr_t) &((qd_message_content_t *)0)->field_reply_to,
         (intptr_t) &((qd_message_content_t *)0)->field_correlation_id
     };
+#define PROPERTIES_FIELD_COUNT (sizeof(offsets) / sizeof(offsets[0]))
     // update table above if new fields need to be accessed:
     assert(QD_FIELD_MESSAGE_ID <= field && field <= QD_FIELD_CORRELATION_ID);
 
@@ -433,33 +613,31 @@ static qd_field_location_t *qd_message_properties_field(qd_message_t *msg, qd_me
     }
     if (field == QD_FIELD_PROPERTIES) return &content->section_message_properties;
 
-    const int index = field - QD_FIELD_MESSAGE_ID;
-    qd_field_location_t *const location = (qd_field_location_t *)((char *)content + offsets[index]);
-    if (location->parsed)
-        return location;
-
-    // requested field not parsed out.  Need to parse out up to the requested field:
-    qd_buffer_t   *buffer = content->section_message_properties.buffer;
-    unsigned char *cursor = qd_buffer_base(buffer) + content->section_message_properties.offset;
-    advance(&cursor, &buffer, content->section_message_properties.hdr_length, 0, 0);
-    if (index >= start_list(&cursor, &buffer)) return 0;  // properties list too short
-
-    int position = 0;
-    while (position < index) {
-        qd_field_location_t *f = (qd_field_location_t *)((char *)content + offsets[position]);
-        if (f->parsed)
-            advance(&cursor, &buffer, f->hdr_length + f->length, 0, 0);
-        else // parse it out
-            if (!traverse_field(&cursor, &buffer, f)) return 0;
-        position++;
+    //
+    // The first request for a field records the locations of all of them, so that later
+    // requests need no parsing.
+    //
+    if (!__atomic_load_n(&content->properties_scanned, __ATOMIC_ACQUIRE)) {
+        sys_mutex_lock(content_lock(content));
+        if (!content->properties_scanned) {
+            qd_buffer_t   *buffer = content->section_message_properties.buffer;
+            unsigned char *cursor = qd_buffer_base(buffer) + content->section_message_properties.offset;
+            advance(&cursor, &buffer, content->section_message_properties.hdr_length, 0, 0);
+
+            int count = start_list(&cursor, &buffer);
+            for (int position = 0; position < count && position < PROPERTIES_FIELD_COUNT && cursor; position++) {
+                qd_field_location_t *f = (qd_field_location_t *)((char *)content + offsets[position]);
+                if (!traverse_field(&cursor, &buffer, f))
+                    break;
+            }
+            __atomic_store_n(&content->properties_scanned, true, __ATOMIC_RELEASE);
+        }
+        sys_mutex_unlock(content_lock(content));
     }
 
-    // all fields previous to the target have now been parsed and cursor/buffer
-    // are in the correct position, parse out the field:
-    if (traverse_field(&cursor, &buffer, location))
-        return location;
-
-    return 0;
+    const int index = field - QD_FIELD_MESSAGE_ID;
+    qd_field_location_t *const location = (qd_field_location_t *)((char *)content + offsets[index]);
+    return location->parsed ? location : 0;
 }
 
 
@@ -541,6 +719,57 @@ static qd_field_location_t *qd_message_field_location(qd_message_t *msg, qd_mess
 }
 
 
+static void annotations_discard_composed(qd_message_annotations_t *ma)
+{
+    for (int strip = 0; strip < 2; strip++) {
+        qd_buffer_list_free_buffers(&ma->composed[strip]);
+        ma->composed_state[strip] = QD_MA_NOT_COMPOSED;
+    }
+}
+
+
+static void annotations_decref(qd_message_annotations_t *ma)
+{
+    if (!ma || sys_atomic_dec(&ma->ref_count) > 1)
+        return;
+
+    qd_buffer_list_free_buffers(&ma->ma_to_override);
+    qd_buffer_list_free_buffers(&ma->ma_trace);
+    qd_buffer_list_free_buffers(&ma->ma_ingress);
+    annotations_discard_composed(ma);
+    sys_atomic_destroy(&ma->ref_count);
+    free_qd_message_annotations_t(ma);
+}
+
+
+/**
+ * Return the message's annotations block, ready to be modified.  A block shared with
+ * copies of the message is copied first so the copies are not affected.
+ */
+static qd_message_annotations_t *annotations_for_update(qd_message_pvt_t *msg)
+{
+    qd_message_annotations_t *ma = msg->ma;
+
+    if (ma && sys_atomic_get(&ma->ref_count) == 1) {
+        annotations_discard_composed(ma);
+        return ma;
+    }
+
+    qd_message_annotations_t *fresh = new_qd_message_annotations_t();
+    ZERO(fresh);
+    sys_atomic_init(&fresh->ref_count, 1);
+    if (ma) {
+        qd_buffer_list_clone(&fresh->ma_to_override, &ma->ma_to_override);
+        qd_buffer_list_clone(&fresh->ma_trace, &ma->ma_trace);
+        qd_buffer_list_clone(&fresh->ma_ingress, &ma->ma_ingress);
+        fresh->ma_phase = ma->ma_phase;
+        annotations_decref(ma);
+    }
+    msg->ma = fresh;
+    return fresh;
+}
+
+
 qd_message_t *qd_message()
 {
     qd_message_pvt_t *msg = (qd_message_pvt_t*) new_qd_message_t();
@@ -548,10 +777,11 @@ qd_message_t *qd_message()
         return 0;
 
     DEQ_ITEM_INIT(msg);
-    DEQ_INIT(msg->ma_to_override);
-    DEQ_INIT(msg->ma_trace);
-    DEQ_INIT(msg->ma_ingress);
-    msg->ma_phase = 0;
+    msg->ma            = 0;
+    msg->cursor_buffer = 0;
+    msg->cursor        = 0;
+    msg->send_started  = false;
+    msg->send_complete = false;
     msg->content = new_qd_message_content_t();
 
     if (msg->content == 0) {
@@ -560,10 +790,11 @@ qd_message_t *qd_message()
     }
 
     ZERO(msg->content);
-    msg->content->lock = sys_mutex();
     sys_atomic_init(&msg->content->ref_count, 1);
     msg->content->parse_depth = QD_DEPTH_NONE;
     msg->content->parsed_message_annotations = 0;
+    msg->content->receive_complete = true;
+    msg->content->aborted = false;
 
     return (qd_message_t*) msg;
 }
@@ -575,9 +806,7 @@ void qd_message_free(qd_message_t *in_msg)
     uint32_t rc;
     qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
 
-    qd_buffer_list_free_buffers(&msg->ma_to_override);
-    qd_buffer_list_free_buffers(&msg->ma_trace);
-    qd_buffer_list_free_buffers(&msg->ma_ingress);
+    annotations_decref(msg->ma);
 
     qd_message_content_t *content = msg->content;
 
@@ -594,7 +823,6 @@ void qd_message_free(qd_message_t *in_msg)
             buf = DEQ_HEAD(content->buffers);
         }
 
-        sys_mutex_free(content->lock);
         free_qd_message_content_t(content);
     }
 
@@ -612,10 +840,13 @@ qd_message_t *qd_message_copy(qd_message_t *in_msg)
         return 0;
 
     DEQ_ITEM_INIT(copy);
-    qd_buffer_list_clone(&copy->ma_to_override, &msg->ma_to_override);
-    qd_buffer_list_clone(&copy->ma_trace, &msg->ma_trace);
-    qd_buffer_list_clone(&copy->ma_ingress, &msg->ma_ingress);
-    copy->ma_phase = msg->ma_phase;
+    copy->ma            = msg->ma;
+    if (copy->ma)
+        sys_atomic_inc(&copy->ma->ref_count);
+    copy->cursor_buffer = 0;
+    copy->cursor        = 0;
+    copy->send_started  = false;
+    copy->send_complete = false;
 
     copy->content = content;
 
@@ -632,64 +863,116 @@ qd_parsed_field_t *qd_message_message_annotations(qd_message_t *in_msg)
     qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
     qd_message_content_t *content = msg->content;
 
-    if (content->parsed_message_annotations)
-        return content->parsed_message_annotations;
+    qd_parsed_field_t *parsed = __atomic_load_n(&content->parsed_message_annotations, __ATOMIC_ACQUIRE);
+    if (parsed)
+        return parsed;
 
     qd_iterator_t *ma = qd_message_field_iterator(in_msg, QD_FIELD_MESSAGE_ANNOTATION);
     if (ma == 0)
         return 0;
 
-    content->parsed_message_annotations = qd_parse(ma);
-    if (content->parsed_message_annotations == 0 ||
-        !qd_parse_ok(content->parsed_message_annotations) ||
-        !qd_parse_is_map(content->parsed_message_annotations)) {
-        qd_iterator_free(ma);
-        qd_parse_free(content->parsed_message_annotations);
-        content->parsed_message_annotations = 0;
+    parsed = qd_parse(ma);
+    qd_iterator_free(ma);
+    if (parsed == 0 || !qd_parse_ok(parsed) || !qd_parse_is_map(parsed)) {
+        qd_parse_free(parsed);
         return 0;
     }
 
-    qd_iterator_free(ma);
-    return content->parsed_message_annotations;
+    //
+    // Copies of the message on other threads may be parsing the annotations at the same
+    // time.  The first one to finish publishes its result; the others use it instead.
+    //
+    qd_parsed_field_t *expected = 0;
+    if (!__atomic_compare_exchange_n(&content->parsed_message_annotations, &expected, parsed, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        qd_parse_free(parsed);
+        parsed = expected;
+    }
+    return parsed;
 }
 
 
 void qd_message_set_trace_annotation(qd_message_t *in_msg, qd_composed_field_t *trace_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_trace);
-    qd_compose_take_buffers(trace_field, &msg->ma_trace);
+    qd_message_annotations_t *ma = annotations_for_update((qd_message_pvt_t*) in_msg);
+    qd_buffer_list_free_buffers(&ma->ma_trace);
+    qd_compose_take_buffers(trace_field, &ma->ma_trace);
     qd_compose_free(trace_field);
 }
 
 void qd_message_set_to_override_annotation(qd_message_t *in_msg, qd_composed_field_t *to_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_to_override);
-    qd_compose_take_buffers(to_field, &msg->ma_to_override);
+    qd_message_annotations_t *ma = annotations_for_update((qd_message_pvt_t*) in_msg);
+    qd_buffer_list_free_buffers(&ma->ma_to_override);
+    qd_compose_take_buffers(to_field, &ma->ma_to_override);
     qd_compose_free(to_field);
 }
 
 void qd_message_set_phase_annotation(qd_message_t *in_msg, int phase)
 {
     qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    msg->ma_phase = phase;
+    if (phase == qd_message_get_phase_annotation(in_msg))
+        return;
+    annotations_for_update(msg)->ma_phase = phase;
 }
 
 int qd_message_get_phase_annotation(const qd_message_t *in_msg)
 {
     qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    return msg->ma_phase;
+    return msg->ma ? msg->ma->ma_phase : 0;
 }
 
 void qd_message_set_ingress_annotation(qd_message_t *in_msg, qd_composed_field_t *ingress_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_ingress);
-    qd_compose_take_buffers(ingress_field, &msg->ma_ingress);
+    qd_message_annotations_t *ma = annotations_for_update((qd_message_pvt_t*) in_msg);
+    qd_buffer_list_free_buffers(&ma->ma_ingress);
+    qd_compose_take_buffers(ingress_field, &ma->ma_ingress);
     qd_compose_free(ingress_field);
 }
 
+qd_message_t *qd_get_message_context(pn_delivery_t *delivery)
+{
+    pn_record_t *record = pn_delivery_attachments(delivery);
+    return (qd_message_t*) pn_record_get(record, PN_DELIVERY_CTX);
+}
+
+
+qd_message_t *qd_message_receive_abort(pn_delivery_t *delivery)
+{
+    pn_record_t      *record = pn_delivery_attachments(delivery);
+    qd_message_pvt_t *msg    = (qd_message_pvt_t*) pn_record_get(record, PN_DELIVERY_CTX);
+
+    if (!msg)
+        return 0;
+
+    pn_record_set(record, PN_DELIVERY_CTX, 0);
+
+    sys_mutex_lock(content_lock(msg->content));
+    msg->content->aborted = true;
+    sys_mutex_unlock(content_lock(msg->content));
+
+    return (qd_message_t*) msg;
+}
+
+
+bool qd_message_receive_complete(const qd_message_t *in_msg)
+{
+    return ((qd_message_pvt_t*) in_msg)->content->receive_complete;
+}
+
+
+bool qd_message_aborted(const qd_message_t *in_msg)
+{
+    return ((qd_message_pvt_t*) in_msg)->content->aborted;
+}
+
+
+bool qd_message_send_complete(const qd_message_t *in_msg)
+{
+    return ((qd_message_pvt_t*) in_msg)->send_complete;
+}
+
+
 qd_message_t *qd_message_receive(pn_delivery_t *delivery)
 {
     pn_link_t        *link = pn_delivery_link(delivery);
@@ -706,20 +989,29 @@ qd_message_t *qd_message_receive(pn_delivery_t *delivery)
     //
     if (!msg) {
         msg = (qd_message_pvt_t*) qd_message();
+        msg->content->receive_complete = false;
         pn_record_def(record, PN_DELIVERY_CTX, PN_WEAKREF);
         pn_record_set(record, PN_DELIVERY_CTX, (void*) msg);
     }
 
+    qd_message_content_t *content = msg->content;
+
     //
     // Get a reference to the tail buffer on the message.  This is the buffer into which
     // we will store incoming message data.  If there is no buffer in the message, allocate
     // an empty one and add it to the message.
     //
-    buf = DEQ_TAIL(msg->content->buffers);
+    // The buffer chain may be read concurrently by threads that are sending the partial
+    // message.  Data is written past the end of the tail buffer without the lock; only
+    // changes that make the data visible to other threads are made under the lock.
+    //
+    sys_mutex_lock(content_lock(content));
+    buf = DEQ_TAIL(content->buffers);
     if (!buf) {
         buf = qd_buffer();
-        DEQ_INSERT_TAIL(msg->content->buffers, buf);
+        DEQ_INSERT_TAIL(content->buffers, buf);
     }
+    sys_mutex_unlock(content_lock(content));
 
     while (1) {
         //
@@ -741,11 +1033,13 @@ qd_message_t *qd_message_receive(pn_delivery_t *delivery)
             // will only happen if the size of the message content is an exact multiple
             // of the buffer size.
             //
-
+            sys_mutex_lock(content_lock(content));
             if (qd_buffer_size(buf) == 0) {
-                DEQ_REMOVE_TAIL(msg->content->buffers);
+                DEQ_REMOVE_TAIL(content->buffers);
                 qd_buffer_free(buf);
             }
+            content->receive_complete = true;
+            sys_mutex_unlock(content_lock(content));
 
             char repr[qd_message_repr_len()];
             qd_log(log_source, QD_LOG_TRACE, "Received %s on link %s",
@@ -760,44 +1054,133 @@ qd_message_t *qd_message_receive(pn_delivery_t *delivery)
             // We have received a positive number of bytes for the message.  Advance
             // the cursor in the buffer.
             //
+            sys_mutex_lock(content_lock(content));
             qd_buffer_insert(buf, rc);
+            content->received_octets += rc;
 
             //
             // If the buffer is full, allocate a new empty buffer and append it to the
-            // tail of the message's list.
+            // tail of the message's list.  The new buffer is sized to the data received
+            // so far, so a large message moves to larger buffers as it arrives while
+            // the buffers never hold more than about twice the message.
             //
             if (qd_buffer_capacity(buf) == 0) {
-                buf = qd_buffer();
-                DEQ_INSERT_TAIL(msg->content->buffers, buf);
+                buf = qd_buffer_sized(content->received_octets);
+                DEQ_INSERT_TAIL(content->buffers, buf);
             }
+            sys_mutex_unlock(content_lock(content));
         } else
             //
             // We received zero bytes, and no PN_EOS.  This means that we've received
             // all of the data available up to this point, but it does not constitute
-            // the entire message.  We'll be back later to finish it up.
+            // the entire message.  We'll be back later to finish it up.  The partial
+            // message is returned so it can be forwarded before it is complete.
             //
             break;
     }
 
-    return 0;
+    return (qd_message_t*) msg;
+}
+
+
+//
+// Outgoing data is gathered from the content's buffer chain by reference while the content
+// lock is held, and copied into the link after the lock is released.  The bytes that have
+// been received are never modified and the buffers holding them live as long as the
+// content, so only the gathering needs the lock.  Senders fanning the same content out to
+// many links then copy it concurrently instead of one at a time.
+//
+#define QD_MESSAGE_SEND_IOV 16
+
+typedef struct {
+    pn_link_t    *pnl;
+    struct iovec  iov[QD_MESSAGE_SEND_IOV];
+    int           count;
+} send_gather_t;
+
+
+static void send_flush(send_gather_t *gather)
+{
+    for (int i = 0; i < gather->count; i++)
+        pn_link_send(gather->pnl, (const char*) gather->iov[i].iov_base, gather->iov[i].iov_len);
+    gather->count = 0;
+}
+
+
+static void send_gather(send_gather_t *gather, const unsigned char *start, size_t length)
+{
+    if (length == 0)
+        return;
+    if (gather->count == QD_MESSAGE_SEND_IOV)
+        send_flush(gather);
+    gather->iov[gather->count].iov_base = (void*) start;
+    gather->iov[gather->count].iov_len  = length;
+    gather->count++;
 }
 
 
 static void send_handler(void *context, const unsigned char *start, int length)
 {
-    pn_link_t *pnl = (pn_link_t*) context;
-    pn_link_send(pnl, (const char*) start, length);
+    send_gather((send_gather_t*) context, start, length);
+}
+
+
+//
+// Gather whatever has been received beyond the send cursor and advance the cursor past
+// it, stopping early if the gather array fills up.  If the message is still being
+// received, the cursor is left at the end of the received data so the send can be
+// resumed when more arrives.  The cursor is never moved onto the empty tail buffer
+// because that buffer is freed if the message ends without using it.  Returns true if
+// everything received so far has been gathered.
+//
+static bool send_gather_LH(qd_message_pvt_t *msg, send_gather_t *gather)
+{
+    qd_message_content_t *content = msg->content;
+    qd_buffer_t          *buf     = msg->cursor_buffer;
+    unsigned char        *cursor  = msg->cursor;
+    bool                  all     = true;
+
+    while (buf) {
+        size_t len = qd_buffer_size(buf) - (cursor - qd_buffer_base(buf));
+        if (len > 0) {
+            if (gather->count == QD_MESSAGE_SEND_IOV) {
+                all = false;
+                break;
+            }
+            send_gather(gather, cursor, len);
+            cursor += len;
+        }
+
+        qd_buffer_t *next = DEQ_NEXT(buf);
+        if (!next || (!content->receive_complete && qd_buffer_size(next) == 0))
+            break;
+        buf    = next;
+        cursor = qd_buffer_base(buf);
+    }
+    msg->cursor_buffer = buf;
+    msg->cursor        = cursor;
+    return all;
+}
+
+
+static qd_buffer_list_t *clone_list(qd_buffer_list_t *dst, const qd_buffer_list_t *src)
+{
+    qd_buffer_list_clone(dst, src);
+    return dst;
 }
 
 
 // create a buffer chain holding the outgoing message annotations section
 static void compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t *out, bool strip_annotations)
 {
+    qd_message_annotations_t *ma = msg->ma;
+
     qd_composed_field_t *out_ma = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
 
     bool map_started = false;
 
-    //We will have to add the custom annotations
+    //We will have to add the custom annotations.  The duplicate shares no iterators with
+    //the parsed annotations, which may be in use by other threads.
     qd_parsed_field_t *in_ma = qd_parse_dup(msg->content->parsed_message_annotations);
     if (in_ma) {
         uint32_t count = qd_parse_sub_count(in_ma);
@@ -807,9 +1190,7 @@ static void compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t
             if (!sub_key)
                 continue;
 
-            qd_iterator_t *iter = qd_parse_raw(sub_key);
-
-            if (!qd_iterator_prefix(iter, QD_MA_PREFIX)) {
+            if (!qd_parse_is_router_annotation(sub_key)) {
                 if (!map_started) {
                     qd_compose_start_map(out_ma);
                     map_started = true;
@@ -824,35 +1205,40 @@ static void compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t
     }
 
     //Add the dispatch router specific annotations only if strip_annotations is false.
-    if (!strip_annotations) {
-        if (!DEQ_IS_EMPTY(msg->ma_to_override) ||
-            !DEQ_IS_EMPTY(msg->ma_trace) ||
-            !DEQ_IS_EMPTY(msg->ma_ingress) ||
-            msg->ma_phase != 0) {
+    //
+    // The annotation block may be shared, so insert copies of its fields.
+    //
+    qd_buffer_list_t field;
+
+    if (!strip_annotations && ma) {
+        if (!DEQ_IS_EMPTY(ma->ma_to_override) ||
+            !DEQ_IS_EMPTY(ma->ma_trace) ||
+            !DEQ_IS_EMPTY(ma->ma_ingress) ||
+            ma->ma_phase != 0) {
 
             if (!map_started) {
                 qd_compose_start_map(out_ma);
                 map_started = true;
             }
 
-            if (!DEQ_IS_EMPTY(msg->ma_to_override)) {
-                qd_compose_insert_symbol(out_ma, QD_MA_TO);
-                qd_compose_insert_buffers(out_ma, &msg->ma_to_override);
+            if (!DEQ_IS_EMPTY(ma->ma_to_override)) {
+                qd_compose_insert_fragment(out_ma, &QD_MA_TO_KEY);
+                qd_compose_insert_buffers(out_ma, clone_list(&field, &ma->ma_to_override));
             }
 
-            if (!DEQ_IS_EMPTY(msg->ma_trace)) {
-                qd_compose_insert_symbol(out_ma, QD_MA_TRACE);
-                qd_compose_insert_buffers(out_ma, &msg->ma_trace);
+            if (!DEQ_IS_EMPTY(ma->ma_trace)) {
+                qd_compose_insert_fragment(out_ma, &QD_MA_TRACE_KEY);
+                qd_compose_insert_buffers(out_ma, clone_list(&field, &ma->ma_trace));
             }
 
-            if (!DEQ_IS_EMPTY(msg->ma_ingress)) {
-                qd_compose_insert_symbol(out_ma, QD_MA_INGRESS);
-                qd_compose_insert_buffers(out_ma, &msg->ma_ingress);
+            if (!DEQ_IS_EMPTY(ma->ma_ingress)) {
+                qd_compose_insert_fragment(out_ma, &QD_MA_INGRESS_KEY);
+                qd_compose_insert_buffers(out_ma, clone_list(&field, &ma->ma_ingress));
             }
 
-            if (msg->ma_phase != 0) {
-                qd_compose_insert_symbol(out_ma, QD_MA_PHASE);
-                qd_compose_insert_int(out_ma, msg->ma_phase);
+            if (ma->ma_phase != 0) {
+                qd_compose_insert_fragment(out_ma, &QD_MA_PHASE_KEY);
+                qd_compose_insert_int(out_ma, ma->ma_phase);
             }
         }
     }
@@ -865,127 +1251,185 @@ static void compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t
     qd_compose_free(out_ma);
 }
 
+/**
+ * Return the encoded annotations section to send ahead of the message body.  The first
+ * sender composes it into the annotation block, where it is shared by all the copies of
+ * the message.  A sender that finds another thread composing the block's section, or a
+ * message with no block, composes a private section into scratch.
+ */
+static const qd_buffer_list_t *outgoing_message_annotations(qd_message_pvt_t *msg, bool strip_annotations,
+                                                            qd_buffer_list_t *scratch)
+{
+    qd_message_annotations_t *ma = msg->ma;
+
+    if (ma) {
+        int idx   = strip_annotations ? 1 : 0;
+        int state = __atomic_load_n(&ma->composed_state[idx], __ATOMIC_ACQUIRE);
+        if (state == QD_MA_COMPOSED)
+            return &ma->composed[idx];
+
+        if (state == QD_MA_NOT_COMPOSED &&
+            __atomic_compare_exchange_n(&ma->composed_state[idx], &state, QD_MA_COMPOSING, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            compose_message_annotations(msg, &ma->composed[idx], strip_annotations);
+            __atomic_store_n(&ma->composed_state[idx], QD_MA_COMPOSED, __ATOMIC_RELEASE);
+            return &ma->composed[idx];
+        }
+    }
+
+    compose_message_annotations(msg, scratch, strip_annotations);
+    return scratch;
+}
+
+
 void qd_message_send(qd_message_t *in_msg,
                      qd_link_t    *link,
                      bool          strip_annotations)
 {
     qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
     qd_message_content_t *content = msg->content;
-    qd_buffer_t          *buf     = DEQ_HEAD(content->buffers);
+    qd_buffer_t          *buf;
     unsigned char        *cursor;
     pn_link_t            *pnl     = qd_link_pn(link);
+    send_gather_t         gather;
 
-    char repr[qd_message_repr_len()];
-    qd_log(log_source, QD_LOG_TRACE, "Sending %s on link %s",
-           qd_message_repr(in_msg, repr, sizeof(repr)),
-           pn_link_name(pnl));
+    if (msg->send_complete)
+        return;
 
-    qd_buffer_list_t new_ma;
-    DEQ_INIT(new_ma);
+    gather.pnl   = pnl;
+    gather.count = 0;
 
-    // Process  the message annotations if any
-    compose_message_annotations(msg, &new_ma, strip_annotations);
+    if (!msg->send_started) {
+        //
+        // The message annotations are replaced on the way out, so nothing can be sent
+        // until everything through the message annotations has been received.
+        //
+        qd_message_depth_status_t status = qd_message_check_depth(in_msg, QD_DEPTH_MESSAGE_ANNOTATIONS);
+        if (status == QD_MESSAGE_DEPTH_INCOMPLETE)
+            return;
+        if (status == QD_MESSAGE_DEPTH_INVALID) {
+            qd_log(log_source, QD_LOG_ERROR, "Cannot send: %s", qd_error_message());
+            msg->send_complete = true;
+            return;
+        }
 
-    //
-    // This is the case where the message annotations have been modified.
-    // The message send must be divided into sections:  The existing header;
-    // the new message annotations; the rest of the existing message.
-    // Note that the original message annotations that are still in the
-    // buffer chain must not be sent.
-    //
-    // Start by making sure that we've parsed the message sections through
-    // the message annotations
-    //
-    // ??? NO LONGER NECESSARY???
-    if (!qd_message_check(in_msg, QD_DEPTH_MESSAGE_ANNOTATIONS)) {
-        qd_log(log_source, QD_LOG_ERROR, "Cannot send: %s", qd_error_message);
-        return;
-    }
+        char repr[qd_message_repr_len()];
+        qd_log(log_source, QD_LOG_TRACE, "Sending %s on link %s",
+               qd_message_repr(in_msg, repr, sizeof(repr)),
+               pn_link_name(pnl));
 
-    //
-    // Send header if present
-    //
-    cursor = qd_buffer_base(buf);
-    if (content->section_message_header.length > 0) {
-        buf    = content->section_message_header.buffer;
-        cursor = content->section_message_header.offset + qd_buffer_base(buf);
-        advance(&cursor, &buf,
-                content->section_message_header.length + content->section_message_header.hdr_length,
-                send_handler, (void*) pnl);
-    }
+        qd_buffer_list_t scratch_ma;
+        DEQ_INIT(scratch_ma);
 
-    //
-    // Send new message annotations
-    //
-    qd_buffer_t *da_buf = DEQ_HEAD(new_ma);
-    while (da_buf) {
-        char *to_send = (char*) qd_buffer_base(da_buf);
-        pn_link_send(pnl, to_send, qd_buffer_size(da_buf));
-        da_buf = DEQ_NEXT(da_buf);
-    }
-    qd_buffer_list_free_buffers(&new_ma);
+        // Process  the message annotations if any
+        qd_message_message_annotations(in_msg);
+        const qd_buffer_list_t *new_ma = outgoing_message_annotations(msg, strip_annotations, &scratch_ma);
 
-    //
-    // Skip over replaced message annotations
-    //
-    if (content->section_message_annotation.length > 0)
-        advance(&cursor, &buf,
-                content->section_message_annotation.hdr_length + content->section_message_annotation.length,
-                0, 0);
+        //
+        // This is the case where the message annotations have been modified.
+        // The message send must be divided into sections:  The existing header;
+        // the new message annotations; the rest of the existing message.
+        // Note that the original message annotations that are still in the
+        // buffer chain must not be sent.
+        //
+        sys_mutex_lock(content_lock(content));
 
-    //
-    // Send remaining partial buffer
-    //
-    if (buf) {
-        size_t len = qd_buffer_size(buf) - (cursor - qd_buffer_base(buf));
-        advance(&cursor, &buf, len, send_handler, (void*) pnl);
-    }
+        //
+        // Gather header if present
+        //
+        buf    = DEQ_HEAD(content->buffers);
+        cursor = qd_buffer_base(buf);
+        if (content->section_message_header.length > 0) {
+            buf    = content->section_message_header.buffer;
+            cursor = content->section_message_header.offset + qd_buffer_base(buf);
+            advance(&cursor, &buf,
+                    content->section_message_header.length + content->section_message_header.hdr_length,
+                    send_handler, (void*) &gather);
+        }
+
+        //
+        // Skip over replaced message annotations
+        //
+        if (content->section_message_annotation.length > 0)
+            advance(&cursor, &buf,
+                    content->section_message_annotation.hdr_length + content->section_message_annotation.length,
+                    0, 0);
 
-    // Fall through to process the remaining buffers normally
-    // Note that 'advance' will have moved us to the next buffer in the chain.
+        msg->cursor_buffer = buf;
+        msg->cursor        = cursor;
+        msg->send_started  = true;
+        sys_mutex_unlock(content_lock(content));
 
+        //
+        // Send the header followed by the new message annotations
+        //
+        qd_buffer_t *da_buf = DEQ_HEAD(*new_ma);
+        while (da_buf) {
+            send_gather(&gather, qd_buffer_base(da_buf), qd_buffer_size(da_buf));
+            da_buf = DEQ_NEXT(da_buf);
+        }
+        send_flush(&gather);
 
-    while (buf) {
-        pn_link_send(pnl, (char*) qd_buffer_base(buf), qd_buffer_size(buf));
-        buf = DEQ_NEXT(buf);
+        qd_buffer_list_free_buffers(&scratch_ma);
     }
+
+    //
+    // Send whatever has been received beyond the cursor.
+    //
+    bool all;
+    do {
+        sys_mutex_lock(content_lock(content));
+        all = send_gather_LH(msg, &gather);
+        if (all)
+            msg->send_complete = content->receive_complete || content->aborted;
+        sys_mutex_unlock(content_lock(content));
+
+        send_flush(&gather);
+    } while (!all);
 }
 
 
-static int qd_check_field_LH(qd_message_content_t *content,
-                             qd_message_depth_t    depth,
-                             const unsigned char  *long_pattern,
-                             const unsigned char  *short_pattern,
-                             const unsigned char  *expected_tags,
-                             qd_field_location_t  *location,
-                             int                   more)
+static qd_message_depth_status_t qd_check_field_LH(qd_message_content_t *content,
+                                                   qd_message_depth_t    depth,
+                                                   const unsigned char  *long_pattern,
+                                                   const unsigned char  *short_pattern,
+                                                   const unsigned char  *expected_tags,
+                                                   qd_field_location_t  *location,
+                                                   int                   more)
 {
 #define LONG  10
 #define SHORT 3
     if (depth > content->parse_depth) {
-        if (0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, long_pattern,  LONG,  expected_tags, location))
-            return 0;
-        if (0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, short_pattern, SHORT, expected_tags, location))
-            return 0;
+        qd_message_depth_status_t rc;
+        rc = qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, long_pattern,  LONG,
+                                  expected_tags, location, content->receive_complete);
+        if (rc != QD_MESSAGE_DEPTH_OK)
+            return rc;
+        rc = qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, short_pattern, SHORT,
+                                  expected_tags, location, content->receive_complete);
+        if (rc != QD_MESSAGE_DEPTH_OK)
+            return rc;
         if (!more)
             content->parse_depth = depth;
     }
-    return 1;
+    return QD_MESSAGE_DEPTH_OK;
 }
 
 
-static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_t depth)
+static qd_message_depth_status_t qd_message_parse_LH(qd_message_content_t *content, qd_message_depth_t depth)
 {
-    qd_error_clear();
     qd_buffer_t *buffer  = DEQ_HEAD(content->buffers);
+    qd_message_depth_status_t rc;
 
     if (!buffer) {
+        if (!content->receive_complete)
+            return QD_MESSAGE_DEPTH_INCOMPLETE;
         qd_error(QD_ERROR_MESSAGE, "No data");
-        return false;
+        return QD_MESSAGE_DEPTH_INVALID;
     }
 
     if (depth <= content->parse_depth)
-        return true; // We've already parsed at least this deep
+        return QD_MESSAGE_DEPTH_OK; // We've already parsed at least this deep
 
     if (content->parse_buffer == 0) {
         content->parse_buffer = buffer;
@@ -993,62 +1437,72 @@ static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_
     }
 
     if (depth == QD_DEPTH_NONE)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // MESSAGE HEADER
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_HEADER,
-                               MSG_HDR_LONG, MSG_HDR_SHORT, TAGS_LIST, &content->section_message_header, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid header");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_HEADER,
+                           MSG_HDR_LONG, MSG_HDR_SHORT, TAGS_LIST, &content->section_message_header, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid header");
+        return rc;
     }
     if (depth == QD_DEPTH_HEADER)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // DELIVERY ANNOTATION
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_DELIVERY_ANNOTATIONS,
-                               DELIVERY_ANNOTATION_LONG, DELIVERY_ANNOTATION_SHORT, TAGS_MAP, &content->section_delivery_annotation, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid delivery-annotations");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_DELIVERY_ANNOTATIONS,
+                           DELIVERY_ANNOTATION_LONG, DELIVERY_ANNOTATION_SHORT, TAGS_MAP, &content->section_delivery_annotation, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid delivery-annotations");
+        return rc;
     }
     if (depth == QD_DEPTH_DELIVERY_ANNOTATIONS)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // MESSAGE ANNOTATION
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_MESSAGE_ANNOTATIONS,
-                               MESSAGE_ANNOTATION_LONG, MESSAGE_ANNOTATION_SHORT, TAGS_MAP, &content->section_message_annotation, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid annotations");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_MESSAGE_ANNOTATIONS,
+                           MESSAGE_ANNOTATION_LONG, MESSAGE_ANNOTATION_SHORT, TAGS_MAP, &content->section_message_annotation, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid annotations");
+        return rc;
     }
     if (depth == QD_DEPTH_MESSAGE_ANNOTATIONS)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // PROPERTIES
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_PROPERTIES,
-                               PROPERTIES_LONG, PROPERTIES_SHORT, TAGS_LIST, &content->section_message_properties, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid message properties");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_PROPERTIES,
+                           PROPERTIES_LONG, PROPERTIES_SHORT, TAGS_LIST, &content->section_message_properties, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid message properties");
+        return rc;
     }
     if (depth == QD_DEPTH_PROPERTIES)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // APPLICATION PROPERTIES
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_APPLICATION_PROPERTIES,
-                               APPLICATION_PROPERTIES_LONG, APPLICATION_PROPERTIES_SHORT, TAGS_MAP, &content->section_application_properties, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid application-properties");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_APPLICATION_PROPERTIES,
+                           APPLICATION_PROPERTIES_LONG, APPLICATION_PROPERTIES_SHORT, TAGS_MAP, &content->section_application_properties, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid application-properties");
+        return rc;
     }
     if (depth == QD_DEPTH_APPLICATION_PROPERTIES)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // BODY
@@ -1056,47 +1510,119 @@ static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_
     // not a problem for messages passing through Dispatch because through-only messages won't
     // be parsed to BODY-depth.
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_DATA_LONG, BODY_DATA_SHORT, TAGS_BINARY, &content->section_body, 1)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body data");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_DATA_LONG, BODY_DATA_SHORT, TAGS_BINARY, &content->section_body, 1);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid body data");
+        return rc;
     }
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_SEQUENCE_LONG, BODY_SEQUENCE_SHORT, TAGS_LIST, &content->section_body, 1)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body sequence");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_SEQUENCE_LONG, BODY_SEQUENCE_SHORT, TAGS_LIST, &content->section_body, 1);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid body sequence");
+        return rc;
     }
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_VALUE_LONG, BODY_VALUE_SHORT, TAGS_ANY, &content->section_body, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body value");
-        return false;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_VALUE_LONG, BODY_VALUE_SHORT, TAGS_ANY, &content->section_body, 0);
+    if (rc != QD_MESSAGE_DEPTH_OK) {
+        if (rc == QD_MESSAGE_DEPTH_INVALID)
+            qd_error(QD_ERROR_MESSAGE, "Invalid body value");
+        return rc;
     }
     if (depth == QD_DEPTH_BODY)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // FOOTER
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_ALL,
-                               FOOTER_LONG, FOOTER_SHORT, TAGS_MAP, &content->section_footer, 0)) {
-
+    rc = qd_check_field_LH(content, QD_DEPTH_ALL,
+                           FOOTER_LONG, FOOTER_SHORT, TAGS_MAP, &content->section_footer, 0);
+    if (rc == QD_MESSAGE_DEPTH_INVALID)
         qd_error(QD_ERROR_MESSAGE, "Invalid footer");
-        return false;
+
+    return rc;
+}
+
+
+static qd_message_depth_status_t qd_message_check_LH(qd_message_content_t *content, qd_message_depth_t depth)
+{
+    qd_error_clear();
+
+    //
+    // If a previous parse stopped at the end of a buffer that has since been followed by
+    // another, resume at the start of the next buffer.
+    //
+    if (content->parse_buffer &&
+        content->parse_cursor == qd_buffer_base(content->parse_buffer) + qd_buffer_size(content->parse_buffer) &&
+        DEQ_NEXT(content->parse_buffer)) {
+        content->parse_buffer = DEQ_NEXT(content->parse_buffer);
+        content->parse_cursor = qd_buffer_base(content->parse_buffer);
     }
 
-    return true;
+    if (content->receive_complete)
+        return qd_message_parse_LH(content, depth);
+
+    //
+    // The message is still arriving.  The parse may run out of data part-way through a
+    // section, so remember where it started and roll back if it could not finish.
+    //
+    qd_field_location_t *sections[] = {&content->section_message_header,
+                                       &content->section_delivery_annotation,
+                                       &content->section_message_annotation,
+                                       &content->section_message_properties,
+                                       &content->section_application_properties,
+                                       &content->section_body,
+                                       &content->section_footer};
+    const int            section_count = sizeof(sections) / sizeof(sections[0]);
+    qd_field_location_t  saved[section_count];
+    qd_buffer_t         *saved_buffer = content->parse_buffer;
+    unsigned char       *saved_cursor = content->parse_cursor;
+    qd_message_depth_t   saved_depth  = content->parse_depth;
+
+    for (int i = 0; i < section_count; i++)
+        saved[i] = *sections[i];
+
+    qd_message_depth_status_t rc = qd_message_parse_LH(content, depth);
+
+    //
+    // If the parse consumed everything received so far, the cursor has run off the end
+    // of the buffer chain.  Park it at the end of the tail buffer so the next parse
+    // picks up from there when more data arrives.
+    //
+    if (rc == QD_MESSAGE_DEPTH_OK && content->parse_depth > saved_depth && !content->parse_cursor) {
+        content->parse_buffer = DEQ_TAIL(content->buffers);
+        content->parse_cursor = qd_buffer_base(content->parse_buffer) + qd_buffer_size(content->parse_buffer);
+    }
+
+    if (rc == QD_MESSAGE_DEPTH_INCOMPLETE) {
+        for (int i = 0; i < section_count; i++)
+            *sections[i] = saved[i];
+        content->parse_buffer = saved_buffer;
+        content->parse_cursor = saved_cursor;
+        content->parse_depth  = saved_depth;
+    }
+
+    return rc;
 }
 
 
 int qd_message_check(qd_message_t *in_msg, qd_message_depth_t depth)
 {
-    qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
-    qd_message_content_t *content = msg->content;
-    int                   result;
+    return qd_message_check_depth(in_msg, depth) == QD_MESSAGE_DEPTH_OK;
+}
+
+
+qd_message_depth_status_t qd_message_check_depth(const qd_message_t *in_msg, qd_message_depth_t depth)
+{
+    qd_message_pvt_t         *msg     = (qd_message_pvt_t*) in_msg;
+    qd_message_content_t     *content = msg->content;
+    qd_message_depth_status_t result;
 
-    sys_mutex_lock(content->lock);
+    sys_mutex_lock(content_lock(content));
     result = qd_message_check_LH(content, depth);
-    sys_mutex_unlock(content->lock);
+    sys_mutex_unlock(content_lock(content));
     return result;
 }
 
@@ -60,12 +60,12 @@ typedef struct {
 
 
 // TODO - consider using pointers to qd_field_location_t below to save memory
-// TODO - provide a way to allocate a message without a lock for the link-routing case.
-//        It's likely that link-routing will cause no contention for the message content.
+//
+// Contents have no lock of their own; message.c maps each content to one of a shared
+// set of locks.
 //
 
 typedef struct {
-    sys_mutex_t         *lock;
     sys_atomic_t         ref_count;                       // The number of messages referencing this
     qd_buffer_list_t     buffers;                         // The buffer chain containing the message
     qd_field_location_t  section_message_header;          // The message header list
@@ -82,29 +82,60 @@ typedef struct {
     qd_field_location_t  field_reply_to;                  // The string value of the reply_to field
     qd_field_location_t  field_correlation_id;            // The string value of the correlation_id field
     qd_field_location_t  body;                            // The body of the message
+    bool                 properties_scanned;              // True once the field_* locations have been recorded
     qd_buffer_t         *parse_buffer;
     unsigned char       *parse_cursor;
     qd_message_depth_t   parse_depth;
     qd_parsed_field_t   *parsed_message_annotations;
+    size_t               received_octets;                 // Octets received so far, used to size new buffers
+    bool                 receive_complete;                // True if the message has been completely received
+    bool                 aborted;                         // True if the reception was abandoned
 } qd_message_content_t;
 
+//
+// The router's outgoing message annotations.  A block is shared by a message and all of
+// its copies and is immutable while shared; a message that changes its annotations gets
+// a private block first.  The encoded annotations section is composed at most once per
+// strip mode and kept with the block.
+//
+typedef enum {
+    QD_MA_NOT_COMPOSED,
+    QD_MA_COMPOSING,
+    QD_MA_COMPOSED
+} qd_ma_compose_state_t;
+
 typedef struct {
-    DEQ_LINKS(qd_message_t);   // Deque linkage that overlays the qd_message_t
-    qd_message_content_t *content;
+    sys_atomic_t          ref_count;
     qd_buffer_list_t      ma_to_override;  // to field in outgoing message annotations.
     qd_buffer_list_t      ma_trace;        // trace list in outgoing message annotations
     qd_buffer_list_t      ma_ingress;      // ingress field in outgoing message annotations
     int                   ma_phase;        // phase for the override address
+    int                   composed_state[2];  // qd_ma_compose_state_t, indexed by strip mode
+    qd_buffer_list_t      composed[2];        // encoded annotations section, indexed by strip mode
+} qd_message_annotations_t;
+
+typedef struct {
+    DEQ_LINKS(qd_message_t);   // Deque linkage that overlays the qd_message_t
+    qd_message_content_t *content;
+    qd_message_annotations_t *ma;          // outgoing annotations, shared with copies; 0 if none
+    qd_buffer_t          *cursor_buffer;   // buffer holding the next octet to be sent
+    unsigned char        *cursor;          // next octet to be sent
+    bool                  send_started;    // true once the header and annotations have been sent
+    bool                  send_complete;   // true once the entire message has been sent
 } qd_message_pvt_t;
 
 ALLOC_DECLARE(qd_message_t);
 ALLOC_DECLARE(qd_message_content_t);
+ALLOC_DECLARE(qd_message_annotations_t);
 
 #define MSG_CONTENT(m) (((qd_message_pvt_t*) m)->content)
 
 /** Initialize logging */
 void qd_message_initialize();
 
+/** Free the content locks.  No message may be in use. */
+void qd_message_finalize();
+
 ///@}
 
 #endif
@@ -21,21 +21,141 @@
 #include <qpid/dispatch/ctools.h>
 #include <qpid/dispatch/parse.h>
 #include <qpid/dispatch/amqp.h>
+#include <string.h>
 
 DEQ_DECLARE(qd_parsed_field_t, qd_parsed_field_list_t);
 
+#define ROUTER_KEY_NONE  -1   // Not a router annotation key
+#define ROUTER_KEY_OTHER -2   // A router annotation key that isn't indexed
+
 struct qd_parsed_field_t {
     DEQ_LINKS(qd_parsed_field_t);
     const qd_parsed_field_t *parent;
     qd_parsed_field_list_t   children;
+    struct qd_parse_arena_t *arena;         // Set in the root field only
     uint8_t                  tag;
-    qd_iterator_t           *raw_iter;
-    qd_iterator_t           *typed_iter;
+    int                      router_key;    // qd_ma_key_t or ROUTER_KEY_* for map keys
+    qd_iterator_view_t       view;
+    qd_iterator_pointer_t    typed_start;   // Position of the tag
+    uint32_t                 typed_length;
+    qd_iterator_pointer_t    raw_start;     // Position of the value following the tag
+    uint32_t                 raw_length;
+    qd_iterator_t           *raw_iter;      // Created on first use
+    qd_iterator_t           *typed_iter;    // Created on first use
     const char              *parse_error;
 };
 
-ALLOC_DECLARE(qd_parsed_field_t);
-ALLOC_DEFINE(qd_parsed_field_t);
+//
+// The fields of a parsed tree are carved out of a chain of arenas owned by the root.
+//
+#define ARENA_FIELDS 16
+
+typedef struct qd_parse_arena_t qd_parse_arena_t;
+struct qd_parse_arena_t {
+    qd_parse_arena_t  *next;
+    qd_parse_arena_t  *tail;                         // Last arena of the chain (root arena only)
+    int                used;
+    qd_parsed_field_t *ma_values[QD_MA_KEY_COUNT];   // Values of the indexed router annotations
+    qd_parsed_field_t  fields[ARENA_FIELDS];
+};
+
+ALLOC_DECLARE(qd_parse_arena_t);
+ALLOC_DEFINE(qd_parse_arena_t);
+
+static const char * const *router_keys[QD_MA_KEY_COUNT] = {
+    &QD_MA_INGRESS,
+    &QD_MA_TRACE,
+    &QD_MA_TO,
+    &QD_MA_PHASE
+};
+
+
+static qd_parse_arena_t *arena(void)
+{
+    qd_parse_arena_t *arena = new_qd_parse_arena_t();
+    if (arena) {
+        arena->next = 0;
+        arena->tail = arena;
+        arena->used = 0;
+        memset(arena->ma_values, 0, sizeof(arena->ma_values));
+    }
+    return arena;
+}
+
+
+static qd_parsed_field_t *arena_field(qd_parse_arena_t *root_arena)
+{
+    qd_parse_arena_t *last = root_arena->tail;
+
+    if (last->used == ARENA_FIELDS) {
+        last->next = arena();
+        if (!last->next)
+            return 0;
+        last = root_arena->tail = last->next;
+    }
+
+    qd_parsed_field_t *field = &last->fields[last->used++];
+    ZERO(field);
+    DEQ_ITEM_INIT(field);
+    DEQ_INIT(field->children);
+    field->router_key = ROUTER_KEY_NONE;
+    return field;
+}
+
+
+//
+// Classify a map key that the iterator has just been advanced past.
+//
+static int router_key(qd_iterator_t *iter, const qd_parsed_field_t *key)
+{
+    if (key->tag != QD_AMQP_SYM8 && key->tag != QD_AMQP_SYM32 &&
+        key->tag != QD_AMQP_STR8_UTF8 && key->tag != QD_AMQP_STR32_UTF8)
+        return ROUTER_KEY_NONE;
+
+    qd_iterator_pointer_t save;
+    qd_iterator_pointer_t text = key->raw_start;
+    int                   result = ROUTER_KEY_NONE;
+
+    qd_iterator_get_view_cursor(iter, &save);
+    if (text.remaining > key->raw_length)
+        text.remaining = key->raw_length;
+    qd_iterator_set_view_cursor(iter, &text);
+
+    if (qd_iterator_prefix(iter, QD_MA_PREFIX)) {
+        result = ROUTER_KEY_OTHER;
+        size_t prefix_length = strlen(QD_MA_PREFIX);
+        for (int k = 0; k < QD_MA_KEY_COUNT; k++) {
+            if (qd_iterator_prefix(iter, *router_keys[k] + prefix_length)) {
+                if (qd_iterator_end(iter))
+                    result = k;
+                break;
+            }
+        }
+    }
+
+    qd_iterator_set_view_cursor(iter, &save);
+    return result;
+}
+
+
+//
+// Index the values of the router annotations in a parsed map.  If a key appears more
+// than once, the last value wins.
+//
+static void index_router_keys(qd_parsed_field_t *root)
+{
+    if (root->tag != QD_AMQP_MAP8 && root->tag != QD_AMQP_MAP32)
+        return;
+
+    qd_parsed_field_t *key = DEQ_HEAD(root->children);
+    while (key && DEQ_NEXT(key)) {
+        qd_parsed_field_t *value = DEQ_NEXT(key);
+        if (key->router_key >= 0)
+            root->arena->ma_values[key->router_key] = value;
+        key = DEQ_NEXT(value);
+    }
+}
+
 
 /**
  * size = the number of bytes following the tag
@@ -121,17 +241,15 @@ static char *get_type_info(qd_iterator_t *iter, uint8_t *tag, uint32_t *size, ui
     return 0;
 }
 
-static qd_parsed_field_t *qd_parse_internal(qd_iterator_t *iter, qd_parsed_field_t *p)
+static qd_parsed_field_t *qd_parse_internal(qd_iterator_t *iter, qd_parsed_field_t *p, qd_parse_arena_t *root_arena)
 {
-    qd_parsed_field_t *field = new_qd_parsed_field_t();
+    qd_parsed_field_t *field = arena_field(root_arena);
     if (!field)
         return 0;
 
-    DEQ_ITEM_INIT(field);
-    DEQ_INIT(field->children);
-    field->parent   = p;
-    field->raw_iter = 0;
-    field->typed_iter = qd_iterator_dup(iter);
+    field->parent = p;
+    field->view   = qd_iterator_get_view(iter);
+    qd_iterator_get_view_cursor(iter, &field->typed_start);
 
     uint32_t size            = 0;
     uint32_t count           = 0;
@@ -141,20 +259,37 @@ static qd_parsed_field_t *qd_parse_internal(qd_iterator_t *iter, qd_parsed_field
     field->parse_error = get_type_info(iter, &field->tag, &size, &count, &length_of_size, &length_of_count);
 
     if (!field->parse_error) {
-        qd_iterator_trim_view(field->typed_iter, size + length_of_size + 1); // + 1 accounts for the tag length
-
-        field->raw_iter = qd_iterator_sub(iter, size - length_of_count);
-
-        qd_iterator_advance(iter, size - length_of_count);
-
+        field->typed_length = size + length_of_size + 1; // + 1 accounts for the tag length
+        field->raw_length   = size - length_of_count;
+        qd_iterator_get_view_cursor(iter, &field->raw_start);
+
+        //
+        // Parse the elements of a compound with the iterator limited to the compound's
+        // value, then step past the value.
+        //
+        qd_iterator_pointer_t limit = field->raw_start;
+        if (limit.remaining > field->raw_length)
+            limit.remaining = field->raw_length;
+        qd_iterator_set_view_cursor(iter, &limit);
+
+        bool is_map = field->tag == QD_AMQP_MAP8 || field->tag == QD_AMQP_MAP32;
         for (uint32_t idx = 0; idx < count; idx++) {
-            qd_parsed_field_t *child = qd_parse_internal(field->raw_iter, field);
+            qd_parsed_field_t *child = qd_parse_internal(iter, field, root_arena);
+            if (!child) {
+                field->parse_error = "Insufficient Memory";
+                break;
+            }
             DEQ_INSERT_TAIL(field->children, child);
             if (!qd_parse_ok(child)) {
                 field->parse_error = child->parse_error;
                 break;
             }
+            if (is_map && p == 0 && (idx & 1) == 0)
+                child->router_key = router_key(iter, child);
         }
+
+        qd_iterator_set_view_cursor(iter, &field->raw_start);
+        qd_iterator_advance(iter, field->raw_length);
     }
 
     return field;
@@ -165,7 +300,19 @@ qd_parsed_field_t *qd_parse(qd_iterator_t *iter)
 {
     if (!iter)
         return 0;
-    return qd_parse_internal(iter, 0);
+
+    qd_parse_arena_t *root_arena = arena();
+    if (!root_arena)
+        return 0;
+
+    qd_parsed_field_t *root = qd_parse_internal(iter, 0, root_arena);
+    if (!root) {
+        free_qd_parse_arena_t(root_arena);
+        return 0;
+    }
+    root->arena = root_arena;
+    index_router_keys(root);
+    return root;
 }
 
 
@@ -175,42 +322,41 @@ void qd_parse_free(qd_parsed_field_t *field)
         return;
 
     assert(field->parent == 0);
-    if (field->raw_iter)
-        qd_iterator_free(field->raw_iter);
-
-    if (field->typed_iter)
-        qd_iterator_free(field->typed_iter);
-
-    qd_parsed_field_t *sub_field = DEQ_HEAD(field->children);
-    while (sub_field) {
-        qd_parsed_field_t *next = DEQ_NEXT(sub_field);
-        DEQ_REMOVE_HEAD(field->children);
-        sub_field->parent = 0;
-        qd_parse_free(sub_field);
-        sub_field = next;
+    qd_parse_arena_t *arena = field->arena;
+    while (arena) {
+        qd_parse_arena_t *next = arena->next;
+        for (int i = 0; i < arena->used; i++) {
+            qd_iterator_free(arena->fields[i].raw_iter);
+            qd_iterator_free(arena->fields[i].typed_iter);
+        }
+        free_qd_parse_arena_t(arena);
+        arena = next;
     }
-
-    free_qd_parsed_field_t(field);
 }
 
 
-static qd_parsed_field_t *qd_parse_dup_internal(const qd_parsed_field_t *field, const qd_parsed_field_t *parent)
+static qd_parsed_field_t *qd_parse_dup_internal(const qd_parsed_field_t *field, const qd_parsed_field_t *parent, qd_parse_arena_t *root_arena)
 {
-    qd_parsed_field_t *dup = new_qd_parsed_field_t();
+    qd_parsed_field_t *dup = arena_field(root_arena);
 
     if (dup == 0)
         return 0;
 
-    ZERO(dup);
-    dup->parent      = parent;
-    dup->tag         = field->tag;
-    dup->raw_iter    = qd_iterator_dup(field->raw_iter);
-    dup->typed_iter  = qd_iterator_dup(field->typed_iter);
-    dup->parse_error = field->parse_error;
+    dup->parent       = parent;
+    dup->tag          = field->tag;
+    dup->router_key   = field->router_key;
+    dup->view         = field->view;
+    dup->typed_start  = field->typed_start;
+    dup->typed_length = field->typed_length;
+    dup->raw_start    = field->raw_start;
+    dup->raw_length   = field->raw_length;
+    dup->parse_error  = field->parse_error;
 
     qd_parsed_field_t *child = DEQ_HEAD(field->children);
     while (child) {
-        qd_parsed_field_t *dup_child = qd_parse_dup_internal(child, field);
+        qd_parsed_field_t *dup_child = qd_parse_dup_internal(child, dup, root_arena);
+        if (!dup_child)
+            break;
         DEQ_INSERT_TAIL(dup->children, dup_child);
         child = DEQ_NEXT(child);
     }
@@ -221,7 +367,17 @@ static qd_parsed_field_t *qd_parse_dup_internal(const qd_parsed_field_t *field,
 
 qd_parsed_field_t *qd_parse_dup(const qd_parsed_field_t *field)
 {
-    return field ? qd_parse_dup_internal(field, 0) : 0;
+    if (!field)
+        return 0;
+
+    qd_parse_arena_t *root_arena = arena();
+    if (!root_arena)
+        return 0;
+
+    qd_parsed_field_t *dup = qd_parse_dup_internal(field, 0, root_arena);
+    dup->arena = root_arena;
+    index_router_keys(dup);
+    return dup;
 }
 
 
@@ -243,15 +399,39 @@ uint8_t qd_parse_tag(qd_parsed_field_t *field)
 }
 
 
+//
+// Create an iterator for a field on first use.  A parsed tree may be shared by threads, so
+// only one of the iterators created concurrently is kept.
+//
+static qd_iterator_t *field_iterator(qd_iterator_t **iter, const qd_iterator_pointer_t *start, uint32_t length, qd_iterator_view_t view)
+{
+    qd_iterator_t *result = __atomic_load_n(iter, __ATOMIC_ACQUIRE);
+    if (result)
+        return result;
+
+    result = qd_iterator_sub_pointer(start, length, view);
+    qd_iterator_t *expected = 0;
+    if (!__atomic_compare_exchange_n(iter, &expected, result, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        qd_iterator_free(result);
+        result = expected;
+    }
+    return result;
+}
+
+
 qd_iterator_t *qd_parse_raw(qd_parsed_field_t *field)
 {
-    return field->raw_iter;
+    if (field->parse_error)
+        return 0;
+    return field_iterator(&field->raw_iter, &field->raw_start, field->raw_length, field->view);
 }
 
 
 qd_iterator_t *qd_parse_typed(qd_parsed_field_t *field)
 {
-    return field->typed_iter;
+    if (field->parse_error)
+        return 0;
+    return field_iterator(&field->typed_iter, &field->typed_start, field->typed_length, field->view);
 }
 
 
@@ -259,22 +439,23 @@ uint32_t qd_parse_as_uint(qd_parsed_field_t *field)
 {
     uint32_t result = 0;
 
-    qd_iterator_reset(field->raw_iter);
+    qd_iterator_t *raw = qd_parse_raw(field);
+    qd_iterator_reset(raw);
 
     switch (field->tag) {
     case QD_AMQP_UINT:
-        result |= ((uint32_t) qd_iterator_octet(field->raw_iter)) << 24;
-        result |= ((uint32_t) qd_iterator_octet(field->raw_iter)) << 16;
+        result |= ((uint32_t) qd_iterator_octet(raw)) << 24;
+        result |= ((uint32_t) qd_iterator_octet(raw)) << 16;
         // fallthrough
 
     case QD_AMQP_USHORT:
-        result |= ((uint32_t) qd_iterator_octet(field->raw_iter)) << 8;
+        result |= ((uint32_t) qd_iterator_octet(raw)) << 8;
         // Fall Through...
 
     case QD_AMQP_UBYTE:
     case QD_AMQP_SMALLUINT:
     case QD_AMQP_BOOLEAN:
-        result |= (uint32_t) qd_iterator_octet(field->raw_iter);
+        result |= (uint32_t) qd_iterator_octet(raw);
         break;
 
     case QD_AMQP_TRUE:
@@ -290,22 +471,23 @@ uint64_t qd_parse_as_ulong(qd_parsed_field_t *field)
 {
     uint64_t result = 0;
 
-    qd_iterator_reset(field->raw_iter);
+    qd_iterator_t *raw = qd_parse_raw(field);
+    qd_iterator_reset(raw);
 
     switch (field->tag) {
     case QD_AMQP_ULONG:
     case QD_AMQP_TIMESTAMP:
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 56;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 48;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 40;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 32;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 24;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 16;
-        result |= ((uint64_t) qd_iterator_octet(field->raw_iter)) << 8;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 56;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 48;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 40;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 32;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 24;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 16;
+        result |= ((uint64_t) qd_iterator_octet(raw)) << 8;
         // Fall Through...
 
     case QD_AMQP_SMALLULONG:
-        result |= (uint64_t) qd_iterator_octet(field->raw_iter);
+        result |= (uint64_t) qd_iterator_octet(raw);
         // Fall Through...
 
     case QD_AMQP_ULONG0:
@@ -320,25 +502,26 @@ int32_t qd_parse_as_int(qd_parsed_field_t *field)
 {
     int32_t result = 0;
 
-    qd_iterator_reset(field->raw_iter);
+    qd_iterator_t *raw = qd_parse_raw(field);
+    qd_iterator_reset(raw);
 
     switch (field->tag) {
     case QD_AMQP_INT:
-        result |= ((int32_t) qd_iterator_octet(field->raw_iter)) << 24;
-        result |= ((int32_t) qd_iterator_octet(field->raw_iter)) << 16;
+        result |= ((int32_t) qd_iterator_octet(raw)) << 24;
+        result |= ((int32_t) qd_iterator_octet(raw)) << 16;
         // Fall Through...
 
     case QD_AMQP_SHORT:
-        result |= ((int32_t) qd_iterator_octet(field->raw_iter)) << 8;
+        result |= ((int32_t) qd_iterator_octet(raw)) << 8;
         // Fall Through...
 
     case QD_AMQP_BYTE:
     case QD_AMQP_BOOLEAN:
-        result |= (int32_t) qd_iterator_octet(field->raw_iter);
+        result |= (int32_t) qd_iterator_octet(raw);
         break;
 
     case QD_AMQP_SMALLINT:
-        result = (int8_t) qd_iterator_octet(field->raw_iter);
+        result = (int8_t) qd_iterator_octet(raw);
         break;
 
     case QD_AMQP_TRUE:
@@ -354,22 +537,23 @@ int64_t qd_parse_as_long(qd_parsed_field_t *field)
 {
     int64_t result = 0;
 
-    qd_iterator_reset(field->raw_iter);
+    qd_iterator_t *raw = qd_parse_raw(field);
+    qd_iterator_reset(raw);
 
     switch (field->tag) {
     case QD_AMQP_LONG:
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 56;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 48;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 40;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 32;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 24;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 16;
-        result |= ((int64_t) qd_iterator_octet(field->raw_iter)) << 8;
-        result |= (uint64_t) qd_iterator_octet(field->raw_iter);
+        result |= ((int64_t) qd_iterator_octet(raw)) << 56;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 48;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 40;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 32;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 24;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 16;
+        result |= ((int64_t) qd_iterator_octet(raw)) << 8;
+        result |= (uint64_t) qd_iterator_octet(raw);
         break;
 
     case QD_AMQP_SMALLLONG:
-        result = (int8_t) qd_iterator_octet(field->raw_iter);
+        result = (int8_t) qd_iterator_octet(raw);
         break;
     }
 
@@ -381,12 +565,13 @@ bool qd_parse_as_bool(qd_parsed_field_t *field)
 {
     bool result = false;
 
-    qd_iterator_reset(field->raw_iter);
+    qd_iterator_t *raw = qd_parse_raw(field);
+    qd_iterator_reset(raw);
 
     switch (field->tag) {
     case QD_AMQP_BYTE:
     case QD_AMQP_BOOLEAN:
-        result = !!qd_iterator_octet(field->raw_iter);
+        result = !!qd_iterator_octet(raw);
         break;
 
     case QD_AMQP_TRUE:
@@ -478,3 +663,27 @@ qd_parsed_field_t *qd_parse_value_by_key(qd_parsed_field_t *field, const char *k
 
     return 0;
 }
+
+
+qd_parsed_field_t *qd_parse_ma_value(qd_parsed_field_t *field, qd_ma_key_t key)
+{
+    if (!field)
+        return 0;
+    if (field->arena)
+        return field->arena->ma_values[key];
+
+    qd_parsed_field_t *value = 0;
+    uint32_t           count = qd_parse_sub_count(field);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        qd_parsed_field_t *sub = qd_parse_sub_key(field, idx);
+        if (sub && qd_iterator_equal(qd_parse_raw(sub), (const unsigned char*) *router_keys[key]))
+            value = qd_parse_sub_value(field, idx);
+    }
+    return value;
+}
+
+
+bool qd_parse_is_router_annotation(qd_parsed_field_t *field)
+{
+    return field->router_key != ROUTER_KEY_NONE;
+}
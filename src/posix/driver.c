@@ -19,6 +19,8 @@
  *
  */
 
+#include "config.h"
+
 #include <assert.h>
 #include <poll.h>
 #include <stdio.h>
@@ -37,6 +39,9 @@
 #include <assert.h>
 #include <time.h>
 #include <sys/eventfd.h>
+#if USE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #ifdef __sun
 #include <signal.h>
@@ -62,6 +67,10 @@
 #define PN_SEL_RD (0x0001)
 #define PN_SEL_WR (0x0002)
 
+#if USE_EPOLL
+#define QDPN_MAX_EVENTS 256
+#endif
+
 DEQ_DECLARE(qdpn_listener_t, qdpn_listener_list_t);
 DEQ_DECLARE(qdpn_connector_t, qdpn_connector_list_t);
 
@@ -75,6 +84,18 @@ static inline void ignore_result(int unused_result) {
     (void) unused_result;
 }
 
+#if USE_EPOLL
+//
+// Map from file descriptor to the listener or connector that owns it.  Events from
+// epoll carry only the descriptor, so an event for an object that has since been freed
+// is simply not found.
+//
+typedef struct {
+    qdpn_listener_t  *listener;
+    qdpn_connector_t *connector;
+} qdpn_fd_entry_t;
+#endif
+
 struct qdpn_driver_t {
     qd_log_source_t *log;
     sys_mutex_t     *lock;
@@ -88,14 +109,28 @@ struct qdpn_driver_t {
     qdpn_connector_t      *connector_next;
     size_t                 closed_count;
 
+#if USE_EPOLL
+    qdpn_connector_list_t  ready;       // connectors that need service
+    qdpn_fd_entry_t       *fd_table;
+    size_t                 fd_table_size;
+    pn_timestamp_t         wakeup;      // earliest connector wakeup
+#endif
+
     //
     // The following values will only be accessed by one thread at a time.
     //
+#if USE_EPOLL
+    int                 epfd;
+    struct epoll_event  events[QDPN_MAX_EVENTS];
+    int                 nevents;
+    bool                no_wait;
+#else
     size_t          capacity;
     struct pollfd  *fds;
     size_t          nfds;
-    int             efd;    // Event-FD for signaling the poll (driver-wakeup)
     pn_timestamp_t  wakeup;
+#endif
+    int             efd;    // Event-FD for signaling the poll (driver-wakeup)
 };
 
 struct qdpn_listener_t {
@@ -112,6 +147,9 @@ struct qdpn_listener_t {
 
 struct qdpn_connector_t {
     DEQ_LINKS(qdpn_connector_t);
+#if USE_EPOLL
+    DEQ_LINKS_N(READY, qdpn_connector_t);
+#endif
     qdpn_driver_t *driver;
     char name[PN_NAME_MAX];
     char hostip[PN_NAME_MAX];
@@ -130,6 +168,28 @@ struct qdpn_connector_t {
     bool socket_error:1;
     bool hangup:1;
     bool closed:1;
+#if USE_EPOLL
+    //
+    // Connectors are registered edge-triggered, so the driver remembers that the socket
+    // is readable or writable until an I/O call finds it drained.  The epochs count
+    // readiness events so that an event that arrives while the connector is being
+    // processed is not lost when the processing thread finds the socket drained.
+    //
+    // Connectors whose I/O is done outside of the driver (see qdpn_connector_set_methods)
+    // cannot report when the socket is drained and are registered level-triggered.
+    //
+    bool     ready;                 // on the driver's ready list
+    bool     readable;
+    bool     writable;
+    bool     read_drained;
+    bool     write_drained;
+    bool     level_triggered;
+    uint32_t read_epoch;
+    uint32_t write_epoch;
+    uint32_t read_snap;
+    uint32_t write_snap;
+    uint32_t interest;              // events registered for a level-triggered connector
+#endif
 };
 
 ALLOC_DECLARE(qdpn_listener_t);
@@ -181,6 +241,135 @@ static pn_timestamp_t pn_timestamp_min( pn_timestamp_t a, pn_timestamp_t b )
     return b;
 }
 
+#if USE_EPOLL
+// epoll
+
+static qdpn_fd_entry_t *qdpn_fd_entry_LH(qdpn_driver_t *d, int fd)
+{
+    if (fd < 0)
+        return 0;
+
+    if ((size_t) fd >= d->fd_table_size) {
+        size_t size = d->fd_table_size > 64 ? d->fd_table_size : 64;
+        while (size <= (size_t) fd)
+            size *= 2;
+        qdpn_fd_entry_t *table = (qdpn_fd_entry_t*) realloc(d->fd_table, size * sizeof(qdpn_fd_entry_t));
+        if (!table)
+            return 0;
+        memset(table + d->fd_table_size, 0, (size - d->fd_table_size) * sizeof(qdpn_fd_entry_t));
+        d->fd_table      = table;
+        d->fd_table_size = size;
+    }
+
+    return &d->fd_table[fd];
+}
+
+static void qdpn_epoll_ctl(qdpn_driver_t *d, int op, int fd, uint32_t events)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(d->epfd, op, fd, &ev) == -1)
+        qdpn_log_errno(d, "epoll_ctl");
+}
+
+static uint32_t qdpn_connector_interest(qdpn_connector_t *c)
+{
+    return (c->status & PN_SEL_RD ? EPOLLIN : 0) | (c->status & PN_SEL_WR ? EPOLLOUT : 0);
+}
+
+//
+// Bring the registration of a level-triggered connector in line with its status.
+//
+static void qdpn_connector_update_interest_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    uint32_t interest = qdpn_connector_interest(c);
+    if (c->closed || c->hangup || c->socket_error || interest == c->interest)
+        return;
+    c->interest = interest;
+    qdpn_epoll_ctl(d, EPOLL_CTL_MOD, c->fd, interest | EPOLLRDHUP);
+}
+
+//
+// Decide whether the connector needs service and, if so, put it on the ready list.
+//
+static void qdpn_connector_arm_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    if (!c->closed && !c->level_triggered) {
+        if (c->readable && (c->status & PN_SEL_RD))
+            c->pending_read = true;
+        if (c->writable && (c->status & PN_SEL_WR))
+            c->pending_write = true;
+        if (c->hangup && !c->pending_read && !c->pending_write) {
+            //
+            // To see what happened on a hangup we need to do an actual recv() to get the
+            // error code.  If there's no interest in input, try to get it via send().
+            //
+            if (c->status & PN_SEL_RD)
+                c->pending_read = true;
+            else if (c->status & PN_SEL_WR)
+                c->pending_write = true;
+        }
+    }
+
+    if (c->ready)
+        return;
+
+    if (c->closed || c->pending_read || c->pending_write || c->pending_tick || c->socket_error) {
+        c->ready = true;
+        DEQ_INSERT_TAIL_N(READY, d->ready, c);
+    }
+}
+
+//
+// Called before the connector is processed.  Note where the readiness events stand so
+// that the I/O done by the processing can be matched against them afterward.
+//
+static void qdpn_connector_process_begin(qdpn_connector_t *c)
+{
+    qdpn_driver_t *d = c->driver;
+    if (!d) return;
+
+    sys_mutex_lock(d->lock);
+    c->read_snap     = c->read_epoch;
+    c->write_snap    = c->write_epoch;
+    c->read_drained  = false;
+    c->write_drained = false;
+    c->pending_tick  = false;
+    sys_mutex_unlock(d->lock);
+}
+
+//
+// Called after the connector is processed.  Forget readiness that was consumed, pick up
+// the connector's new status and wakeup time, and re-queue the connector if there is
+// still work that can be done without a new event from the kernel.
+//
+static void qdpn_connector_process_end(qdpn_connector_t *c)
+{
+    qdpn_driver_t *d = c->driver;
+    if (!d) return;
+
+    sys_mutex_lock(d->lock);
+    c->pending_read  = false;
+    c->pending_write = false;
+    if (c->level_triggered)
+        qdpn_connector_update_interest_LH(d, c);
+    else {
+        if (c->read_drained && c->read_epoch == c->read_snap)
+            c->readable = false;
+        if (c->write_drained && c->write_epoch == c->write_snap)
+            c->writable = false;
+    }
+
+    if (c->wakeup && (!d->wakeup || c->wakeup < d->wakeup))
+        d->wakeup = c->wakeup;
+
+    qdpn_connector_arm_LH(d, c);
+    sys_mutex_unlock(d->lock);
+}
+#endif
+
 // listener
 
 static void qdpn_driver_add_listener(qdpn_driver_t *d, qdpn_listener_t *l)
@@ -188,6 +377,14 @@ static void qdpn_driver_add_listener(qdpn_driver_t *d, qdpn_listener_t *l)
     if (!l->driver) return;
     sys_mutex_lock(d->lock);
     DEQ_INSERT_TAIL(d->listeners, l);
+#if USE_EPOLL
+    qdpn_fd_entry_t *entry = qdpn_fd_entry_LH(d, l->fd);
+    if (entry) {
+        entry->listener  = l;
+        entry->connector = 0;
+    }
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, l->fd, EPOLLIN);
+#endif
     sys_mutex_unlock(d->lock);
     l->driver = d;
 }
@@ -200,6 +397,14 @@ static void qdpn_driver_remove_listener(qdpn_driver_t *d, qdpn_listener_t *l)
     if (l == d->listener_next)
         d->listener_next = DEQ_NEXT(l);
     DEQ_REMOVE(d->listeners, l);
+#if USE_EPOLL
+    //
+    // The descriptor left the epoll set when it was closed.  Only forget the mapping
+    // if the descriptor has not since been reused.
+    //
+    if (l->fd >= 0 && (size_t) l->fd < d->fd_table_size && d->fd_table[l->fd].listener == l)
+        d->fd_table[l->fd].listener = 0;
+#endif
     sys_mutex_unlock(d->lock);
 
     l->driver = NULL;
@@ -367,6 +572,7 @@ void qdpn_listener_set_context(qdpn_listener_t *listener, void *context)
 }
 
 qdpn_connector_t *qdpn_listener_accept(qdpn_listener_t *l,
+                                       qdpn_driver_t *driver,
                                        void *policy,
                                        bool (*policy_fn)(void *, const char *name),
                                        bool *counted)
@@ -404,7 +610,7 @@ qdpn_connector_t *qdpn_listener_accept(qdpn_listener_t *l,
             *counted = true;
         }
     }
-    qdpn_connector_t *c = qdpn_connector_fd(l->driver, sock, NULL);
+    qdpn_connector_t *c = qdpn_connector_fd(driver ? driver : l->driver, sock, NULL);
     snprintf(c->name, PN_NAME_MAX, "%s", name);
     snprintf(c->hostip, PN_NAME_MAX, "%s", hostip);
     c->listener = l;
@@ -435,6 +641,18 @@ static void qdpn_driver_add_connector(qdpn_driver_t *d, qdpn_connector_t *c)
     if (!c->driver) return;
     sys_mutex_lock(d->lock);
     DEQ_INSERT_TAIL(d->connectors, c);
+#if USE_EPOLL
+    qdpn_fd_entry_t *entry = qdpn_fd_entry_LH(d, c->fd);
+    if (entry) {
+        entry->listener  = 0;
+        entry->connector = c;
+    }
+    //
+    // Registering reports the current state of the socket, so there is no need to
+    // assume that a new connector is readable or writable.
+    //
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, c->fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+#endif
     sys_mutex_unlock(d->lock);
     c->driver = d;
 }
@@ -449,6 +667,14 @@ static void qdpn_driver_remove_connector(qdpn_driver_t *d, qdpn_connector_t *c)
     }
 
     DEQ_REMOVE(d->connectors, c);
+#if USE_EPOLL
+    if (c->ready) {
+        DEQ_REMOVE_N(READY, d->ready, c);
+        c->ready = false;
+    }
+    if (c->fd >= 0 && (size_t) c->fd < d->fd_table_size && d->fd_table[c->fd].connector == c)
+        d->fd_table[c->fd].connector = 0;
+#endif
     c->driver = NULL;
     if (c->closed) {
         d->closed_count--;
@@ -456,6 +682,41 @@ static void qdpn_driver_remove_connector(qdpn_driver_t *d, qdpn_connector_t *c)
     sys_mutex_unlock(d->lock);
 }
 
+int qdpn_connect_socket(qdpn_driver_t *driver, const struct sockaddr *addr, socklen_t addrlen)
+{
+    int sock = qdpn_create_socket(addr->sa_family);
+    if (sock == PN_INVALID_SOCKET) {
+        qdpn_log_errno(driver, "pn_create_socket");
+        return -1;
+    }
+
+    qdpn_configure_sock(driver, sock, true);
+
+    if (connect(sock, addr, addrlen) == -1) {
+        if (errno != EINPROGRESS) {
+            int err = errno;
+            qdpn_log_errno(driver, "connect");
+            close(sock);
+            errno = err;
+            return -1;
+        }
+    }
+
+    return sock;
+}
+
+qdpn_connector_t *qdpn_connector_socket(qdpn_driver_t *driver,
+                                        int sock,
+                                        const char *host,
+                                        const char *port,
+                                        void *context)
+{
+    qdpn_connector_t *c = qdpn_connector_fd(driver, sock, context);
+    if (c)
+        snprintf(c->name, PN_NAME_MAX, "%s:%s", host, port);
+    return c;
+}
+
 qdpn_connector_t *qdpn_connector(qdpn_driver_t *driver,
                                  const char *host,
                                  const char *port,
@@ -466,41 +727,24 @@ qdpn_connector_t *qdpn_connector(qdpn_driver_t *driver,
 
     struct addrinfo hints = {0}, *addr;
     hints.ai_socktype = SOCK_STREAM;
+
+    // Only look for addresses in the requested protocol family.
+    qd_set_addr_ai_family(driver, &hints, protocol_family);
+
     int code = getaddrinfo(host, port, &hints, &addr);
     if (code) {
         qd_log(driver->log, QD_LOG_ERROR, "getaddrinfo(%s, %s): %s", host, port, gai_strerror(code));
         return 0;
     }
 
-    // Set the protocol family before creating the socket.
-    qd_set_addr_ai_family(driver, addr, protocol_family);
-
-    int sock = qdpn_create_socket(addr->ai_family);
-    if (sock == PN_INVALID_SOCKET) {
-        freeaddrinfo(addr);
-        qdpn_log_errno(driver, "pn_create_socket");
-        return 0;
-    }
-
-    qdpn_configure_sock(driver, sock, true);
-
-    if (connect(sock, addr->ai_addr, addr->ai_addrlen) == -1) {
-        if (errno != EINPROGRESS) {
-            qdpn_log_errno(driver, "connect");
-            freeaddrinfo(addr);
-            close(sock);
-            return 0;
-        }
-    }
-
+    int sock = qdpn_connect_socket(driver, addr->ai_addr, addr->ai_addrlen);
     freeaddrinfo(addr);
+    if (sock < 0)
+        return 0;
 
-    qdpn_connector_t *c = qdpn_connector_fd(driver, sock, context);
-    snprintf(c->name, PN_NAME_MAX, "%s:%s", host, port);
-    return c;
+    return qdpn_connector_socket(driver, sock, host, port, context);
 }
 
-
 static void connector_process(qdpn_connector_t *c);
 static void connector_close(qdpn_connector_t *c);
 
@@ -516,6 +760,20 @@ qdpn_connector_t *qdpn_connector_fd(qdpn_driver_t *driver, int fd, void *context
     qdpn_connector_t *c = new_qdpn_connector_t();
     if (!c) return NULL;
     DEQ_ITEM_INIT(c);
+#if USE_EPOLL
+    DEQ_ITEM_INIT_N(READY, c);
+    c->ready           = false;
+    c->readable        = false;
+    c->writable        = false;
+    c->read_drained    = false;
+    c->write_drained   = false;
+    c->level_triggered = false;
+    c->read_epoch      = 0;
+    c->write_epoch     = 0;
+    c->read_snap       = 0;
+    c->write_snap      = 0;
+    c->interest        = 0;
+#endif
     c->driver = driver;
     c->pending_tick = false;
     c->pending_read = false;
@@ -628,6 +886,9 @@ void qdpn_connector_mark_closed(qdpn_connector_t *ctor)
         qd_log(ctor->driver->log, QD_LOG_TRACE, "closed %s", ctor->name);
         ctor->closed = true;
         ctor->driver->closed_count++;
+#if USE_EPOLL
+        qdpn_connector_arm_LH(ctor->driver, ctor);
+#endif
     }
     sys_mutex_unlock(ctor->driver->lock);
 }
@@ -671,6 +932,11 @@ void qdpn_connector_free(qdpn_connector_t *ctor)
 
 void qdpn_connector_activate(qdpn_connector_t *ctor, qdpn_activate_criteria_t crit)
 {
+#if USE_EPOLL
+    qdpn_driver_t *d = ctor->driver;
+    if (d) sys_mutex_lock(d->lock);
+#endif
+
     switch (crit) {
     case QDPN_CONNECTOR_WRITABLE :
         ctor->status |= PN_SEL_WR;
@@ -680,6 +946,20 @@ void qdpn_connector_activate(qdpn_connector_t *ctor, qdpn_activate_criteria_t cr
         ctor->status |= PN_SEL_RD;
         break;
     }
+
+#if USE_EPOLL
+    //
+    // A socket that is already writable will not produce another edge, so the
+    // connector must be queued here if the activation can be acted on right away.
+    //
+    if (d) {
+        if (ctor->level_triggered)
+            qdpn_connector_update_interest_LH(d, ctor);
+        else
+            qdpn_connector_arm_LH(d, ctor);
+        sys_mutex_unlock(d->lock);
+    }
+#endif
 }
 
 
@@ -689,6 +969,12 @@ void qdpn_activate_all(qdpn_driver_t *d)
     qdpn_connector_t *c = DEQ_HEAD(d->connectors);
     while (c) {
         c->status |= PN_SEL_WR;
+#if USE_EPOLL
+        if (c->level_triggered)
+            qdpn_connector_update_interest_LH(d, c);
+        else
+            qdpn_connector_arm_LH(d, c);
+#endif
         c = DEQ_NEXT(c);
     }
     sys_mutex_unlock(d->lock);
@@ -727,7 +1013,15 @@ static pn_timestamp_t qdpn_connector_tick(qdpn_connector_t *ctor, pn_timestamp_t
 
 void qdpn_connector_process(qdpn_connector_t *c)
 {
-    if (c && !c->closed) c->methods->process(c);
+    if (c && !c->closed) {
+#if USE_EPOLL
+        qdpn_connector_process_begin(c);
+        c->methods->process(c);
+        qdpn_connector_process_end(c);
+#else
+        c->methods->process(c);
+#endif
+    }
 }
 
 static void connector_process(qdpn_connector_t *c)
@@ -751,9 +1045,17 @@ static void connector_process(qdpn_connector_t *c)
                     qdpn_log_errno(c->driver, "recv %s", c->name);
                     pn_transport_close_tail( transport );
                 }
+#if USE_EPOLL
+                else
+                    c->read_drained = true;
+#endif
             } else if (n == 0) { /* HUP */
                 pn_transport_close_tail( transport );
             } else {
+#if USE_EPOLL
+                if (n < capacity)
+                    c->read_drained = true;
+#endif
                 pn_transport_process(transport, (size_t) n);
             }
         }
@@ -782,7 +1084,15 @@ static void connector_process(qdpn_connector_t *c)
                     qdpn_log_errno(c->driver, "send %s", c->name);
                     pn_transport_close_head( transport );
                 }
+#if USE_EPOLL
+                else
+                    c->write_drained = true;
+#endif
             } else if (n) {
+#if USE_EPOLL
+                if (n < pending)
+                    c->write_drained = true;
+#endif
                 pn_transport_pop(transport, (size_t) n);
             }
         }
@@ -806,9 +1116,17 @@ qdpn_driver_t *qdpn_driver(qd_log_source_t *log)
     d->listener_next = NULL;
     d->connector_next = NULL;
     d->closed_count = 0;
+#if USE_EPOLL
+    DEQ_INIT(d->ready);
+    d->fd_table = NULL;
+    d->fd_table_size = 0;
+    d->nevents = 0;
+    d->no_wait = false;
+#else
     d->capacity = 0;
     d->fds = NULL;
     d->nfds = 0;
+#endif
     d->efd  = 0;
     d->wakeup = 0;
 
@@ -818,6 +1136,15 @@ qdpn_driver_t *qdpn_driver(qd_log_source_t *log)
         exit(1);
     }
 
+#if USE_EPOLL
+    d->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (d->epfd < 0) {
+        qdpn_log_errno(d, "Can't create epoll instance");
+        exit(1);
+    }
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, d->efd, EPOLLIN);
+#endif
+
 #ifdef __sun
     struct sigaction act;
     act.sa_handler = SIG_IGN;
@@ -836,7 +1163,12 @@ void qdpn_driver_free(qdpn_driver_t *d)
         qdpn_connector_free(DEQ_HEAD(d->connectors));
     while (DEQ_HEAD(d->listeners))
         qdpn_listener_free(DEQ_HEAD(d->listeners));
+#if USE_EPOLL
+    close(d->epfd);
+    free(d->fd_table);
+#else
     free(d->fds);
+#endif
     sys_mutex_free(d->lock);
     free(d);
 }
@@ -850,6 +1182,137 @@ int qdpn_driver_wakeup(qdpn_driver_t *d)
     return 0;
 }
 
+#if USE_EPOLL
+
+void qdpn_driver_wait_1(qdpn_driver_t *d)
+{
+    //
+    // If there are connectors ready to be serviced, don't block in the wait.
+    //
+    sys_mutex_lock(d->lock);
+    d->no_wait = DEQ_SIZE(d->ready) > 0 || d->closed_count > 0;
+    sys_mutex_unlock(d->lock);
+}
+
+int qdpn_driver_wait_2(qdpn_driver_t *d, int timeout)
+{
+    sys_mutex_lock(d->lock);
+    pn_timestamp_t wakeup = d->wakeup;
+    sys_mutex_unlock(d->lock);
+
+    if (wakeup) {
+        pn_timestamp_t now = pn_i_now();
+        if (now >= wakeup)
+            timeout = 0;
+        else
+            timeout = (timeout < 0) ? wakeup-now : pn_min(timeout, wakeup - now);
+    }
+    int result = epoll_wait(d->epfd, d->events, QDPN_MAX_EVENTS, d->no_wait ? 0 : timeout);
+    if (result == -1 && errno != EINTR)
+        qdpn_log_errno(d, "epoll_wait");
+    d->nevents = result > 0 ? result : 0;
+    return result;
+}
+
+int qdpn_driver_wait_3(qdpn_driver_t *d)
+{
+    bool woken = false;
+
+    sys_mutex_lock(d->lock);
+    qdpn_listener_t *l = DEQ_HEAD(d->listeners);
+    while (l) {
+        l->pending = false;
+        l = DEQ_NEXT(l);
+    }
+
+    //
+    // Visit only the descriptors that reported events.
+    //
+    for (int i = 0; i < d->nevents; i++) {
+        int      fd      = d->events[i].data.fd;
+        uint32_t revents = d->events[i].events;
+
+        if (fd == d->efd) {
+            woken = true;
+            char buffer[sizeof(uint64_t)];
+            ignore_result(read(d->efd, buffer, sizeof(uint64_t)));
+            continue;
+        }
+
+        if (fd < 0 || (size_t) fd >= d->fd_table_size)
+            continue;
+
+        qdpn_fd_entry_t *entry = &d->fd_table[fd];
+        if (entry->listener) {
+            entry->listener->pending = (revents & EPOLLIN) != 0;
+            continue;
+        }
+
+        qdpn_connector_t *c = entry->connector;
+        if (!c || c->closed)
+            continue;
+
+        if (revents & EPOLLERR)
+            c->socket_error = true;
+        if (revents & (EPOLLHUP | EPOLLRDHUP))
+            c->hangup = true;
+
+        if (c->level_triggered) {
+            c->pending_read  = (revents & EPOLLIN) != 0;
+            c->pending_write = (revents & EPOLLOUT) != 0;
+            if (revents & (EPOLLHUP | EPOLLRDHUP)) {
+                if (c->interest & EPOLLIN) c->pending_read = true;
+                else if (c->interest & EPOLLOUT) c->pending_write = true;
+            }
+            //
+            // A hangup or error is reported on every wait for as long as the descriptor
+            // is registered.  Stop watching it, the connector will be closed.
+            //
+            if (c->hangup || c->socket_error)
+                qdpn_epoll_ctl(d, EPOLL_CTL_DEL, fd, 0);
+        } else {
+            if (revents & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) {
+                c->readable = true;
+                c->read_epoch++;
+            }
+            if (revents & EPOLLOUT) {
+                c->writable = true;
+                c->write_epoch++;
+            }
+        }
+
+        qdpn_connector_arm_LH(d, c);
+    }
+    d->nevents = 0;
+
+    //
+    // Connector wakeups are tracked only by the earliest one.  The connectors are
+    // visited when that time has passed, and the next earliest is found.
+    //
+    pn_timestamp_t now = pn_i_now();
+    if (d->wakeup && d->wakeup <= now) {
+        d->wakeup = 0;
+        qdpn_connector_t *c = DEQ_HEAD(d->connectors);
+        while (c) {
+            if (!c->closed && c->wakeup) {
+                if (c->wakeup <= now) {
+                    c->pending_tick = true;
+                    qdpn_connector_arm_LH(d, c);
+                } else
+                    d->wakeup = pn_timestamp_min(d->wakeup, c->wakeup);
+            }
+            c = DEQ_NEXT(c);
+        }
+    }
+
+    d->listener_next = DEQ_HEAD(d->listeners);
+    sys_mutex_unlock(d->lock);
+
+    return woken ? PN_INTR : 0;
+}
+
+#else
+
 static void qdpn_driver_rebuild(qdpn_driver_t *d)
 {
     sys_mutex_lock(d->lock);
@@ -982,6 +1445,8 @@ int qdpn_driver_wait_3(qdpn_driver_t *d)
     return woken ? PN_INTR : 0;
 }
 
+#endif
+
 //
 // XXX - pn_driver_wait has been divided into three internal functions as a
 //       temporary workaround for a multi-threading problem.  A multi-threaded
@@ -1024,6 +1489,16 @@ qdpn_connector_t *qdpn_driver_connector(qdpn_driver_t *d)
 {
     if (!d) return NULL;
 
+#if USE_EPOLL
+    sys_mutex_lock(d->lock);
+    qdpn_connector_t *c = DEQ_HEAD(d->ready);
+    if (c) {
+        DEQ_REMOVE_HEAD_N(READY, d->ready);
+        c->ready = false;
+    }
+    sys_mutex_unlock(d->lock);
+    return c;
+#else
     sys_mutex_lock(d->lock);
     while (d->connector_next) {
         qdpn_connector_t *c = d->connector_next;
@@ -1037,6 +1512,7 @@ qdpn_connector_t *qdpn_driver_connector(qdpn_driver_t *d)
 
     sys_mutex_unlock(d->lock);
     return NULL;
+#endif
 }
 
 void qdpn_connector_wakeup(qdpn_connector_t *c, pn_timestamp_t t) {
@@ -1045,4 +1521,19 @@ void qdpn_connector_wakeup(qdpn_connector_t *c, pn_timestamp_t t) {
 
 void qdpn_connector_set_methods(qdpn_connector_t *c, qdpn_connector_methods_t *m) {
     c->methods = m;
+#if USE_EPOLL
+    //
+    // The I/O for this connector is done by its own methods, which cannot tell the
+    // driver when the socket has been drained.  Switch it to level-triggered events.
+    //
+    qdpn_driver_t *d = c->driver;
+    if (d && !c->level_triggered) {
+        sys_mutex_lock(d->lock);
+        c->level_triggered = true;
+        c->interest        = qdpn_connector_interest(c);
+        if (!c->closed)
+            qdpn_epoll_ctl(d, EPOLL_CTL_MOD, c->fd, c->interest | EPOLLRDHUP);
+        sys_mutex_unlock(d->lock);
+    }
+#endif
 }
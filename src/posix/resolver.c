@@ -0,0 +1,394 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include <qpid/dispatch/ctools.h>
+#include <qpid/dispatch/threading.h>
+#include "alloc.h"
+#include "resolver.h"
+
+//
+// Lookups are spread over this many resolver threads.  Each thread may be blocked in
+// getaddrinfo for as long as the name server takes to answer.
+//
+#define QD_RESOLVER_THREADS 4
+
+//
+// How long resolved addresses and failures are remembered.  getaddrinfo does not report
+// the DNS TTL, so fixed times are used.  Failures are kept briefly so that a broken name
+// is retried soon, but not on every reconnect attempt of every connector using it.
+//
+#define QD_RESOLVER_CACHE_MSEC    30000
+#define QD_RESOLVER_NEGATIVE_MSEC 5000
+
+typedef struct qd_resolver_waiter_t qd_resolver_waiter_t;
+typedef struct qd_resolver_entry_t  qd_resolver_entry_t;
+
+struct qd_resolver_waiter_t {
+    DEQ_LINKS(qd_resolver_waiter_t);
+    qd_timer_t *notify;
+};
+
+DEQ_DECLARE(qd_resolver_waiter_t, qd_resolver_waiter_list_t);
+
+typedef enum {
+    QD_RESOLVER_QUEUED,
+    QD_RESOLVER_RUNNING,
+    QD_RESOLVER_DONE
+} qd_resolver_entry_state_t;
+
+struct qd_resolver_entry_t {
+    DEQ_LINKS(qd_resolver_entry_t);
+    DEQ_LINKS_N(QUEUE, qd_resolver_entry_t);
+    char                      *host;
+    char                      *port;
+    int                        family;
+    qd_resolver_entry_state_t  state;
+    qd_resolve_status_t        status;
+    qd_resolved_addr_t         result;
+    uint64_t                   expires;   // Monotonic msec; meaningful once done
+    qd_resolver_waiter_list_t  waiters;
+};
+
+DEQ_DECLARE(qd_resolver_entry_t, qd_resolver_entry_list_t);
+
+ALLOC_DECLARE(qd_resolver_waiter_t);
+ALLOC_DEFINE(qd_resolver_waiter_t);
+ALLOC_DECLARE(qd_resolver_entry_t);
+ALLOC_DEFINE(qd_resolver_entry_t);
+
+struct qd_resolver_t {
+    qd_log_source_t          *log;
+    sys_mutex_t              *lock;
+    sys_cond_t               *cond;
+    bool                      shutdown;
+    bool                      hold;          // Lookups are left queued (tests only)
+    uint64_t                  cache_msec;
+    uint64_t                  negative_msec;
+    qd_resolver_entry_list_t  entries;   // Every cached or pending lookup
+    qd_resolver_entry_list_t  queue;     // Lookups waiting for a thread (QUEUE links)
+    sys_thread_t             *threads[QD_RESOLVER_THREADS];
+};
+
+
+static uint64_t resolver_now_msec(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+static int resolver_family(const char *protocol_family)
+{
+    if (protocol_family) {
+        if (strcmp(protocol_family, "IPv6") == 0)
+            return AF_INET6;
+        if (strcmp(protocol_family, "IPv4") == 0)
+            return AF_INET;
+    }
+    return AF_UNSPEC;
+}
+
+
+static void resolver_entry_free_LH(qd_resolver_t *resolver, qd_resolver_entry_t *entry)
+{
+    qd_resolver_waiter_t *waiter = DEQ_HEAD(entry->waiters);
+    while (waiter) {
+        DEQ_REMOVE_HEAD(entry->waiters);
+        free_qd_resolver_waiter_t(waiter);
+        waiter = DEQ_HEAD(entry->waiters);
+    }
+    if (entry->state == QD_RESOLVER_QUEUED)
+        DEQ_REMOVE_N(QUEUE, resolver->queue, entry);
+    DEQ_REMOVE(resolver->entries, entry);
+    free(entry->host);
+    free(entry->port);
+    free_qd_resolver_entry_t(entry);
+}
+
+
+//
+// Drop the cached results that have expired.  This runs whenever a lookup misses the cache,
+// so entries for hosts that are never looked up again do not accumulate.
+//
+static void resolver_prune_LH(qd_resolver_t *resolver, uint64_t now)
+{
+    qd_resolver_entry_t *entry = DEQ_HEAD(resolver->entries);
+    while (entry) {
+        qd_resolver_entry_t *next = DEQ_NEXT(entry);
+        if (entry->state == QD_RESOLVER_DONE && entry->expires <= now)
+            resolver_entry_free_LH(resolver, entry);
+        entry = next;
+    }
+}
+
+
+static qd_resolver_entry_t *resolver_find_LH(qd_resolver_t *resolver, const char *host, const char *port, int family)
+{
+    qd_resolver_entry_t *entry = DEQ_HEAD(resolver->entries);
+    while (entry) {
+        if (entry->family == family && strcmp(entry->host, host) == 0 && strcmp(entry->port, port) == 0)
+            return entry;
+        entry = DEQ_NEXT(entry);
+    }
+    return 0;
+}
+
+
+static qd_resolve_status_t resolver_run_lookup(const char *host, const char *port, int family, qd_resolved_addr_t *result)
+{
+    struct addrinfo hints = {0}, *addr;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family   = family;
+
+    int code = getaddrinfo(host, port, &hints, &addr);
+    if (code) {
+        result->error = gai_strerror(code);
+        return QD_RESOLVE_FAILED;
+    }
+
+    qd_resolve_status_t status = QD_RESOLVE_FAILED;
+    if (addr->ai_addrlen <= sizeof(result->addr)) {
+        memcpy(&result->addr, addr->ai_addr, addr->ai_addrlen);
+        result->addr_len = addr->ai_addrlen;
+        result->error    = 0;
+        status           = QD_RESOLVE_OK;
+    } else
+        result->error = "Address too long";
+    freeaddrinfo(addr);
+    return status;
+}
+
+
+static void *resolver_thread(void *context)
+{
+    qd_resolver_t *resolver = (qd_resolver_t*) context;
+
+    sys_mutex_lock(resolver->lock);
+    while (!resolver->shutdown) {
+        qd_resolver_entry_t *entry = resolver->hold ? 0 : DEQ_HEAD(resolver->queue);
+        if (!entry) {
+            sys_cond_wait(resolver->cond, resolver->lock);
+            continue;
+        }
+        DEQ_REMOVE_HEAD_N(QUEUE, resolver->queue);
+        entry->state = QD_RESOLVER_RUNNING;
+
+        //
+        // The entry stays on the entries list while the lock is released; only this thread
+        // takes it off (see qd_resolver_expire), so the copies of its names remain valid.
+        //
+        char *host   = entry->host;
+        char *port   = entry->port;
+        int   family = entry->family;
+        sys_mutex_unlock(resolver->lock);
+
+        uint64_t started = resolver_now_msec();
+        qd_resolved_addr_t  result;
+        ZERO(&result);
+        qd_resolve_status_t status  = resolver_run_lookup(host, port, family, &result);
+        uint64_t            elapsed = resolver_now_msec() - started;
+
+        if (status == QD_RESOLVE_OK)
+            qd_log(resolver->log, QD_LOG_DEBUG, "Resolved %s:%s in %"PRIu64" msec", host, port, elapsed);
+        else
+            qd_log(resolver->log, QD_LOG_ERROR, "getaddrinfo(%s, %s): %s", host, port, result.error);
+
+        sys_mutex_lock(resolver->lock);
+        entry->status  = status;
+        entry->result  = result;
+        entry->state   = QD_RESOLVER_DONE;
+        entry->expires = resolver_now_msec() +
+            (status == QD_RESOLVE_OK ? resolver->cache_msec : resolver->negative_msec);
+
+        //
+        // Wake the waiting connectors.  Their timers fire on a server thread, where they
+        // find the result in the cache.
+        //
+        qd_resolver_waiter_t *waiter = DEQ_HEAD(entry->waiters);
+        while (waiter) {
+            DEQ_REMOVE_HEAD(entry->waiters);
+            qd_timer_schedule(waiter->notify, 0);
+            free_qd_resolver_waiter_t(waiter);
+            waiter = DEQ_HEAD(entry->waiters);
+        }
+    }
+    sys_mutex_unlock(resolver->lock);
+    return 0;
+}
+
+
+qd_resolver_t *qd_resolver(qd_log_source_t *log)
+{
+    qd_resolver_t *resolver = NEW(qd_resolver_t);
+    ZERO(resolver);
+    resolver->log           = log;
+    resolver->lock          = sys_mutex();
+    resolver->cond          = sys_cond();
+    resolver->cache_msec    = QD_RESOLVER_CACHE_MSEC;
+    resolver->negative_msec = QD_RESOLVER_NEGATIVE_MSEC;
+    DEQ_INIT(resolver->entries);
+    DEQ_INIT(resolver->queue);
+    for (int i = 0; i < QD_RESOLVER_THREADS; i++)
+        resolver->threads[i] = sys_thread(resolver_thread, resolver);
+    return resolver;
+}
+
+
+void qd_resolver_free(qd_resolver_t *resolver)
+{
+    if (!resolver)
+        return;
+
+    sys_mutex_lock(resolver->lock);
+    resolver->shutdown = true;
+    sys_cond_signal_all(resolver->cond);
+    sys_mutex_unlock(resolver->lock);
+
+    //
+    // A thread blocked in getaddrinfo finishes its lookup before it sees the shutdown.
+    //
+    for (int i = 0; i < QD_RESOLVER_THREADS; i++) {
+        sys_thread_join(resolver->threads[i]);
+        sys_thread_free(resolver->threads[i]);
+    }
+
+    qd_resolver_entry_t *entry = DEQ_HEAD(resolver->entries);
+    while (entry) {
+        resolver_entry_free_LH(resolver, entry);
+        entry = DEQ_HEAD(resolver->entries);
+    }
+
+    sys_cond_free(resolver->cond);
+    sys_mutex_free(resolver->lock);
+    free(resolver);
+}
+
+
+qd_resolve_status_t qd_resolver_lookup(qd_resolver_t *resolver, const char *host, const char *port,
+                                       const char *protocol_family, qd_timer_t *notify,
+                                       qd_resolved_addr_t *result)
+{
+    int                  family = resolver_family(protocol_family);
+    qd_resolve_status_t  status = QD_RESOLVE_PENDING;
+    uint64_t             now    = resolver_now_msec();
+
+    sys_mutex_lock(resolver->lock);
+    qd_resolver_entry_t *entry = resolver_find_LH(resolver, host, port, family);
+
+    if (entry && entry->state == QD_RESOLVER_DONE && entry->expires <= now) {
+        resolver_entry_free_LH(resolver, entry);
+        entry = 0;
+    }
+
+    if (!entry) {
+        resolver_prune_LH(resolver, now);
+        entry = new_qd_resolver_entry_t();
+        ZERO(entry);
+        DEQ_ITEM_INIT(entry);
+        DEQ_ITEM_INIT_N(QUEUE, entry);
+        DEQ_INIT(entry->waiters);
+        entry->host   = strdup(host);
+        entry->port   = strdup(port);
+        entry->family = family;
+        entry->state  = QD_RESOLVER_QUEUED;
+        DEQ_INSERT_TAIL(resolver->entries, entry);
+        DEQ_INSERT_TAIL_N(QUEUE, resolver->queue, entry);
+        sys_cond_signal(resolver->cond);
+    }
+
+    if (entry->state == QD_RESOLVER_DONE) {
+        status  = entry->status;
+        *result = entry->result;
+    } else {
+        //
+        // Wait for the lookup, once per timer.
+        //
+        qd_resolver_waiter_t *waiter = DEQ_HEAD(entry->waiters);
+        while (waiter && waiter->notify != notify)
+            waiter = DEQ_NEXT(waiter);
+        if (!waiter) {
+            waiter = new_qd_resolver_waiter_t();
+            DEQ_ITEM_INIT(waiter);
+            waiter->notify = notify;
+            DEQ_INSERT_TAIL(entry->waiters, waiter);
+        }
+    }
+    sys_mutex_unlock(resolver->lock);
+
+    return status;
+}
+
+
+void qd_resolver_expire(qd_resolver_t *resolver, const char *host, const char *port,
+                        const char *protocol_family)
+{
+    sys_mutex_lock(resolver->lock);
+    qd_resolver_entry_t *entry = resolver_find_LH(resolver, host, port, resolver_family(protocol_family));
+    if (entry && entry->state == QD_RESOLVER_DONE)
+        resolver_entry_free_LH(resolver, entry);
+    sys_mutex_unlock(resolver->lock);
+}
+
+
+void qd_resolver_cancel(qd_resolver_t *resolver, qd_timer_t *notify)
+{
+    sys_mutex_lock(resolver->lock);
+    qd_resolver_entry_t *entry = DEQ_HEAD(resolver->entries);
+    while (entry) {
+        qd_resolver_waiter_t *waiter = DEQ_HEAD(entry->waiters);
+        while (waiter) {
+            qd_resolver_waiter_t *next = DEQ_NEXT(waiter);
+            if (waiter->notify == notify) {
+                DEQ_REMOVE(entry->waiters, waiter);
+                free_qd_resolver_waiter_t(waiter);
+            }
+            waiter = next;
+        }
+        entry = DEQ_NEXT(entry);
+    }
+    sys_mutex_unlock(resolver->lock);
+}
+
+
+void qd_resolver_set_cache_times(qd_resolver_t *resolver, int cache_msec, int negative_msec)
+{
+    sys_mutex_lock(resolver->lock);
+    resolver->cache_msec    = cache_msec;
+    resolver->negative_msec = negative_msec;
+    sys_mutex_unlock(resolver->lock);
+}
+
+
+void qd_resolver_hold(qd_resolver_t *resolver, bool hold)
+{
+    sys_mutex_lock(resolver->lock);
+    resolver->hold = hold;
+    if (!hold)
+        sys_cond_signal_all(resolver->cond);
+    sys_mutex_unlock(resolver->lock);
+}
@@ -24,6 +24,7 @@
 #include <qpid/dispatch/error.h>
 #include <qpid/dispatch/amqp.h>
 #include "alloc.h"
+#include "compose_private.h"
 #include <qpid/dispatch/router.h>
 #include <qpid/dispatch/error.h>
 
@@ -146,6 +147,9 @@ qd_error_t qd_py_to_composed(PyObject *value, qd_composed_field_t *field)
     else if (PyString_Check(value) || PyUnicode_Check(value)) {
         qd_compose_insert_string(field, PyString_AsString(value));
     }
+    else if (PyByteArray_Check(value)) {
+        qd_compose_insert_binary(field, (const uint8_t*) PyByteArray_AS_STRING(value), (uint32_t) PyByteArray_GET_SIZE(value));
+    }
     else if (PyDict_Check(value)) {
         Py_ssize_t  iter = 0;
         PyObject   *key;
@@ -513,6 +517,10 @@ static void qd_io_rx_handler(void *context, qd_message_t *msg, int link_id, int
     iter_to_py_attr(qd_message_field_iterator(msg, QD_FIELD_APPLICATION_PROPERTIES), py_iter_parse, py_msg, "properties");
     iter_to_py_attr(qd_message_field_iterator(msg, QD_FIELD_BODY), py_iter_parse, py_msg, "body");
 
+    PyObject *body_size = PyInt_FromLong((long) qd_message_field_length(msg, QD_FIELD_BODY));
+    PyObject_SetAttrString(py_msg, "body_size", body_size);
+    Py_XDECREF(body_size);
+
     PyObject *value = PyObject_CallFunction(self->handler, "Oll", py_msg, link_id, inter_router_cost);
 
     Py_DECREF(py_msg);
@@ -559,8 +567,12 @@ static void IoAdapter_dealloc(IoAdapter* self)
     self->ob_type->tp_free((PyObject*)self);
 }
 
+//
+// Compose a message from its python counterpart.  body_size is set to the number of
+// octets in the encoded body.
+//
 static qd_error_t compose_python_message(qd_composed_field_t **field, PyObject *message,
-                                         qd_dispatch_t* qd) {
+                                         qd_dispatch_t* qd, long *body_size) {
     *field = qd_compose(QD_PERFORMATIVE_PROPERTIES, *field);
     qd_compose_start_list(*field);
     qd_compose_insert_null(*field);                                 // message-id
@@ -575,7 +587,9 @@ static qd_error_t compose_python_message(qd_composed_field_t **field, PyObject *
     qd_py_attr_to_composed(message, "properties", *field); QD_ERROR_RET();
 
     *field = qd_compose(QD_PERFORMATIVE_BODY_AMQP_VALUE, *field); QD_ERROR_RET();
+    unsigned int before_body = qd_buffer_list_length(&(*field)->buffers);
     qd_py_attr_to_composed(message, "body", *field); QD_ERROR_RET();
+    *body_size = (long) (qd_buffer_list_length(&(*field)->buffers) - before_body);
     return qd_error_code();
 }
 
@@ -587,11 +601,12 @@ static PyObject *qd_python_send(PyObject *self, PyObject *args)
     PyObject *message = 0;
     int       no_echo = 1;
     int       control = 0;
+    long      body_size = 0;
 
     if (!PyArg_ParseTuple(args, "O|ii", &message, &no_echo, &control))
         return 0;
 
-    if (compose_python_message(&field, message, ioa->qd) == QD_ERROR_NONE) {
+    if (compose_python_message(&field, message, ioa->qd, &body_size) == QD_ERROR_NONE) {
         qd_message_t *msg = qd_message();
         qd_message_compose_2(msg, field);
 
@@ -613,7 +628,7 @@ static PyObject *qd_python_send(PyObject *self, PyObject *args)
         }
         qd_compose_free(field);
         qd_message_free(msg);
-        Py_RETURN_NONE;
+        return PyInt_FromLong(body_size);
     }
     if (!PyErr_Occurred())
         PyErr_SetString(PyExc_RuntimeError, qd_error_message());
@@ -0,0 +1,91 @@
+#ifndef __resolver_h__
+#define __resolver_h__ 1
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <qpid/dispatch/log.h>
+#include <qpid/dispatch/timer.h>
+#include <sys/socket.h>
+
+/**
+ * Asynchronous host name resolution for connectors.
+ *
+ * Lookups run on a small pool of resolver threads so that a slow or unreachable name
+ * server never blocks a server thread.  Results, including failures, are cached for a
+ * short time so that a reconnecting connector does not resolve its host on every attempt.
+ *
+ * The resolver schedules the timers of waiting callers while holding the server lock
+ * (the timer lock), so its functions must not be called with the server lock held.
+ */
+typedef struct qd_resolver_t qd_resolver_t;
+
+typedef enum {
+    QD_RESOLVE_PENDING,  ///< A lookup is in progress; the notify timer will be scheduled when it ends
+    QD_RESOLVE_OK,       ///< The address was resolved
+    QD_RESOLVE_FAILED    ///< The address could not be resolved
+} qd_resolve_status_t;
+
+typedef struct qd_resolved_addr_t {
+    struct sockaddr_storage  addr;
+    socklen_t                addr_len;
+    const char              *error;     ///< Reason for a failed lookup (static text)
+} qd_resolved_addr_t;
+
+qd_resolver_t *qd_resolver(qd_log_source_t *log);
+void qd_resolver_free(qd_resolver_t *resolver);
+
+/**
+ * Look up a host and port.
+ *
+ * If a result is cached it is returned at once.  Otherwise a lookup is started (or joined,
+ * if one is already running for the same host) and QD_RESOLVE_PENDING is returned; the
+ * notify timer is scheduled to fire immediately when the lookup ends, and the caller is
+ * expected to look up again then.
+ *
+ * @param resolver The resolver
+ * @param host The host name or address literal
+ * @param port The port number or service name
+ * @param protocol_family "IPv4", "IPv6" or 0 for either
+ * @param notify The timer to schedule when a pending lookup ends
+ * @param result Filled in with the address (QD_RESOLVE_OK) or the error (QD_RESOLVE_FAILED)
+ */
+qd_resolve_status_t qd_resolver_lookup(qd_resolver_t *resolver, const char *host, const char *port,
+                                       const char *protocol_family, qd_timer_t *notify,
+                                       qd_resolved_addr_t *result);
+
+/**
+ * Drop the cached result for a host and port, for example after connecting to the cached
+ * address failed.  The next lookup resolves the host again.
+ */
+void qd_resolver_expire(qd_resolver_t *resolver, const char *host, const char *port,
+                        const char *protocol_family);
+
+/**
+ * Stop waiting for lookups on behalf of a timer.  This must be called before a timer
+ * passed to qd_resolver_lookup is freed.
+ */
+void qd_resolver_cancel(qd_resolver_t *resolver, qd_timer_t *notify);
+
+/// For tests only: change how long results and failures are cached
+void qd_resolver_set_cache_times(qd_resolver_t *resolver, int cache_msec, int negative_msec);
+
+/// For tests only: while held, lookups stay queued and are not started
+void qd_resolver_hold(qd_resolver_t *resolver, bool hold);
+
+#endif
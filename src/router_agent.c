@@ -38,6 +38,35 @@ static const char *qd_router_mode_names[] = {
 };
 ENUM_DEFINE(qd_router_mode, qd_router_mode_names);
 
+const char *QD_ROUTER_OPCODE_NAMES[QD_ROUTER_OPCODE_COUNT] = {
+    "HELLO",
+    "RA",
+    "LSU",
+    "LSR",
+    "MAU",
+    "MAR"
+};
+
+static qd_error_t qd_router_refresh_control_stats(qd_entity_t *entity, qd_router_t *router)
+{
+    if (qd_entity_set_map(entity, "controlMessagesSent") ||
+        qd_entity_set_map(entity, "controlOctetsSent") ||
+        qd_entity_set_map(entity, "controlMessagesReceived") ||
+        qd_entity_set_map(entity, "controlOctetsReceived"))
+        return qd_error_code();
+
+    for (int op = 0; op < QD_ROUTER_OPCODE_COUNT; op++) {
+        const char                *name  = QD_ROUTER_OPCODE_NAMES[op];
+        qd_router_control_stats_t *stats = &router->control_stats[op];
+        if (qd_entity_set_map_key_value_long(entity, "controlMessagesSent", name, (long) stats->messages_sent) ||
+            qd_entity_set_map_key_value_long(entity, "controlOctetsSent", name, (long) stats->octets_sent) ||
+            qd_entity_set_map_key_value_long(entity, "controlMessagesReceived", name, (long) stats->messages_received) ||
+            qd_entity_set_map_key_value_long(entity, "controlOctetsReceived", name, (long) stats->octets_received))
+            return QD_ERROR_PYTHON;
+    }
+    return QD_ERROR_NONE;
+}
+
 qd_error_t qd_entity_refresh_router(qd_entity_t* entity, void *impl) {
     qd_dispatch_t *qd = (qd_dispatch_t*) impl;
     qd_router_t *router = qd->router;
@@ -45,7 +74,8 @@ qd_error_t qd_entity_refresh_router(qd_entity_t* entity, void *impl) {
         qd_entity_set_string(entity, "mode", qd_router_mode_name(router->router_mode)) == 0 &&
         qd_entity_set_long(entity, "addrCount", 0) == 0 &&
         qd_entity_set_long(entity, "linkCount", 0) == 0 &&
-        qd_entity_set_long(entity, "nodeCount", 0) == 0
+        qd_entity_set_long(entity, "nodeCount", 0) == 0 &&
+        qd_router_refresh_control_stats(entity, router) == 0
     )
         return QD_ERROR_NONE;
     return qd_error_code();
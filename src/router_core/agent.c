@@ -27,6 +27,7 @@
 #include "agent_connection.h"
 #include "router_core_private.h"
 #include <stdio.h>
+#include <time.h>
 
 static void qdr_manage_read_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_manage_create_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
@@ -89,6 +90,7 @@ qdr_query_t *qdr_query(qdr_core_t              *core,
     query->entity_type = type;
     query->context     = context;
     query->body        = body;
+    query->remaining   = -1;
     query->more        = false;
 
     return query;
@@ -218,11 +220,12 @@ void qdr_query_add_attribute_names(qdr_query_t *query)
     }
 }
 
-void qdr_query_get_first(qdr_query_t *query, int offset)
+void qdr_query_get_first(qdr_query_t *query, int offset, int count)
 {
     qdr_action_t *action = qdr_action(qdrh_query_get_first_CT, "query_get_first");
     action->args.agent.query  = query;
     action->args.agent.offset = offset;
+    action->args.agent.count  = count;
     qdr_action_enqueue(query->core, action);
 }
 
@@ -240,9 +243,6 @@ void qdr_query_free(qdr_query_t *query)
     if (!query)
         return;
 
-    if (query->next_key)
-        qdr_field_free(query->next_key);
-
     free_qdr_query_t(query);
 }
 
@@ -253,6 +253,8 @@ static void qdr_agent_emit_columns(qdr_query_t *query, const char *qdr_columns[]
     while (query->columns[i] >= 0) {
         if (query->columns[i] < column_count)
             qd_compose_insert_string(query->body, qdr_columns[query->columns[i]]);
+        else
+            qd_compose_insert_null(query->body);
         i++;
     }
     qd_compose_end_list(query->body);
@@ -289,9 +291,11 @@ static void qdr_agent_set_columns(qdr_query_t *query,
 
     for (idx = 0; idx < count; idx++) {
         qd_parsed_field_t *name = qd_parse_sub_value(attribute_names, idx);
-        if (!name || (qd_parse_tag(name) != QD_AMQP_STR8_UTF8 && qd_parse_tag(name) != QD_AMQP_STR32_UTF8))
-            query->columns[idx] = QDR_AGENT_COLUMN_NULL;
-        else {
+        //
+        // Names that match no column are answered with null rather than with another column.
+        //
+        query->columns[idx] = QDR_AGENT_COLUMN_NULL;
+        if (name && (qd_parse_tag(name) == QD_AMQP_STR8_UTF8 || qd_parse_tag(name) == QD_AMQP_STR32_UTF8)) {
             int j = 0;
             while (qdr_columns[j]) {
                 qd_iterator_t *iter = qd_parse_raw(name);
@@ -325,11 +329,79 @@ void qdr_manage_handler(qdr_core_t *core, qdr_manage_response_t response_handler
 void qdr_agent_setup_CT(qdr_core_t *core)
 {
     DEQ_INIT(core->outgoing_query_list);
+    DEQ_INIT(core->agent_cursors);
     core->query_lock  = sys_mutex();
     core->agent_timer = qd_timer(core->qd, qdr_agent_response_handler, core);
 }
 
 
+static uint64_t qdr_agent_now_usec(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+void qdr_agent_page_start_CT(qdr_query_t *query)
+{
+    query->page_records  = 0;
+    query->page_deadline = qdr_agent_now_usec() + QDR_AGENT_PAGE_USEC;
+}
+
+
+bool qdr_agent_page_has_room_CT(qdr_query_t *query)
+{
+    if (query->remaining == 0 || query->page_records == QDR_AGENT_PAGE_RECORDS)
+        return false;
+
+    //
+    // Reading the clock costs more than composing a small record, so the time budget is
+    // only checked every 32 records.
+    //
+    if (query->page_records > 0 && (query->page_records & 0x1f) == 0 &&
+        qdr_agent_now_usec() >= query->page_deadline)
+        return false;
+
+    query->page_records++;
+    if (query->remaining > 0)
+        query->remaining--;
+    return true;
+}
+
+
+void qdr_agent_page_finish_CT(qdr_core_t *core, qdr_query_t *query, void *next_record)
+{
+    query->next_record = next_record;
+    query->more        = next_record != 0 && query->remaining != 0;
+
+    //
+    // While the query has more to return, its cursor is kept on the core's list so that
+    // it can be moved along if the record it refers to is removed.
+    //
+    if (query->more && !query->parked) {
+        DEQ_INSERT_TAIL_N(CURSOR, core->agent_cursors, query);
+        query->parked = true;
+    } else if (!query->more && query->parked) {
+        DEQ_REMOVE_N(CURSOR, core->agent_cursors, query);
+        query->parked = false;
+    }
+
+    qdr_agent_enqueue_response_CT(core, query);
+}
+
+
+void qdr_agent_cursor_remove_CT(qdr_core_t *core, void *record, void *next_record)
+{
+    qdr_query_t *query = DEQ_HEAD(core->agent_cursors);
+    while (query) {
+        if (query->next_record == record)
+            query->next_record = next_record;
+        query = DEQ_NEXT_N(CURSOR, query);
+    }
+}
+
+
 static void qdr_agent_forbidden(qdr_core_t *core, qdr_query_t *query, bool op_query)
 {
     query->status = QD_AMQP_FORBIDDEN;
@@ -447,6 +519,7 @@ static void qdrh_query_get_first_CT(qdr_core_t *core, qdr_action_t *action, bool
     int          offset = action->args.agent.offset;
 
     if (!discard) {
+        query->remaining = action->args.agent.count > 0 ? action->args.agent.count : -1;
         switch (query->entity_type) {
         case QD_ROUTER_CONFIG_ADDRESS:    qdra_config_address_get_first_CT(core, query, offset); break;
         case QD_ROUTER_CONFIG_LINK_ROUTE: qdra_config_link_route_get_first_CT(core, query, offset); break;
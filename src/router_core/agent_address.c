@@ -121,11 +121,13 @@ static void qdr_insert_address_columns_CT(qdr_core_t          *core,
     }
 
     case QDR_ADDRESS_DELIVERIES_INGRESS:
-        qd_compose_insert_ulong(body, addr->deliveries_ingress);
+        qd_compose_insert_ulong(body, addr->deliveries_ingress +
+                                __atomic_load_n(&addr->deliveries_ingress_direct, __ATOMIC_RELAXED));
         break;
 
     case QDR_ADDRESS_DELIVERIES_EGRESS:
-        qd_compose_insert_ulong(body, addr->deliveries_egress);
+        qd_compose_insert_ulong(body, addr->deliveries_egress +
+                                __atomic_load_n(&addr->deliveries_egress_direct, __ATOMIC_RELAXED));
         break;
 
     case QDR_ADDRESS_DELIVERIES_TRANSIT:
@@ -196,15 +198,18 @@ static void qdr_manage_write_address_list_CT(qdr_core_t *core, qdr_query_t *quer
 }
 
 
-static void qdr_manage_advance_address_CT(qdr_query_t *query, qdr_address_t *addr)
+static void qdr_manage_write_address_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_address_t *addr)
 {
-    query->next_offset++;
-    addr = DEQ_NEXT(addr);
-    if (addr) {
-        query->more     = true;
-        query->next_key = qdr_field((const char*) qd_hash_key_by_handle(addr->hash_handle));
-    } else
-        query->more = false;
+    qdr_agent_page_start_CT(query);
+    while (addr && qdr_agent_page_has_room_CT(query)) {
+        qdr_manage_write_address_list_CT(core, query, addr);
+        addr = DEQ_NEXT(addr);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next address.
+    //
+    qdr_agent_page_finish_CT(core, query, addr);
 }
 
 void qdra_address_get_CT(qdr_core_t    *core,
@@ -248,79 +253,28 @@ void qdra_address_get_first_CT(qdr_core_t *core, qdr_query_t *query, int offset)
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of addresses, end the query now.
+    // Run to the address at the offset.  If the offset goes beyond the set of addresses,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->addrs)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_address_t *addr = 0;
+    if (offset < DEQ_SIZE(core->addrs)) {
+        addr = DEQ_HEAD(core->addrs);
+        for (int i = 0; i < offset && addr; i++)
+            addr = DEQ_NEXT(addr);
     }
 
     //
-    // Run to the address at the offset.
-    //
-    qdr_address_t *addr = DEQ_HEAD(core->addrs);
-    for (int i = 0; i < offset && addr; i++)
-        addr = DEQ_NEXT(addr);
-    assert(addr != 0);
-
-    //
-    // Write the columns of the address entity into the response body.
-    //
-    qdr_manage_write_address_list_CT(core, query, addr);
-
-    //
-    // Advance to the next address
+    // Write the columns of as many addresses as fit into the response body.
     //
-    query->next_offset = offset;
-    qdr_manage_advance_address_CT(query, addr);
-
-    //
-    // Enqueue the response.
-    //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_manage_write_address_page_CT(core, query, addr);
 }
 
 
 void qdra_address_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_address_t *addr = 0;
-
-    //
-    // Use the stored key to try to find the next entry in the table.
-    //
-    if (query->next_key) {
-        qd_hash_retrieve(core->addr_hash, query->next_key->iterator, (void**) &addr);
-        qdr_field_free(query->next_key);
-        query->next_key = 0;
-    }
-    if (!addr) {
-        //
-        // If the address was removed in the time between this get and the previous one,
-        // we need to use the saved offset, which is less efficient.
-        //
-        if (query->next_offset < DEQ_SIZE(core->addrs)) {
-            addr = DEQ_HEAD(core->addrs);
-            for (int i = 0; i < query->next_offset && addr; i++)
-                addr = DEQ_NEXT(addr);
-        }
-    }
-
-    if (addr) {
-        //
-        // Write the columns of the address entity into the response body.
-        //
-        qdr_manage_write_address_list_CT(core, query, addr);
-
-        //
-        // Advance to the next address
-        //
-        qdr_manage_advance_address_CT(query, addr);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the address it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_manage_write_address_page_CT(core, query, (qdr_address_t*) query->next_record);
 }
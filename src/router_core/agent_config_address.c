@@ -107,6 +107,10 @@ static void qdr_config_address_insert_column_CT(qdr_address_config_t *addr, int
     case QDR_CONFIG_ADDRESS_OUT_PHASE:
         qd_compose_insert_int(body, addr->out_phase);
         break;
+
+    default:
+        qd_compose_insert_null(body);
+        break;
     }
 }
 
@@ -125,11 +129,18 @@ static void qdr_agent_write_config_address_CT(qdr_query_t *query,  qdr_address_c
 }
 
 
-static void qdr_manage_advance_config_address_CT(qdr_query_t *query, qdr_address_config_t *addr)
+static void qdr_agent_write_config_address_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_address_config_t *addr)
 {
-    query->next_offset++;
-    addr = DEQ_NEXT(addr);
-    query->more = !!addr;
+    qdr_agent_page_start_CT(query);
+    while (addr && qdr_agent_page_has_room_CT(query)) {
+        qdr_agent_write_config_address_CT(query, addr);
+        addr = DEQ_NEXT(addr);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next object.
+    //
+    qdr_agent_page_finish_CT(core, query, addr);
 }
 
 
@@ -141,67 +152,30 @@ void qdra_config_address_get_first_CT(qdr_core_t *core, qdr_query_t *query, int
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of objects, end the query now.
+    // Run to the object at the offset.  If the offset goes beyond the set of objects,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->addr_config)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_address_config_t *addr = 0;
+    if (offset < DEQ_SIZE(core->addr_config)) {
+        addr = DEQ_HEAD(core->addr_config);
+        for (int i = 0; i < offset && addr; i++)
+            addr = DEQ_NEXT(addr);
     }
 
     //
-    // Run to the object at the offset.
-    //
-    qdr_address_config_t *addr = DEQ_HEAD(core->addr_config);
-    for (int i = 0; i < offset && addr; i++)
-        addr = DEQ_NEXT(addr);
-    assert(addr);
-
-    //
-    // Write the columns of the object into the response body.
-    //
-    qdr_agent_write_config_address_CT(query, addr);
-
-    //
-    // Advance to the next address
-    //
-    query->next_offset = offset;
-    qdr_manage_advance_config_address_CT(query, addr);
-
-    //
-    // Enqueue the response.
+    // Write the columns of as many objects as fit into the response body.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_address_page_CT(core, query, addr);
 }
 
 
 void qdra_config_address_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_address_config_t *addr = 0;
-
-    if (query->next_offset < DEQ_SIZE(core->addr_config)) {
-        addr = DEQ_HEAD(core->addr_config);
-        for (int i = 0; i < query->next_offset && addr; i++)
-            addr = DEQ_NEXT(addr);
-    }
-
-    if (addr) {
-        //
-        // Write the columns of the addr entity into the response body.
-        //
-        qdr_agent_write_config_address_CT(query, addr);
-
-        //
-        // Advance to the next object
-        //
-        qdr_manage_advance_config_address_CT(query, addr);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the object it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_address_page_CT(core, query, (qdr_address_config_t*) query->next_record);
 }
 
 
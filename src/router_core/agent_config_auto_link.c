@@ -149,6 +149,10 @@ static void qdr_config_auto_link_insert_column_CT(qdr_auto_link_t *al, int col,
         else
             qd_compose_insert_null(body);
         break;
+
+    default:
+        qd_compose_insert_null(body);
+        break;
     }
 }
 
@@ -167,11 +171,18 @@ static void qdr_agent_write_config_auto_link_CT(qdr_query_t *query,  qdr_auto_li
 }
 
 
-static void qdr_manage_advance_config_auto_link_CT(qdr_query_t *query, qdr_auto_link_t *al)
+static void qdr_agent_write_config_auto_link_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_auto_link_t *al)
 {
-    query->next_offset++;
-    al = DEQ_NEXT(al);
-    query->more = !!al;
+    qdr_agent_page_start_CT(query);
+    while (al && qdr_agent_page_has_room_CT(query)) {
+        qdr_agent_write_config_auto_link_CT(query, al);
+        al = DEQ_NEXT(al);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next object.
+    //
+    qdr_agent_page_finish_CT(core, query, al);
 }
 
 
@@ -183,67 +194,30 @@ void qdra_config_auto_link_get_first_CT(qdr_core_t *core, qdr_query_t *query, in
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of objects, end the query now.
+    // Run to the object at the offset.  If the offset goes beyond the set of objects,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->auto_links)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_auto_link_t *al = 0;
+    if (offset < DEQ_SIZE(core->auto_links)) {
+        al = DEQ_HEAD(core->auto_links);
+        for (int i = 0; i < offset && al; i++)
+            al = DEQ_NEXT(al);
     }
 
     //
-    // Run to the object at the offset.
-    //
-    qdr_auto_link_t *al = DEQ_HEAD(core->auto_links);
-    for (int i = 0; i < offset && al; i++)
-        al = DEQ_NEXT(al);
-    assert(al);
-
-    //
-    // Write the columns of the object into the response body.
-    //
-    qdr_agent_write_config_auto_link_CT(query, al);
-
-    //
-    // Advance to the next auto_link
+    // Write the columns of as many objects as fit into the response body.
     //
-    query->next_offset = offset;
-    qdr_manage_advance_config_auto_link_CT(query, al);
-
-    //
-    // Enqueue the response.
-    //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_auto_link_page_CT(core, query, al);
 }
 
 
 void qdra_config_auto_link_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_auto_link_t *al = 0;
-
-    if (query->next_offset < DEQ_SIZE(core->auto_links)) {
-        al = DEQ_HEAD(core->auto_links);
-        for (int i = 0; i < query->next_offset && al; i++)
-            al = DEQ_NEXT(al);
-    }
-
-    if (al) {
-        //
-        // Write the columns of the addr entity into the response body.
-        //
-        qdr_agent_write_config_auto_link_CT(query, al);
-
-        //
-        // Advance to the next object
-        //
-        qdr_manage_advance_config_auto_link_CT(query, al);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the object it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_auto_link_page_CT(core, query, (qdr_auto_link_t*) query->next_record);
 }
 
 
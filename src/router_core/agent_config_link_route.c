@@ -123,6 +123,10 @@ static void qdr_config_link_route_insert_column_CT(qdr_link_route_t *lr, int col
         text = lr->active ? "active" : "inactive";
         qd_compose_insert_string(body, text);
         break;
+
+    default:
+        qd_compose_insert_null(body);
+        break;
     }
 }
 
@@ -141,11 +145,18 @@ static void qdr_agent_write_config_link_route_CT(qdr_query_t *query,  qdr_link_r
 }
 
 
-static void qdr_manage_advance_config_link_route_CT(qdr_query_t *query, qdr_link_route_t *lr)
+static void qdr_agent_write_config_link_route_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_link_route_t *lr)
 {
-    query->next_offset++;
-    lr = DEQ_NEXT(lr);
-    query->more = !!lr;
+    qdr_agent_page_start_CT(query);
+    while (lr && qdr_agent_page_has_room_CT(query)) {
+        qdr_agent_write_config_link_route_CT(query, lr);
+        lr = DEQ_NEXT(lr);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next object.
+    //
+    qdr_agent_page_finish_CT(core, query, lr);
 }
 
 
@@ -157,37 +168,20 @@ void qdra_config_link_route_get_first_CT(qdr_core_t *core, qdr_query_t *query, i
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of objects, end the query now.
+    // Run to the object at the offset.  If the offset goes beyond the set of objects,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->link_routes)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_link_route_t *lr = 0;
+    if (offset < DEQ_SIZE(core->link_routes)) {
+        lr = DEQ_HEAD(core->link_routes);
+        for (int i = 0; i < offset && lr; i++)
+            lr = DEQ_NEXT(lr);
     }
 
     //
-    // Run to the object at the offset.
-    //
-    qdr_link_route_t *lr = DEQ_HEAD(core->link_routes);
-    for (int i = 0; i < offset && lr; i++)
-        lr = DEQ_NEXT(lr);
-    assert(lr);
-
-    //
-    // Write the columns of the object into the response body.
-    //
-    qdr_agent_write_config_link_route_CT(query, lr);
-
-    //
-    // Advance to the next link_route
+    // Write the columns of as many objects as fit into the response body.
     //
-    query->next_offset = offset;
-    qdr_manage_advance_config_link_route_CT(query, lr);
-
-    //
-    // Enqueue the response.
-    //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_link_route_page_CT(core, query, lr);
 }
 
 
@@ -210,31 +204,11 @@ static void qdr_manage_write_config_link_route_map_CT(qdr_core_t          *core,
 
 void qdra_config_link_route_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_link_route_t *lr = 0;
-
-    if (query->next_offset < DEQ_SIZE(core->link_routes)) {
-        lr = DEQ_HEAD(core->link_routes);
-        for (int i = 0; i < query->next_offset && lr; i++)
-            lr = DEQ_NEXT(lr);
-    }
-
-    if (lr) {
-        //
-        // Write the columns of the addr entity into the response body.
-        //
-        qdr_agent_write_config_link_route_CT(query, lr);
-
-        //
-        // Advance to the next object
-        //
-        qdr_manage_advance_config_link_route_CT(query, lr);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the object it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_config_link_route_page_CT(core, query, (qdr_link_route_t*) query->next_record);
 }
 
 
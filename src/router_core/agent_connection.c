@@ -226,6 +226,10 @@ static void qdr_connection_insert_column_CT(qdr_connection_t *conn, int col, qd_
         qd_compose_end_map(body);
     }
     break;
+
+    default:
+        qd_compose_insert_null(body);
+        break;
     }
 }
 
@@ -244,11 +248,18 @@ static void qdr_agent_write_connection_CT(qdr_query_t *query,  qdr_connection_t
 }
 
 
-static void qdr_manage_advance_connection_CT(qdr_query_t *query, qdr_connection_t *conn)
+static void qdr_agent_write_connection_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_connection_t *conn)
 {
-    query->next_offset++;
-    conn = DEQ_NEXT(conn);
-    query->more = !!conn;
+    qdr_agent_page_start_CT(query);
+    while (conn && qdr_agent_page_has_room_CT(query)) {
+        qdr_agent_write_connection_CT(query, conn);
+        conn = DEQ_NEXT(conn);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next connection.
+    //
+    qdr_agent_page_finish_CT(core, query, conn);
 }
 
 
@@ -260,66 +271,29 @@ void qdra_connection_get_first_CT(qdr_core_t *core, qdr_query_t *query, int offs
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of objects, end the query now.
+    // Run to the connection at the offset.  If the offset goes beyond the set of connections,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->open_connections)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_connection_t *conn = 0;
+    if (offset < DEQ_SIZE(core->open_connections)) {
+        conn = DEQ_HEAD(core->open_connections);
+        for (int i = 0; i < offset && conn; i++)
+            conn = DEQ_NEXT(conn);
     }
 
     //
-    // Run to the object at the offset.
-    //
-    qdr_connection_t *conn = DEQ_HEAD(core->open_connections);
-    for (int i = 0; i < offset && conn; i++)
-        conn = DEQ_NEXT(conn);
-    assert(conn);
-
-    //
-    // Write the columns of the object into the response body.
-    //
-    qdr_agent_write_connection_CT(query, conn);
-
+    // Write the columns of as many connections as fit into the response body.
     //
-    // Advance to the next connection
-    //
-    query->next_offset = offset;
-    qdr_manage_advance_connection_CT(query, conn);
-
-    //
-    // Enqueue the response.
-    //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_connection_page_CT(core, query, conn);
 }
 
 void qdra_connection_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_connection_t *conn = 0;
-
-    if (query->next_offset < DEQ_SIZE(core->open_connections)) {
-        conn = DEQ_HEAD(core->open_connections);
-        for (int i = 0; i < query->next_offset && conn; i++)
-            conn = DEQ_NEXT(conn);
-    }
-
-    if (conn) {
-        //
-        // Write the columns of the connection entity into the response body.
-        //
-        qdr_agent_write_connection_CT(query, conn);
-
-        //
-        // Advance to the next object
-        //
-        qdr_manage_advance_connection_CT(query, conn);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the connection it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_connection_page_CT(core, query, (qdr_connection_t*) query->next_record);
 }
 
 static void qdr_manage_write_connection_map_CT(qdr_core_t          *core,
@@ -41,6 +41,7 @@
 #define QDR_LINK_REJECTED_COUNT     17
 #define QDR_LINK_RELEASED_COUNT     18
 #define QDR_LINK_MODIFIED_COUNT     19
+#define QDR_LINK_DROPPED_PRESETTLED_COUNT 20
 
 const char *qdr_link_columns[] =
     {"name",
@@ -63,6 +64,7 @@ const char *qdr_link_columns[] =
      "rejectedCount",
      "releasedCount",
      "modifiedCount",
+     "droppedPresettledCount",
      0};
 
 static const char *qd_link_type_name(qd_link_type_t lt)
@@ -147,7 +149,7 @@ static void qdr_agent_write_column_CT(qd_composed_field_t *body, int col, qdr_li
         break;
 
     case QDR_LINK_DELIVERY_COUNT:
-        qd_compose_insert_ulong(body, link->total_deliveries);
+        qd_compose_insert_ulong(body, link->total_deliveries + __atomic_load_n(&link->direct_deliveries, __ATOMIC_RELAXED));
         break;
 
     case QDR_LINK_CONNECTION_ID: {
@@ -178,7 +180,7 @@ static void qdr_agent_write_column_CT(qd_composed_field_t *body, int col, qdr_li
         break;
 
     case QDR_LINK_PRESETTLED_COUNT:
-        qd_compose_insert_ulong(body, link->presettled_deliveries);
+        qd_compose_insert_ulong(body, link->presettled_deliveries + __atomic_load_n(&link->direct_deliveries, __ATOMIC_RELAXED));
         break;
 
     case QDR_LINK_ACCEPTED_COUNT:
@@ -197,6 +199,10 @@ static void qdr_agent_write_column_CT(qd_composed_field_t *body, int col, qdr_li
         qd_compose_insert_ulong(body, link->modified_deliveries);
         break;
 
+    case QDR_LINK_DROPPED_PRESETTLED_COUNT:
+        qd_compose_insert_ulong(body, link->dropped_presettled_deliveries);
+        break;
+
     default:
         qd_compose_insert_null(body);
         break;
@@ -216,15 +222,18 @@ static void qdr_agent_write_link_CT(qdr_query_t *query,  qdr_link_t *link)
     qd_compose_end_list(body);
 }
 
-static void qdr_manage_advance_link_CT(qdr_query_t *query, qdr_link_t *link)
+static void qdr_agent_write_link_page_CT(qdr_core_t *core, qdr_query_t *query, qdr_link_t *link)
 {
-    query->next_offset++;
-    link = DEQ_NEXT(link);
-    if (link) {
-        query->more     = true;
-        //query->next_key = qdr_field((const char*) qd_hash_key_by_handle(link->owning_addr->hash_handle));
-    } else
-        query->more = false;
+    qdr_agent_page_start_CT(query);
+    while (link && qdr_agent_page_has_room_CT(query)) {
+        qdr_agent_write_link_CT(query, link);
+        link = DEQ_NEXT(link);
+    }
+
+    //
+    // Enqueue the response with a cursor on the next link.
+    //
+    qdr_agent_page_finish_CT(core, query, link);
 }
 
 
@@ -236,67 +245,30 @@ void qdra_link_get_first_CT(qdr_core_t *core, qdr_query_t *query, int offset)
     query->status = QD_AMQP_OK;
 
     //
-    // If the offset goes beyond the set of links, end the query now.
+    // Run to the link at the offset.  If the offset goes beyond the set of links,
+    // the page is empty and the query ends.
     //
-    if (offset >= DEQ_SIZE(core->open_links)) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
+    qdr_link_t *link = 0;
+    if (offset < DEQ_SIZE(core->open_links)) {
+        link = DEQ_HEAD(core->open_links);
+        for (int i = 0; i < offset && link; i++)
+            link = DEQ_NEXT(link);
     }
 
     //
-    // Run to the address at the offset.
-    //
-    qdr_link_t *link = DEQ_HEAD(core->open_links);
-    for (int i = 0; i < offset && link; i++)
-        link = DEQ_NEXT(link);
-    assert(link);
-
-    //
-    // Write the columns of the link into the response body.
-    //
-    qdr_agent_write_link_CT(query, link);
-
+    // Write the columns of as many links as fit into the response body.
     //
-    // Advance to the next address
-    //
-    query->next_offset = offset;
-    qdr_manage_advance_link_CT(query, link);
-
-    //
-    // Enqueue the response.
-    //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_link_page_CT(core, query, link);
 }
 
 
 void qdra_link_get_next_CT(qdr_core_t *core, qdr_query_t *query)
 {
-    qdr_link_t *link = 0;
-
-        if (query->next_offset < DEQ_SIZE(core->open_links)) {
-            link = DEQ_HEAD(core->open_links);
-            for (int i = 0; i < query->next_offset && link; i++)
-                link = DEQ_NEXT(link);
-        }
-
-    if (link) {
-        //
-        // Write the columns of the link entity into the response body.
-        //
-        qdr_agent_write_link_CT(query, link);
-
-        //
-        // Advance to the next link
-        //
-        qdr_manage_advance_link_CT(query, link);
-    } else
-        query->more = false;
-
     //
-    // Enqueue the response.
+    // Continue from the cursor.  It was moved along if the link it referred to was
+    // removed in the time between this get and the previous one.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_write_link_page_CT(core, query, (qdr_link_t*) query->next_record);
 }
 
 
@@ -180,21 +180,14 @@ void qdra_router_get_first_CT(qdr_core_t *core, qdr_query_t *query, int offset)
     //
     query->status = QD_AMQP_OK;
 
-    if (offset >= 1) {
-        query->more = false;
-        qdr_agent_enqueue_response_CT(core, query);
-        return;
-    }
-
-    //
-    // Write the columns of core into the response body.
-    //
-    qdr_agent_write_router_CT(query, core);
-
     //
-    // Enqueue the response.
+    // Write the columns of core into the response body.  There is only one record, so
+    // nothing follows it.
     //
-    qdr_agent_enqueue_response_CT(core, query);
+    qdr_agent_page_start_CT(query);
+    if (offset < 1 && qdr_agent_page_has_room_CT(query))
+        qdr_agent_write_router_CT(query, core);
+    qdr_agent_page_finish_CT(core, query, 0);
 }
 
 // Nothing to do here. The router has only one entry.
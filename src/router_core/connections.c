@@ -200,6 +200,11 @@ int qdr_connection_process(qdr_connection_t *conn)
 
     int event_count = 0;
 
+    //
+    // Hand the actions that result from this pass to the core as one batch.
+    //
+    qdr_action_batch_begin(core);
+
     do {
         sys_mutex_lock(conn->work_lock);
         ref = DEQ_HEAD(conn->links_with_deliveries);
@@ -285,6 +290,8 @@ int qdr_connection_process(qdr_connection_t *conn)
         }
     } while (link);
 
+    qdr_action_batch_end(core);
+
     return event_count;
 }
 
@@ -513,9 +520,15 @@ static void qdr_generate_link_name(const char *label, char *buffer, size_t lengt
 
 static void qdr_link_cleanup_CT(qdr_core_t *core, qdr_connection_t *conn, qdr_link_t *link)
 {
+    //
+    // IO threads may be forwarding onto this link from the forwarding snapshot.
+    //
+    qdr_forward_snapshot_invalidate_CT(core);
+
     //
     // Remove the link from the master list of links
     //
+    qdr_agent_cursor_remove_CT(core, link, DEQ_NEXT(link));
     DEQ_REMOVE(core->open_links, link);
 
     //
@@ -545,6 +558,7 @@ static void qdr_link_cleanup_CT(qdr_core_t *core, qdr_connection_t *conn, qdr_li
     sys_mutex_lock(conn->work_lock);
     DEQ_MOVE(link->updated_deliveries, updated_deliveries);
     DEQ_MOVE(link->undelivered, undelivered);
+    DEQ_INIT(link->undelivered_presettled);
     qdr_delivery_t *d = DEQ_HEAD(undelivered);
     while (d) {
         assert(d->where == QDR_DELIVERY_IN_UNDELIVERED);
@@ -589,6 +603,12 @@ static void qdr_link_cleanup_CT(qdr_core_t *core, qdr_connection_t *conn, qdr_li
     qdr_delivery_t *peer;
     while (dlv) {
         DEQ_REMOVE_HEAD(undelivered);
+
+        //
+        // The delivery may outlive the link if it is referenced by a message that is still
+        // being received.  Make sure it no longer refers to the link.
+        //
+        dlv->link = 0;
         peer = dlv->peer;
         if (peer) {
             dlv->peer  = 0;
@@ -620,6 +640,7 @@ static void qdr_link_cleanup_CT(qdr_core_t *core, qdr_connection_t *conn, qdr_li
     dlv = DEQ_HEAD(unsettled);
     while (dlv) {
         DEQ_REMOVE_HEAD(unsettled);
+        dlv->link = 0;
 
         if (dlv->tracking_addr) {
             dlv->tracking_addr->outstanding_deliveries[dlv->tracking_addr_bit]--;
@@ -657,6 +678,18 @@ static void qdr_link_cleanup_CT(qdr_core_t *core, qdr_connection_t *conn, qdr_li
         dlv = DEQ_HEAD(unsettled);
     }
 
+    //
+    // Release the delivery that was being cut through when the link went away.
+    //
+    sys_mutex_lock(conn->work_lock);
+    qdr_delivery_t *streaming = link->streaming_delivery;
+    link->streaming_delivery = 0;
+    sys_mutex_unlock(conn->work_lock);
+    if (streaming) {
+        streaming->link = 0;
+        qdr_delivery_decref_CT(core, streaming);
+    }
+
     //
     // Remove the reference to this link in the connection's reference lists
     //
@@ -1159,6 +1192,7 @@ static void qdr_connection_closed_CT(qdr_core_t *core, qdr_action_t *action, boo
         DEQ_REMOVE_N(ACTIVATE, core->connections_to_activate, conn);
     }
 
+    qdr_agent_cursor_remove_CT(core, conn, DEQ_NEXT(conn));
     DEQ_REMOVE(core->open_connections, conn);
     sys_mutex_free(conn->work_lock);
     qdr_connection_free(conn);
@@ -1249,6 +1283,7 @@ static void qdr_link_inbound_first_attach_CT(qdr_core_t *core, qdr_action_t *act
                     // to do an address lookup for deliveries that arrive on this link.
                     //
                     link->owning_addr = addr;
+                    qdr_forward_snapshot_invalidate_CT(core);
                     qdr_add_link_ref(&addr->inlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                     qdr_link_outbound_second_attach_CT(core, link, source, target);
 
@@ -1306,6 +1341,7 @@ static void qdr_link_inbound_first_attach_CT(qdr_core_t *core, qdr_action_t *act
                 // Associate the link with the address.
                 //
                 link->owning_addr = addr;
+                qdr_forward_snapshot_invalidate_CT(core);
                 qdr_add_link_ref(&addr->rlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                 if (DEQ_SIZE(addr->rlinks) == 1) {
                     const char *key = (const char*) qd_hash_key_by_handle(addr->hash_handle);
@@ -1367,6 +1403,7 @@ static void qdr_link_inbound_second_attach_CT(qdr_core_t *core, qdr_action_t *ac
                 //
                 if (qdr_terminus_get_address(source)) {
                     link->auto_link->state = QDR_AUTO_LINK_STATE_ACTIVE;
+                    qdr_forward_snapshot_invalidate_CT(core);
                     qdr_add_link_ref(&link->auto_link->addr->inlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                     link->owning_addr = link->auto_link->addr;
                 }
@@ -1398,6 +1435,7 @@ static void qdr_link_inbound_second_attach_CT(qdr_core_t *core, qdr_action_t *ac
                 //
                 if (qdr_terminus_get_address(target)) {
                     link->auto_link->state = QDR_AUTO_LINK_STATE_ACTIVE;
+                    qdr_forward_snapshot_invalidate_CT(core);
                     qdr_add_link_ref(&link->auto_link->addr->rlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                     link->owning_addr = link->auto_link->addr;
                     if (DEQ_SIZE(link->auto_link->addr->rlinks) == 1) {
@@ -1477,6 +1515,7 @@ static void qdr_link_inbound_detach_CT(qdr_core_t *core, qdr_action_t *action, b
     }
 
     link->owning_addr = 0;
+    qdr_forward_snapshot_invalidate_CT(core);
 
     if (link->link_direction == QD_INCOMING) {
         //
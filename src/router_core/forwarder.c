@@ -19,6 +19,7 @@
 
 #include "router_core_private.h"
 #include <qpid/dispatch/amqp.h>
+#include <sched.h>
 #include <stdio.h>
 
 //
@@ -109,7 +110,7 @@ qdr_delivery_t *qdr_forward_new_delivery_CT(qdr_core_t *core, qdr_delivery_t *in
     dlv->msg        = qd_message_copy(msg);
     dlv->settled    = !in_dlv || in_dlv->settled;
     dlv->presettled = dlv->settled;
-    *tag            = core->next_tag++;
+    *tag            = __atomic_fetch_add(&core->next_tag, 1, __ATOMIC_RELAXED);
     dlv->tag_length = 8;
     dlv->error      = 0;
 
@@ -126,57 +127,103 @@ qdr_delivery_t *qdr_forward_new_delivery_CT(qdr_core_t *core, qdr_delivery_t *in
         }
     }
 
+    //
+    // If the message is still being received, remember the outgoing delivery so its
+    // link can be woken up as more of the message arrives.
+    //
+    if (in_dlv && !qd_message_receive_complete(msg) && !qd_message_aborted(msg)) {
+        qdr_delivery_incref(dlv);
+        qdr_add_delivery_ref(&in_dlv->streaming_peers, dlv);
+    }
+
     return dlv;
 }
 
 
 //
-// Drop all pre-settled deliveries pending on the link's
-// undelivered list.
+// Take one pre-settled delivery pending on the link's undelivered list
+// and put it on the dropped list.
 //
-static void qdr_forward_drop_presettled_CT_LH(qdr_core_t *core, qdr_link_t *link)
+static void qdr_forward_drop_presettled_LH(qdr_link_t *link, qdr_delivery_t *dlv, qdr_delivery_list_t *dropped)
 {
-    qdr_delivery_t *dlv = DEQ_HEAD(link->undelivered);
-    qdr_delivery_t *next;
-
-    while (dlv) {
-        next = DEQ_NEXT(dlv);
-        if (dlv->settled) {
-            DEQ_REMOVE(link->undelivered, dlv);
-            dlv->where = QDR_DELIVERY_NOWHERE;
-            qdr_delivery_decref_CT(core, dlv);
-        }
-        dlv = next;
-    }
+    DEQ_REMOVE_N(PRESETTLED, link->undelivered_presettled, dlv);
+    DEQ_REMOVE(link->undelivered, dlv);
+    dlv->where = QDR_DELIVERY_NOWHERE;
+    link->dropped_presettled_deliveries++;
+    DEQ_INSERT_TAIL(*dropped, dlv);
 }
 
 
-void qdr_forward_deliver_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv)
+//
+// Put an outgoing delivery on its link's undelivered list.  Deliveries discarded by the
+// presettled drop policy are moved to the dropped list; the caller releases them after
+// the lock is given up.  Returns true if the link was put on its connection's
+// links_with_deliveries list by this call.
+//
+static bool qdr_forward_enqueue_LH(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv, qdr_delivery_list_t *dropped)
 {
-    sys_mutex_lock(link->conn->work_lock);
-
-    //
-    // If the delivery is pre-settled and the outbound link is at or above capacity,
-    // discard all pre-settled deliveries on the undelivered list prior to enqueuing
-    // the new delivery.
-    //
-    if (dlv->settled && link->capacity > 0 && DEQ_SIZE(link->undelivered) >= link->capacity)
-        qdr_forward_drop_presettled_CT_LH(core, link);
-
     DEQ_INSERT_TAIL(link->undelivered, dlv);
     dlv->where = QDR_DELIVERY_IN_UNDELIVERED;
     qdr_delivery_incref(dlv);
 
+    if (dlv->settled) {
+        DEQ_INSERT_TAIL_N(PRESETTLED, link->undelivered_presettled, dlv);
+
+        //
+        // If the outbound link was already at or above capacity, make room by discarding
+        // presettled deliveries as the configured policy directs.  The presettled deliveries
+        // are kept on their own list so none of the policies has to search the queue.
+        //
+        if (link->capacity > 0 && DEQ_SIZE(link->undelivered) > link->capacity) {
+            switch (core->presettled_drop) {
+            case QDR_PRESETTLED_DROP_FLUSH:
+                while (DEQ_HEAD(link->undelivered_presettled) != dlv)
+                    qdr_forward_drop_presettled_LH(link, DEQ_HEAD(link->undelivered_presettled), dropped);
+                break;
+
+            case QDR_PRESETTLED_DROP_OLDEST:
+                for (int i = 0; i < core->presettled_drop_count && DEQ_HEAD(link->undelivered_presettled) != dlv; i++)
+                    qdr_forward_drop_presettled_LH(link, DEQ_HEAD(link->undelivered_presettled), dropped);
+                break;
+
+            case QDR_PRESETTLED_DROP_NEWEST:
+                qdr_forward_drop_presettled_LH(link, dlv, dropped);
+                return false;
+            }
+        }
+    }
+
     //
     // If the link isn't already on the links_with_deliveries list, put it there.
     //
+    bool listed = !!link->ref[QDR_LINK_LIST_CLASS_DELIVERY];
     qdr_add_link_ref(&link->conn->links_with_deliveries, link, QDR_LINK_LIST_CLASS_DELIVERY);
+    return !listed;
+}
+
+
+void qdr_forward_deliver_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv)
+{
+    qdr_delivery_list_t dropped;
+    DEQ_INIT(dropped);
+
+    sys_mutex_lock(link->conn->work_lock);
+    qdr_forward_enqueue_LH(core, link, dlv, &dropped);
+    bool queued = dlv->where == QDR_DELIVERY_IN_UNDELIVERED;
     sys_mutex_unlock(link->conn->work_lock);
 
+    qdr_delivery_t *drop = DEQ_HEAD(dropped);
+    while (drop) {
+        DEQ_REMOVE_HEAD(dropped);
+        qdr_delivery_decref_CT(core, drop);
+        drop = DEQ_HEAD(dropped);
+    }
+
     //
     // Activate the outgoing connection for later processing.
     //
-    qdr_connection_activate_CT(core, link->conn);
+    if (queued)
+        qdr_connection_activate_CT(core, link->conn);
 }
 
 
@@ -199,6 +246,20 @@ void qdr_forward_on_message_CT(qdr_core_t *core, qdr_subscription_t *sub, qdr_li
 }
 
 
+//
+// Deliver a message to an in-process subscriber.  A subscriber can only handle a complete
+// message, so if the message is still being received the subscription is remembered on the
+// incoming delivery and serviced when the rest of the message arrives.
+//
+static void qdr_forward_to_subscriber_CT(qdr_core_t *core, qdr_subscription_t *sub, qdr_delivery_t *in_dlv, qd_message_t *msg)
+{
+    if (in_dlv && !qd_message_receive_complete(msg))
+        qdr_add_subscription_ref_CT(&in_dlv->deferred_subscriptions, sub);
+    else
+        qdr_forward_on_message_CT(core, sub, in_dlv ? in_dlv->link : 0, msg);
+}
+
+
 int qdr_forward_multicast_CT(qdr_core_t      *core,
                              qdr_address_t   *addr,
                              qd_message_t    *msg,
@@ -317,7 +378,7 @@ int qdr_forward_multicast_CT(qdr_core_t      *core,
         //
         qdr_subscription_t *sub = DEQ_HEAD(addr->subscriptions);
         while (sub) {
-            qdr_forward_on_message_CT(core, sub, in_delivery ? in_delivery->link : 0, msg);
+            qdr_forward_to_subscriber_CT(core, sub, in_delivery, msg);
             fanout++;
             addr->deliveries_to_container++;
             sub = DEQ_NEXT(sub);
@@ -361,7 +422,7 @@ int qdr_forward_closest_CT(qdr_core_t      *core,
     if (!exclude_inprocess) {
         qdr_subscription_t *sub = DEQ_HEAD(addr->subscriptions);
         if (sub) {
-            qdr_forward_on_message_CT(core, sub, in_delivery ? in_delivery->link : 0, msg);
+            qdr_forward_to_subscriber_CT(core, sub, in_delivery, msg);
 
             //
             // If the incoming delivery is not settled, it should be accepted and settled here.
@@ -765,3 +826,333 @@ bool qdr_forward_attach_CT(qdr_core_t *core, qdr_address_t *addr, qdr_link_t *in
     return false;
 }
 
+
+
+//==================================================================================
+// Forwarding Snapshot
+//==================================================================================
+
+//
+// The forwarding snapshot lets IO threads forward the simplest deliveries themselves
+// instead of handing them to the core thread.  It is an immutable copy of the routes of
+// the addresses whose only destinations are local endpoint links.  Anything with
+// in-process subscribers or remote destinations, and every unsettled or partially
+// received delivery, still goes through the core.
+//
+// The core thread withdraws the snapshot before it changes the address table and
+// publishes a new one after its batch of actions.  An IO thread holds the snapshot only
+// while it forwards one delivery.
+//
+typedef enum {
+    QDR_FORWARD_MULTICAST,
+    QDR_FORWARD_CLOSEST,
+    QDR_FORWARD_BALANCED
+} qdr_forward_kind_t;
+
+typedef struct qdr_forward_route_t {
+    qdr_address_t       *addr;
+    qdr_forward_kind_t   kind;
+    uint32_t             next;        ///< Round-robin cursor (atomic)
+    int                  link_count;
+    qdr_link_t         **links;
+} qdr_forward_route_t;
+
+typedef struct qdr_forward_slot_t {
+    qdr_link_t          *link;
+    qdr_forward_route_t *route;
+} qdr_forward_slot_t;
+
+struct qdr_forward_snapshot_t {
+    qd_hash_t            *by_address;  ///< Routes for anonymous senders, by address hash key
+    qdr_forward_slot_t   *by_link;     ///< Routes for targeted senders, by incoming link
+    uint32_t              link_mask;
+    qdr_forward_route_t  *routes;
+    int                   route_count;
+};
+
+
+static inline uint32_t qdr_forward_slot_home(const qdr_forward_snapshot_t *snap, const qdr_link_t *link)
+{
+    return (uint32_t) (((uintptr_t) link >> 4) * 2654435769u) & snap->link_mask;
+}
+
+
+static qdr_forward_route_t *qdr_forward_route_for_link(const qdr_forward_snapshot_t *snap, const qdr_link_t *link)
+{
+    uint32_t idx = qdr_forward_slot_home(snap, link);
+    while (snap->by_link[idx].link) {
+        if (snap->by_link[idx].link == link)
+            return snap->by_link[idx].route;
+        idx = (idx + 1) & snap->link_mask;
+    }
+    return 0;
+}
+
+
+bool qdr_forward_addr_is_direct_CT(qdr_address_t *addr)
+{
+    if (!addr->forwarder || addr->local || DEQ_SIZE(addr->rlinks) == 0 ||
+        DEQ_SIZE(addr->subscriptions) > 0 || qd_bitmask_cardinality(addr->rnodes) > 0)
+        return false;
+
+    if (addr->forwarder->forward_message != qdr_forward_multicast_CT &&
+        addr->forwarder->forward_message != qdr_forward_closest_CT &&
+        addr->forwarder->forward_message != qdr_forward_balanced_CT)
+        return false;
+
+    qdr_link_ref_t *ref = DEQ_HEAD(addr->rlinks);
+    while (ref) {
+        if (ref->link->link_type != QD_LINK_ENDPOINT)
+            return false;
+        ref = DEQ_NEXT(ref);
+    }
+
+    return true;
+}
+
+
+static bool qdr_forward_inlink_is_direct_CT(qdr_link_t *link)
+{
+    return link->link_type == QD_LINK_ENDPOINT && !link->connected_link && DEQ_SIZE(link->undelivered) == 0;
+}
+
+
+static void qdr_forward_snapshot_release(qdr_forward_snapshot_t *snap)
+{
+    for (int i = 0; i < snap->route_count; i++)
+        free(snap->routes[i].links);
+    free(snap->routes);
+    free(snap->by_link);
+    qd_hash_free(snap->by_address);
+    free(snap);
+}
+
+
+static qdr_forward_snapshot_t *qdr_forward_snapshot_build_CT(qdr_core_t *core)
+{
+    qdr_forward_snapshot_t *snap = NEW(qdr_forward_snapshot_t);
+    ZERO(snap);
+    snap->by_address = qd_hash(6, 4, 0);
+
+    int            route_count = 0;
+    int            inlink_count = 0;
+    qdr_address_t *addr = DEQ_HEAD(core->addrs);
+    while (addr) {
+        if (qdr_forward_addr_is_direct_CT(addr)) {
+            route_count++;
+            inlink_count += DEQ_SIZE(addr->inlinks);
+        }
+        addr = DEQ_NEXT(addr);
+    }
+
+    uint32_t slots = 8;
+    while (slots < 2 * (uint32_t) inlink_count)
+        slots <<= 1;
+    snap->link_mask = slots - 1;
+    snap->by_link   = NEW_ARRAY(qdr_forward_slot_t, slots);
+    memset(snap->by_link, 0, slots * sizeof(qdr_forward_slot_t));
+
+    if (route_count == 0)
+        return snap;
+
+    snap->routes = NEW_ARRAY(qdr_forward_route_t, route_count);
+    addr = DEQ_HEAD(core->addrs);
+    while (addr) {
+        if (qdr_forward_addr_is_direct_CT(addr)) {
+            qdr_forward_route_t *route = &snap->routes[snap->route_count++];
+            route->addr       = addr;
+            route->kind       = addr->forwarder->forward_message == qdr_forward_multicast_CT ? QDR_FORWARD_MULTICAST :
+                                addr->forwarder->forward_message == qdr_forward_closest_CT   ? QDR_FORWARD_CLOSEST :
+                                QDR_FORWARD_BALANCED;
+            route->next       = 0;
+            route->link_count = 0;
+            route->links      = NEW_ARRAY(qdr_link_t*, DEQ_SIZE(addr->rlinks));
+
+            qdr_link_ref_t *ref = DEQ_HEAD(addr->rlinks);
+            while (ref) {
+                route->links[route->link_count++] = ref->link;
+                ref = DEQ_NEXT(ref);
+            }
+
+            const unsigned char *key = qd_hash_key_by_handle(addr->hash_handle);
+            if (key) {
+                qd_iterator_t *iter = qd_iterator_string((const char*) key, ITER_VIEW_ALL);
+                qd_hash_insert(snap->by_address, iter, route, 0);
+                qd_iterator_free(iter);
+            }
+
+            ref = DEQ_HEAD(addr->inlinks);
+            while (ref) {
+                if (qdr_forward_inlink_is_direct_CT(ref->link)) {
+                    uint32_t idx = qdr_forward_slot_home(snap, ref->link);
+                    while (snap->by_link[idx].link)
+                        idx = (idx + 1) & snap->link_mask;
+                    snap->by_link[idx].link  = ref->link;
+                    snap->by_link[idx].route = route;
+                }
+                ref = DEQ_NEXT(ref);
+            }
+        }
+        addr = DEQ_NEXT(addr);
+    }
+
+    return snap;
+}
+
+
+void qdr_forward_snapshot_publish_CT(qdr_core_t *core)
+{
+    if (core->forward_snapshot)
+        return;
+
+    __atomic_store_n(&core->forward_snapshot, qdr_forward_snapshot_build_CT(core), __ATOMIC_SEQ_CST);
+}
+
+
+void qdr_forward_snapshot_invalidate_CT(qdr_core_t *core)
+{
+    qdr_forward_snapshot_t *snap = core->forward_snapshot;
+    if (!snap)
+        return;
+
+    //
+    // Unpublish the snapshot, then move new readers to the other epoch.  Every reader that
+    // can still hold the snapshot is counted in the previous epoch, so once that count
+    // drains nobody is using it.
+    //
+    int epoch = core->forward_epoch;
+    __atomic_store_n(&core->forward_snapshot, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&core->forward_epoch, epoch ^ 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&core->forward_readers[epoch], __ATOMIC_SEQ_CST) > 0)
+        sched_yield();
+
+    qdr_forward_snapshot_release(snap);
+}
+
+
+void qdr_forward_snapshot_free(qdr_core_t *core)
+{
+    if (core->forward_snapshot)
+        qdr_forward_snapshot_release(core->forward_snapshot);
+    core->forward_snapshot = 0;
+}
+
+
+//
+// Create a presettled delivery of msg on an outgoing link and queue it for sending.
+//
+static void qdr_forward_direct_to_link(qdr_core_t *core, qdr_link_t *link, qd_message_t *msg)
+{
+    qdr_delivery_t *dlv = new_qdr_delivery_t();
+    uint64_t       *tag = (uint64_t*) dlv->tag;
+
+    ZERO(dlv);
+    sys_atomic_init(&dlv->ref_count, 0);
+    dlv->link       = link;
+    dlv->msg        = qd_message_copy(msg);
+    dlv->settled    = true;
+    dlv->presettled = true;
+    *tag            = __atomic_fetch_add(&core->next_tag, 1, __ATOMIC_RELAXED);
+    dlv->tag_length = 8;
+
+    qdr_delivery_list_t dropped;
+    DEQ_INIT(dropped);
+
+    sys_mutex_lock(link->conn->work_lock);
+    bool activate = qdr_forward_enqueue_LH(core, link, dlv, &dropped);
+    sys_mutex_unlock(link->conn->work_lock);
+
+    qdr_delivery_t *drop = DEQ_HEAD(dropped);
+    while (drop) {
+        DEQ_REMOVE_HEAD(dropped);
+        qdr_delivery_decref(core, drop);
+        drop = DEQ_HEAD(dropped);
+    }
+
+    //
+    // A link that was already listed belongs to a connection that has been activated and
+    // not yet processed, so only the first delivery needs to wake the connection up.
+    //
+    if (activate)
+        core->activate_handler(core->user_context, link->conn, true);
+}
+
+
+//
+// Choose the local link with the fewest outstanding deliveries as qdr_forward_balanced_CT
+// does, preferring links that are below capacity.  The scan starts at a rotating position
+// so that idle links share the load.
+//
+static qdr_link_t *qdr_forward_direct_balanced(qdr_forward_route_t *route, uint32_t start)
+{
+    qdr_link_t *best_eligible   = 0;
+    qdr_link_t *best_ineligible = 0;
+    uint32_t    eligible_value   = UINT32_MAX;
+    uint32_t    ineligible_value = UINT32_MAX;
+
+    for (int i = 0; i < route->link_count; i++) {
+        qdr_link_t *link  = route->links[(start + i) % route->link_count];
+        uint32_t    value = DEQ_SIZE(link->undelivered) + DEQ_SIZE(link->unsettled);
+        if (link->capacity > value) {
+            if (eligible_value > value) {
+                best_eligible  = link;
+                eligible_value = value;
+            }
+        } else if (ineligible_value > value) {
+            best_ineligible  = link;
+            ineligible_value = value;
+        }
+    }
+
+    return best_eligible ? best_eligible : best_ineligible;
+}
+
+
+bool qdr_forward_direct(qdr_link_t *in_link, qd_iterator_t *addr_iter, qd_message_t *msg)
+{
+    qdr_core_t *core = in_link->core;
+    int         epoch;
+
+    //
+    // Join the current reader epoch.  If the core flipped the epoch in the meantime, it
+    // may already have checked our count, so back out and join the new epoch.
+    //
+    while (true) {
+        epoch = __atomic_load_n(&core->forward_epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&core->forward_readers[epoch], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&core->forward_epoch, __ATOMIC_SEQ_CST) == epoch)
+            break;
+        __atomic_sub_fetch(&core->forward_readers[epoch], 1, __ATOMIC_SEQ_CST);
+    }
+
+    qdr_forward_snapshot_t *snap  = __atomic_load_n(&core->forward_snapshot, __ATOMIC_SEQ_CST);
+    qdr_forward_route_t    *route = 0;
+
+    if (snap) {
+        if (addr_iter)
+            qd_hash_retrieve(snap->by_address, addr_iter, (void**) &route);
+        else
+            route = qdr_forward_route_for_link(snap, in_link);
+    }
+
+    if (route) {
+        int fanout = 1;
+        if (route->kind == QDR_FORWARD_MULTICAST) {
+            for (int i = 0; i < route->link_count; i++)
+                qdr_forward_direct_to_link(core, route->links[i], msg);
+            fanout = route->link_count;
+        } else {
+            uint32_t next = __atomic_fetch_add(&route->next, 1, __ATOMIC_RELAXED);
+            qdr_link_t *link = route->kind == QDR_FORWARD_BALANCED ?
+                qdr_forward_direct_balanced(route, next) : route->links[next % route->link_count];
+            qdr_forward_direct_to_link(core, link, msg);
+        }
+
+        if (in_link->link_type != QD_LINK_ROUTER)
+            __atomic_fetch_add(&route->addr->deliveries_ingress_direct, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&route->addr->deliveries_egress_direct, fanout, __ATOMIC_RELAXED);
+    }
+
+    __atomic_sub_fetch(&core->forward_readers[epoch], 1, __ATOMIC_SEQ_CST);
+    return !!route;
+}
@@ -79,8 +79,6 @@ typedef struct qd_management_context_t {
     qd_composed_field_t        *field;
     qdr_query_t                *query;
     qdr_core_t                 *core;
-    int                         count;
-    int                         current_count;
     qd_router_operation_type_t  operation_type;
 } qd_management_context_t ;
 
@@ -95,16 +93,13 @@ static qd_management_context_t* qd_management_context(qd_message_t
                                                       qd_composed_field_t        *field,
                                                       qdr_query_t                *query,
                                                       qdr_core_t                 *core,
-                                                      qd_router_operation_type_t operation_type,
-                                                      int                        count)
+                                                      qd_router_operation_type_t operation_type)
 {
     qd_management_context_t *ctx = new_qd_management_context_t();
-    ctx->count  = count;
     ctx->field  = field;
     ctx->msg    = msg;
     ctx->source = qd_message_copy(source);
     ctx->query  = query;
-    ctx->current_count = 0;
     ctx->core   = core;
     ctx->operation_type = operation_type;
 
@@ -155,18 +150,13 @@ static void qd_manage_response_handler(void *context, const qd_amqp_error_t *sta
     qd_management_context_t *ctx = (qd_management_context_t*) context;
 
     if (ctx->operation_type == QD_ROUTER_OPERATION_QUERY) {
-        if (status->status / 100 == 2) { // There is no error, proceed to conditionally call get_next
-            if (more) {
-               ctx->current_count++; // Increment how many you have at hand
-               if (ctx->count != ctx->current_count) {
-                   qdr_query_get_next(ctx->query);
-                   return;
-               } else
-                   //
-                   // This is the one case where the core agent won't free the query itself.
-                   //
-                   qdr_query_free(ctx->query);
-            }
+        //
+        // The core stops the query (more is false) once the requested count of records has
+        // been written, so there is no need to count them here.
+        //
+        if (status->status / 100 == 2 && more) {
+            qdr_query_get_next(ctx->query);
+            return;
         }
         qd_compose_end_list(ctx->field);
         qd_compose_end_map(ctx->field);
@@ -231,7 +221,7 @@ static void qd_core_agent_query_handler(qdr_core_t                 *core,
     qd_compose_insert_string(field, ATTRIBUTE_NAMES);
 
     // Call local function that creates and returns a local qd_management_context_t object containing the values passed in.
-    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, field, 0, core, operation_type, (*count));
+    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, field, 0, core, operation_type);
 
     // Grab the attribute names from the incoming message body. The attribute names will be used later on in the response.
     qd_parsed_field_t *attribute_names_parsed_field = 0;
@@ -252,7 +242,7 @@ static void qd_core_agent_query_handler(qdr_core_t                 *core,
     qd_compose_insert_string(field, results); //add a "results" key
     qd_compose_start_list(field); //start the list for results
 
-    qdr_query_get_first(ctx->query, (*offset));
+    qdr_query_get_first(ctx->query, (*offset), (*count));
 
     qd_iterator_free(body_iter);
     qd_parse_free(body);
@@ -275,7 +265,7 @@ static void qd_core_agent_read_handler(qdr_core_t                 *core,
     qdr_manage_handler(core, qd_manage_response_handler);
 
     // Call local function that creates and returns a qd_management_context_t containing the values passed in.
-    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, body, 0, core, operation_type, 0);
+    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, body, 0, core, operation_type);
 
     //Call the read API function
     qdr_manage_read(core, ctx, entity_type, name_iter, identity_iter, body);
@@ -297,7 +287,7 @@ static void qd_core_agent_create_handler(qdr_core_t                 *core,
     qdr_manage_handler(core, qd_manage_response_handler);
 
     // Call local function that creates and returns a qd_management_context_t containing the values passed in.
-    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, out_body, 0, core, operation_type, 0);
+    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, out_body, 0, core, operation_type);
 
     qd_iterator_t *body_iter = qd_message_field_iterator(msg, QD_FIELD_BODY);
 
@@ -322,7 +312,7 @@ static void qd_core_agent_update_handler(qdr_core_t                 *core,
     // Set the callback function.
     qdr_manage_handler(core, qd_manage_response_handler);
 
-    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, out_body, 0, core, operation_type, 0);
+    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, out_body, 0, core, operation_type);
 
     qd_iterator_t *iter = qd_message_field_iterator(msg, QD_FIELD_BODY);
     qd_parsed_field_t *in_body= qd_parse(iter);
@@ -349,7 +339,7 @@ static void qd_core_agent_delete_handler(qdr_core_t                 *core,
     qdr_manage_handler(core, qd_manage_response_handler);
 
     // Call local function that creates and returns a qd_management_context_t containing the values passed in.
-    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, body, 0, core, operation_type, 0);
+    qd_management_context_t *ctx = qd_management_context(qd_message(), msg, body, 0, core, operation_type);
 
     qdr_manage_delete(core, ctx, entity_type, name_iter, identity_iter);
 }
@@ -0,0 +1,815 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <qpid/dispatch/router_core.h>
+#include <qpid/dispatch/ctools.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// Shortest-path computation for the router network.
+//
+// The trees are the ones PathEngine in python/qpid_dispatch_internal/router/path.py
+// builds: Dijkstra over the directed link-state graph, resolving nodes in order of
+// (cost, router id).  A node's predecessor is the first resolved node that reaches it
+// at its final cost.  With link costs of at least one, that is the in-neighbor on a
+// shortest path with the lowest (cost, id), which depends only on the final costs.
+// This lets a tree be repaired in place and still come out exactly as a full run
+// would build it.
+//
+// A set of link-state changes is applied to each tree as follows:
+//
+//   - The subtree under every tree edge whose cost rose (or that was removed) is
+//     invalidated.  Every other node keeps a path whose cost is still achievable.
+//   - The invalidated nodes, and the far ends of edges whose cost fell (or that were
+//     added), are seeded from their remaining in-neighbors, and Dijkstra runs from
+//     those seeds until no cost improves.
+//   - Predecessors are chosen again only for nodes whose cost changed, their
+//     out-neighbors, and the far ends of changed edges.
+//
+// Trees that none of the changes touch are left alone.
+//
+
+#define PATH_NONE -1
+
+typedef struct {
+    int peer;
+    int cost;
+} qdr_path_edge_t;
+
+typedef struct {
+    int from;
+    int to;
+    int old_cost;   // PATH_NONE for an added edge
+    int new_cost;   // PATH_NONE for a removed edge
+} qdr_path_change_t;
+
+//
+// The shortest-path tree rooted at one router.  'order' holds the reachable nodes in
+// resolution order, root first, so every node follows its predecessor.  'below' is
+// the set of nodes whose path from the root runs through the local router.
+//
+typedef struct {
+    bool          valid;
+    int          *cost;
+    int          *prev;
+    int          *order;
+    int           order_count;
+    qd_bitmask_t *below;
+    bool          changed;
+    bool          origin;       // root is currently counted as a valid origin
+} qdr_path_tree_t;
+
+typedef struct {
+    bool             present;
+    char            *id;
+    int              rank;          // position of the id among all ids
+    qdr_path_edge_t *edges;         // link state, sorted by peer
+    int              edge_count;
+
+    //
+    // The route last reported for this node and its current valid origins.
+    //
+    int              next_hop;
+    int              cost;
+    qd_bitmask_t    *valid_origins;
+    bool             origins_changed;
+} qdr_path_node_t;
+
+struct qdr_path_engine_t {
+    int                width;
+    qdr_path_node_t   *nodes;
+    qdr_path_tree_t   *trees;
+    bool               rebuild;
+
+    qdr_path_change_t *changes;
+    int                change_count;
+    int                change_capacity;
+
+    //
+    // In-edges of every node, rebuilt from the link states for each calculation.
+    //
+    int               *in_start;
+    int               *in_from;
+    int               *in_cost;
+    int                in_capacity;
+
+    //
+    // Binary heap of (cost, node) with stale entries skipped when popped.
+    //
+    int               *heap_node;
+    int               *heap_cost;
+    int                heap_count;
+    int                heap_capacity;
+
+    //
+    // Per-calculation scratch, indexed by node.  An entry is current when its
+    // generation matches 'generation'.
+    //
+    unsigned int       generation;
+    unsigned int      *settled;
+    unsigned int      *invalid;
+    unsigned int      *touched;
+    int               *saved_cost;
+    int               *saved_prev;
+    int               *touched_list;
+    int                touched_count;
+    unsigned char     *listed;
+    int               *next_hop;
+
+    qdr_path_route_t  *routes;
+};
+
+
+//==================================================================================
+// Internal Functions
+//==================================================================================
+
+static inline bool qdr_path_before(qdr_path_engine_t *engine, const int *cost, int a, int b)
+{
+    return cost[a] < cost[b] || (cost[a] == cost[b] && engine->nodes[a].rank < engine->nodes[b].rank);
+}
+
+
+static void qdr_path_heap_push(qdr_path_engine_t *engine, const int *cost, int node)
+{
+    if (engine->heap_count == engine->heap_capacity) {
+        engine->heap_capacity *= 2;
+        engine->heap_node = (int*) realloc(engine->heap_node, engine->heap_capacity * sizeof(int));
+        engine->heap_cost = (int*) realloc(engine->heap_cost, engine->heap_capacity * sizeof(int));
+    }
+
+    int i = engine->heap_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        int pn     = engine->heap_node[parent];
+        int pc     = engine->heap_cost[parent];
+        if (pc < cost[node] || (pc == cost[node] && engine->nodes[pn].rank <= engine->nodes[node].rank))
+            break;
+        engine->heap_node[i] = pn;
+        engine->heap_cost[i] = pc;
+        i = parent;
+    }
+    engine->heap_node[i] = node;
+    engine->heap_cost[i] = cost[node];
+}
+
+
+static int qdr_path_heap_pop(qdr_path_engine_t *engine, int *node_cost)
+{
+    int node = engine->heap_node[0];
+    *node_cost = engine->heap_cost[0];
+
+    int last_node = engine->heap_node[--engine->heap_count];
+    int last_cost = engine->heap_cost[engine->heap_count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= engine->heap_count)
+            break;
+        if (child + 1 < engine->heap_count) {
+            int a = engine->heap_node[child], b = engine->heap_node[child + 1];
+            int ac = engine->heap_cost[child], bc = engine->heap_cost[child + 1];
+            if (bc < ac || (bc == ac && engine->nodes[b].rank < engine->nodes[a].rank))
+                child++;
+        }
+        int cn = engine->heap_node[child];
+        int cc = engine->heap_cost[child];
+        if (last_cost < cc || (last_cost == cc && engine->nodes[last_node].rank <= engine->nodes[cn].rank))
+            break;
+        engine->heap_node[i] = cn;
+        engine->heap_cost[i] = cc;
+        i = child;
+    }
+    engine->heap_node[i] = last_node;
+    engine->heap_cost[i] = last_cost;
+    return node;
+}
+
+
+/**
+ * Record a node whose cost or predecessor may change, saving the old values so the
+ * tree can tell afterwards whether anything actually moved.
+ */
+static void qdr_path_touch(qdr_path_engine_t *engine, qdr_path_tree_t *tree, int node)
+{
+    if (engine->touched[node] == engine->generation)
+        return;
+    engine->touched[node]    = engine->generation;
+    engine->saved_cost[node] = tree->cost[node];
+    engine->saved_prev[node] = tree->prev[node];
+    engine->touched_list[engine->touched_count++] = node;
+}
+
+
+/**
+ * Run Dijkstra from whatever is on the heap, lowering costs where a cheaper path is
+ * found.
+ */
+static void qdr_path_relax(qdr_path_engine_t *engine, qdr_path_tree_t *tree)
+{
+    while (engine->heap_count > 0) {
+        int cost;
+        int node = qdr_path_heap_pop(engine, &cost);
+        if (cost != tree->cost[node] || engine->settled[node] == engine->generation)
+            continue;
+        engine->settled[node] = engine->generation;
+
+        qdr_path_node_t *pn = &engine->nodes[node];
+        for (int i = 0; i < pn->edge_count; i++) {
+            int peer = pn->edges[i].peer;
+            if (!engine->nodes[peer].present)
+                continue;
+            int alt = cost + pn->edges[i].cost;
+            if (tree->cost[peer] == PATH_NONE || alt < tree->cost[peer]) {
+                qdr_path_touch(engine, tree, peer);
+                tree->cost[peer] = alt;
+                qdr_path_heap_push(engine, tree->cost, peer);
+            }
+        }
+    }
+}
+
+
+/**
+ * Choose the predecessor of a node from its in-neighbors: the lowest (cost, id)
+ * among those on a shortest path.
+ */
+static int qdr_path_choose_prev(qdr_path_engine_t *engine, qdr_path_tree_t *tree, int root, int node)
+{
+    if (node == root || tree->cost[node] == PATH_NONE)
+        return PATH_NONE;
+
+    int best = PATH_NONE;
+    for (int i = engine->in_start[node]; i < engine->in_start[node + 1]; i++) {
+        int from = engine->in_from[i];
+        if (tree->cost[from] != PATH_NONE && tree->cost[from] + engine->in_cost[i] == tree->cost[node])
+            if (best == PATH_NONE || qdr_path_before(engine, tree->cost, from, best))
+                best = from;
+    }
+    return best;
+}
+
+
+/**
+ * Rebuild the resolution order and the set of nodes reached through the local router.
+ * The previous order is mostly still sorted, so an insertion sort is nearly linear.
+ */
+static void qdr_path_tree_finish(qdr_path_engine_t *engine, qdr_path_tree_t *tree, int root)
+{
+    int count = 0;
+    memset(engine->listed, 0, engine->width);
+    for (int i = 0; i < tree->order_count; i++) {
+        int node = tree->order[i];
+        if (engine->nodes[node].present && tree->cost[node] != PATH_NONE && !engine->listed[node]) {
+            engine->listed[node] = 1;
+            tree->order[count++] = node;
+        }
+    }
+    for (int node = 0; node < engine->width; node++)
+        if (engine->nodes[node].present && tree->cost[node] != PATH_NONE && !engine->listed[node])
+            tree->order[count++] = node;
+    tree->order_count = count;
+
+    for (int i = 1; i < count; i++) {
+        int node = tree->order[i];
+        int j    = i;
+        while (j > 0 && qdr_path_before(engine, tree->cost, node, tree->order[j - 1])) {
+            tree->order[j] = tree->order[j - 1];
+            j--;
+        }
+        tree->order[j] = node;
+    }
+
+    qd_bitmask_clear_all(tree->below);
+    if (root != 0)
+        for (int i = 1; i < count; i++) {
+            int node = tree->order[i];
+            int prev = tree->prev[node];
+            if (prev == 0 || (prev != PATH_NONE && qd_bitmask_value(tree->below, prev)))
+                qd_bitmask_set_bit(tree->below, node);
+        }
+
+    tree->changed = true;
+}
+
+
+static void qdr_path_next_generation(qdr_path_engine_t *engine)
+{
+    if (++engine->generation == 0) {
+        for (int i = 0; i < engine->width; i++) {
+            engine->settled[i] = 0;
+            engine->invalid[i] = 0;
+            engine->touched[i] = 0;
+        }
+        engine->generation = 1;
+    }
+    engine->touched_count = 0;
+    engine->heap_count    = 0;
+}
+
+
+static void qdr_path_tree_compute(qdr_path_engine_t *engine, int root)
+{
+    qdr_path_tree_t *tree = &engine->trees[root];
+
+    if (!tree->cost) {
+        tree->cost  = NEW_ARRAY(int, engine->width);
+        tree->prev  = NEW_ARRAY(int, engine->width);
+        tree->order = NEW_ARRAY(int, engine->width);
+        tree->below = qd_bitmask(0);
+        tree->order_count = 0;
+    }
+
+    for (int i = 0; i < engine->width; i++) {
+        tree->cost[i] = PATH_NONE;
+        tree->prev[i] = PATH_NONE;
+    }
+
+    qdr_path_next_generation(engine);
+    tree->cost[root] = 0;
+    qdr_path_heap_push(engine, tree->cost, root);
+    qdr_path_relax(engine, tree);
+
+    for (int node = 0; node < engine->width; node++)
+        if (tree->cost[node] != PATH_NONE)
+            tree->prev[node] = qdr_path_choose_prev(engine, tree, root, node);
+
+    tree->valid = true;
+    qdr_path_tree_finish(engine, tree, root);
+}
+
+
+/**
+ * Apply the pending link-state changes to one tree.  Returns without touching the
+ * tree if none of the changes can affect it.
+ */
+static void qdr_path_tree_update(qdr_path_engine_t *engine, int root)
+{
+    qdr_path_tree_t *tree = &engine->trees[root];
+    bool             seeded = false;
+
+    qdr_path_next_generation(engine);
+
+    for (int i = 0; i < engine->change_count; i++) {
+        qdr_path_change_t *change = &engine->changes[i];
+        bool raised  = change->old_cost != PATH_NONE &&
+            (change->new_cost == PATH_NONE || change->new_cost > change->old_cost);
+        bool lowered = change->new_cost != PATH_NONE &&
+            (change->old_cost == PATH_NONE || change->new_cost < change->old_cost);
+
+        if (raised && tree->prev[change->to] == change->from) {
+            engine->invalid[change->to] = engine->generation;
+            seeded = true;
+        }
+        if (lowered && tree->cost[change->from] != PATH_NONE) {
+            qdr_path_touch(engine, tree, change->to);
+            seeded = true;
+        }
+    }
+
+    if (!seeded)
+        return;
+
+    //
+    // Spread the invalid marks down the tree.  A node follows its predecessor in the
+    // resolution order, so one pass is enough.
+    //
+    for (int i = 1; i < tree->order_count; i++) {
+        int node = tree->order[i];
+        int prev = tree->prev[node];
+        if (prev != PATH_NONE && engine->invalid[prev] == engine->generation)
+            engine->invalid[node] = engine->generation;
+    }
+    for (int i = 1; i < tree->order_count; i++) {
+        int node = tree->order[i];
+        if (engine->invalid[node] == engine->generation) {
+            qdr_path_touch(engine, tree, node);
+            tree->cost[node] = PATH_NONE;
+            tree->prev[node] = PATH_NONE;
+        }
+    }
+
+    //
+    // Seed each touched node from its in-neighbors that still have a cost.
+    //
+    int seed_count = engine->touched_count;
+    for (int i = 0; i < seed_count; i++) {
+        int node = engine->touched_list[i];
+        int best = PATH_NONE;
+        for (int j = engine->in_start[node]; j < engine->in_start[node + 1]; j++) {
+            int from = engine->in_from[j];
+            if (tree->cost[from] != PATH_NONE) {
+                int alt = tree->cost[from] + engine->in_cost[j];
+                if (best == PATH_NONE || alt < best)
+                    best = alt;
+            }
+        }
+        if (best != PATH_NONE && (tree->cost[node] == PATH_NONE || best < tree->cost[node])) {
+            tree->cost[node] = best;
+            qdr_path_heap_push(engine, tree->cost, node);
+        }
+    }
+
+    qdr_path_relax(engine, tree);
+
+    //
+    // Choose predecessors again for the touched nodes and the out-neighbors of those
+    // whose cost moved, then see whether the tree changed at all.
+    //
+    int touched_count = engine->touched_count;
+    for (int i = 0; i < touched_count; i++) {
+        int node = engine->touched_list[i];
+        if (tree->cost[node] == engine->saved_cost[node])
+            continue;
+        qdr_path_node_t *pn = &engine->nodes[node];
+        for (int j = 0; j < pn->edge_count; j++)
+            if (engine->nodes[pn->edges[j].peer].present)
+                qdr_path_touch(engine, tree, pn->edges[j].peer);
+    }
+    for (int i = 0; i < engine->change_count; i++)
+        qdr_path_touch(engine, tree, engine->changes[i].to);
+
+    bool changed = false;
+    for (int i = 0; i < engine->touched_count; i++) {
+        int node = engine->touched_list[i];
+        tree->prev[node] = qdr_path_choose_prev(engine, tree, root, node);
+        if (tree->cost[node] != engine->saved_cost[node] || tree->prev[node] != engine->saved_prev[node])
+            changed = true;
+    }
+
+    if (changed)
+        qdr_path_tree_finish(engine, tree, root);
+}
+
+
+/**
+ * Build the in-edge index from the current link states.
+ */
+static void qdr_path_index_in_edges(qdr_path_engine_t *engine)
+{
+    int total = 0;
+    for (int i = 0; i <= engine->width; i++)
+        engine->in_start[i] = 0;
+    for (int from = 0; from < engine->width; from++) {
+        qdr_path_node_t *pn = &engine->nodes[from];
+        if (!pn->present)
+            continue;
+        for (int i = 0; i < pn->edge_count; i++)
+            if (engine->nodes[pn->edges[i].peer].present) {
+                engine->in_start[pn->edges[i].peer + 1]++;
+                total++;
+            }
+    }
+
+    if (total > engine->in_capacity) {
+        engine->in_capacity = total;
+        engine->in_from = (int*) realloc(engine->in_from, total * sizeof(int));
+        engine->in_cost = (int*) realloc(engine->in_cost, total * sizeof(int));
+    }
+
+    for (int i = 0; i < engine->width; i++)
+        engine->in_start[i + 1] += engine->in_start[i];
+
+    //
+    // Fill using the next free slot of each node, kept in saved_cost for the moment.
+    //
+    for (int i = 0; i < engine->width; i++)
+        engine->saved_cost[i] = engine->in_start[i];
+    for (int from = 0; from < engine->width; from++) {
+        qdr_path_node_t *pn = &engine->nodes[from];
+        if (!pn->present)
+            continue;
+        for (int i = 0; i < pn->edge_count; i++) {
+            int to = pn->edges[i].peer;
+            if (engine->nodes[to].present) {
+                int slot = engine->saved_cost[to]++;
+                engine->in_from[slot] = from;
+                engine->in_cost[slot] = pn->edges[i].cost;
+            }
+        }
+    }
+}
+
+
+static void qdr_path_rank_nodes(qdr_path_engine_t *engine)
+{
+    for (int a = 0; a < engine->width; a++) {
+        qdr_path_node_t *na = &engine->nodes[a];
+        if (!na->present)
+            continue;
+        na->rank = 0;
+        for (int b = 0; b < engine->width; b++) {
+            qdr_path_node_t *nb = &engine->nodes[b];
+            if (b != a && nb->present) {
+                int diff = strcmp(nb->id, na->id);
+                if (diff < 0 || (diff == 0 && b < a))
+                    na->rank++;
+            }
+        }
+    }
+}
+
+
+/**
+ * Update the column of the valid-origin sets that belongs to one root.  A root is a
+ * valid origin for a destination if it is reachable from here and its path to the
+ * destination runs through this router.
+ */
+static void qdr_path_update_origin(qdr_path_engine_t *engine, int root, bool origin)
+{
+    qdr_path_tree_t *tree = &engine->trees[root];
+    tree->origin = origin;
+
+    for (int dest = 1; dest < engine->width; dest++) {
+        qdr_path_node_t *pn = &engine->nodes[dest];
+        if (!pn->present)
+            continue;
+        if (origin && qd_bitmask_value(tree->below, dest)) {
+            if (!qd_bitmask_set_bit(pn->valid_origins, root))
+                pn->origins_changed = true;
+        } else {
+            if (qd_bitmask_clear_bit(pn->valid_origins, root))
+                pn->origins_changed = true;
+        }
+    }
+}
+
+
+static void qdr_path_add_change(qdr_path_engine_t *engine, int from, int to, int old_cost, int new_cost)
+{
+    if (engine->change_count == engine->change_capacity) {
+        engine->change_capacity = engine->change_capacity ? engine->change_capacity * 2 : 16;
+        engine->changes = (qdr_path_change_t*) realloc(engine->changes,
+                                                       engine->change_capacity * sizeof(qdr_path_change_t));
+    }
+    qdr_path_change_t *change = &engine->changes[engine->change_count++];
+    change->from     = from;
+    change->to       = to;
+    change->old_cost = old_cost;
+    change->new_cost = new_cost;
+}
+
+
+static void qdr_path_forget_route(qdr_path_node_t *pn)
+{
+    pn->next_hop        = PATH_NONE;
+    pn->cost            = PATH_NONE;
+    pn->origins_changed = true;
+    qd_bitmask_clear_all(pn->valid_origins);
+}
+
+
+//==================================================================================
+// Interface Functions
+//==================================================================================
+
+qdr_path_engine_t *qdr_path_engine(void)
+{
+    qdr_path_engine_t *engine = NEW(qdr_path_engine_t);
+    ZERO(engine);
+
+    int width = qd_bitmask_width();
+    engine->width = width;
+    engine->nodes = NEW_ARRAY(qdr_path_node_t, width);
+    engine->trees = NEW_ARRAY(qdr_path_tree_t, width);
+    memset(engine->nodes, 0, width * sizeof(qdr_path_node_t));
+    memset(engine->trees, 0, width * sizeof(qdr_path_tree_t));
+    for (int i = 0; i < width; i++) {
+        engine->nodes[i].valid_origins = qd_bitmask(0);
+        qdr_path_forget_route(&engine->nodes[i]);
+    }
+
+    engine->in_start      = NEW_ARRAY(int, width + 1);
+    engine->heap_capacity = width * 2;
+    engine->heap_node     = NEW_ARRAY(int, engine->heap_capacity);
+    engine->heap_cost     = NEW_ARRAY(int, engine->heap_capacity);
+    engine->settled       = (unsigned int*) calloc(width, sizeof(unsigned int));
+    engine->invalid       = (unsigned int*) calloc(width, sizeof(unsigned int));
+    engine->touched       = (unsigned int*) calloc(width, sizeof(unsigned int));
+    engine->saved_cost    = NEW_ARRAY(int, width);
+    engine->saved_prev    = NEW_ARRAY(int, width);
+    engine->touched_list  = NEW_ARRAY(int, width);
+    engine->listed        = NEW_ARRAY(unsigned char, width);
+    engine->next_hop      = NEW_ARRAY(int, width);
+    engine->routes        = NEW_ARRAY(qdr_path_route_t, width);
+    engine->generation    = 1;
+    return engine;
+}
+
+
+void qdr_path_engine_free(qdr_path_engine_t *engine)
+{
+    if (!engine)
+        return;
+
+    for (int i = 0; i < engine->width; i++) {
+        free(engine->nodes[i].id);
+        free(engine->nodes[i].edges);
+        qd_bitmask_free(engine->nodes[i].valid_origins);
+        free(engine->trees[i].cost);
+        free(engine->trees[i].prev);
+        free(engine->trees[i].order);
+        qd_bitmask_free(engine->trees[i].below);
+    }
+    free(engine->nodes);
+    free(engine->trees);
+    free(engine->changes);
+    free(engine->in_start);
+    free(engine->in_from);
+    free(engine->in_cost);
+    free(engine->heap_node);
+    free(engine->heap_cost);
+    free(engine->settled);
+    free(engine->invalid);
+    free(engine->touched);
+    free(engine->saved_cost);
+    free(engine->saved_prev);
+    free(engine->touched_list);
+    free(engine->listed);
+    free(engine->next_hop);
+    free(engine->routes);
+    free(engine);
+}
+
+
+void qdr_path_set_link_state(qdr_path_engine_t *engine, int router_maskbit, const char *id,
+                             int peer_count, const int *peers, const int *costs)
+{
+    if (router_maskbit < 0 || router_maskbit >= engine->width)
+        return;
+
+    qdr_path_node_t *pn = &engine->nodes[router_maskbit];
+    if (!pn->present || strcmp(pn->id, id) != 0) {
+        free(pn->id);
+        pn->id      = strdup(id);
+        pn->present = true;
+        engine->rebuild = true;
+    }
+
+    //
+    // Sort the new link state by peer.  Link costs are at least one; the trees
+    // depend on that.
+    //
+    qdr_path_edge_t *edges = NEW_ARRAY(qdr_path_edge_t, peer_count > 0 ? peer_count : 1);
+    int count = 0;
+    for (int i = 0; i < peer_count; i++) {
+        int peer = peers[i];
+        if (peer < 0 || peer >= engine->width || peer == router_maskbit)
+            continue;
+        int j = count++;
+        while (j > 0 && edges[j - 1].peer > peer) {
+            edges[j] = edges[j - 1];
+            j--;
+        }
+        edges[j].peer = peer;
+        edges[j].cost = costs[i] < 1 ? 1 : costs[i];
+    }
+
+    //
+    // Merge against the old link state to record what changed.
+    //
+    int i = 0, j = 0;
+    while (i < pn->edge_count || j < count) {
+        if (j == count || (i < pn->edge_count && pn->edges[i].peer < edges[j].peer)) {
+            qdr_path_add_change(engine, router_maskbit, pn->edges[i].peer, pn->edges[i].cost, PATH_NONE);
+            i++;
+        } else if (i == pn->edge_count || edges[j].peer < pn->edges[i].peer) {
+            qdr_path_add_change(engine, router_maskbit, edges[j].peer, PATH_NONE, edges[j].cost);
+            j++;
+        } else {
+            if (pn->edges[i].cost != edges[j].cost)
+                qdr_path_add_change(engine, router_maskbit, edges[j].peer, pn->edges[i].cost, edges[j].cost);
+            i++;
+            j++;
+        }
+    }
+
+    free(pn->edges);
+    pn->edges      = edges;
+    pn->edge_count = count;
+}
+
+
+void qdr_path_del_router(qdr_path_engine_t *engine, int router_maskbit)
+{
+    if (router_maskbit < 0 || router_maskbit >= engine->width)
+        return;
+
+    qdr_path_node_t *pn = &engine->nodes[router_maskbit];
+    if (!pn->present)
+        return;
+
+    free(pn->id);
+    free(pn->edges);
+    pn->id         = 0;
+    pn->edges      = 0;
+    pn->edge_count = 0;
+    pn->present    = false;
+    qdr_path_forget_route(pn);
+    engine->trees[router_maskbit].valid = false;
+    engine->rebuild = true;
+}
+
+
+void qdr_path_reset_next_hop(qdr_path_engine_t *engine, int router_maskbit)
+{
+    if (router_maskbit >= 0 && router_maskbit < engine->width)
+        engine->nodes[router_maskbit].next_hop = PATH_NONE;
+}
+
+
+int qdr_path_calculate(qdr_path_engine_t *engine, qdr_path_route_t **routes)
+{
+    *routes = engine->routes;
+
+    qdr_path_index_in_edges(engine);
+
+    //
+    // A router joining or leaving changes the id order and makes edges to it appear
+    // or vanish, so every tree is rebuilt.  Otherwise only the trees that the changed
+    // edges reach are repaired.
+    //
+    if (engine->rebuild)
+        qdr_path_rank_nodes(engine);
+
+    for (int root = 0; root < engine->width; root++) {
+        qdr_path_tree_t *tree = &engine->trees[root];
+        tree->changed = false;
+        if (!engine->nodes[root].present)
+            continue;
+        if (engine->rebuild || !tree->valid)
+            qdr_path_tree_compute(engine, root);
+        else if (engine->change_count > 0)
+            qdr_path_tree_update(engine, root);
+    }
+    engine->rebuild      = false;
+    engine->change_count = 0;
+
+    qdr_path_tree_t *local = &engine->trees[0];
+    if (!engine->nodes[0].present)
+        return 0;
+
+    //
+    // The next hop of each destination is the first node after the root on its path.
+    //
+    if (local->changed)
+        for (int i = 1; i < local->order_count; i++) {
+            int node = local->order[i];
+            int prev = local->prev[node];
+            engine->next_hop[node] = prev == 0 ? node : engine->next_hop[prev];
+        }
+
+    for (int root = 1; root < engine->width; root++) {
+        qdr_path_tree_t *tree = &engine->trees[root];
+        bool origin = engine->nodes[root].present && local->cost[root] != PATH_NONE;
+        if (tree->changed || origin != tree->origin)
+            qdr_path_update_origin(engine, root, origin);
+    }
+
+    //
+    // Report the routes to reachable routers that differ from what was last reported.
+    //
+    int count = 0;
+    for (int i = 1; i < local->order_count; i++) {
+        int               node  = local->order[i];
+        qdr_path_node_t  *pn    = &engine->nodes[node];
+        qdr_path_route_t *route = &engine->routes[count];
+        int               nh    = engine->next_hop[node];
+
+        route->router_maskbit = node;
+        route->next_hop       = PATH_NONE;
+        route->cost           = PATH_NONE;
+        route->valid_origins  = 0;
+
+        if (nh != node && nh != pn->next_hop)
+            route->next_hop = pn->next_hop = nh;
+        if (local->cost[node] != pn->cost)
+            route->cost = pn->cost = local->cost[node];
+        if (pn->origins_changed) {
+            route->valid_origins = pn->valid_origins;
+            pn->origins_changed  = false;
+        }
+
+        if (route->next_hop != PATH_NONE || route->cost != PATH_NONE || route->valid_origins)
+            count++;
+    }
+
+    return count;
+}
@@ -248,6 +248,7 @@ void qdr_route_del_link_route_CT(qdr_core_t *core, qdr_link_route_t *lr)
     //
     // Remove the link route from the core list.
     //
+    qdr_agent_cursor_remove_CT(core, lr, DEQ_NEXT(lr));
     DEQ_REMOVE(core->link_routes, lr);
     free(lr->name);
     free_qdr_link_route_t(lr);
@@ -342,6 +343,7 @@ void qdr_route_del_auto_link_CT(qdr_core_t *core, qdr_auto_link_t *al)
     //
     // Remove the auto link from the core list.
     //
+    qdr_agent_cursor_remove_CT(core, al, DEQ_NEXT(al));
     DEQ_REMOVE(core->auto_links, al);
     free(al->name);
     free(al->external_addr);
@@ -28,10 +28,11 @@ static void qdr_set_next_hop_CT      (qdr_core_t *core, qdr_action_t *action, bo
 static void qdr_remove_next_hop_CT   (qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_set_cost_CT          (qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_set_valid_origins_CT (qdr_core_t *core, qdr_action_t *action, bool discard);
-static void qdr_map_destination_CT   (qdr_core_t *core, qdr_action_t *action, bool discard);
-static void qdr_unmap_destination_CT (qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_address_update_CT    (qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_address_resume_CT    (qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_subscribe_CT         (qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_unsubscribe_CT       (qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_address_updates_discard_CT(qdr_core_t *core, int router_maskbit);
 
 
 //==================================================================================
@@ -107,23 +108,60 @@ void qdr_core_set_valid_origins(qdr_core_t *core, int router_maskbit, qd_bitmask
 }
 
 
-void qdr_core_map_destination(qdr_core_t *core, int router_maskbit, const char *address_hash)
+static void qdr_core_address_update(qdr_core_t *core, int router_maskbit, bool unmap, int count, const char **address_hashes)
 {
-    qdr_action_t *action = qdr_action(qdr_map_destination_CT, "map_destination");
-    action->args.route_table.router_maskbit = router_maskbit;
-    action->args.route_table.address        = qdr_field(address_hash);
+    size_t length = 0;
+    for (int idx = 0; idx < count; idx++)
+        length += strlen(address_hashes[idx]) + 1;
+
+    if (length == 0)
+        return;
+
+    qdr_address_update_t *update = NEW(qdr_address_update_t);
+    DEQ_ITEM_INIT(update);
+    update->router_maskbit = router_maskbit;
+    update->unmap          = unmap;
+    update->addresses      = (char*) malloc(length);
+    update->cursor         = update->addresses;
+    update->end            = update->addresses + length;
+
+    char *ptr = update->addresses;
+    for (int idx = 0; idx < count; idx++) {
+        size_t len = strlen(address_hashes[idx]) + 1;
+        memcpy(ptr, address_hashes[idx], len);
+        ptr += len;
+    }
+
+    qdr_action_t *action = qdr_action(qdr_address_update_CT, unmap ? "unmap_destinations" : "map_destinations");
+    action->args.route_table.address_update = update;
     qdr_action_enqueue(core, action);
 }
 
 
+void qdr_core_map_destination(qdr_core_t *core, int router_maskbit, const char *address_hash)
+{
+    qdr_core_address_update(core, router_maskbit, false, 1, &address_hash);
+}
+
+
 void qdr_core_unmap_destination(qdr_core_t *core, int router_maskbit, const char *address_hash)
 {
-    qdr_action_t *action = qdr_action(qdr_unmap_destination_CT, "unmap_destination");
-    action->args.route_table.router_maskbit = router_maskbit;
-    action->args.route_table.address        = qdr_field(address_hash);
-    qdr_action_enqueue(core, action);
+    qdr_core_address_update(core, router_maskbit, true, 1, &address_hash);
 }
 
+
+void qdr_core_map_destinations(qdr_core_t *core, int router_maskbit, int count, const char **address_hashes)
+{
+    qdr_core_address_update(core, router_maskbit, false, count, address_hashes);
+}
+
+
+void qdr_core_unmap_destinations(qdr_core_t *core, int router_maskbit, int count, const char **address_hashes)
+{
+    qdr_core_address_update(core, router_maskbit, true, count, address_hashes);
+}
+
+
 void qdr_core_route_table_handlers(qdr_core_t           *core, 
                                    void                 *context,
                                    qdr_mobile_added_t    mobile_added,
@@ -150,6 +188,8 @@ qdr_subscription_t *qdr_core_subscribe(qdr_core_t             *core,
     sub->addr               = 0;
     sub->on_message         = on_message;
     sub->on_message_context = context;
+    sub->ref_count          = 0;
+    sub->unsubscribed       = false;
 
     qdr_action_t *action = qdr_action(qdr_subscribe_CT, "subscribe");
     action->args.io.address       = qdr_field(address);
@@ -217,6 +257,7 @@ void qdr_route_table_setup_CT(qdr_core_t *core)
 {
     DEQ_INIT(core->addrs);
     DEQ_INIT(core->routers);
+    DEQ_INIT(core->address_updates);
     core->addr_hash    = qd_hash(12, 32, 0);
     core->conn_id_hash = qd_hash(6, 4, 0);
     core->cost_epoch   = 1;
@@ -311,6 +352,7 @@ static void qdr_add_router_CT(qdr_core_t *core, qdr_action_t *action, bool disca
         //
         // Link the router record to the address record.
         //
+        qdr_forward_snapshot_invalidate_CT(core);
         qd_bitmask_set_bit(addr->rnodes, router_maskbit);
 
         //
@@ -349,6 +391,12 @@ static void qdr_del_router_CT(qdr_core_t *core, qdr_action_t *action, bool disca
         return;
     }
 
+    //
+    // Drop any address updates still pending for this router.  The addresses it has
+    // already been mapped to are unlinked below.
+    //
+    qdr_address_updates_discard_CT(core, router_maskbit);
+
     qdr_node_t    *rnode = core->routers_by_mask_bit[router_maskbit];
     qdr_address_t *oaddr = rnode->owning_addr;
     assert(oaddr);
@@ -356,6 +404,7 @@ static void qdr_del_router_CT(qdr_core_t *core, qdr_action_t *action, bool disca
     //
     // Unlink the router node from the address record
     //
+    qdr_forward_snapshot_invalidate_CT(core);
     qd_bitmask_clear_bit(oaddr->rnodes, router_maskbit);
     qd_bitmask_clear_bit(core->router_addr_T->rnodes, router_maskbit);
     qd_bitmask_clear_bit(core->routerma_addr_T->rnodes, router_maskbit);
@@ -536,93 +585,176 @@ static void qdr_set_valid_origins_CT(qdr_core_t *core, qdr_action_t *action, boo
 }
 
 
-static void qdr_map_destination_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+static void qdr_address_update_free(qdr_address_update_t *update)
 {
-    int          router_maskbit = action->args.route_table.router_maskbit;
-    qdr_field_t *address        = action->args.route_table.address;
+    free(update->addresses);
+    free(update);
+}
 
-    if (discard) {
-        qdr_field_free(address);
-        return;
+
+static void qdr_map_address_CT(qdr_core_t *core, qdr_node_t *rnode, int router_maskbit, qd_iterator_t *iter)
+{
+    qdr_address_t *addr = 0;
+
+    qd_hash_retrieve(core->addr_hash, iter, (void**) &addr);
+    if (!addr) {
+        addr = qdr_address_CT(core, qdr_treatment_for_address_hash_CT(core, iter));
+        qd_hash_insert(core->addr_hash, iter, addr, &addr->hash_handle);
+        DEQ_ITEM_INIT(addr);
+        DEQ_INSERT_TAIL(core->addrs, addr);
     }
 
-    do {
-        if (router_maskbit >= qd_bitmask_width() || router_maskbit < 0) {
-            qd_log(core->log, QD_LOG_CRITICAL, "map_destination: Router maskbit out of range: %d", router_maskbit);
-            break;
-        }
+    //
+    // A remote destination takes the address out of the forwarding snapshot.  Most
+    // mobile addresses are not in it, and those are left alone.
+    //
+    if (qdr_forward_addr_is_direct_CT(addr))
+        qdr_forward_snapshot_invalidate_CT(core);
+    qd_bitmask_set_bit(addr->rnodes, router_maskbit);
+    rnode->ref_count++;
+    addr->cost_epoch--;
+    qdr_addr_start_inlinks_CT(core, addr);
+}
 
-        if (core->routers_by_mask_bit[router_maskbit] == 0) {
-            qd_log(core->log, QD_LOG_CRITICAL, "map_destination: Router not found");
-            break;
-        }
 
-        qd_iterator_t *iter = address->iterator;
-        qdr_address_t *addr = 0;
+static void qdr_unmap_address_CT(qdr_core_t *core, qdr_node_t *rnode, int router_maskbit, qd_iterator_t *iter)
+{
+    qdr_address_t *addr = 0;
 
-        qd_hash_retrieve(core->addr_hash, iter, (void**) &addr);
-        if (!addr) {
-            addr = qdr_address_CT(core, qdr_treatment_for_address_hash_CT(core, iter));
-            qd_hash_insert(core->addr_hash, iter, addr, &addr->hash_handle);
-            DEQ_ITEM_INIT(addr);
-            DEQ_INSERT_TAIL(core->addrs, addr);
-        }
+    qd_hash_retrieve(core->addr_hash, iter, (void**) &addr);
+    if (!addr) {
+        qd_log(core->log, QD_LOG_CRITICAL, "unmap_destination: Address not found");
+        return;
+    }
 
-        qdr_node_t *rnode = core->routers_by_mask_bit[router_maskbit];
-        qd_bitmask_set_bit(addr->rnodes, router_maskbit);
-        rnode->ref_count++;
-        addr->cost_epoch--;
-        qdr_addr_start_inlinks_CT(core, addr);
-    } while (false);
+    qd_bitmask_clear_bit(addr->rnodes, router_maskbit);
+    rnode->ref_count--;
+    addr->cost_epoch--;
+    if (qdr_forward_addr_is_direct_CT(addr))
+        qdr_forward_snapshot_invalidate_CT(core);
 
-    qdr_field_free(address);
+    //
+    // TODO - If this affects a waypoint, create the proper side effects
+    //
+
+    qdr_check_addr_CT(core, addr, false);
 }
 
 
-static void qdr_unmap_destination_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+//
+// Apply up to 'limit' of the address hashes remaining in an update.  Returns the number
+// of hashes consumed.
+//
+static int qdr_address_update_apply_CT(qdr_core_t *core, qdr_address_update_t *update, int limit)
 {
-    int          router_maskbit = action->args.route_table.router_maskbit;
-    qdr_field_t *address        = action->args.route_table.address;
+    const char *label          = update->unmap ? "unmap_destination" : "map_destination";
+    int         router_maskbit = update->router_maskbit;
+    int         count          = 0;
 
-    if (discard) {
-        qdr_field_free(address);
-        return;
+    if (router_maskbit >= qd_bitmask_width() || router_maskbit < 0) {
+        qd_log(core->log, QD_LOG_CRITICAL, "%s: Router maskbit out of range: %d", label, router_maskbit);
+        update->cursor = update->end;
+        return 1;
     }
 
-    do {
-        if (router_maskbit >= qd_bitmask_width() || router_maskbit < 0) {
-            qd_log(core->log, QD_LOG_CRITICAL, "unmap_destination: Router maskbit out of range: %d", router_maskbit);
-            break;
-        }
+    qdr_node_t *rnode = core->routers_by_mask_bit[router_maskbit];
+    if (rnode == 0) {
+        qd_log(core->log, QD_LOG_CRITICAL, "%s: Router not found", label);
+        update->cursor = update->end;
+        return 1;
+    }
 
-        if (core->routers_by_mask_bit[router_maskbit] == 0) {
-            qd_log(core->log, QD_LOG_CRITICAL, "unmap_destination: Router not found");
-            break;
+    while (count < limit && update->cursor < update->end) {
+        qd_iterator_t *iter = qd_iterator_string(update->cursor, ITER_VIEW_ALL);
+        if (update->unmap)
+            qdr_unmap_address_CT(core, rnode, router_maskbit, iter);
+        else
+            qdr_map_address_CT(core, rnode, router_maskbit, iter);
+        qd_iterator_free(iter);
+        update->cursor += strlen(update->cursor) + 1;
+        count++;
+    }
+
+    return count;
+}
+
+
+//
+// Apply the pending address updates, in order, until a slice's worth of address hashes
+// has been applied.  If any remain, queue an action to resume after the actions that
+// arrived in the meantime so a large update does not stall forwarding.
+//
+static void qdr_address_updates_CT(qdr_core_t *core)
+{
+    if (core->address_update_scheduled)
+        return;
+
+    int                   budget = QDR_ADDRESS_UPDATE_SLICE;
+    qdr_address_update_t *update = DEQ_HEAD(core->address_updates);
+    while (update && budget > 0) {
+        budget -= qdr_address_update_apply_CT(core, update, budget);
+        if (update->cursor == update->end) {
+            DEQ_REMOVE_HEAD(core->address_updates);
+            qdr_address_update_free(update);
+            update = DEQ_HEAD(core->address_updates);
         }
+    }
 
-        qdr_node_t    *rnode = core->routers_by_mask_bit[router_maskbit];
-        qd_iterator_t *iter  = address->iterator;
-        qdr_address_t *addr  = 0;
+    if (update) {
+        core->address_update_scheduled = true;
+        qdr_action_enqueue(core, qdr_action(qdr_address_resume_CT, "address_resume"));
+    }
+}
 
-        qd_hash_retrieve(core->addr_hash, iter, (void**) &addr);
 
-        if (!addr) {
-            qd_log(core->log, QD_LOG_CRITICAL, "unmap_destination: Address not found");
-            break;
+//
+// Free, without applying them, the pending address updates for a router that is about
+// to be deleted.  The updates for other routers keep their place in the queue.
+//
+static void qdr_address_updates_discard_CT(qdr_core_t *core, int router_maskbit)
+{
+    qdr_address_update_t *update = DEQ_HEAD(core->address_updates);
+    while (update) {
+        qdr_address_update_t *next = DEQ_NEXT(update);
+        if (update->router_maskbit == router_maskbit) {
+            DEQ_REMOVE(core->address_updates, update);
+            qdr_address_update_free(update);
         }
+        update = next;
+    }
+}
 
-        qd_bitmask_clear_bit(addr->rnodes, router_maskbit);
-        rnode->ref_count--;
-        addr->cost_epoch--;
 
-        //
-        // TODO - If this affects a waypoint, create the proper side effects
-        //
+void qdr_route_table_cleanup(qdr_core_t *core)
+{
+    qdr_address_update_t *update = DEQ_HEAD(core->address_updates);
+    while (update) {
+        DEQ_REMOVE_HEAD(core->address_updates);
+        qdr_address_update_free(update);
+        update = DEQ_HEAD(core->address_updates);
+    }
+}
 
-        qdr_check_addr_CT(core, addr, false);
-    } while (false);
 
-    qdr_field_free(address);
+static void qdr_address_update_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    qdr_address_update_t *update = action->args.route_table.address_update;
+
+    if (discard) {
+        qdr_address_update_free(update);
+        return;
+    }
+
+    DEQ_INSERT_TAIL(core->address_updates, update);
+    qdr_address_updates_CT(core);
+}
+
+
+static void qdr_address_resume_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    core->address_update_scheduled = false;
+    if (!discard)
+        qdr_address_updates_CT(core);
 }
 
 
@@ -655,6 +787,7 @@ static void qdr_subscribe_CT(qdr_core_t *core, qdr_action_t *action, bool discar
 
         sub->addr = addr;
         DEQ_ITEM_INIT(sub);
+        qdr_forward_snapshot_invalidate_CT(core);
         DEQ_INSERT_TAIL(addr->subscriptions, sub);
         qdr_addr_start_inlinks_CT(core, addr);
 
@@ -670,12 +803,19 @@ static void qdr_unsubscribe_CT(qdr_core_t *core, qdr_action_t *action, bool disc
     qdr_subscription_t *sub = action->args.io.subscription;
 
     if (!discard) {
+        qdr_forward_snapshot_invalidate_CT(core);
         DEQ_REMOVE(sub->addr->subscriptions, sub);
         sub->addr = 0;
         qdr_check_addr_CT(sub->core, sub->addr, false);
     }
 
-    free(sub);
+    //
+    // Deliveries still being received may hold deferred references to this subscription.
+    // The last of them frees it.
+    //
+    sub->unsubscribed = true;
+    if (sub->ref_count == 0)
+        free(sub);
 }
 
 //==================================================================================
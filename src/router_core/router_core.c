@@ -25,6 +25,7 @@ ALLOC_DEFINE(qdr_address_config_t);
 ALLOC_DEFINE(qdr_node_t);
 ALLOC_DEFINE(qdr_delivery_t);
 ALLOC_DEFINE(qdr_delivery_ref_t);
+ALLOC_DEFINE(qdr_subscription_ref_t);
 ALLOC_DEFINE(qdr_link_t);
 ALLOC_DEFINE(qdr_router_ref_t);
 ALLOC_DEFINE(qdr_link_ref_t);
@@ -43,6 +44,8 @@ qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area,
     core->router_mode = mode;
     core->router_area = area;
     core->router_id   = id;
+    core->presettled_drop = qd->presettled_drop;
+    core->presettled_drop_count = qd->presettled_drop_count > 0 ? qd->presettled_drop_count : 1;
 
     //
     // Set up the logging sources for the router core
@@ -53,10 +56,11 @@ qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area,
     //
     // Set up the threading support
     //
-    core->action_cond = sys_cond();
-    core->action_lock = sys_mutex();
-    core->running     = true;
-    DEQ_INIT(core->action_list);
+    core->action_cond   = sys_cond();
+    core->action_lock   = sys_mutex();
+    core->running       = true;
+    core->action_stack  = 0;
+    core->action_parked = false;
 
     core->work_lock = sys_mutex();
     DEQ_INIT(core->work_list);
@@ -92,8 +96,10 @@ void qdr_core_free(qdr_core_t *core)
     //
     // Stop and join the thread
     //
+    sys_mutex_lock(core->action_lock);
     core->running = false;
     sys_cond_signal(core->action_cond);
+    sys_mutex_unlock(core->action_lock);
     sys_thread_join(core->thread);
 
     //
@@ -111,6 +117,9 @@ void qdr_core_free(qdr_core_t *core)
     free(core->agent_subscription_mobile);
     free(core->agent_subscription_local);
 
+    qdr_forward_snapshot_free(core);
+    qdr_route_table_cleanup(core);
+
     for (int i = 0; i <= QD_TREATMENT_LINK_BALANCED; ++i) {
         if (core->forwarders[i]) {
             free(core->forwarders[i]);
@@ -251,12 +260,87 @@ qdr_action_t *qdr_action(qdr_action_handler_t action_handler, const char *label)
 }
 
 
+//
+// Actions collected by the calling thread between qdr_action_batch_begin and
+// qdr_action_batch_end.  The chain is linked newest-first through the 'next'
+// links, the same order as the core's action stack, so it can be pushed as is.
+//
+typedef struct {
+    qdr_core_t   *core;
+    int           depth;
+    qdr_action_t *newest;
+    qdr_action_t *oldest;
+} qdr_action_batch_t;
+
+static __thread qdr_action_batch_t action_batch;
+
+
+/**
+ * Push a newest-first chain of actions onto the core's action stack with a single
+ * compare-and-swap.  The core thread is signaled only if it is parked.
+ */
+static void qdr_action_publish(qdr_core_t *core, qdr_action_t *newest, qdr_action_t *oldest)
+{
+    qdr_action_t *top = __atomic_load_n(&core->action_stack, __ATOMIC_RELAXED);
+    do {
+        DEQ_NEXT(oldest) = top;
+    } while (!__atomic_compare_exchange_n(&core->action_stack, &top, newest, true,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    //
+    // The core thread sets action_parked before its last look at the stack, and this
+    // thread looks at action_parked after its push.  At least one of the two sees the
+    // other's write, so a wakeup can't be lost.
+    //
+    if (__atomic_load_n(&core->action_parked, __ATOMIC_SEQ_CST)) {
+        sys_mutex_lock(core->action_lock);
+        sys_cond_signal(core->action_cond);
+        sys_mutex_unlock(core->action_lock);
+    }
+}
+
+
 void qdr_action_enqueue(qdr_core_t *core, qdr_action_t *action)
 {
-    sys_mutex_lock(core->action_lock);
-    DEQ_INSERT_TAIL(core->action_list, action);
-    sys_cond_signal(core->action_cond);
-    sys_mutex_unlock(core->action_lock);
+    if (action_batch.depth > 0 && action_batch.core == core) {
+        DEQ_NEXT(action) = action_batch.newest;
+        action_batch.newest = action;
+        if (!action_batch.oldest)
+            action_batch.oldest = action;
+        return;
+    }
+
+    qdr_action_publish(core, action, action);
+}
+
+
+qdr_action_t *qdr_action_batch_newest(qdr_core_t *core)
+{
+    if (action_batch.depth > 0 && action_batch.core == core)
+        return action_batch.newest;
+    return 0;
+}
+
+
+void qdr_action_batch_begin(qdr_core_t *core)
+{
+    assert(action_batch.depth == 0 || action_batch.core == core);
+    if (action_batch.depth++ == 0)
+        action_batch.core = core;
+}
+
+
+void qdr_action_batch_end(qdr_core_t *core)
+{
+    assert(action_batch.depth > 0 && action_batch.core == core);
+    if (--action_batch.depth > 0)
+        return;
+
+    if (action_batch.newest)
+        qdr_action_publish(core, action_batch.newest, action_batch.oldest);
+    action_batch.core   = 0;
+    action_batch.newest = 0;
+    action_batch.oldest = 0;
 }
 
 
@@ -294,8 +378,15 @@ qdr_address_t *qdr_add_local_address_CT(qdr_core_t *core, char aclass, const cha
 
 void qdr_core_remove_address(qdr_core_t *core, qdr_address_t *addr)
 {
+    //
+    // Only addresses forwarded directly are referenced by the forwarding snapshot
+    //
+    if (qdr_forward_addr_is_direct_CT(addr))
+        qdr_forward_snapshot_invalidate_CT(core);
+
     // Remove the address from the list and hash index
     qd_hash_remove_by_handle(core->addr_hash, addr->hash_handle);
+    qdr_agent_cursor_remove_CT(core, addr, DEQ_NEXT(addr));
     DEQ_REMOVE(core->addrs, addr);
 
     // Free resources associated with this address
@@ -314,6 +405,7 @@ void qdr_core_remove_address_config(qdr_core_t *core, qdr_address_config_t *addr
 {
     // Remove the address from the list and the hash index.
     qd_hash_remove_by_handle(core->addr_hash, addr->hash_handle);
+    qdr_agent_cursor_remove_CT(core, addr, DEQ_NEXT(addr));
     DEQ_REMOVE(core->addr_config, addr);
 
     // Free resources associated with this address.
@@ -386,6 +478,26 @@ void qdr_del_delivery_ref(qdr_delivery_ref_list_t *list, qdr_delivery_ref_t *ref
 }
 
 
+void qdr_add_subscription_ref_CT(qdr_subscription_ref_list_t *list, qdr_subscription_t *sub)
+{
+    qdr_subscription_ref_t *ref = new_qdr_subscription_ref_t();
+    DEQ_ITEM_INIT(ref);
+    ref->sub = sub;
+    DEQ_INSERT_TAIL(*list, ref);
+    sub->ref_count++;
+}
+
+
+void qdr_del_subscription_ref_CT(qdr_subscription_ref_list_t *list, qdr_subscription_ref_t *ref)
+{
+    qdr_subscription_t *sub = ref->sub;
+    DEQ_REMOVE(*list, ref);
+    free_qdr_subscription_ref_t(ref);
+    if (--sub->ref_count == 0 && sub->unsubscribed)
+        free(sub);
+}
+
+
 static void qdr_general_handler(void *context)
 {
     qdr_core_t              *core = (qdr_core_t*) context;
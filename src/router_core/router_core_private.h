@@ -32,10 +32,12 @@ typedef struct qdr_node_t            qdr_node_t;
 typedef struct qdr_router_ref_t      qdr_router_ref_t;
 typedef struct qdr_link_ref_t        qdr_link_ref_t;
 typedef struct qdr_forwarder_t       qdr_forwarder_t;
+typedef struct qdr_forward_snapshot_t qdr_forward_snapshot_t;
 typedef struct qdr_link_route_t      qdr_link_route_t;
 typedef struct qdr_auto_link_t       qdr_auto_link_t;
 typedef struct qdr_conn_identifier_t qdr_conn_identifier_t;
 typedef struct qdr_connection_ref_t  qdr_connection_ref_t;
+typedef struct qdr_address_update_t  qdr_address_update_t;
 
 qdr_forwarder_t *qdr_forwarder_CT(qdr_core_t *core, qd_address_treatment_t treatment);
 int qdr_forward_message_CT(qdr_core_t *core, qdr_address_t *addr, qd_message_t *msg, qdr_delivery_t *in_delivery,
@@ -66,6 +68,30 @@ qd_iterator_t *qdr_field_iterator(qdr_field_t *field);
 void qdr_field_free(qdr_field_t *field);
 char *qdr_field_copy(qdr_field_t *field);
 
+/**
+ * qdr_address_update_t - A list of address hashes to be mapped to or unmapped from one
+ *                        remote router.  The hashes are stored back to back, each
+ *                        null-terminated, and are applied by the core thread in slices.
+ */
+struct qdr_address_update_t {
+    DEQ_LINKS(qdr_address_update_t);
+    int   router_maskbit;
+    bool  unmap;
+    char *addresses;
+    char *cursor;
+    char *end;
+};
+
+DEQ_DECLARE(qdr_address_update_t, qdr_address_update_list_t);
+
+//
+// The number of address hashes applied to the address table before the core thread
+// yields to the other actions queued behind a mobile-address update.
+//
+#define QDR_ADDRESS_UPDATE_SLICE 1000
+
+DEQ_DECLARE(qdr_delivery_t, qdr_delivery_list_t);
+
 /**
  * qdr_action_t - This type represents one work item to be performed by the router-core thread.
  */
@@ -87,6 +113,7 @@ struct qdr_action_t {
             int           cost;
             qd_bitmask_t *router_set;
             qdr_field_t  *address;
+            qdr_address_update_t *address_update;
         } route_table;
 
         //
@@ -98,6 +125,7 @@ struct qdr_action_t {
             qdr_field_t      *container_id;
             qdr_link_t       *link;
             qdr_delivery_t   *delivery;
+            qdr_delivery_list_t deliveries;  ///< Batched link_deliver: arrivals on 'link' in order
             qd_message_t     *msg;
             qd_direction_t    dir;
             qdr_terminus_t   *source;
@@ -140,6 +168,7 @@ struct qdr_action_t {
         struct {
             qdr_query_t             *query;
             int                      offset;
+            int                      count;
             qdr_field_t             *identity;
             qdr_field_t             *name;
             qd_parsed_field_t       *in_body;
@@ -155,15 +184,27 @@ DEQ_DECLARE(qdr_action_t, qdr_action_list_t);
 #define QDR_AGENT_MAX_COLUMNS 64
 #define QDR_AGENT_COLUMN_NULL (QDR_AGENT_MAX_COLUMNS + 1)
 
+//
+// A query fills a page of records per core action.  The page ends when the query's count
+// is reached, after QDR_AGENT_PAGE_RECORDS records or once QDR_AGENT_PAGE_USEC microseconds
+// have been spent composing it, so a large table does not hold off forwarding for long.
+//
+#define QDR_AGENT_PAGE_RECORDS 1000
+#define QDR_AGENT_PAGE_USEC    2000
+
 struct qdr_query_t {
     DEQ_LINKS(qdr_query_t);
+    DEQ_LINKS_N(CURSOR, qdr_query_t);
     qdr_core_t              *core;
     qd_router_entity_type_t  entity_type;
     void                    *context;
     int                      columns[QDR_AGENT_MAX_COLUMNS];
     qd_composed_field_t     *body;
-    qdr_field_t             *next_key;
-    int                      next_offset;
+    void                    *next_record;   ///< The record the next page starts at
+    bool                     parked;        ///< On the core's list of open cursors
+    int                      remaining;     ///< Records still to be returned, -1 for all
+    int                      page_records;
+    uint64_t                 page_deadline; ///< Monotonic time in microseconds
     bool                     more;
     qd_amqp_error_t          status;
 };
@@ -198,6 +239,25 @@ struct qdr_router_ref_t {
 ALLOC_DECLARE(qdr_router_ref_t);
 DEQ_DECLARE(qdr_router_ref_t, qdr_router_ref_list_t);
 
+typedef struct qdr_delivery_ref_t {
+    DEQ_LINKS(struct qdr_delivery_ref_t);
+    qdr_delivery_t *dlv;
+} qdr_delivery_ref_t;
+
+ALLOC_DECLARE(qdr_delivery_ref_t);
+DEQ_DECLARE(qdr_delivery_ref_t, qdr_delivery_ref_list_t);
+
+typedef struct qdr_subscription_ref_t {
+    DEQ_LINKS(struct qdr_subscription_ref_t);
+    qdr_subscription_t *sub;
+} qdr_subscription_ref_t;
+
+ALLOC_DECLARE(qdr_subscription_ref_t);
+DEQ_DECLARE(qdr_subscription_ref_t, qdr_subscription_ref_list_t);
+
+void qdr_add_subscription_ref_CT(qdr_subscription_ref_list_t *list, qdr_subscription_t *sub);
+void qdr_del_subscription_ref_CT(qdr_subscription_ref_list_t *list, qdr_subscription_ref_t *ref);
+
 typedef enum {
     QDR_DELIVERY_NOWHERE = 0,
     QDR_DELIVERY_IN_UNDELIVERED,
@@ -206,6 +266,7 @@ typedef enum {
 
 struct qdr_delivery_t {
     DEQ_LINKS(qdr_delivery_t);
+    DEQ_LINKS_N(PRESETTLED, qdr_delivery_t);
     void                *context;
     sys_atomic_t         ref_count;
     qdr_link_t          *link;
@@ -224,18 +285,11 @@ struct qdr_delivery_t {
     qd_bitmask_t        *link_exclusion;
     qdr_address_t       *tracking_addr;
     int                  tracking_addr_bit;
+    qdr_delivery_ref_list_t     streaming_peers;   // outbound deliveries cut through from this one
+    qdr_subscription_ref_list_t deferred_subscriptions; // in-process subscribers waiting for the whole message
 };
 
 ALLOC_DECLARE(qdr_delivery_t);
-DEQ_DECLARE(qdr_delivery_t, qdr_delivery_list_t);
-
-typedef struct qdr_delivery_ref_t {
-    DEQ_LINKS(struct qdr_delivery_ref_t);
-    qdr_delivery_t *dlv;
-} qdr_delivery_ref_t;
-
-ALLOC_DECLARE(qdr_delivery_ref_t);
-DEQ_DECLARE(qdr_delivery_ref_t, qdr_delivery_ref_list_t);
 
 void qdr_add_delivery_ref(qdr_delivery_ref_list_t *list, qdr_delivery_t *dlv);
 void qdr_del_delivery_ref(qdr_delivery_ref_list_t *list, qdr_delivery_ref_t *ref);
@@ -268,6 +322,7 @@ struct qdr_link_t {
     qdr_link_ref_t          *ref[QDR_LINK_LIST_CLASSES];  ///< Pointers to containing reference objects
     qdr_auto_link_t         *auto_link;          ///< [ref] Auto_link that owns this link
     qdr_delivery_list_t      undelivered;        ///< Deliveries to be forwarded or sent
+    qdr_delivery_list_t      undelivered_presettled; ///< Presettled deliveries in undelivered, in order (outgoing links)
     qdr_delivery_list_t      unsettled;          ///< Unsettled deliveries
     qdr_delivery_ref_list_t  updated_deliveries; ///< References to deliveries (in the unsettled list) with updates.
     bool                     admin_enabled;
@@ -281,6 +336,9 @@ struct qdr_link_t {
     bool                     drain_mode;
     bool                     drain_mode_changed;
     int                      credit_to_core; ///< Number of the available credits incrementally given to the core
+    qdr_delivery_t          *streaming_delivery; ///< Outgoing delivery whose message is still arriving (protected by conn->work_lock)
+    bool                     streaming_settled;  ///< Settled-ness of streaming_delivery when it was started
+    uint32_t                 deliveries_to_core; ///< Incoming deliveries handed to the core and not yet forwarded (atomic)
 
     uint64_t total_deliveries;
     uint64_t presettled_deliveries;
@@ -288,6 +346,8 @@ struct qdr_link_t {
     uint64_t rejected_deliveries;
     uint64_t released_deliveries;
     uint64_t modified_deliveries;
+    uint64_t dropped_presettled_deliveries;
+    uint64_t direct_deliveries;  ///< Incoming deliveries forwarded by the IO thread (IO thread only)
 };
 
 ALLOC_DECLARE(qdr_link_t);
@@ -323,6 +383,8 @@ struct qdr_subscription_t {
     qdr_address_t *addr;
     qdr_receive_t  on_message;
     void          *on_message_context;
+    int            ref_count;     ///< Deferred-subscription references held by deliveries
+    bool           unsubscribed;  ///< Freed when the last reference is dropped
 };
 
 DEQ_DECLARE(qdr_subscription_t, qdr_subscription_list_t);
@@ -362,6 +424,8 @@ struct qdr_address_t {
     uint64_t deliveries_transit;
     uint64_t deliveries_to_container;
     uint64_t deliveries_from_container;
+    uint64_t deliveries_ingress_direct;  ///< Updated atomically by IO threads
+    uint64_t deliveries_egress_direct;   ///< Updated atomically by IO threads
     ///@}
 };
 
@@ -550,7 +614,14 @@ struct qdr_core_t {
     qd_log_source_t   *agent_log;
     sys_thread_t      *thread;
     bool               running;
-    qdr_action_list_t  action_list;
+
+    //
+    // Actions are passed to the core thread through a lock-free stack (newest first)
+    // that the core thread takes whole.  The lock and condition variable are used only
+    // to park the core thread when the stack is empty.
+    //
+    qdr_action_t      *action_stack;
+    bool               action_parked;
     sys_cond_t        *action_cond;
     sys_mutex_t       *action_lock;
 
@@ -566,6 +637,7 @@ struct qdr_core_t {
     // Agent section
     //
     qdr_query_list_t       outgoing_query_list;
+    qdr_query_list_t       agent_cursors;  ///< Queries with more records to return (CURSOR links)
     sys_mutex_t           *query_lock;
     qd_timer_t            *agent_timer;
     qdr_manage_response_t  agent_response_handler;
@@ -580,6 +652,12 @@ struct qdr_core_t {
     qdr_mobile_removed_t  rt_mobile_removed;
     qdr_link_lost_t       rt_link_lost;
 
+    //
+    // Mobile-address updates not yet applied to the address table, oldest first
+    //
+    qdr_address_update_list_t  address_updates;
+    bool                       address_update_scheduled;
+
     //
     // Connection section
     //
@@ -599,6 +677,8 @@ struct qdr_core_t {
     qd_router_mode_t  router_mode;
     const char       *router_area;
     const char       *router_id;
+    qdr_presettled_drop_t presettled_drop;
+    int                   presettled_drop_count;
 
     qdr_address_config_list_t  addr_config;
     qdr_auto_link_list_t       auto_links;
@@ -619,7 +699,17 @@ struct qdr_core_t {
     qdr_link_t          **data_links_by_mask_bit;
     uint64_t              cost_epoch;
 
-    uint64_t              next_tag;
+    uint64_t              next_tag;           ///< Updated atomically; IO threads also create deliveries
+
+    //
+    // The forwarding snapshot is published by the core thread and read by IO threads.
+    // Readers announce themselves in the reader count of the current epoch.  To retire a
+    // snapshot, the core thread flips the epoch and waits for the count of the previous
+    // epoch to drain.
+    //
+    qdr_forward_snapshot_t *forward_snapshot;
+    uint32_t                forward_readers[2];
+    int                     forward_epoch;
 
     uint64_t              next_identifier;
     sys_mutex_t          *id_lock;
@@ -631,10 +721,18 @@ void *router_core_thread(void *arg);
 uint64_t qdr_identifier(qdr_core_t* core);
 void qdr_management_agent_on_message(void *context, qd_message_t *msg, int link_id, int cost);
 void  qdr_route_table_setup_CT(qdr_core_t *core);
+void  qdr_route_table_cleanup(qdr_core_t *core);
 void  qdr_agent_setup_CT(qdr_core_t *core);
 void  qdr_forwarder_setup_CT(qdr_core_t *core);
 qdr_action_t *qdr_action(qdr_action_handler_t action_handler, const char *label);
 void qdr_action_enqueue(qdr_core_t *core, qdr_action_t *action);
+
+/**
+ * Return the most recently enqueued action of the calling thread's open batch for this
+ * core, or 0 if there is none.  The action has not been published yet, so the caller
+ * may still add to its arguments.
+ */
+qdr_action_t *qdr_action_batch_newest(qdr_core_t *core);
 void qdr_link_issue_credit_CT(qdr_core_t *core, qdr_link_t *link, int credit, bool drain);
 void qdr_addr_start_inlinks_CT(qdr_core_t *core, qdr_address_t *addr);
 void qdr_delivery_push_CT(qdr_core_t *core, qdr_delivery_t *dlv);
@@ -644,6 +742,22 @@ bool qdr_delivery_settled_CT(qdr_core_t *core, qdr_delivery_t *delivery);
 void qdr_delivery_decref_CT(qdr_core_t *core, qdr_delivery_t *delivery);
 void qdr_agent_enqueue_response_CT(qdr_core_t *core, qdr_query_t *query);
 
+/**
+ * Helpers for writing a page of query records.  qdr_agent_page_start_CT begins a page and
+ * qdr_agent_page_has_room_CT is called before each record is written; it returns false once
+ * the page is full.  qdr_agent_page_finish_CT records the next unwritten record (0 at the
+ * end of the table) as the query's cursor and enqueues the response.
+ */
+void qdr_agent_page_start_CT(qdr_query_t *query);
+bool qdr_agent_page_has_room_CT(qdr_query_t *query);
+void qdr_agent_page_finish_CT(qdr_core_t *core, qdr_query_t *query, void *next_record);
+
+/**
+ * Called before a record that a query can list is removed from its table.  Open cursors
+ * on the record are moved on to the one that follows it.
+ */
+void qdr_agent_cursor_remove_CT(qdr_core_t *core, void *record, void *next_record);
+
 void qdr_post_mobile_added_CT(qdr_core_t *core, const char *address_hash);
 void qdr_post_mobile_removed_CT(qdr_core_t *core, const char *address_hash);
 void qdr_post_link_lost_CT(qdr_core_t *core, int link_maskbit);
@@ -651,8 +765,32 @@ void qdr_post_link_lost_CT(qdr_core_t *core, int link_maskbit);
 void qdr_post_general_work_CT(qdr_core_t *core, qdr_general_work_t *work);
 void qdr_check_addr_CT(qdr_core_t *core, qdr_address_t *addr, bool was_local);
 
+//
+// Withdraw the published forwarding snapshot because the address table is about to change
+// (or just did).  This waits until no IO thread is using the snapshot, so on return the
+// links, connections and addresses it referenced may be modified or freed.  A new snapshot
+// is published when the core thread finishes its current batch of actions.
+//
+void qdr_forward_snapshot_invalidate_CT(qdr_core_t *core);
+void qdr_forward_snapshot_publish_CT(qdr_core_t *core);
+void qdr_forward_snapshot_free(qdr_core_t *core);
+
+//
+// True if the address would be forwarded by IO threads from a snapshot, i.e. if a change
+// to the address requires the snapshot to be withdrawn.
+//
+bool qdr_forward_addr_is_direct_CT(qdr_address_t *addr);
+
+//
+// Forward a complete, presettled delivery from an IO thread using the published snapshot.
+// addr_iter is the destination for an anonymous link, or 0 to use the link's own address.
+// Returns false, having done nothing, if the delivery must be forwarded by the core.
+//
+bool qdr_forward_direct(qdr_link_t *in_link, qd_iterator_t *addr_iter, qd_message_t *msg);
+
 qdr_delivery_t *qdr_forward_new_delivery_CT(qdr_core_t *core, qdr_delivery_t *peer, qdr_link_t *link, qd_message_t *msg);
 void qdr_forward_deliver_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv);
+void qdr_forward_on_message_CT(qdr_core_t *core, qdr_subscription_t *sub, qdr_link_t *link, qd_message_t *msg);
 void qdr_connection_activate_CT(qdr_core_t *core, qdr_connection_t *conn);
 qd_address_treatment_t qdr_treatment_for_address_CT(qdr_core_t *core, qdr_connection_t *conn, qd_iterator_t *iter, int *in_phase, int *out_phase);
 qd_address_treatment_t qdr_treatment_for_address_hash_CT(qdr_core_t *core, qd_iterator_t *iter);
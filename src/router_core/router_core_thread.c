@@ -55,22 +55,36 @@ void *router_core_thread(void *arg)
     qd_log(core->log, QD_LOG_INFO, "Router Core thread running. %s/%s", core->router_area, core->router_id);
     while (core->running) {
         //
-        // Use the lock only to protect the condition variable and the action list
+        // Take the entire action stack.  Producers only ever push onto it, so taking it
+        // whole with one exchange is safe without a lock.
         //
-        sys_mutex_lock(core->action_lock);
+        qdr_action_t *stack = __atomic_exchange_n(&core->action_stack, 0, __ATOMIC_ACQUIRE);
 
-        //
-        // Block on the condition variable when there is no action to do
-        //
-        while (core->running && DEQ_IS_EMPTY(core->action_list))
-            sys_cond_wait(core->action_cond, core->action_lock);
+        if (!stack) {
+            //
+            // There is no action to do.  Park on the condition variable.  The lock is used
+            // only for parking; producers take it only when they see that we are parked.
+            //
+            sys_mutex_lock(core->action_lock);
+            __atomic_store_n(&core->action_parked, true, __ATOMIC_SEQ_CST);
+            while (core->running && __atomic_load_n(&core->action_stack, __ATOMIC_SEQ_CST) == 0)
+                sys_cond_wait(core->action_cond, core->action_lock);
+            __atomic_store_n(&core->action_parked, false, __ATOMIC_RELAXED);
+            sys_mutex_unlock(core->action_lock);
+            continue;
+        }
 
         //
-        // Move the entire action list to a private list so we can process it without
-        // holding the lock
+        // The stack is newest-first.  Reverse it into a private list so the actions are
+        // processed in the order they were submitted.
         //
-        DEQ_MOVE(core->action_list, action_list);
-        sys_mutex_unlock(core->action_lock);
+        DEQ_INIT(action_list);
+        while (stack) {
+            action = stack;
+            stack  = DEQ_NEXT(stack);
+            DEQ_ITEM_INIT(action);
+            DEQ_INSERT_HEAD(action_list, action);
+        }
 
         //
         // Process and free all of the action items in the list
@@ -85,6 +99,11 @@ void *router_core_thread(void *arg)
             action = DEQ_HEAD(action_list);
         }
 
+        //
+        // If the address table changed, give the IO threads a new forwarding snapshot.
+        //
+        qdr_forward_snapshot_publish_CT(core);
+
         //
         // Activate all connections that were flagged for activation during the above processing
         //
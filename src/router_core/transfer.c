@@ -28,6 +28,7 @@ static void qdr_link_check_credit_CT(qdr_core_t *core, qdr_action_t *action, boo
 static void qdr_send_to_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_update_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_delete_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_deliver_continue_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 
 //==================================================================================
 // Internal Functions
@@ -38,11 +39,30 @@ static void qdr_delete_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool
 // Interface Functions
 //==================================================================================
 
+/**
+ * Hand a new incoming delivery to the core.  If the calling thread has an action batch
+ * open and the newest action in it is a delivery on the same link, the delivery joins
+ * that action so the core forwards the run of deliveries together.
+ */
+static void qdr_link_deliver_submit(qdr_link_t *link, qdr_delivery_t *dlv)
+{
+    qdr_action_t *action = qdr_action_batch_newest(link->core);
+
+    __atomic_add_fetch(&link->deliveries_to_core, 1, __ATOMIC_RELAXED);
+    if (!action || action->action_handler != qdr_link_deliver_CT || action->args.connection.link != link) {
+        action = qdr_action(qdr_link_deliver_CT, "link_deliver");
+        action->args.connection.link = link;
+        DEQ_INSERT_TAIL(action->args.connection.deliveries, dlv);
+        qdr_action_enqueue(link->core, action);
+    } else
+        DEQ_INSERT_TAIL(action->args.connection.deliveries, dlv);
+}
+
+
 qdr_delivery_t *qdr_link_deliver(qdr_link_t *link, qd_message_t *msg, qd_iterator_t *ingress,
                                  bool settled, qd_bitmask_t *link_exclusion)
 {
-    qdr_action_t   *action = qdr_action(qdr_link_deliver_CT, "link_deliver");
-    qdr_delivery_t *dlv    = new_qdr_delivery_t();
+    qdr_delivery_t *dlv = new_qdr_delivery_t();
 
     ZERO(dlv);
     sys_atomic_init(&dlv->ref_count, 1); // referenced by the action
@@ -55,8 +75,7 @@ qdr_delivery_t *qdr_link_deliver(qdr_link_t *link, qd_message_t *msg, qd_iterato
     dlv->link_exclusion = link_exclusion;
     dlv->error          = 0;
 
-    action->args.connection.delivery = dlv;
-    qdr_action_enqueue(link->core, action);
+    qdr_link_deliver_submit(link, dlv);
     return dlv;
 }
 
@@ -65,8 +84,7 @@ qdr_delivery_t *qdr_link_deliver_to(qdr_link_t *link, qd_message_t *msg,
                                     qd_iterator_t *ingress, qd_iterator_t *addr,
                                     bool settled, qd_bitmask_t *link_exclusion)
 {
-    qdr_action_t   *action = qdr_action(qdr_link_deliver_CT, "link_deliver");
-    qdr_delivery_t *dlv    = new_qdr_delivery_t();
+    qdr_delivery_t *dlv = new_qdr_delivery_t();
 
     ZERO(dlv);
     sys_atomic_init(&dlv->ref_count, 1); // referenced by the action
@@ -79,8 +97,7 @@ qdr_delivery_t *qdr_link_deliver_to(qdr_link_t *link, qd_message_t *msg,
     dlv->link_exclusion = link_exclusion;
     dlv->error          = 0;
 
-    action->args.connection.delivery = dlv;
-    qdr_action_enqueue(link->core, action);
+    qdr_link_deliver_submit(link, dlv);
     return dlv;
 }
 
@@ -102,14 +119,49 @@ qdr_delivery_t *qdr_link_deliver_to_routed_link(qdr_link_t *link, qd_message_t *
     dlv->presettled = settled;
     dlv->error      = 0;
 
-    action->args.connection.delivery = dlv;
+    //
+    // The delivery tag travels in the action, so link-routed deliveries are never batched.
+    //
+    action->args.connection.link = link;
+    DEQ_INSERT_TAIL(action->args.connection.deliveries, dlv);
     action->args.connection.tag_length = tag_length;
     memcpy(action->args.connection.tag, tag, tag_length);
+    __atomic_add_fetch(&link->deliveries_to_core, 1, __ATOMIC_RELAXED);
     qdr_action_enqueue(link->core, action);
     return dlv;
 }
 
 
+bool qdr_link_deliver_direct(qdr_link_t *link, qd_message_t *msg, qd_iterator_t *addr,
+                             qd_bitmask_t *link_exclusion)
+{
+    //
+    // Deliveries that this link handed to the core earlier must be forwarded first to keep
+    // the link's order.  Only this thread adds to the count, so once it is seen at zero it
+    // stays there until this thread hands over another delivery.
+    //
+    if (link->link_type == QD_LINK_CONTROL || !qd_message_receive_complete(msg) ||
+        __atomic_load_n(&link->deliveries_to_core, __ATOMIC_ACQUIRE) > 0)
+        return false;
+
+    if (addr) {
+        qdr_connection_t *conn = link->conn;
+        if (conn && conn->tenant_space)
+            qd_iterator_annotate_space(addr, conn->tenant_space, conn->tenant_space_len);
+    }
+
+    if (!qdr_forward_direct(link, addr, msg))
+        return false;
+
+    __atomic_add_fetch(&link->direct_deliveries, 1, __ATOMIC_RELAXED);
+    qd_message_free(msg);
+    if (addr)
+        qd_iterator_free(addr);
+    qd_bitmask_free(link_exclusion);
+    return true;
+}
+
+
 void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit)
 {
     qdr_connection_t *conn = link->conn;
@@ -119,11 +171,43 @@ void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit)
     bool              settled = false;
 
     if (link->link_direction == QD_OUTGOING) {
+        //
+        // If a delivery was started before its message was completely received, it must
+        // be finished before any other delivery can be sent on this link.
+        // The core thread releases the streaming delivery if the link is cleaned up, so the
+        // field is only touched under the work lock and a reference is held while it is sent.
+        //
+        sys_mutex_lock(conn->work_lock);
+        dlv     = link->streaming_delivery;
+        settled = link->streaming_settled;
+        if (dlv)
+            qdr_delivery_incref(dlv);
+        sys_mutex_unlock(conn->work_lock);
+
+        if (dlv) {
+            core->deliver_handler(core->user_context, link, dlv, settled);
+            if (qd_message_send_complete(qdr_delivery_message(dlv))) {
+                bool release = false;
+                sys_mutex_lock(conn->work_lock);
+                if (link->streaming_delivery == dlv) {
+                    link->streaming_delivery = 0;
+                    release = true;
+                }
+                sys_mutex_unlock(conn->work_lock);
+                if (release)
+                    qdr_delivery_decref(core, dlv);
+            } else
+                credit = 0;
+            qdr_delivery_decref(core, dlv);
+        }
+
         while (credit > 0 && !drained) {
             sys_mutex_lock(conn->work_lock);
             dlv = DEQ_HEAD(link->undelivered);
             if (dlv) {
                 DEQ_REMOVE_HEAD(link->undelivered);
+                if (dlv == DEQ_HEAD(link->undelivered_presettled))
+                    DEQ_REMOVE_HEAD_N(PRESETTLED, link->undelivered_presettled);
                 settled = dlv->settled;
                 if (!settled) {
                     DEQ_INSERT_TAIL(link->unsettled, dlv);
@@ -140,9 +224,28 @@ void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit)
 
             if (dlv) {
                 link->credit_to_core--;
+                if (!settled)
+                    qdr_delivery_incref(dlv);  // protect the delivery until the send is checked
                 core->deliver_handler(core->user_context, link, dlv, settled);
-                if (settled)
-                    qdr_delivery_decref(core, dlv);
+
+                if (!qd_message_send_complete(qdr_delivery_message(dlv))) {
+                    //
+                    // Only part of the message has arrived.  Hold on to the delivery
+                    // (using the reference protecting it above, or the reference owned by a
+                    // settled delivery) and continue it when more of the message arrives.
+                    //
+                    sys_mutex_lock(conn->work_lock);
+                    link->streaming_delivery = dlv;
+                    link->streaming_settled  = settled;
+                    sys_mutex_unlock(conn->work_lock);
+                    break;
+                }
+
+                //
+                // Release the protecting reference or, for a settled delivery, the
+                // reference that was owned by the undelivered list.
+                //
+                qdr_delivery_decref(core, dlv);
             }
         }
 
@@ -297,6 +400,25 @@ qdr_error_t *qdr_delivery_error(const qdr_delivery_t *delivery)
 }
 
 
+bool qdr_delivery_is_settled(const qdr_delivery_t *delivery)
+{
+    return delivery->settled;
+}
+
+
+void qdr_delivery_continue(qdr_core_t *core, qdr_delivery_t *delivery)
+{
+    qdr_action_t *action = qdr_action(qdr_deliver_continue_CT, "deliver_continue");
+    action->args.connection.delivery = delivery;
+
+    //
+    // Protect the delivery on its way into the core thread.
+    //
+    qdr_delivery_incref(delivery);
+    qdr_action_enqueue(core, action);
+}
+
+
 //==================================================================================
 // In-Thread Functions
 //==================================================================================
@@ -394,6 +516,23 @@ static void qdr_delete_delivery_internal_CT(qdr_core_t *core, qdr_delivery_t *de
 {
     qdr_link_t *link = delivery->link;
 
+    //
+    // Drop any remaining cut-through state.  This only happens if the delivery goes away
+    // before its message was completely received.
+    //
+    qdr_delivery_ref_t *ref = DEQ_HEAD(delivery->streaming_peers);
+    while (ref) {
+        qdr_delivery_decref_CT(core, ref->dlv);
+        qdr_del_delivery_ref(&delivery->streaming_peers, ref);
+        ref = DEQ_HEAD(delivery->streaming_peers);
+    }
+
+    qdr_subscription_ref_t *sub = DEQ_HEAD(delivery->deferred_subscriptions);
+    while (sub) {
+        qdr_del_subscription_ref_CT(&delivery->deferred_subscriptions, sub);
+        sub = DEQ_HEAD(delivery->deferred_subscriptions);
+    }
+
     if (delivery->msg)
         qd_message_free(delivery->msg);
 
@@ -513,7 +652,11 @@ static long qdr_addr_path_count_CT(qdr_address_t *addr)
 }
 
 
-static void qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv, qdr_address_t *addr)
+/**
+ * Forward an incoming delivery to addr.  Returns the number of credits the caller must
+ * replenish on the link, so that a caller forwarding many deliveries can issue them once.
+ */
+static int qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv, qdr_address_t *addr)
 {
     if (addr && addr == link->owning_addr && qdr_addr_path_count_CT(addr) == 0) {
         //
@@ -528,7 +671,7 @@ static void qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery
         //
         DEQ_INSERT_TAIL(link->undelivered, dlv);
         dlv->where = QDR_DELIVERY_IN_UNDELIVERED;
-        return;
+        return 0;
     }
 
     int fanout = 0;
@@ -549,20 +692,20 @@ static void qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery
         if (!dlv->settled)
             qdr_delivery_release_CT(core, dlv);
         qdr_delivery_decref_CT(core, dlv);
-        qdr_link_issue_credit_CT(core, link, 1, false);
-    } else if (fanout > 0) {
+        return 1;
+    }
+
+    if (fanout > 0) {
         if (dlv->settled) {
             //
-            // The delivery is settled.  Keep it off the unsettled list and issue
-            // replacement credit for it now.
-            //
-            qdr_link_issue_credit_CT(core, link, 1, false);
-
+            // The delivery is settled.  Keep it off the unsettled list and have the
+            // caller issue replacement credit for it now.
             //
             // If the delivery has no more references, free it now.
             //
             assert(!dlv->peer);
             qdr_delivery_decref_CT(core, dlv);
+            return 1;
         } else {
             //
             // Again, don't bother decrementing then incrementing the ref_count
@@ -577,19 +720,23 @@ static void qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery
             // are many addresses sharing the link.
             //
             if (link->link_type == QD_LINK_ROUTER)
-                qdr_link_issue_credit_CT(core, link, 1, false);
+                return 1;
         }
     }
+
+    return 0;
 }
 
 
-static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+/**
+ * Deliver one incoming delivery from the action.  The address lookup for anonymous links
+ * is remembered in *cache so that a run of deliveries to the same address resolves it once.
+ * Returns the number of credits to replenish on the link.
+ */
+static int qdr_link_deliver_one_CT(qdr_core_t *core, qdr_action_t *action, qdr_delivery_t *dlv,
+                                   qdr_address_t **cache)
 {
-    if (discard)
-        return;
-
-    qdr_delivery_t *dlv  = action->args.connection.delivery;
-    qdr_link_t     *link = dlv->link;
+    qdr_link_t *link = dlv->link;
 
     //
     // If this is an attach-routed link, put the delivery directly onto the peer link
@@ -622,7 +769,7 @@ static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool dis
             //
             qdr_delivery_decref_CT(core, dlv);
         }
-        return;
+        return 0;
     }
 
     //
@@ -637,20 +784,68 @@ static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool dis
             qdr_connection_t *conn = link->conn;
             if (conn && conn->tenant_space)
                 qd_iterator_annotate_space(dlv->to_addr, conn->tenant_space, conn->tenant_space_len);
-            qd_hash_retrieve(core->addr_hash, dlv->to_addr, (void**) &addr);
+
+            //
+            // Anonymous senders tend to send runs of messages to one address.  Check the
+            // previous delivery's address before going to the hash table.  The view hash is
+            // cached in the iterator and is needed for the table lookup anyway, so compare it
+            // first and only compare the keys when it matches.
+            //
+            if (*cache
+                && qd_iterator_hash_view(dlv->to_addr) == qd_hash_hash_by_handle((*cache)->hash_handle)
+                && qd_iterator_equal(dlv->to_addr, qd_hash_key_by_handle((*cache)->hash_handle)))
+                addr = *cache;
+            else {
+                qd_hash_retrieve(core->addr_hash, dlv->to_addr, (void**) &addr);
+                *cache = addr;
+            }
         }
 
         //
         // Give the action reference to the qdr_link_forward function.
         //
-        qdr_link_forward_CT(core, link, dlv, addr);
-    } else {
-        //
-        // Take the action reference and use it for undelivered.  Don't decref/incref.
-        //
-        DEQ_INSERT_TAIL(link->undelivered, dlv);
-        dlv->where = QDR_DELIVERY_IN_UNDELIVERED;
+        return qdr_link_forward_CT(core, link, dlv, addr);
+    }
+
+    //
+    // Take the action reference and use it for undelivered.  Don't decref/incref.
+    //
+    DEQ_INSERT_TAIL(link->undelivered, dlv);
+    dlv->where = QDR_DELIVERY_IN_UNDELIVERED;
+    return 0;
+}
+
+
+static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+
+    qdr_link_t     *link   = action->args.connection.link;
+    qdr_address_t  *cache  = 0;
+    int             credit = 0;
+    uint32_t        count  = 0;
+    qdr_delivery_t *dlv    = DEQ_HEAD(action->args.connection.deliveries);
+
+    //
+    // Forward the deliveries in arrival order and replenish the link's credit once for
+    // the whole batch.
+    //
+    while (dlv) {
+        DEQ_REMOVE_HEAD(action->args.connection.deliveries);
+        credit += qdr_link_deliver_one_CT(core, action, dlv, &cache);
+        dlv = DEQ_HEAD(action->args.connection.deliveries);
+        count++;
     }
+
+    //
+    // The deliveries are on their outgoing links now; the link's IO thread may forward
+    // the ones that follow without the core.
+    //
+    __atomic_sub_fetch(&link->deliveries_to_core, count, __ATOMIC_RELEASE);
+
+    if (credit > 0)
+        qdr_link_issue_credit_CT(core, link, credit, false);
 }
 
 
@@ -760,6 +955,66 @@ static void qdr_delete_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool
 }
 
 
+static void qdr_deliver_continue_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+
+    qdr_delivery_t     *in_dlv = action->args.connection.delivery;
+    qdr_delivery_ref_t *ref    = DEQ_HEAD(in_dlv->streaming_peers);
+    qd_message_t       *msg    = in_dlv->msg;
+
+    //
+    // A link-routed delivery gives its message to the peer, all copies share the content.
+    //
+    if (!msg && ref)
+        msg = ref->dlv->msg;
+
+    bool done = !msg || qd_message_receive_complete(msg) || qd_message_aborted(msg);
+
+    //
+    // Wake up the outgoing links that are sending this message.  Deliveries that have been
+    // cleaned up with their links no longer refer to a link.
+    //
+    while (ref) {
+        qdr_delivery_t *peer = ref->dlv;
+        qdr_link_t     *link = peer->link;
+
+        if (link) {
+            sys_mutex_lock(link->conn->work_lock);
+            qdr_add_link_ref(&link->conn->links_with_deliveries, link, QDR_LINK_LIST_CLASS_DELIVERY);
+            sys_mutex_unlock(link->conn->work_lock);
+            qdr_connection_activate_CT(core, link->conn);
+        }
+
+        if (done) {
+            qdr_delivery_decref_CT(core, peer);
+            qdr_del_delivery_ref(&in_dlv->streaming_peers, ref);
+            ref = DEQ_HEAD(in_dlv->streaming_peers);
+        } else
+            ref = DEQ_NEXT(ref);
+    }
+
+    //
+    // In-process subscribers get the message once it is complete.
+    //
+    if (done) {
+        qdr_subscription_ref_t *sub = DEQ_HEAD(in_dlv->deferred_subscriptions);
+        while (sub) {
+            if (msg && !qd_message_aborted(msg) && !sub->sub->unsubscribed)
+                qdr_forward_on_message_CT(core, sub->sub, in_dlv->link, msg);
+            qdr_del_subscription_ref_CT(&in_dlv->deferred_subscriptions, sub);
+            sub = DEQ_HEAD(in_dlv->deferred_subscriptions);
+        }
+    }
+
+    //
+    // Release the action reference
+    //
+    qdr_delivery_decref_CT(core, in_dlv);
+}
+
+
 /**
  * Check the link's accumulated credit.  If the credit given to the connection thread
  * has been issued to Proton, provide the next batch of credit to the connection thread.
@@ -840,12 +1095,15 @@ void qdr_addr_start_inlinks_CT(qdr_core_t *core, qdr_address_t *addr)
                 qdr_delivery_list_t deliveries;
                 DEQ_MOVE(link->undelivered, deliveries);
 
-                qdr_delivery_t *dlv = DEQ_HEAD(deliveries);
+                qdr_delivery_t *dlv    = DEQ_HEAD(deliveries);
+                int             credit = 0;
                 while (dlv) {
                     DEQ_REMOVE_HEAD(deliveries);
-                    qdr_link_forward_CT(core, link, dlv, addr);
+                    credit += qdr_link_forward_CT(core, link, dlv, addr);
                     dlv = DEQ_HEAD(deliveries);
                 }
+                if (credit > 0)
+                    qdr_link_issue_credit_CT(core, link, credit, false);
             }
 
             ref = DEQ_NEXT(ref);
@@ -38,6 +38,7 @@ static char *on_demand_role = "on-demand";
 static char *container_role = "route-container";
 static char *direct_prefix;
 static char *node_id;
+static qd_composed_fragment_t node_id_string;  // node_id encoded as a string
 
 /**
  * Determine the role of a connection
@@ -81,13 +82,27 @@ static void qd_router_connection_get_config(const qd_connection_t  *conn,
 }
 
 
+//
+// The core of the action batch this thread opened for the deliveries received during the
+// current connector pass, or 0.  The server runs the writable handler at the end of every
+// pass that dispatched events, so that is where the batch is closed.
+//
+static __thread qdr_core_t *rx_batch_core = 0;
+
+
 static int AMQP_writable_conn_handler(void *type_context, qd_connection_t *conn, void *context)
 {
-    qdr_connection_t *qconn = (qdr_connection_t*) qd_connection_get_context(conn);
+    qdr_connection_t *qconn  = (qdr_connection_t*) qd_connection_get_context(conn);
+    int               events = 0;
 
     if (qconn)
-        return qdr_connection_process(qconn);
-    return 0;
+        events = qdr_connection_process(qconn);
+
+    if (rx_batch_core) {
+        qdr_action_batch_end(rx_batch_core);
+        rx_batch_core = 0;
+    }
+    return events;
 }
 
 
@@ -107,28 +122,10 @@ static qd_iterator_t *router_annotate_message(qd_router_t       *router,
     *link_exclusions = 0;
 
     if (in_ma && !strip_inbound_annotations) {
-        uint32_t count = qd_parse_sub_count(in_ma);
-        bool done = false;
-
-        for (uint32_t idx = 0; idx < count && !done; idx++) {
-            qd_parsed_field_t *sub  = qd_parse_sub_key(in_ma, idx);
-            if (!sub)
-                continue;
-            qd_iterator_t *iter = qd_parse_raw(sub);
-            if (!iter)
-                continue;
-
-            if        (qd_iterator_equal(iter, (unsigned char*) QD_MA_TRACE)) {
-                trace = qd_parse_sub_value(in_ma, idx);
-            } else if (qd_iterator_equal(iter, (unsigned char*) QD_MA_INGRESS)) {
-                ingress = qd_parse_sub_value(in_ma, idx);
-            } else if (qd_iterator_equal(iter, (unsigned char*) QD_MA_TO)) {
-                to = qd_parse_sub_value(in_ma, idx);
-            } else if (qd_iterator_equal(iter, (unsigned char*) QD_MA_PHASE)) {
-                phase = qd_parse_sub_value(in_ma, idx);
-            }
-            done = trace && ingress && to && phase;
-        }
+        trace   = qd_parse_ma_value(in_ma, QD_MA_KEY_TRACE);
+        ingress = qd_parse_ma_value(in_ma, QD_MA_KEY_INGRESS);
+        to      = qd_parse_ma_value(in_ma, QD_MA_KEY_TO);
+        phase   = qd_parse_ma_value(in_ma, QD_MA_KEY_PHASE);
     }
 
     //
@@ -148,21 +145,14 @@ static qd_iterator_t *router_annotate_message(qd_router_t       *router,
             *link_exclusions = qd_tracemask_create(router->tracemask, trace);
 
             //
-            // Append this router's ID to the trace.
+            // Append this router's ID to the trace.  The existing items are copied
+            // as they were encoded.
             //
-            uint32_t idx = 0;
-            qd_parsed_field_t *trace_item = qd_parse_sub_value(trace, idx);
-            while (trace_item) {
-                qd_iterator_t *iter = qd_parse_raw(trace_item);
-                qd_iterator_reset_view(iter, ITER_VIEW_ALL);
-                qd_compose_insert_string_iterator(trace_field, iter);
-                idx++;
-                trace_item = qd_parse_sub_value(trace, idx);
-            }
+            qd_compose_insert_encoded_iterator(trace_field, qd_parse_raw(trace), qd_parse_sub_count(trace));
         }
     }
 
-    qd_compose_insert_string(trace_field, node_id);
+    qd_compose_insert_fragment(trace_field, &node_id_string);
     qd_compose_end_list(trace_field);
     qd_message_set_trace_annotation(msg, trace_field);
 
@@ -195,7 +185,7 @@ static qd_iterator_t *router_annotate_message(qd_router_t       *router,
         ingress_iter = qd_parse_raw(ingress);
         qd_compose_insert_string_iterator(ingress_field, ingress_iter);
     } else
-        qd_compose_insert_string(ingress_field, node_id);
+        qd_compose_insert_fragment(ingress_field, &node_id_string);
     qd_message_set_ingress_annotation(msg, ingress_field);
 
     //
@@ -218,46 +208,82 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
     qd_message_t   *msg;
 
     //
-    // Receive the message into a local representation.  If the returned message
-    // pointer is NULL, we have not yet received a complete message.
+    // Collect the deliveries of this pass into one batch so that consecutive deliveries on
+    // a link reach the core as a single action.
     //
-    // Note:  In the link-routing case, consider cutting the message through.  There's
-    //        no reason to wait for the whole message to be received before starting to
-    //        send it.
+    if (!rx_batch_core) {
+        rx_batch_core = router->router_core;
+        qdr_action_batch_begin(rx_batch_core);
+    }
+
+    //
+    // Receive the message into a local representation.  The message is returned as soon
+    // as any part of it has arrived so that it can be cut through to its destinations.
+    // Until the message is complete, it remains owned by the proton delivery and the core
+    // is given a copy.
     //
     msg = qd_message_receive(pnd);
-    if (!msg)
+    bool receive_complete = qd_message_receive_complete(msg);
+
+    //
+    // If the delivery has already been handed to the core, this is more of a message that
+    // is being cut through.  Let the core know so the outgoing links can continue sending.
+    //
+    delivery = (qdr_delivery_t*) pn_delivery_get_context(pnd);
+    if (delivery) {
+        qdr_delivery_continue(router->router_core, delivery);
+        if (receive_complete) {
+            pn_link_advance(pn_link);
+            qd_message_free(msg);
+
+            //
+            // If the delivery was settled while the message was arriving, the settlement
+            // was deferred until now.
+            //
+            if (pn_delivery_settled(pnd) || qdr_delivery_is_settled(delivery)) {
+                pn_delivery_set_context(pnd, 0);
+                qdr_delivery_set_context(delivery, 0);
+                pn_delivery_settle(pnd);
+                qdr_delivery_decref(router->router_core, delivery);
+            }
+        }
         return;
+    }
 
     //
     // Consume the delivery.
     //
-    pn_link_advance(pn_link);
+    if (receive_complete)
+        pn_link_advance(pn_link);
 
     //
     // If there's no router link, free the message and finish.  It's likely that the link
     // is closing.
     //
     if (!rlink) {
-        qd_message_free(msg);
+        if (receive_complete)
+            qd_message_free(msg);
         return;
     }
 
     //
-    // Handle the link-routed case
+    // Handle the link-routed case.  Link-routed messages are cut through as soon as the
+    // first frame arrives.
     //
     if (qdr_link_is_routed(rlink)) {
-        pn_delivery_tag_t dtag = pn_delivery_tag(pnd);
-        delivery = qdr_link_deliver_to_routed_link(rlink, msg, pn_delivery_settled(pnd), (uint8_t*) dtag.start, dtag.size);
+        pn_delivery_tag_t dtag    = pn_delivery_tag(pnd);
+        qd_message_t     *dlv_msg = receive_complete ? msg : qd_message_copy(msg);
+        delivery = qdr_link_deliver_to_routed_link(rlink, dlv_msg, pn_delivery_settled(pnd), (uint8_t*) dtag.start, dtag.size);
         if (delivery) {
-            if (pn_delivery_settled(pnd))
+            if (receive_complete && pn_delivery_settled(pnd))
                 pn_delivery_settle(pnd);
             else {
                 pn_delivery_set_context(pnd, delivery);
                 qdr_delivery_set_context(delivery, pnd);
                 qdr_delivery_incref(delivery);
             }
-        }
+        } else
+            qd_message_free(dlv_msg);
         return;
     }
 
@@ -290,8 +316,15 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
     // 'to' field.  If the link is not anonymous, we don't need the 'to' field as we will be
     // using the address from the link target.
     //
-    qd_message_depth_t  validation_depth = (anonymous_link || check_user) ? QD_DEPTH_PROPERTIES : QD_DEPTH_MESSAGE_ANNOTATIONS;
-    bool                valid_message    = qd_message_check(msg, validation_depth);
+    // A partial message is not routed until everything through the validation depth has
+    // arrived.  A partial message that fails validation is rejected once it is complete.
+    //
+    qd_message_depth_t        validation_depth = (anonymous_link || check_user) ? QD_DEPTH_PROPERTIES : QD_DEPTH_MESSAGE_ANNOTATIONS;
+    qd_message_depth_status_t depth_status     = qd_message_check_depth(msg, validation_depth);
+    bool                      valid_message    = depth_status == QD_MESSAGE_DEPTH_OK;
+
+    if (!receive_complete && !valid_message)
+        return;
 
     if (valid_message) {
         if (check_user) {
@@ -302,6 +335,11 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
                 if (qd_iterator_remaining(userid_iter) > 0) {
                     // user_id property in message is not blank
                     if (!qd_iterator_equal(userid_iter, (const unsigned char *)conn->user_id)) {
+                        if (!receive_complete) {
+                            // Wait for the rest of the message before rejecting it
+                            qd_iterator_free(userid_iter);
+                            return;
+                        }
                         // This message is rejected: attempted user proxy is disallowed
                         qd_log(router->log_source, QD_LOG_DEBUG, "Message rejected due to user_id proxy violation. User:%s", conn->user_id);
                         pn_link_flow(pn_link, 1);
@@ -329,7 +367,7 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
             // If the message has delivery annotations, get the to-override field from the annotations.
             //
             if (in_ma) {
-                qd_parsed_field_t *ma_to = qd_parse_value_by_key(in_ma, QD_MA_TO);
+                qd_parsed_field_t *ma_to = qd_parse_ma_value(in_ma, QD_MA_KEY_TO);
                 if (ma_to) {
                     addr_iter = qd_iterator_dup(qd_parse_raw(ma_to));
                     phase = qd_message_get_phase_annotation(msg);
@@ -359,7 +397,14 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
                 qd_iterator_reset_view(addr_iter, ITER_VIEW_ADDRESS_HASH);
                 if (phase > 0)
                     qd_iterator_annotate_phase(addr_iter, '0' + (char) phase);
-                delivery = qdr_link_deliver_to(rlink, msg, ingress_iter, addr_iter, pn_delivery_settled(pnd),
+                if (receive_complete && pn_delivery_settled(pnd) &&
+                    qdr_link_deliver_direct(rlink, msg, addr_iter, link_exclusions)) {
+                    pn_link_flow(pn_link, 1);
+                    pn_delivery_settle(pnd);
+                    return;
+                }
+                delivery = qdr_link_deliver_to(rlink, receive_complete ? msg : qd_message_copy(msg),
+                                               ingress_iter, addr_iter, pn_delivery_settled(pnd),
                                                link_exclusions);
             }
         } else {
@@ -384,17 +429,33 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
                 if (phase != 0)
                     qd_message_set_phase_annotation(msg, phase);
             }
-            delivery = qdr_link_deliver(rlink, msg, ingress_iter, pn_delivery_settled(pnd), link_exclusions);
+            if (receive_complete && pn_delivery_settled(pnd) &&
+                qdr_link_deliver_direct(rlink, msg, 0, link_exclusions)) {
+                pn_link_flow(pn_link, 1);
+                pn_delivery_settle(pnd);
+                return;
+            }
+            delivery = qdr_link_deliver(rlink, receive_complete ? msg : qd_message_copy(msg),
+                                        ingress_iter, pn_delivery_settled(pnd), link_exclusions);
         }
 
         if (delivery) {
-            if (pn_delivery_settled(pnd))
+            //
+            // A delivery whose message is still arriving stays linked to the proton delivery
+            // so that the rest of the message can be passed along, even if it is settled.
+            //
+            if (receive_complete && pn_delivery_settled(pnd))
                 pn_delivery_settle(pnd);
             else {
                 pn_delivery_set_context(pnd, delivery);
                 qdr_delivery_set_context(delivery, pnd);
                 qdr_delivery_incref(delivery);
             }
+        } else if (!receive_complete) {
+            //
+            // There is no address.  Wait for the rest of the message before rejecting it.
+            //
+            qd_bitmask_free(link_exclusions);
         } else {
             //
             // The message is now and will always be unroutable because there is no address.
@@ -448,6 +509,15 @@ static void AMQP_disposition_handler(void* context, qd_link_t *link, pn_delivery
     if (!delivery)
         return;
 
+    //
+    // An incoming delivery stays current on its link until the whole message has arrived.
+    // Its settlement is handled by AMQP_rx_handler once the message is complete.
+    //
+    pn_link_t *pn_link     = pn_delivery_link(pnd);
+    bool       in_progress = pn_link_current(pn_link) == pnd;
+    if (in_progress && pn_link_is_receiver(pn_link))
+        return;
+
     pn_disposition_t *disp   = pn_delivery_remote(pnd);
     pn_condition_t *cond     = pn_disposition_condition(disp);
     qdr_error_t    *error    = qdr_error_from_pn(cond);
@@ -477,9 +547,10 @@ static void AMQP_disposition_handler(void* context, qd_link_t *link, pn_delivery
                                     give_reference);
 
     //
-    // If settled, close out the delivery
+    // If settled, close out the delivery.  An outgoing delivery that is still being sent
+    // is settled by CORE_link_deliver when the last of the message has gone out.
     //
-    if (pn_delivery_settled(pnd))
+    if (pn_delivery_settled(pnd) && !in_progress)
         pn_delivery_settle(pnd);
 }
 
@@ -557,8 +628,32 @@ static int AMQP_link_flow_handler(void* context, qd_link_t *link)
  */
 static int AMQP_link_detach_handler(void* context, qd_link_t *link, qd_detach_type_t dt)
 {
+    qd_router_t    *router = (qd_router_t*) context;
     qdr_link_t     *rlink  = (qdr_link_t*) qd_link_get_context(link);
-    pn_condition_t *cond   = qd_link_pn(link) ? pn_link_remote_condition(qd_link_pn(link)) : 0;
+    pn_link_t      *pn_link = qd_link_pn(link);
+    pn_condition_t *cond   = pn_link ? pn_link_remote_condition(pn_link) : 0;
+
+    //
+    // If a message was being received on this link, it will never be completed.  Abandon
+    // it so that outgoing links that are cutting it through can finish.
+    //
+    pn_delivery_t *pnd = pn_link && pn_link_is_receiver(pn_link) ? pn_link_current(pn_link) : 0;
+    if (pnd) {
+        qdr_delivery_t *delivery = (qdr_delivery_t*) pn_delivery_get_context(pnd);
+        qd_message_t   *msg      = qd_message_receive_abort(pnd);
+
+        if (msg) {
+            if (delivery) {
+                qdr_delivery_continue(router->router_core, delivery);
+                if (pn_delivery_settled(pnd)) {
+                    pn_delivery_set_context(pnd, 0);
+                    qdr_delivery_set_context(delivery, 0);
+                    qdr_delivery_decref(router->router_core, delivery);
+                }
+            }
+            qd_message_free(msg);
+        }
+    }
 
     if (rlink) {
         qdr_error_t *error = qdr_error_from_pn(cond);
@@ -785,6 +880,11 @@ qd_router_t *qd_router(qd_dispatch_t *qd, qd_router_mode_t mode, const char *are
     strcat(node_id, "/");
     strcat(node_id, id);
 
+    qd_composed_field_t *node_id_field = qd_compose_subfield(0);
+    qd_compose_insert_string(node_id_field, node_id);
+    qd_compose_take_fragment(node_id_field, &node_id_string);
+    qd_compose_free(node_id_field);
+
     qd_router_t *router = NEW(qd_router_t);
     ZERO(router);
 
@@ -829,8 +929,10 @@ static void CORE_connection_activate(void *context, qdr_connection_t *conn, bool
 {
     //
     // IMPORTANT:  This is the only core callback that is invoked on the core
-    //             thread itself.  It is imperative that this function do nothing
-    //             apart from setting the activation in the server for the connection.
+    //             thread itself.  It is also invoked on IO threads that forward
+    //             deliveries directly to another connection's links.  It is imperative
+    //             that this function do nothing apart from setting the activation in the
+    //             server for the connection.
     //
     qd_server_activate((qd_connection_t*) qdr_connection_get_context(conn), awaken);
 }
@@ -1001,32 +1103,58 @@ static void CORE_link_deliver(void *context, qdr_link_t *link, qdr_delivery_t *d
     if (!plink)
         return;
 
-    const char *tag;
-    int         tag_length;
-
-    qdr_delivery_tag(dlv, &tag, &tag_length);
-
-    pn_delivery(plink, pn_dtag(tag, tag_length));
-    pn_delivery_t *pdlv = pn_link_current(plink);
+    qd_message_t *msg = qdr_delivery_message(dlv);
 
     //
     // If the remote send settle mode is set to 'settled', we should settle the delivery on behalf of the receiver.
     //
     bool remote_snd_settled = qd_link_remote_snd_settle_mode(qlink) == PN_SND_SETTLED;
 
-    if (!settled && !remote_snd_settled) {
-        pn_delivery_set_context(pdlv, dlv);
-        qdr_delivery_set_context(dlv, pdlv);
-        qdr_delivery_incref(dlv);
+    //
+    // A delivery stays current on the link until all of its message has been sent.  If
+    // there is a current delivery, this call continues a message that is being cut through.
+    //
+    pn_delivery_t *pdlv = pn_link_current(plink);
+    if (!pdlv) {
+        const char *tag;
+        int         tag_length;
+
+        qdr_delivery_tag(dlv, &tag, &tag_length);
+        pdlv = pn_delivery(plink, pn_dtag(tag, tag_length));
+
+        if (!settled && !remote_snd_settled) {
+            pn_delivery_set_context(pdlv, dlv);
+            qdr_delivery_set_context(dlv, pdlv);
+            qdr_delivery_incref(dlv);
+        }
     }
 
-    qd_message_send(qdr_delivery_message(dlv), qlink, qdr_link_strip_annotations_out(link));
+    qd_message_send(msg, qlink, qdr_link_strip_annotations_out(link));
+
+    if (!qd_message_send_complete(msg))
+        return;
+
+    bool aborted    = qd_message_aborted(msg);
+    bool settle_now = settled || remote_snd_settled || pn_delivery_settled(pdlv);
 
     if (!settled && remote_snd_settled)
         // Tell the core that the delivery has been accepted and settled, since we are settling on behalf of the receiver
-        qdr_delivery_update_disposition(router->router_core, dlv, PN_ACCEPTED, true, 0, false);
+        qdr_delivery_update_disposition(router->router_core, dlv, aborted ? PN_MODIFIED : PN_ACCEPTED, true, 0, false);
+    else if (pn_delivery_get_context(pdlv) && (aborted || qdr_delivery_is_settled(dlv))) {
+        //
+        // The message was abandoned by its sender before it was complete, or the delivery
+        // was settled by the core while it was being sent.  Remove the linkage now.
+        //
+        pn_delivery_set_context(pdlv, 0);
+        qdr_delivery_set_context(dlv, 0);
+        if (aborted)
+            qdr_delivery_update_disposition(router->router_core, dlv, PN_MODIFIED, true, 0, true);
+        else
+            qdr_delivery_decref(router->router_core, dlv);
+        settle_now = true;
+    }
 
-    if (settled || remote_snd_settled)
+    if (settle_now)
         pn_delivery_settle(pdlv);
 
     pn_link_advance(plink);
@@ -1066,7 +1194,13 @@ static void CORE_delivery_update(void *context, qdr_delivery_t *dlv, uint64_t di
 
     //
     // If the delivery is settled, remove the linkage and settle the proton delivery.
+    // A delivery that is still current on its link is in the middle of a cut-through
+    // transfer; settling it now would end the transfer, so the linkage is left in place
+    // and the delivery is settled when the transfer completes.
     //
+    if (settled && pn_link_current(pn_delivery_link(pnd)) == pnd)
+        return;
+
     if (settled) {
         qdr_delivery_set_context(dlv, 0);
         pn_delivery_set_context(pnd, 0);
@@ -1113,6 +1247,7 @@ void qd_router_free(qd_router_t *router)
 
     free(router);
     free(node_id);
+    qd_compose_free_fragment(&node_id_string);
     free(direct_prefix);
 }
 
@@ -51,6 +51,29 @@ extern const char *QD_ROUTER_NODE_TYPE;
 extern const char *QD_ROUTER_ADDRESS_TYPE;
 extern const char *QD_ROUTER_LINK_TYPE;
 
+//
+// Counts of the router-protocol control messages exchanged with other routers, by
+// opcode.  The octets are those of the encoded message bodies.
+//
+typedef enum {
+    QD_ROUTER_OPCODE_HELLO,
+    QD_ROUTER_OPCODE_RA,
+    QD_ROUTER_OPCODE_LSU,
+    QD_ROUTER_OPCODE_LSR,
+    QD_ROUTER_OPCODE_MAU,
+    QD_ROUTER_OPCODE_MAR,
+    QD_ROUTER_OPCODE_COUNT
+} qd_router_opcode_t;
+
+extern const char *QD_ROUTER_OPCODE_NAMES[QD_ROUTER_OPCODE_COUNT];
+
+typedef struct {
+    uint64_t messages_sent;
+    uint64_t octets_sent;
+    uint64_t messages_received;
+    uint64_t octets_received;
+} qd_router_control_stats_t;
+
 
 struct qd_router_t {
     qd_dispatch_t            *qd;
@@ -64,6 +87,8 @@ struct qd_router_t {
 
     sys_mutex_t              *lock;
     qd_timer_t               *timer;
+
+    qd_router_control_stats_t control_stats[QD_ROUTER_OPCODE_COUNT];
 };
 
 #endif
@@ -34,6 +34,8 @@ static PyObject        *pyAdded    = 0;
 static PyObject        *pyRemoved  = 0;
 static PyObject        *pyLinkLost = 0;
 
+static qdr_path_engine_t *path_engine = 0;
+
 typedef struct {
     PyObject_HEAD
     qd_router_t *router;
@@ -69,6 +71,8 @@ static PyObject* qd_del_router(PyObject *self, PyObject *args)
 
     qdr_core_del_router(router->router_core, router_maskbit);
     qd_tracemask_del_router(router->tracemask, router_maskbit);
+    if (path_engine)
+        qdr_path_del_router(path_engine, router_maskbit);
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -137,6 +141,8 @@ static PyObject* qd_remove_next_hop(PyObject *self, PyObject *args)
         return 0;
 
     qdr_core_remove_next_hop(router->router_core, router_maskbit);
+    if (path_engine)
+        qdr_path_reset_next_hop(path_engine, router_maskbit);
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -219,6 +225,117 @@ static PyObject* qd_set_valid_origins(PyObject *self, PyObject *args)
 }
 
 
+static PyObject* qd_set_link_state(PyObject *self, PyObject *args)
+{
+    const char *router_id;
+    int         router_maskbit;
+    PyObject   *peer_map;
+    PyObject   *key;
+    PyObject   *value;
+    Py_ssize_t  pos = 0;
+
+    if (!PyArg_ParseTuple(args, "isO", &router_maskbit, &router_id, &peer_map))
+        return 0;
+
+    if (router_maskbit >= qd_bitmask_width() || router_maskbit < 0) {
+        PyErr_SetString(PyExc_Exception, "Router bit mask out of range");
+        return 0;
+    }
+
+    if (!PyDict_Check(peer_map)) {
+        PyErr_SetString(PyExc_Exception, "Expected Dictionary as argument 3");
+        return 0;
+    }
+
+    Py_ssize_t peer_count = PyDict_Size(peer_map);
+    int       *peers      = NEW_ARRAY(int, peer_count + 1);
+    int       *costs      = NEW_ARRAY(int, peer_count + 1);
+    int        idx        = 0;
+
+    while (PyDict_Next(peer_map, &pos, &key, &value)) {
+        peers[idx] = (int) PyInt_AsLong(key);
+        costs[idx] = (int) PyInt_AsLong(value);
+        idx++;
+    }
+
+    if (PyErr_Occurred()) {
+        free(peers);
+        free(costs);
+        return 0;
+    }
+
+    qdr_path_set_link_state(path_engine, router_maskbit, router_id, idx, peers, costs);
+    free(peers);
+    free(costs);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+static void qd_set_route_item(PyObject *dict, int router_maskbit, PyObject *value)
+{
+    PyObject *key = PyInt_FromLong((long) router_maskbit);
+    PyDict_SetItem(dict, key, value);
+    Py_DECREF(key);
+    Py_DECREF(value);
+}
+
+
+static PyObject* qd_calculate_routes(PyObject *self, PyObject *args)
+{
+    RouterAdapter    *adapter = (RouterAdapter*) self;
+    qd_router_t      *router  = adapter->router;
+    qdr_path_route_t *routes;
+
+    //
+    // Compute the changed routes and hand them to the core in one batch.  The
+    // changes are also returned, keyed by mask bit, so the caller can keep its
+    // records of the router nodes up to date.
+    //
+    int count = qdr_path_calculate(path_engine, &routes);
+
+    PyObject *next_hops     = PyDict_New();
+    PyObject *costs         = PyDict_New();
+    PyObject *valid_origins = PyDict_New();
+
+    qdr_action_batch_begin(router->router_core);
+    for (int i = 0; i < count; i++) {
+        qdr_path_route_t *route = &routes[i];
+
+        if (route->next_hop >= 0) {
+            qdr_core_set_next_hop(router->router_core, route->router_maskbit, route->next_hop);
+            qd_set_route_item(next_hops, route->router_maskbit, PyInt_FromLong((long) route->next_hop));
+        }
+
+        if (route->valid_origins) {
+            qd_bitmask_t *core_bitmask = qd_bitmask(0);
+            PyObject     *origin_list  = PyList_New(0);
+            int           maskbit;
+            int           c;
+
+            qd_bitmask_set_bit(core_bitmask, 0);  // This router is a valid origin for all destinations
+            for (QD_BITMASK_EACH(route->valid_origins, maskbit, c)) {
+                PyObject *item = PyInt_FromLong((long) maskbit);
+                qd_bitmask_set_bit(core_bitmask, maskbit);
+                PyList_Append(origin_list, item);
+                Py_DECREF(item);
+            }
+            qdr_core_set_valid_origins(router->router_core, route->router_maskbit, core_bitmask);
+            qd_set_route_item(valid_origins, route->router_maskbit, origin_list);
+        }
+
+        if (route->cost >= 0) {
+            qdr_core_set_cost(router->router_core, route->router_maskbit, route->cost);
+            qd_set_route_item(costs, route->router_maskbit, PyInt_FromLong((long) route->cost));
+        }
+    }
+    qdr_action_batch_end(router->router_core);
+
+    return Py_BuildValue("(NNN)", next_hops, costs, valid_origins);
+}
+
+
 static PyObject* qd_map_destination(PyObject *self, PyObject *args)
 {
     RouterAdapter *adapter = (RouterAdapter*) self;
@@ -262,6 +379,93 @@ static PyObject* qd_unmap_destination(PyObject *self, PyObject *args)
     return Py_None;
 }
 
+static PyObject* qd_update_destinations(PyObject *self, PyObject *args, bool unmap)
+{
+    RouterAdapter *adapter = (RouterAdapter*) self;
+    qd_router_t   *router  = adapter->router;
+    PyObject      *addr_list;
+    int            maskbit;
+
+    if (!PyArg_ParseTuple(args, "Oi", &addr_list, &maskbit))
+        return 0;
+
+    if (maskbit >= qd_bitmask_width() || maskbit < 0) {
+        PyErr_SetString(PyExc_Exception, "Router bit mask out of range");
+        return 0;
+    }
+
+    PyObject *addrs = PySequence_Fast(addr_list, "Expected a sequence of addresses");
+    if (!addrs)
+        return 0;
+
+    //
+    // Borrow the address strings for as long as the sequence is held; the core copies
+    // them into a single update.
+    //
+    Py_ssize_t   count  = PySequence_Fast_GET_SIZE(addrs);
+    const char **hashes = (const char**) malloc((count ? count : 1) * sizeof(char*));
+    for (Py_ssize_t idx = 0; idx < count; idx++) {
+        hashes[idx] = PyString_AsString(PySequence_Fast_GET_ITEM(addrs, idx));
+        if (!hashes[idx]) {
+            free(hashes);
+            Py_DECREF(addrs);
+            return 0;
+        }
+    }
+
+    if (unmap)
+        qdr_core_unmap_destinations(router->router_core, maskbit, (int) count, hashes);
+    else
+        qdr_core_map_destinations(router->router_core, maskbit, (int) count, hashes);
+
+    free(hashes);
+    Py_DECREF(addrs);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+static PyObject* qd_map_destinations(PyObject *self, PyObject *args)
+{
+    return qd_update_destinations(self, args, false);
+}
+
+
+static PyObject* qd_unmap_destinations(PyObject *self, PyObject *args)
+{
+    return qd_update_destinations(self, args, true);
+}
+
+static PyObject* qd_count_control_message(PyObject *self, PyObject *args)
+{
+    RouterAdapter *adapter = (RouterAdapter*) self;
+    qd_router_t   *router  = adapter->router;
+    const char    *opcode;
+    long           octets;
+    int            sent;
+
+    if (!PyArg_ParseTuple(args, "sli", &opcode, &octets, &sent))
+        return 0;
+
+    for (int op = 0; op < QD_ROUTER_OPCODE_COUNT; op++) {
+        if (strcmp(opcode, QD_ROUTER_OPCODE_NAMES[op]) == 0) {
+            qd_router_control_stats_t *stats = &router->control_stats[op];
+            if (sent) {
+                stats->messages_sent++;
+                stats->octets_sent += octets > 0 ? octets : 0;
+            } else {
+                stats->messages_received++;
+                stats->octets_received += octets > 0 ? octets : 0;
+            }
+            break;
+        }
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject* qd_get_agent(PyObject *self, PyObject *args) {
     RouterAdapter *adapter = (RouterAdapter*) self;
     PyObject *agent = adapter->router->qd->agent;
@@ -281,8 +485,13 @@ static PyMethodDef RouterAdapter_methods[] = {
     {"remove_next_hop",     qd_remove_next_hop,   METH_VARARGS, "Remove the next hop for a remote router"},
     {"set_cost",            qd_set_cost,          METH_VARARGS, "Set the cost to reach a remote router"},
     {"set_valid_origins",   qd_set_valid_origins, METH_VARARGS, "Set the valid origins for a remote router"},
+    {"set_link_state",      qd_set_link_state,    METH_VARARGS, "Set the link state of a router for route calculation"},
+    {"calculate_routes",    qd_calculate_routes,  METH_VARARGS, "Recompute and apply the routes to remote routers"},
     {"map_destination",     qd_map_destination,   METH_VARARGS, "Add a newly discovered destination mapping"},
     {"unmap_destination",   qd_unmap_destination, METH_VARARGS, "Delete a destination mapping"},
+    {"map_destinations",    qd_map_destinations,  METH_VARARGS, "Add a list of destination mappings for a router"},
+    {"unmap_destinations",  qd_unmap_destinations, METH_VARARGS, "Delete a list of destination mappings for a router"},
+    {"count_control_message", qd_count_control_message, METH_VARARGS, "Count a control message sent to or received from another router"},
     {"get_agent",           qd_get_agent,         METH_VARARGS, "Get the management agent"},
     {0, 0, 0, 0}
 };
@@ -414,6 +623,8 @@ qd_error_t qd_router_python_setup(qd_router_t *router)
     if (router->router_mode != QD_ROUTER_MODE_INTERIOR)
         return QD_ERROR_NONE;
 
+    path_engine = qdr_path_engine();
+
     PyObject *pDispatchModule = qd_python_module();
     RouterAdapterType.tp_new = PyType_GenericNew;
     PyType_Ready(&RouterAdapterType);
@@ -479,7 +690,8 @@ qd_error_t qd_router_python_setup(qd_router_t *router)
 }
 
 void qd_router_python_free(qd_router_t *router) {
-    // empty
+    qdr_path_engine_free(path_engine);
+    path_engine = 0;
 }
 
 
@@ -23,11 +23,13 @@
 #include <qpid/dispatch/log.h>
 #include <qpid/dispatch/amqp.h>
 #include <qpid/dispatch/server.h>
+#include <qpid/dispatch/atomic.h>
 #include "qpid/dispatch/python_embedded.h"
 #include "entity.h"
 #include "entity_cache.h"
 #include "dispatch_private.h"
 #include "policy.h"
+#include "resolver.h"
 #include "server_private.h"
 #include "timer_private.h"
 #include "alloc.h"
@@ -36,15 +38,17 @@
 #include <time.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 #include <inttypes.h>
 
 typedef struct qd_thread_t {
-    qd_server_t  *qd_server;
-    int           thread_id;
-    volatile int  running;
-    volatile int  canceled;
-    int           using_thread;
-    sys_thread_t *thread;
+    qd_server_t      *qd_server;
+    qd_server_loop_t *loop;
+    int               thread_id;
+    volatile int      running;
+    volatile int      canceled;
+    int               using_thread;
+    sys_thread_t     *thread;
 } qd_thread_t;
 
 
@@ -56,13 +60,33 @@ typedef struct qd_work_item_t {
 DEQ_DECLARE(qd_work_item_t, qd_work_list_t);
 
 
+//
+// Connections are sharded across one or more event loops.  Each loop has its own driver
+// and work queue, and the threads assigned to it elect a leader among themselves to wait
+// on the driver.  The loop lock protects the work queue and the ownership of the loop's
+// connections.  The server lock may be held while taking a loop lock, never the reverse.
+//
+struct qd_server_loop_t {
+    qd_server_t      *server;
+    int               loop_id;
+    qdpn_driver_t    *driver;
+    sys_cond_t       *cond;
+    sys_mutex_t      *lock;
+    qd_work_list_t    work_queue;
+    bool              a_thread_is_waiting;
+    int               threads_active;
+};
+
+
 struct qd_server_t {
     qd_dispatch_t            *qd;
     int                       thread_count;
     const char               *container_name;
     const char               *sasl_config_path;
     const char               *sasl_config_name;
-    qdpn_driver_t            *driver;
+    int                       loop_count;
+    qd_server_loop_t        **loops;
+    int                       next_loop;
     qd_log_source_t          *log_source;
     qd_thread_start_cb_t      start_handler;
     qd_conn_handler_cb_t      conn_handler;
@@ -73,10 +97,7 @@ struct qd_server_t {
     sys_cond_t               *cond;
     sys_mutex_t              *lock;
     qd_thread_t             **threads;
-    qd_work_list_t            work_queue;
     qd_timer_list_t           pending_timers;
-    bool                      a_thread_is_waiting;
-    int                       threads_active;
     int                       pause_requests;
     int                       threads_paused;
     int                       pause_next_sequence;
@@ -90,6 +111,7 @@ struct qd_server_t {
     uint64_t                 next_connection_id;
     void                     *py_displayname_obj;
     qd_http_server_t         *http;
+    qd_resolver_t            *resolver;
 };
 
 /**
@@ -115,6 +137,10 @@ struct qd_connector_t {
     qd_connection_t          *ctx;
     qd_timer_t               *timer;
     long                      delay;
+    sys_atomic_t              connect_attempts;
+    sys_atomic_t              connect_failures;
+    sys_atomic_t              resolve_failures;
+    sys_atomic_t              connections_opened;
 };
 
 
@@ -153,6 +179,7 @@ static qd_thread_t *thread(qd_server_t *qd_server, int id)
         return 0;
 
     thread->qd_server    = qd_server;
+    thread->loop         = qd_server->loops[id % qd_server->loop_count];
     thread->thread_id    = id;
     thread->running      = 0;
     thread->canceled     = 0;
@@ -161,6 +188,63 @@ static qd_thread_t *thread(qd_server_t *qd_server, int id)
     return thread;
 }
 
+
+static qd_server_loop_t *server_loop(qd_server_t *qd_server, int id)
+{
+    qd_server_loop_t *loop = NEW(qd_server_loop_t);
+    if (!loop)
+        return 0;
+
+    loop->server              = qd_server;
+    loop->loop_id             = id;
+    loop->driver              = qdpn_driver(qd_server->log_source);
+    loop->cond                = sys_cond();
+    loop->lock                = sys_mutex();
+    DEQ_INIT(loop->work_queue);
+    loop->a_thread_is_waiting = false;
+    loop->threads_active      = 0;
+
+    return loop;
+}
+
+
+static void server_loop_free(qd_server_loop_t *loop)
+{
+    if (!loop)
+        return;
+
+    qdpn_driver_free(loop->driver);
+    sys_cond_free(loop->cond);
+    sys_mutex_free(loop->lock);
+    free(loop);
+}
+
+
+/**
+ * Choose the event loop for a new connection.  Connections are spread round-robin.
+ */
+static qd_server_loop_t *server_next_loop_LH(qd_server_t *qd_server)
+{
+    qd_server_loop_t *loop = qd_server->loops[qd_server->next_loop];
+    qd_server->next_loop = (qd_server->next_loop + 1) % qd_server->loop_count;
+    return loop;
+}
+
+
+/**
+ * Wake every thread that is blocked in any of the event loops.
+ */
+static void server_wake_loops(qd_server_t *qd_server)
+{
+    for (int i = 0; i < qd_server->loop_count; i++) {
+        qd_server_loop_t *loop = qd_server->loops[i];
+        sys_mutex_lock(loop->lock);
+        sys_cond_signal_all(loop->cond);
+        sys_mutex_unlock(loop->lock);
+        qdpn_driver_wakeup(loop->driver);
+    }
+}
+
 static void free_qd_connection(qd_connection_t *ctx)
 {
     if (ctx->policy_settings) {
@@ -566,9 +650,24 @@ static void decorate_connection(qd_server_t *qd_server, pn_connection_t *conn, c
 }
 
 
+/**
+ * Make a newly set up connection available to the threads of its event loop.  Readiness
+ * reported while the connection was being set up was passed over, so activate it.
+ */
+static void server_release_connection(qd_connection_t *ctx)
+{
+    sys_mutex_lock(ctx->loop->lock);
+    ctx->owner_thread = CONTEXT_NO_OWNER;
+    sys_mutex_unlock(ctx->loop->lock);
+
+    qdpn_connector_activate(ctx->pn_cxtr, QDPN_CONNECTOR_WRITABLE);
+    qdpn_driver_wakeup(ctx->loop->driver);
+}
+
+
 static void thread_process_listeners_LH(qd_server_t *qd_server)
 {
-    qdpn_driver_t    *driver = qd_server->driver;
+    qdpn_driver_t    *driver = qd_server->loops[0]->driver;
     qdpn_listener_t  *listener;
     qdpn_connector_t *cxtr;
     qd_connection_t  *ctx;
@@ -576,14 +675,25 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
     for (listener = qdpn_driver_listener(driver); listener; listener = qdpn_driver_listener(driver)) {
         qd_listener_t *li = qdpn_listener_context(listener);
         bool policy_counted = false;
-        cxtr = qdpn_listener_accept(listener, qd_server->qd->policy, &qd_policy_socket_accept, &policy_counted);
-        if (!cxtr)
+
+        //
+        // The accepted connector is handed to the next event loop.  That loop's threads
+        // run concurrently with this one, so its lock is held until the connector has a
+        // context.  The connection stays unowned-but-unavailable until it is configured.
+        //
+        qd_server_loop_t *loop = server_next_loop_LH(qd_server);
+        sys_mutex_lock(loop->lock);
+        cxtr = qdpn_listener_accept(listener, loop->driver, qd_server->qd->policy, &qd_policy_socket_accept, &policy_counted);
+        if (!cxtr) {
+            sys_mutex_unlock(loop->lock);
             continue;
+        }
 
         char logbuf[qd_log_max_len()];
 
         ctx = connection_allocate();
         ctx->server        = qd_server;
+        ctx->loop          = loop;
         ctx->owner_thread  = CONTEXT_UNSPECIFIED_OWNER;
         ctx->pn_cxtr       = cxtr;
         ctx->listener      = qdpn_listener_context(listener);
@@ -603,8 +713,8 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         qdpn_connector_set_connection(cxtr, conn);
         pn_connection_set_context(conn, ctx);
         ctx->pn_conn = conn;
-        ctx->owner_thread = CONTEXT_NO_OWNER;
         qdpn_connector_set_context(cxtr, ctx);
+        sys_mutex_unlock(loop->lock);
 
         // qd_server->lock is already locked
         DEQ_INSERT_TAIL(qd_server->connections, ctx);
@@ -650,6 +760,7 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
                 qd_log(qd_server->log_source, QD_LOG_ERROR, "%s on %s",
                        qd_error_message(), log_incoming(logbuf, sizeof(logbuf), cxtr));
                 qdpn_connector_close(cxtr);
+                server_release_connection(ctx);
                 continue;
             }
         }
@@ -666,6 +777,8 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         pn_transport_require_auth(tport, config->requireAuthentication);
         pn_transport_require_encryption(tport, config->requireEncryption);
         pn_sasl_set_allow_insecure_mechs(sasl, config->allowInsecureAuthentication);
+
+        server_release_connection(ctx);
     }
 }
 
@@ -780,6 +893,7 @@ static int process_connector(qd_server_t *qd_server, qdpn_connector_t *cxtr)
                     if (ctx->connector) {
                         ce = QD_CONN_EVENT_CONNECTOR_OPEN;
                         ctx->connector->delay = 2000;  // Delay on re-connect in case there is a recurring error
+                        sys_atomic_add(&ctx->connector->connections_opened, 1);
                     } else
                         assert(ctx->listener);
 
@@ -821,10 +935,155 @@ void qdpn_driver_wait_3(qdpn_driver_t *d);
 // END TEMPORARY
 //
 
+/**
+ * Check, without the server lock, whether there is server-wide work for a thread of this
+ * loop: a signal, a pause, or (for loop 0, which runs the timers) a pending timer.
+ */
+static inline bool server_needs_attention(qd_server_t *qd_server, qd_server_loop_t *loop)
+{
+    return qd_server->pending_signal || qd_server->pause_requests > 0 ||
+        (loop->loop_id == 0 && !DEQ_IS_EMPTY(qd_server->pending_timers));
+}
+
+
+/**
+ * Take the work item at the head of a loop's work queue.  If its connection is not
+ * currently being processed, claim the connection for this thread and return its
+ * connector.  Otherwise re-queue the item and return zero.
+ */
+static qdpn_connector_t *thread_claim_work_LH(qd_thread_t *thread, qd_server_loop_t *loop)
+{
+    qd_work_item_t *work = DEQ_HEAD(loop->work_queue);
+    if (!work)
+        return 0;
+
+    DEQ_REMOVE_HEAD(loop->work_queue);
+    qd_connection_t *ctx = qdpn_connector_context(work->cxtr);
+    if (ctx->owner_thread == CONTEXT_NO_OWNER) {
+        qdpn_connector_t *cxtr = work->cxtr;
+        ctx->owner_thread = thread->thread_id;
+        ctx->enqueued = 0;
+        loop->threads_active++;
+        free_qd_work_item_t(work);
+        return cxtr;
+    }
+
+    //
+    // This connector is being processed by another thread, re-queue it.
+    //
+    DEQ_INSERT_TAIL(loop->work_queue, work);
+    return 0;
+}
+
+
+/**
+ * Look for work queued on the other event loops.  This is used by threads whose own loop
+ * is idle so that a busy loop can borrow them.
+ */
+static qdpn_connector_t *thread_steal_work(qd_thread_t *thread)
+{
+    qd_server_t *qd_server = thread->qd_server;
+
+    for (int i = 1; i < qd_server->loop_count; i++) {
+        qd_server_loop_t *victim = qd_server->loops[(thread->loop->loop_id + i) % qd_server->loop_count];
+
+        //
+        // Peek without the lock; an idle loop is not worth contending for.
+        //
+        if (DEQ_SIZE(victim->work_queue) == 0)
+            continue;
+
+        sys_mutex_lock(victim->lock);
+        qdpn_connector_t *cxtr = thread_claim_work_LH(thread, victim);
+        sys_mutex_unlock(victim->lock);
+        if (cxtr)
+            return cxtr;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Process a connector that has been claimed by this thread.
+ */
+static void thread_process_connector(qd_server_t *qd_server, qdpn_connector_t *cxtr)
+{
+    qd_connection_t  *ctx  = qdpn_connector_context(cxtr);
+    qd_server_loop_t *loop = ctx->loop;
+    int work_done = 1;
+
+    if (qdpn_connector_failed(cxtr))
+        qdpn_connector_close(cxtr);
+
+    //
+    // Even if the connector has failed there are still events that 
+    // must be processed so that associated links will be cleaned up.
+    //
+    work_done = process_connector(qd_server, cxtr);
+
+    //
+    // Check to see if the connector was closed during processing
+    //
+    if (qdpn_connector_closed(cxtr)) {
+        qd_entity_cache_remove(QD_CONNECTION_TYPE, ctx);
+        //
+        // Connector is closed.  Free the context and the connector.
+        // If this is a dispatch connector, schedule the re-connect timer
+        //
+        if (ctx->connector) {
+            qd_connector_t *ct = ctx->connector;
+            if (!ctx->opened) {
+                //
+                // The cached address may be stale; resolve the host again on the next attempt.
+                //
+                sys_atomic_add(&ct->connect_failures, 1);
+                qd_resolver_expire(qd_server->resolver, ct->config->host, ct->config->port,
+                                   ct->config->protocol_family);
+            }
+            ct->ctx = 0;
+            ct->state = CXTR_STATE_CONNECTING;
+            qd_timer_schedule(ct->timer, ct->delay);
+        }
+
+        sys_mutex_lock(qd_server->lock);
+        DEQ_REMOVE(qd_server->connections, ctx);
+
+        if (ctx->policy_counted) {
+            qd_policy_socket_close(qd_server->qd->policy, ctx);
+        }
+
+        qdpn_connector_free(cxtr);
+        invoke_deferred_calls(ctx, true);  // Discard any pending deferred calls
+        sys_mutex_free(ctx->deferred_call_lock);
+        free_qd_connection(ctx);
+        sys_mutex_unlock(qd_server->lock);
+
+        sys_mutex_lock(loop->lock);
+        loop->threads_active--;
+        sys_mutex_unlock(loop->lock);
+    } else {
+        //
+        // The connector lives on.  Mark it as no longer owned by this thread.
+        //
+        sys_mutex_lock(loop->lock);
+        ctx->owner_thread = CONTEXT_NO_OWNER;
+        loop->threads_active--;
+        sys_mutex_unlock(loop->lock);
+    }
+
+    //
+    // Wake up the proton driver to force it to reconsider its set of FDs
+    // in light of the processing that just occurred.
+    //
+    if (work_done)
+        qdpn_driver_wakeup(loop->driver);
+}
+
+
 static void *thread_run(void *arg)
 {
     qd_thread_t      *thread    = (qd_thread_t*) arg;
-    qd_work_item_t   *work;
     qdpn_connector_t *cxtr;
     qd_connection_t  *ctx;
     int               error;
@@ -834,6 +1093,7 @@ static void *thread_run(void *arg)
         return 0;
 
     qd_server_t      *qd_server = thread->qd_server;
+    qd_server_loop_t *loop      = thread->loop;
     thread_server   = qd_server;
     thread->running = 1;
 
@@ -851,225 +1111,198 @@ static void *thread_run(void *arg)
     // Main Loop
     //
     while (thread->running) {
-        sys_mutex_lock(qd_server->lock);
-
         //
-        // Check for pending signals to process
+        // Signals, pauses, and timers are server-wide and are handled under the server
+        // lock.  Check for them without the lock first so that the threads of different
+        // loops don't contend for the server lock on every pass.
         //
-        handle_signals_LH(qd_server);
-        if (!thread->running) {
-            sys_mutex_unlock(qd_server->lock);
-            break;
-        }
-
-        //
-        // Check to see if the server is pausing.  If so, block here.
-        //
-        block_if_paused_LH(qd_server);
-        if (!thread->running) {
-            sys_mutex_unlock(qd_server->lock);
-            break;
-        }
-
-        //
-        // Service pending timers.
-        //
-        qd_timer_t *timer = DEQ_HEAD(qd_server->pending_timers);
-        if (timer) {
-            DEQ_REMOVE_HEAD(qd_server->pending_timers);
+        if (server_needs_attention(qd_server, loop)) {
+            sys_mutex_lock(qd_server->lock);
 
             //
-            // Mark the timer as idle in case it reschedules itself.
+            // Check for pending signals to process
             //
-            qd_timer_idle_LH(timer);
+            handle_signals_LH(qd_server);
+            if (!thread->running) {
+                sys_mutex_unlock(qd_server->lock);
+                break;
+            }
 
             //
-            // Release the lock and invoke the connection handler.
+            // Check to see if the server is pausing.  If so, block here.
             //
-            sys_mutex_unlock(qd_server->lock);
-            timer->handler(timer->context);
-            qdpn_driver_wakeup(qd_server->driver);
-            continue;
-        }
+            block_if_paused_LH(qd_server);
+            if (!thread->running) {
+                sys_mutex_unlock(qd_server->lock);
+                break;
+            }
 
-        //
-        // Check the work queue for connectors scheduled for processing.
-        //
-        work = DEQ_HEAD(qd_server->work_queue);
-        if (!work) {
             //
-            // There is no pending work to do
+            // Service pending timers.  Timers are run by the threads of loop 0.
             //
-            if (qd_server->a_thread_is_waiting) {
-                //
-                // Another thread is waiting on the proton driver, this thread must
-                // wait on the condition variable until signaled.
-                //
-                sys_cond_wait(qd_server->cond, qd_server->lock);
-            } else {
-                //
-                // This thread elects itself to wait on the proton driver.  Set the
-                // thread-is-waiting flag so other idle threads will not interfere.
-                //
-                qd_server->a_thread_is_waiting = true;
+            qd_timer_t *timer = loop->loop_id == 0 ? DEQ_HEAD(qd_server->pending_timers) : 0;
+            if (timer) {
+                DEQ_REMOVE_HEAD(qd_server->pending_timers);
 
                 //
-                // Ask the timer module when its next timer is scheduled to fire.  We'll
-                // use this value in driver_wait as the timeout.  If there are no scheduled
-                // timers, the returned value will be -1.
+                // Mark the timer as idle in case it reschedules itself.
                 //
-                qd_timestamp_t duration = qd_timer_next_duration_LH();
+                qd_timer_idle_LH(timer);
 
                 //
-                // Invoke the proton driver's wait sequence.  This is a bit of a hack for now
-                // and will be improved in the future.  The wait process is divided into three parts,
-                // the first and third of which need to be non-reentrant, and the second of which
-                // must be reentrant (and blocks).
+                // Release the lock and invoke the connection handler.
                 //
-                qdpn_driver_wait_1(qd_server->driver);
                 sys_mutex_unlock(qd_server->lock);
+                timer->handler(timer->context);
+                qdpn_driver_wakeup(loop->driver);
+                continue;
+            }
 
-                do {
-                    error = 0;
-                    poll_result = qdpn_driver_wait_2(qd_server->driver, duration);
-                    if (poll_result == -1)
-                        error = errno;
-                } while (error == EINTR);
-                if (error) {
-                    exit(-1);
-                }
-
-                sys_mutex_lock(qd_server->lock);
-                qdpn_driver_wait_3(qd_server->driver);
-
-                if (!thread->running) {
-                    sys_mutex_unlock(qd_server->lock);
-                    break;
-                }
-
-                //
-                // Visit the timer module.
-                //
-                struct timespec tv;
-                clock_gettime(CLOCK_REALTIME, &tv);
-                qd_timestamp_t milliseconds = ((qd_timestamp_t)tv.tv_sec) * 1000 + tv.tv_nsec / 1000000;
-                qd_timer_visit_LH(milliseconds);
+            sys_mutex_unlock(qd_server->lock);
+        }
 
-                //
-                // Process listeners (incoming connections).
-                //
-                thread_process_listeners_LH(qd_server);
+        //
+        // Check the work queue for connectors scheduled for processing.
+        //
+        sys_mutex_lock(loop->lock);
+        if (!DEQ_IS_EMPTY(loop->work_queue)) {
+            //
+            // If we were given a connector to work on from the work queue, mark it as
+            // owned by this thread and as no longer enqueued.
+            //
+            cxtr = thread_claim_work_LH(thread, loop);
+            sys_mutex_unlock(loop->lock);
 
-                //
-                // Traverse the list of connectors-needing-service from the proton driver.
-                // If the connector is not already in the work queue and it is not currently
-                // being processed by another thread, put it in the work queue and signal the
-                // condition variable.
-                //
-                cxtr = qdpn_driver_connector(qd_server->driver);
-                while (cxtr) {
-                    ctx = qdpn_connector_context(cxtr);
-                    if (!ctx->enqueued && ctx->owner_thread == CONTEXT_NO_OWNER) {
-                        ctx->enqueued = 1;
-                        qd_work_item_t *workitem = new_qd_work_item_t();
-                        DEQ_ITEM_INIT(workitem);
-                        workitem->cxtr = cxtr;
-                        DEQ_INSERT_TAIL(qd_server->work_queue, workitem);
-                        sys_cond_signal(qd_server->cond);
-                    }
-                    cxtr = qdpn_driver_connector(qd_server->driver);
-                }
+            //
+            // Process the connector that we now have exclusive access to.
+            //
+            if (cxtr)
+                thread_process_connector(qd_server, cxtr);
+            continue;
+        }
 
-                //
-                // Release our exclusive claim on qdpn_driver_wait.
-                //
-                qd_server->a_thread_is_waiting = false;
+        //
+        // There is no pending work to do
+        //
+        if (loop->a_thread_is_waiting) {
+            //
+            // Another thread is waiting on this loop's driver.  Before going idle, look
+            // for work that is backed up on the other loops.
+            //
+            sys_mutex_unlock(loop->lock);
+            cxtr = thread_steal_work(thread);
+            if (cxtr) {
+                thread_process_connector(qd_server, cxtr);
+                continue;
             }
+
+            //
+            // Wait on the condition variable until signaled.  Recheck under the loop lock,
+            // which the waker must take before signaling, so that a wakeup isn't lost.
+            //
+            sys_mutex_lock(loop->lock);
+            if (loop->a_thread_is_waiting && DEQ_IS_EMPTY(loop->work_queue) &&
+                !server_needs_attention(qd_server, loop) && thread->running)
+                sys_cond_wait(loop->cond, loop->lock);
+            sys_mutex_unlock(loop->lock);
+            continue;
         }
 
         //
-        // If we were given a connector to work on from the work queue, mark it as
-        // owned by this thread and as no longer enqueued.
+        // This thread elects itself to wait on the proton driver.  Set the
+        // thread-is-waiting flag so other idle threads will not interfere.
         //
-        cxtr = 0;
-        if (work) {
-            DEQ_REMOVE_HEAD(qd_server->work_queue);
-            ctx = qdpn_connector_context(work->cxtr);
-            if (ctx->owner_thread == CONTEXT_NO_OWNER) {
-                ctx->owner_thread = thread->thread_id;
-                ctx->enqueued = 0;
-                qd_server->threads_active++;
-                cxtr = work->cxtr;
-                free_qd_work_item_t(work);
-            } else {
-                //
-                // This connector is being processed by another thread, re-queue it.
-                //
-                DEQ_INSERT_TAIL(qd_server->work_queue, work);
-            }
+        loop->a_thread_is_waiting = true;
+        sys_mutex_unlock(loop->lock);
+
+        //
+        // Ask the timer module when its next timer is scheduled to fire.  We'll
+        // use this value in driver_wait as the timeout.  If there are no scheduled
+        // timers, the returned value will be -1.  Only loop 0 runs timers.
+        //
+        qd_timestamp_t duration = -1;
+        if (loop->loop_id == 0) {
+            sys_mutex_lock(qd_server->lock);
+            duration = qd_timer_next_duration_LH();
+            sys_mutex_unlock(qd_server->lock);
         }
-        sys_mutex_unlock(qd_server->lock);
 
         //
-        // Process the connector that we now have exclusive access to.
+        // Invoke the proton driver's wait sequence.  This is a bit of a hack for now
+        // and will be improved in the future.  The wait process is divided into three parts,
+        // the first and third of which need to be non-reentrant, and the second of which
+        // must be reentrant (and blocks).  Only the elected thread of each loop runs them.
         //
-        if (cxtr) {
-            int work_done = 1;
+        qdpn_driver_wait_1(loop->driver);
+
+        do {
+            error = 0;
+            poll_result = qdpn_driver_wait_2(loop->driver, duration);
+            if (poll_result == -1)
+                error = errno;
+        } while (error == EINTR);
+        if (error) {
+            exit(-1);
+        }
 
-            if (qdpn_connector_failed(cxtr))
-                qdpn_connector_close(cxtr);
+        qdpn_driver_wait_3(loop->driver);
+
+        if (!thread->running)
+            break;
+
+        if (loop->loop_id == 0) {
+            sys_mutex_lock(qd_server->lock);
 
             //
-            // Even if the connector has failed there are still events that 
-            // must be processed so that associated links will be cleaned up.
+            // Visit the timer module.
             //
-            work_done = process_connector(qd_server, cxtr);
+            struct timespec tv;
+            clock_gettime(CLOCK_REALTIME, &tv);
+            qd_timestamp_t milliseconds = ((qd_timestamp_t)tv.tv_sec) * 1000 + tv.tv_nsec / 1000000;
+            qd_timer_visit_LH(milliseconds);
 
             //
-            // Check to see if the connector was closed during processing
+            // Process listeners (incoming connections).
             //
-            if (qdpn_connector_closed(cxtr)) {
-                qd_entity_cache_remove(QD_CONNECTION_TYPE, ctx);
-                //
-                // Connector is closed.  Free the context and the connector.
-                // If this is a dispatch connector, schedule the re-connect timer
-                //
-                if (ctx->connector) {
-                    ctx->connector->ctx = 0;
-                    ctx->connector->state = CXTR_STATE_CONNECTING;
-                    qd_timer_schedule(ctx->connector->timer, ctx->connector->delay);
-                }
-
-                sys_mutex_lock(qd_server->lock);
-                DEQ_REMOVE(qd_server->connections, ctx);
+            thread_process_listeners_LH(qd_server);
 
-                if (ctx->policy_counted) {
-                    qd_policy_socket_close(qd_server->qd->policy, ctx);
-                }
+            sys_mutex_unlock(qd_server->lock);
+        }
 
-                qdpn_connector_free(cxtr);
-                invoke_deferred_calls(ctx, true);  // Discard any pending deferred calls
-                sys_mutex_free(ctx->deferred_call_lock);
-                free_qd_connection(ctx);
-                qd_server->threads_active--;
-                sys_mutex_unlock(qd_server->lock);
-            } else {
-                //
-                // The connector lives on.  Mark it as no longer owned by this thread.
-                //
-                sys_mutex_lock(qd_server->lock);
-                ctx->owner_thread = CONTEXT_NO_OWNER;
-                qd_server->threads_active--;
-                sys_mutex_unlock(qd_server->lock);
+        //
+        // Traverse the list of connectors-needing-service from the proton driver.
+        // If the connector is not already in the work queue and it is not currently
+        // being processed by another thread, put it in the work queue and signal the
+        // condition variable.
+        //
+        sys_mutex_lock(loop->lock);
+        cxtr = qdpn_driver_connector(loop->driver);
+        while (cxtr) {
+            ctx = qdpn_connector_context(cxtr);
+            if (!ctx->enqueued && ctx->owner_thread == CONTEXT_NO_OWNER) {
+                ctx->enqueued = 1;
+                qd_work_item_t *workitem = new_qd_work_item_t();
+                DEQ_ITEM_INIT(workitem);
+                workitem->cxtr = cxtr;
+                DEQ_INSERT_TAIL(loop->work_queue, workitem);
+                sys_cond_signal(loop->cond);
             }
-
-            //
-            // Wake up the proton driver to force it to reconsider its set of FDs
-            // in light of the processing that just occurred.
-            //
-            if (work_done)
-                qdpn_driver_wakeup(qd_server->driver);
+            cxtr = qdpn_driver_connector(loop->driver);
         }
+
+        //
+        // Release our exclusive claim on qdpn_driver_wait.
+        //
+        loop->a_thread_is_waiting = false;
+        size_t backlog = DEQ_SIZE(loop->work_queue);
+        sys_mutex_unlock(loop->lock);
+
+        //
+        // If this loop has queued more work than it can start right away, nudge an idle
+        // thread of the next loop so that it can steal some of it.
+        //
+        if (backlog > 1 && qd_server->loop_count > 1)
+            sys_cond_signal(qd_server->loops[(loop->loop_id + 1) % qd_server->loop_count]->cond);
     }
 
     return 0;
@@ -1123,6 +1356,41 @@ static void cxtr_try_open(void *context)
     if (ct->state != CXTR_STATE_CONNECTING)
         return;
 
+    //
+    // Resolve the host and start connecting without holding the server lock.  If the
+    // address is not cached yet, this timer fires again when the lookup is done.
+    //
+    const qd_server_config_t *config = ct->config;
+    qd_resolved_addr_t        addr;
+    switch (qd_resolver_lookup(ct->server->resolver, config->host, config->port,
+                               config->protocol_family, ct->timer, &addr)) {
+    case QD_RESOLVE_PENDING:
+        return;
+
+    case QD_RESOLVE_FAILED:
+        qd_log(ct->server->log_source, QD_LOG_TRACE, "Cannot resolve %s:%s: %s", config->host, config->port, addr.error);
+        sys_atomic_add(&ct->resolve_failures, 1);
+        ct->delay = 10000;
+        qd_timer_schedule(ct->timer, ct->delay);
+        return;
+
+    case QD_RESOLVE_OK:
+        break;
+    }
+
+    qd_log(ct->server->log_source, QD_LOG_TRACE, "Connecting to %s:%s", config->host, config->port);
+
+    sys_atomic_add(&ct->connect_attempts, 1);
+    // Any driver will do here; it is only used for logging.
+    int sock = qdpn_connect_socket(ct->server->loops[0]->driver, (struct sockaddr*) &addr.addr, addr.addr_len);
+    if (sock < 0) {
+        sys_atomic_add(&ct->connect_failures, 1);
+        qd_resolver_expire(ct->server->resolver, config->host, config->port, config->protocol_family);
+        ct->delay = 10000;
+        qd_timer_schedule(ct->timer, ct->delay);
+        return;
+    }
+
     qd_connection_t *ctx = connection_allocate();
     ctx->server       = ct->server;
     ctx->owner_thread = CONTEXT_UNSPECIFIED_OWNER;
@@ -1136,26 +1404,24 @@ static void cxtr_try_open(void *context)
     ctx->role          = (char*) malloc(role_length);
     strcpy(ctx->role, ctx->connector->config->role);
 
-    qd_log(ct->server->log_source, QD_LOG_TRACE, "Connecting to %s:%s", ct->config->host, ct->config->port);
-
     pn_connection_collect(ctx->pn_conn, ctx->collector);
     decorate_connection(ctx->server, ctx->pn_conn, ct->config);
 
     //
-    // qdpn_connector is not thread safe
+    // The server lock is only needed to register the connecting socket.
     //
     sys_mutex_lock(ct->server->lock);
     // Increment the connection id so the next connection can use it
     ctx->connection_id = ct->server->next_connection_id++;
-    ctx->pn_cxtr = qdpn_connector(ct->server->driver, ct->config->host, ct->config->port, ct->config->protocol_family, (void*) ctx);
+    ctx->loop = server_next_loop_LH(ct->server);
+    ctx->pn_cxtr = qdpn_connector_socket(ctx->loop->driver, sock, config->host, config->port, (void*) ctx);
     if (ctx->pn_cxtr) {
         DEQ_INSERT_TAIL(ct->server->connections, ctx);
     }
     sys_mutex_unlock(ct->server->lock);
 
-    const qd_server_config_t *config = ct->config;
-
     if (ctx->pn_cxtr == 0) {
+        close(sock);
         sys_mutex_free(ctx->deferred_call_lock);
         free_qd_connection(ctx);
         ct->delay = 10000;
@@ -1280,19 +1546,23 @@ static void cxtr_try_open(void *context)
 
     pn_connection_open(ctx->pn_conn);
 
-    ctx->owner_thread = CONTEXT_NO_OWNER;
+    server_release_connection(ctx);
 }
 
 
 static void heartbeat_cb(void *context)
 {
     qd_server_t *qd_server = (qd_server_t*) context;
-    qdpn_activate_all(qd_server->driver);
+    for (int i = 0; i < qd_server->loop_count; i++) {
+        qdpn_activate_all(qd_server->loops[i]->driver);
+        if (i > 0)
+            qdpn_driver_wakeup(qd_server->loops[i]->driver);
+    }
     qd_timer_schedule(qd_server->heartbeat_timer, HEARTBEAT_INTERVAL);
 }
 
 
-qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *container_name,
+qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, int loop_count, const char *container_name,
                        const char *sasl_config_path, const char *sasl_config_name)
 {
     int i;
@@ -1308,7 +1578,6 @@ qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *containe
     qd_server->container_name   = container_name;
     qd_server->sasl_config_path = sasl_config_path;
     qd_server->sasl_config_name = sasl_config_name;
-    qd_server->driver           = qdpn_driver(qd_server->log_source);
     qd_server->start_handler    = 0;
     qd_server->conn_handler     = 0;
     qd_server->pn_event_handler = 0;
@@ -1320,14 +1589,24 @@ qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *containe
 
     qd_timer_initialize(qd_server->lock);
 
+    //
+    // Every loop needs at least one thread to wait on its driver.
+    //
+    if (loop_count > thread_count)
+        loop_count = thread_count;
+    if (loop_count < 1)
+        loop_count = 1;
+    qd_server->loop_count = loop_count;
+    qd_server->next_loop  = 0;
+    qd_server->loops = NEW_PTR_ARRAY(qd_server_loop_t, loop_count);
+    for (i = 0; i < loop_count; i++)
+        qd_server->loops[i] = server_loop(qd_server, i);
+
     qd_server->threads = NEW_PTR_ARRAY(qd_thread_t, thread_count);
     for (i = 0; i < thread_count; i++)
         qd_server->threads[i] = thread(qd_server, i);
 
-    DEQ_INIT(qd_server->work_queue);
     DEQ_INIT(qd_server->pending_timers);
-    qd_server->a_thread_is_waiting    = false;
-    qd_server->threads_active         = 0;
     qd_server->pause_requests         = 0;
     qd_server->threads_paused         = 0;
     qd_server->pause_next_sequence    = 0;
@@ -1338,7 +1617,10 @@ qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *containe
     qd_server->next_connection_id     = 1;
     qd_server->py_displayname_obj     = 0;
     qd_server->http                   = qd_http_server(qd, qd_server->log_source);
+    qd_server->resolver               = qd_resolver(qd_server->log_source);
     qd_log(qd_server->log_source, QD_LOG_INFO, "Container Name: %s", qd_server->container_name);
+    if (loop_count > 1)
+        qd_log(qd_server->log_source, QD_LOG_INFO, "Event Loops: %d", loop_count);
 
     return qd_server;
 }
@@ -1350,10 +1632,13 @@ void qd_server_free(qd_server_t *qd_server)
     for (int i = 0; i < qd_server->thread_count; i++)
         thread_free(qd_server->threads[i]);
     qd_http_server_free(qd_server->http);
+    qd_resolver_free(qd_server->resolver);
     qd_timer_finalize();
-    qdpn_driver_free(qd_server->driver);
+    for (int i = 0; i < qd_server->loop_count; i++)
+        server_loop_free(qd_server->loops[i]);
     sys_mutex_free(qd_server->lock);
     sys_cond_free(qd_server->cond);
+    free(qd_server->loops);
     free(qd_server->threads);
     Py_XDECREF((PyObject *)qd_server->py_displayname_obj);
     free(qd_server);
@@ -1455,7 +1740,7 @@ void qd_server_stop(qd_dispatch_t *qd)
     for (idx = 0; idx < qd_server->thread_count; idx++)
         thread_cancel(qd_server->threads[idx]);
     sys_cond_signal_all(qd_server->cond);
-    qdpn_driver_wakeup(qd_server->driver);
+    server_wake_loops(qd_server);
     sys_mutex_unlock(qd_server->lock);
 
     if (thread_server != qd_server) {
@@ -1473,9 +1758,15 @@ void qd_server_signal(qd_dispatch_t *qd, int signum)
 
     qd_server_t *qd_server = qd->server;
 
+    //
+    // This is called from a signal handler, so the loop locks can't be taken here.
+    //
     qd_server->pending_signal = signum;
     sys_cond_signal_all(qd_server->cond);
-    qdpn_driver_wakeup(qd_server->driver);
+    for (int i = 0; i < qd_server->loop_count; i++) {
+        sys_cond_signal_all(qd_server->loops[i]->cond);
+        qdpn_driver_wakeup(qd_server->loops[i]->driver);
+    }
 }
 
 
@@ -1495,7 +1786,7 @@ void qd_server_pause(qd_dispatch_t *qd)
     // Awaken all threads that are currently blocking.
     //
     sys_cond_signal_all(qd_server->cond);
-    qdpn_driver_wakeup(qd_server->driver);
+    server_wake_loops(qd_server);
 
     //
     // Wait for the paused thread count plus the number of threads requesting a pause to equal
@@ -1534,7 +1825,7 @@ void qd_server_activate(qd_connection_t *ctx, bool awaken)
     if (!qdpn_connector_closed(ctor)) {
         qdpn_connector_activate(ctor, QDPN_CONNECTOR_WRITABLE);
         if (awaken)
-            qdpn_driver_wakeup(ctx->server->driver);
+            qdpn_driver_wakeup(ctx->loop->driver);
     }
 }
 
@@ -1645,7 +1936,7 @@ qd_listener_t *qd_server_listen(qd_dispatch_t *qd, const qd_server_config_t *con
         }
     }
     li->pn_listener = qdpn_listener(
-        qd_server->driver, config->host, config->port, config->protocol_family, li);
+        qd_server->loops[0]->driver, config->host, config->port, config->protocol_family, li);
 
     if (!li->pn_listener) {
         free_qd_listener_t(li);
@@ -1692,6 +1983,10 @@ qd_connector_t *qd_server_connect(qd_dispatch_t *qd, const qd_server_config_t *c
     ct->ctx     = 0;
     ct->timer   = qd_timer(qd, cxtr_try_open, (void*) ct);
     ct->delay   = 0;
+    sys_atomic_init(&ct->connect_attempts, 0);
+    sys_atomic_init(&ct->connect_failures, 0);
+    sys_atomic_init(&ct->resolve_failures, 0);
+    sys_atomic_init(&ct->connections_opened, 0);
 
     qd_timer_schedule(ct->timer, ct->delay);
     return ct;
@@ -1711,14 +2006,19 @@ void qd_server_connector_free(qd_connector_t* ct)
         ct->ctx->connector = 0;
     }
 
+    qd_resolver_cancel(ct->server->resolver, ct->timer);
     qd_timer_free(ct->timer);
+    sys_atomic_destroy(&ct->connect_attempts);
+    sys_atomic_destroy(&ct->connect_failures);
+    sys_atomic_destroy(&ct->resolve_failures);
+    sys_atomic_destroy(&ct->connections_opened);
     free_qd_connector_t(ct);
 }
 
 void qd_server_timer_pending_LH(qd_timer_t *timer)
 {
     DEQ_INSERT_TAIL(timer->server->pending_timers, timer);
-    qdpn_driver_wakeup(timer->server->driver);
+    qdpn_driver_wakeup(timer->server->loops[0]->driver);
 }
 
 
@@ -1748,3 +2048,12 @@ const qd_server_config_t *qd_connector_config(const qd_connector_t *c) {
 qd_http_listener_t *qd_listener_http(qd_listener_t *l) {
     return l->http;
 }
+
+
+void qd_connector_get_stats(qd_connector_t *ct, qd_connector_stats_t *stats)
+{
+    stats->connect_attempts   = sys_atomic_get(&ct->connect_attempts);
+    stats->connect_failures   = sys_atomic_get(&ct->connect_failures);
+    stats->resolve_failures   = sys_atomic_get(&ct->resolve_failures);
+    stats->connections_opened = sys_atomic_get(&ct->connections_opened);
+}
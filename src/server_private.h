@@ -45,11 +45,28 @@ qd_connector_t* qd_connection_connector(const qd_connection_t *c);
 
 const qd_server_config_t *qd_connector_config(const qd_connector_t *c);
 
+/**
+ * Connect-rate counters of a connector, since it was created.
+ */
+typedef struct qd_connector_stats_t {
+    uint32_t connect_attempts;    ///< Sockets that were started connecting
+    uint32_t connect_failures;    ///< Attempts that closed before the connection opened
+    uint32_t resolve_failures;    ///< Attempts abandoned because the host did not resolve
+    uint32_t connections_opened;  ///< Attempts that reached the open state
+} qd_connector_stats_t;
+
+void qd_connector_get_stats(qd_connector_t *c, qd_connector_stats_t *stats);
+
 qd_http_listener_t *qd_listener_http(qd_listener_t *l);
 
 #define CONTEXT_NO_OWNER -1
 #define CONTEXT_UNSPECIFIED_OWNER -2
 
+/**
+ * An event loop: one driver, its work queue, and the threads that serve them.
+ */
+typedef struct qd_server_loop_t qd_server_loop_t;
+
 typedef enum {
     QD_BIND_SUCCESSFUL, // Bind to socket was attempted and the bind succeeded
     QD_BIND_FAILED,     // Bind to socket was attempted and bind failed
@@ -87,6 +104,7 @@ DEQ_DECLARE(qd_pn_free_link_session_t, qd_pn_free_link_session_list_t);
 struct qd_connection_t {
     DEQ_LINKS(qd_connection_t);
     qd_server_t              *server;
+    qd_server_loop_t         *loop;   // The event loop whose driver owns pn_cxtr
     bool                      opened; // An open callback was invoked for this connection
     bool                      closed;
     int                       owner_thread;
@@ -25,10 +25,28 @@
 #include "alloc.h"
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+
+//
+// Scheduled timers are kept in a hierarchical timing wheel.  Each of the WHEEL_LEVELS
+// levels has WHEEL_SLOTS slots; a slot in level n spans WHEEL_SLOTS^n milliseconds.  A
+// timer is placed in the lowest level whose span covers its remaining time, in the slot
+// indexed by its expiration time.  When the wheel time reaches the start of a slot in
+// an upper level, the timers in that slot are cascaded into the levels below.  Schedule
+// and cancel are O(1) and a visit only touches slots that hold timers.
+//
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 6
+#define WHEEL_SPAN(level) ((qd_timestamp_t) 1 << (WHEEL_BITS * (level)))
 
 static sys_mutex_t     *lock;
 static qd_timer_list_t  idle_timers;
-static qd_timer_list_t  scheduled_timers;
+static qd_timer_list_t  wheel[WHEEL_LEVELS * WHEEL_SLOTS];
+static uint64_t         wheel_occupied[WHEEL_LEVELS];  // Bit per non-empty slot
+static int              scheduled_count;
+static qd_timestamp_t   wheel_time;
 static qd_timestamp_t   time_base;
 
 ALLOC_DECLARE(qd_timer_t);
@@ -41,6 +59,70 @@ sys_mutex_t* qd_timer_lock() { return lock; }
 // Private static functions
 //=========================================================================
 
+static void qd_timer_wheel_insert_LH(qd_timer_t *timer)
+{
+    qd_timestamp_t remaining = timer->expire - wheel_time;
+    int            level     = 0;
+    int            index;
+
+    if (remaining < 0)
+        remaining = 0;
+    while (level < WHEEL_LEVELS - 1 && remaining >= WHEEL_SPAN(level + 1))
+        level++;
+
+    if (remaining >= WHEEL_SPAN(WHEEL_LEVELS)) {
+        //
+        // Beyond the reach of the wheel.  Park the timer in the top-level slot that will
+        // be cascaded last; it is placed again with its real expiration at that time.
+        //
+        index = ((wheel_time >> (WHEEL_BITS * level)) - 1) & WHEEL_MASK;
+    } else
+        index = ((wheel_time + remaining) >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+    timer->slot = level * WHEEL_SLOTS + index;
+    DEQ_INSERT_TAIL(wheel[timer->slot], timer);
+    wheel_occupied[level] |= (uint64_t) 1 << index;
+}
+
+
+static void qd_timer_wheel_remove_LH(qd_timer_t *timer)
+{
+    DEQ_REMOVE(wheel[timer->slot], timer);
+    if (DEQ_IS_EMPTY(wheel[timer->slot]))
+        wheel_occupied[timer->slot / WHEEL_SLOTS] &= ~((uint64_t) 1 << (timer->slot & WHEEL_MASK));
+}
+
+
+//
+// Return the wheel time of the next slot that must be serviced, either to fire its
+// timers (level 0) or to cascade them (upper levels).  There must be scheduled timers.
+//
+static qd_timestamp_t qd_timer_wheel_next_LH(void)
+{
+    qd_timestamp_t next = -1;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        uint64_t occupied = wheel_occupied[level];
+        if (!occupied)
+            continue;
+
+        //
+        // Rotate the occupancy bits so that the slot after the current one is bit zero.
+        //
+        qd_timestamp_t base     = wheel_time >> (WHEEL_BITS * level);
+        int            rotation = (base + 1) & WHEEL_MASK;
+        if (rotation)
+            occupied = (occupied >> rotation) | (occupied << (WHEEL_SLOTS - rotation));
+
+        qd_timestamp_t when = (base + 1 + __builtin_ctzll(occupied)) << (WHEEL_BITS * level);
+        if (next < 0 || when < next)
+            next = when;
+    }
+
+    return next;
+}
+
+
 static void qd_timer_cancel_LH(qd_timer_t *timer)
 {
     switch (timer->state) {
@@ -52,9 +134,8 @@ static void qd_timer_cancel_LH(qd_timer_t *timer)
         break;
 
     case TIMER_SCHEDULED:
-        if (timer->next)
-            timer->next->delta_time += timer->delta_time;
-        DEQ_REMOVE(scheduled_timers, timer);
+        qd_timer_wheel_remove_LH(timer);
+        scheduled_count--;
         DEQ_INSERT_TAIL(idle_timers, timer);
         break;
 
@@ -83,7 +164,8 @@ qd_timer_t *qd_timer(qd_dispatch_t *qd, qd_timer_cb_t cb, void* context)
     timer->server     = qd ? qd->server : 0;
     timer->handler    = cb;
     timer->context    = context;
-    timer->delta_time = 0;
+    timer->expire     = 0;
+    timer->slot       = -1;
     timer->state      = TIMER_IDLE;
 
     sys_mutex_lock(lock);
@@ -109,10 +191,6 @@ void qd_timer_free(qd_timer_t *timer)
 
 void qd_timer_schedule(qd_timer_t *timer, qd_timestamp_t duration)
 {
-    qd_timer_t     *ptr;
-    qd_timer_t     *last;
-    qd_timestamp_t  total_time;
-
     sys_mutex_lock(lock);
     qd_timer_cancel_LH(timer);  // Timer is now on the idle list
     assert(timer->state == TIMER_IDLE);
@@ -120,49 +198,19 @@ void qd_timer_schedule(qd_timer_t *timer, qd_timestamp_t duration)
 
     //
     // Handle the special case of a zero-time scheduling.  In this case,
-    // the timer doesn't go on the scheduled list.  It goes straight to the
+    // the timer doesn't go on the wheel.  It goes straight to the
     // pending list in the server.
     //
-    if (duration == 0) {
+    if (duration <= 0) {
         timer->state = TIMER_PENDING;
         qd_server_timer_pending_LH(timer);
         sys_mutex_unlock(lock);
         return;
     }
 
-    //
-    // Find the insert point in the schedule.
-    //
-    total_time = 0;
-    ptr        = DEQ_HEAD(scheduled_timers);
-    assert(!ptr || ptr->prev == 0);
-    while (ptr) {
-        total_time += ptr->delta_time;
-        if (total_time > duration)
-            break;
-        ptr = ptr->next;
-    }
-
-    //
-    // Insert the timer into the schedule and adjust the delta time
-    // of the following timer if present.
-    //
-    if (total_time <= duration) {
-        assert(ptr == 0);
-        timer->delta_time = duration - total_time;
-        DEQ_INSERT_TAIL(scheduled_timers, timer);
-    } else {
-        total_time -= ptr->delta_time;
-        timer->delta_time = duration - total_time;
-        assert(ptr->delta_time > timer->delta_time);
-        ptr->delta_time -= timer->delta_time;
-        last = ptr->prev;
-        if (last)
-            DEQ_INSERT_AFTER(scheduled_timers, timer, last);
-        else
-            DEQ_INSERT_HEAD(scheduled_timers, timer);
-    }
-
+    timer->expire = wheel_time + duration;
+    qd_timer_wheel_insert_LH(timer);
+    scheduled_count++;
     timer->state = TIMER_SCHEDULED;
 
     sys_mutex_unlock(lock);
@@ -185,8 +233,12 @@ void qd_timer_initialize(sys_mutex_t *server_lock)
 {
     lock = server_lock;
     DEQ_INIT(idle_timers);
-    DEQ_INIT(scheduled_timers);
-    time_base = 0;
+    for (int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++)
+        DEQ_INIT(wheel[i]);
+    memset(wheel_occupied, 0, sizeof(wheel_occupied));
+    scheduled_count = 0;
+    wheel_time      = 0;
+    time_base       = 0;
 }
 
 
@@ -198,40 +250,78 @@ void qd_timer_finalize(void)
 
 qd_timestamp_t qd_timer_next_duration_LH(void)
 {
-    qd_timer_t *timer = DEQ_HEAD(scheduled_timers);
-    if (timer)
-        return timer->delta_time;
-    return -1;
+    if (scheduled_count == 0)
+        return -1;
+    return qd_timer_wheel_next_LH() - wheel_time;
 }
 
 
 void qd_timer_visit_LH(qd_timestamp_t current_time)
 {
-    qd_timestamp_t  delta;
-    qd_timer_t     *timer = DEQ_HEAD(scheduled_timers);
+    qd_timestamp_t target;
 
     if (time_base == 0) {
         time_base = current_time;
         return;
     }
 
-    delta     = current_time - time_base;
+    //
+    // If the clock has stepped backwards, count no time as having passed.
+    //
+    if (current_time <= time_base) {
+        time_base = current_time;
+        return;
+    }
+
+    target    = wheel_time + (current_time - time_base);
     time_base = current_time;
 
-    while (timer) {
-        assert(delta >= 0);
-        if (timer->delta_time > delta) {
-            timer->delta_time -= delta;
+    //
+    // Advance the wheel from one occupied slot to the next.  Slots passed over are empty
+    // so there is nothing to do for them.
+    //
+    while (scheduled_count > 0) {
+        qd_timestamp_t next = qd_timer_wheel_next_LH();
+        if (next > target)
             break;
-        } else {
-            DEQ_REMOVE_HEAD(scheduled_timers);
-            delta -= timer->delta_time;
+        wheel_time = next;
+
+        //
+        // Cascade the upper-level slots that begin at this time, highest level first.
+        //
+        int top = 0;
+        while (top < WHEEL_LEVELS - 1 && (wheel_time & (WHEEL_SPAN(top + 1) - 1)) == 0)
+            top++;
+        for (int level = top; level > 0; level--) {
+            int              slot = level * WHEEL_SLOTS + ((wheel_time >> (WHEEL_BITS * level)) & WHEEL_MASK);
+            qd_timer_list_t  cascade;
+            DEQ_MOVE(wheel[slot], cascade);
+            wheel_occupied[level] &= ~((uint64_t) 1 << (slot & WHEEL_MASK));
+
+            qd_timer_t *timer = DEQ_HEAD(cascade);
+            while (timer) {
+                DEQ_REMOVE_HEAD(cascade);
+                qd_timer_wheel_insert_LH(timer);
+                timer = DEQ_HEAD(cascade);
+            }
+        }
+
+        //
+        // Everything in the current level-0 slot has expired.
+        //
+        int         slot  = wheel_time & WHEEL_MASK;
+        qd_timer_t *timer = DEQ_HEAD(wheel[slot]);
+        while (timer) {
+            DEQ_REMOVE_HEAD(wheel[slot]);
+            scheduled_count--;
             timer->state = TIMER_PENDING;
             qd_server_timer_pending_LH(timer);
-
+            timer = DEQ_HEAD(wheel[slot]);
         }
-        timer = DEQ_HEAD(scheduled_timers);
+        wheel_occupied[0] &= ~((uint64_t) 1 << slot);
     }
+
+    wheel_time = target;
 }
 
 
@@ -36,7 +36,8 @@ struct qd_timer_t {
     qd_server_t      *server;
     qd_timer_cb_t     handler;
     void             *context;
-    qd_timestamp_t    delta_time;
+    qd_timestamp_t    expire;   ///< Wheel time at which a scheduled timer fires
+    int               slot;     ///< Index of the wheel slot holding a scheduled timer
     qd_timer_state_t  state;
 };
 
@@ -0,0 +1,42 @@
+#ifndef _bench_h_
+#define _bench_h_ 1
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+//
+// Helpers shared by the benchmarks, which are built but not run as part of the test suite.
+//
+
+/**
+ * Seconds on the monotonic clock.
+ */
+double bench_now(void);
+
+/**
+ * The integer value of positional argument 'index', or 'value' if it was not given.
+ */
+int bench_int_arg(int argc, char **argv, int index, int value);
+
+/**
+ * Print the usage line of a benchmark and return its exit status.
+ */
+int bench_usage(char **argv, const char *arguments);
+
+#endif
@@ -20,6 +20,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "test_case.h"
 #include <qpid/dispatch/buffer.h>
 
@@ -85,11 +86,72 @@ static char *test_buffer_list_clone(void *context)
 }
 
 
+static char *test_buffer_size_classes(void *context)
+{
+    qd_buffer_t *buf  = qd_buffer();
+    size_t       base = qd_buffer_capacity(buf);
+    qd_buffer_free(buf);
+
+    buf = qd_buffer_sized(0);
+    if (qd_buffer_capacity(buf) != base) return "Expected the smallest class";
+    qd_buffer_free(buf);
+    buf = qd_buffer_sized(base * 8 - 1);
+    if (qd_buffer_capacity(buf) != base) return "Expected a small buffer";
+    qd_buffer_free(buf);
+    buf = qd_buffer_sized(base * 8);
+    if (qd_buffer_capacity(buf) != base * 8) return "Expected a medium buffer";
+    qd_buffer_free(buf);
+    buf = qd_buffer_sized(base * 1000);
+    if (qd_buffer_capacity(buf) != base * 128) return "Expected a large buffer";
+    qd_buffer_free(buf);
+
+    //
+    // Build a chain that alternates between the classes and make sure it clones intact.
+    //
+    size_t         length = base * 140;
+    unsigned char *data   = (unsigned char*) malloc(length);
+    for (size_t i = 0; i < length; i++)
+        data[i] = (unsigned char) (i * 7);
+
+    qd_buffer_list_t list;
+    DEQ_INIT(list);
+    size_t classes[3] = {base, base * 8, base * 128};
+    size_t offset     = 0;
+    int    idx        = 0;
+    char  *error      = 0;
+    while (offset < length) {
+        int c = idx++ % 3;
+        buf = qd_buffer_sized(classes[c]);
+        if (!error && qd_buffer_capacity(buf) != classes[c])
+            error = "Chain buffer has the wrong size class";
+        size_t count = qd_buffer_capacity(buf);
+        if (count > length - offset) count = length - offset;
+        memcpy(qd_buffer_cursor(buf), data + offset, count);
+        qd_buffer_insert(buf, count);
+        DEQ_INSERT_TAIL(list, buf);
+        offset += count;
+    }
+
+    qd_buffer_list_t copy;
+    size_t           copied = qd_buffer_list_clone(&copy, &list);
+    if (!error && copied != length)
+        error = "Clone length mismatch";
+    if (!error && (!compare_buffer(&list, data, length) || !compare_buffer(&copy, data, length)))
+        error = "Mixed buffer list corrupted";
+
+    qd_buffer_list_free_buffers(&list);
+    qd_buffer_list_free_buffers(&copy);
+    free(data);
+    return error;
+}
+
+
 int buffer_tests()
 {
     int result = 0;
 
     TEST_CASE(test_buffer_list_clone, 0);
+    TEST_CASE(test_buffer_size_classes, 0);
 
     return result;
 }
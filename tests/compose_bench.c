@@ -0,0 +1,145 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Annotation-composing benchmark.  For each message, extends the trace of a parsed
+// annotations map with this router's id and composes the outgoing annotations section,
+// either re-encoding every value ("encode") or splicing pre-encoded fragments and the
+// incoming trace items ("splice").  Not run as part of the test suite.
+//
+//   usage: compose_bench [messages [encode|splice]]
+//
+
+#include "alloc.h"
+#include "bench.h"
+#include <qpid/dispatch/amqp.h>
+#include <qpid/dispatch/buffer.h>
+#include <qpid/dispatch/compose.h>
+#include <qpid/dispatch/parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *node_id = "0/Router.D";
+
+
+static void compose_encode(qd_parsed_field_t *trace, qd_buffer_list_t *out)
+{
+    qd_composed_field_t *field = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
+    qd_compose_start_map(field);
+
+    qd_compose_insert_symbol(field, QD_MA_TRACE);
+    qd_compose_start_list(field);
+    uint32_t idx = 0;
+    qd_parsed_field_t *trace_item = qd_parse_sub_value(trace, idx);
+    while (trace_item) {
+        qd_compose_insert_string_iterator(field, qd_parse_raw(trace_item));
+        trace_item = qd_parse_sub_value(trace, ++idx);
+    }
+    qd_compose_insert_string(field, node_id);
+    qd_compose_end_list(field);
+
+    qd_compose_insert_symbol(field, QD_MA_INGRESS);
+    qd_compose_insert_string(field, node_id);
+    qd_compose_insert_symbol(field, QD_MA_PHASE);
+    qd_compose_insert_int(field, 1);
+
+    qd_compose_end_map(field);
+    qd_compose_take_buffers(field, out);
+    qd_compose_free(field);
+}
+
+
+static void compose_splice(qd_parsed_field_t *trace, const qd_composed_fragment_t *node, qd_buffer_list_t *out)
+{
+    qd_composed_field_t *field = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
+    qd_compose_start_map(field);
+
+    qd_compose_insert_fragment(field, &QD_MA_TRACE_KEY);
+    qd_compose_start_list(field);
+    qd_compose_insert_encoded_iterator(field, qd_parse_raw(trace), qd_parse_sub_count(trace));
+    qd_compose_insert_fragment(field, node);
+    qd_compose_end_list(field);
+
+    qd_compose_insert_fragment(field, &QD_MA_INGRESS_KEY);
+    qd_compose_insert_fragment(field, node);
+    qd_compose_insert_fragment(field, &QD_MA_PHASE_KEY);
+    qd_compose_insert_int(field, 1);
+
+    qd_compose_end_map(field);
+    qd_compose_take_buffers(field, out);
+    qd_compose_free(field);
+}
+
+
+int main(int argc, char **argv)
+{
+    int  message_count = bench_int_arg(argc, argv, 1, 1000000);
+    bool splice        = argc <= 2 || strcmp(argv[2], "encode") != 0;
+
+    if (message_count < 1 || (argc > 2 && strcmp(argv[2], "encode") && strcmp(argv[2], "splice")))
+        return bench_usage(argv, "[messages [encode|splice]]");
+
+    qd_alloc_initialize();
+
+    //
+    // The incoming trace, as it would be parsed from the message annotations.
+    //
+    qd_composed_field_t *field = qd_compose_subfield(0);
+    qd_compose_start_list(field);
+    qd_compose_insert_string(field, "0/Router.A");
+    qd_compose_insert_string(field, "0/Router.B");
+    qd_compose_insert_string(field, "0/Router.C");
+    qd_compose_end_list(field);
+
+    qd_buffer_list_t trace_buffers;
+    qd_compose_take_buffers(field, &trace_buffers);
+    qd_compose_free(field);
+
+    qd_iterator_t *iter = qd_iterator_buffer(DEQ_HEAD(trace_buffers), 0,
+                                             qd_buffer_list_length(&trace_buffers), ITER_VIEW_ALL);
+    qd_parsed_field_t *trace = qd_parse(iter);
+
+    qd_composed_fragment_t node;
+    field = qd_compose_subfield(0);
+    qd_compose_insert_string(field, node_id);
+    qd_compose_take_fragment(field, &node);
+    qd_compose_free(field);
+
+    double start = bench_now();
+    for (int i = 0; i < message_count; i++) {
+        qd_buffer_list_t out;
+        if (splice)
+            compose_splice(trace, &node, &out);
+        else
+            compose_encode(trace, &out);
+        qd_buffer_list_free_buffers(&out);
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%s: %d messages in %.3f s, %.0f ns/message\n", splice ? "splice" : "encode",
+           message_count, elapsed, elapsed * 1e9 / message_count);
+
+    qd_compose_free_fragment(&node);
+    qd_parse_free(trace);
+    qd_iterator_free(iter);
+    qd_buffer_list_free_buffers(&trace_buffers);
+    qd_alloc_finalize();
+    return 0;
+}
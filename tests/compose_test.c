@@ -339,6 +339,108 @@ static char *test_compose_subfields(void *context)
 }
 
 
+static char *check_encoding(qd_composed_field_t *field, const char *expected, int expected_length)
+{
+    qd_buffer_list_t list;
+    qd_compose_take_buffers(field, &list);
+    qd_compose_free(field);
+
+    char *result = 0;
+    if (qd_buffer_list_length(&list) != expected_length)
+        result = "Improper encoded length";
+    else {
+        const unsigned char *src = (const unsigned char*) expected;
+        qd_buffer_t *buf = DEQ_HEAD(list);
+        while (buf && !result) {
+            unsigned char *c = qd_buffer_base(buf);
+            while (c != (qd_buffer_base(buf) + qd_buffer_size(buf))) {
+                if (*c != *src) {
+                    result = "Pattern Mismatch";
+                    break;
+                }
+                c++;
+                src++;
+            }
+            buf = DEQ_NEXT(buf);
+        }
+    }
+
+    qd_buffer_list_free_buffers(&list);
+    return result;
+}
+
+
+// verify that splicing pre-encoded fragments matches composing the same values
+static char *test_compose_fragments(void *context)
+{
+    static const struct {
+        const qd_composed_fragment_t *fragment;
+        const char * const           *symbol;
+    } keys[] = {
+        {&QD_MA_INGRESS_KEY, &QD_MA_INGRESS},
+        {&QD_MA_TRACE_KEY,   &QD_MA_TRACE},
+        {&QD_MA_TO_KEY,      &QD_MA_TO},
+        {&QD_MA_PHASE_KEY,   &QD_MA_PHASE},
+    };
+
+    for (int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        qd_composed_field_t *field = qd_compose_subfield(0);
+        qd_compose_insert_symbol(field, *keys[i].symbol);
+        char *result = check_encoding(field, (const char*) keys[i].fragment->encoded, keys[i].fragment->length);
+        if (result)
+            return result;
+    }
+
+    //
+    // Compose a trace list, then extend it by splicing its items and a fragment.
+    //
+    qd_composed_fragment_t node;
+    qd_composed_field_t   *field = qd_compose_subfield(0);
+    qd_compose_insert_string(field, "0/Router.C");
+    qd_compose_take_fragment(field, &node);
+    qd_compose_free(field);
+    if (node.length != 12)
+        return "Improper fragment length";
+
+    field = qd_compose_subfield(0);
+    qd_compose_start_list(field);
+    qd_compose_insert_string(field, "0/Router.A");
+    qd_compose_insert_string(field, "0/Router.B");
+    qd_compose_end_list(field);
+
+    qd_buffer_list_t list;
+    qd_compose_take_buffers(field, &list);
+    qd_compose_free(field);
+
+    qd_iterator_t     *iter  = qd_iterator_buffer(DEQ_HEAD(list), 0, qd_buffer_list_length(&list), ITER_VIEW_ALL);
+    qd_parsed_field_t *trace = qd_parse(iter);
+
+    field = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
+    qd_compose_start_map(field);
+    qd_compose_insert_fragment(field, &QD_MA_TRACE_KEY);
+    qd_compose_start_list(field);
+    qd_compose_insert_encoded_iterator(field, qd_parse_raw(trace), qd_parse_sub_count(trace));
+    qd_compose_insert_fragment(field, &node);
+    qd_compose_end_list(field);
+    qd_compose_end_map(field);
+
+    qd_parse_free(trace);
+    qd_iterator_free(iter);
+    qd_buffer_list_free_buffers(&list);
+    qd_compose_free_fragment(&node);
+
+    return check_encoding(field,
+                          "\x00\x53\x72"                          // message annotations
+                          "\xd1\x00\x00\x00\x41\x00\x00\x00\x02"  // map32, 65 bytes, 2 fields
+                          "\xa3\x0ex-opt-qd.trace"                // sym8
+                          "\xd0\x00\x00\x00\x28\x00\x00\x00\x03"  // list32, 40 bytes, 3 items
+                          "\xa1\x0a" "0/Router.A"                 // str8
+                          "\xa1\x0a" "0/Router.B"                 // str8
+                          "\xa1\x0a" "0/Router.C",                // str8
+                          73);
+}
+
+
 int compose_tests()
 {
     int result = 0;
@@ -347,6 +449,7 @@ int compose_tests()
     TEST_CASE(test_compose_nested_composites, 0);
     TEST_CASE(test_compose_scalars, 0);
     TEST_CASE(test_compose_subfields, 0);
+    TEST_CASE(test_compose_fragments, 0);
 
     return result;
 }
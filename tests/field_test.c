@@ -923,6 +923,151 @@ static char *test_prefix_hash_with_space(void *context)
 }
 
 
+static char *test_hash_growth(void *context)
+{
+    static char    error[200];
+    const int      count = 5000;
+    char           key[100];
+    qd_hash_handle_t *handles[5000];
+
+    //
+    // Start small so that the table grows several times, with short (inline) and long keys.
+    //
+    qd_hash_t *hash = qd_hash(3, 1, 0);
+
+    for (long idx = 0; idx < count; idx++) {
+        snprintf(key, sizeof(key), idx % 3 ? "M0addr.%ld" : "M0a.much.longer.address.that.is.not.stored.inline.%ld", idx);
+        qd_iterator_t *iter = qd_iterator_string(key, ITER_VIEW_ALL);
+        qd_error_t     err  = qd_hash_insert(hash, iter, (void*) (idx + 1), &handles[idx]);
+        qd_iterator_free(iter);
+        if (err != QD_ERROR_NONE) {
+            snprintf(error, 200, "Insert of '%s' failed", key);
+            return error;
+        }
+
+        //
+        // Remove every fourth key as the table grows.
+        //
+        if (idx % 4 == 3) {
+            qd_hash_remove_by_handle(hash, handles[idx - 1]);
+            qd_hash_handle_free(handles[idx - 1]);
+            handles[idx - 1] = 0;
+        }
+    }
+
+    if (qd_hash_size(hash) != count - count / 4)
+        return "Unexpected hash size after inserts";
+
+    for (long idx = 0; idx < count; idx++) {
+        snprintf(key, sizeof(key), idx % 3 ? "M0addr.%ld" : "M0a.much.longer.address.that.is.not.stored.inline.%ld", idx);
+        qd_iterator_t *iter = qd_iterator_string(key, ITER_VIEW_ALL);
+        void *val;
+        qd_hash_retrieve(hash, iter, &val);
+        qd_iterator_free(iter);
+
+        long expected = handles[idx] ? idx + 1 : 0;
+        if ((long) val != expected) {
+            snprintf(error, 200, "Key '%s': expected %ld, got %ld", key, expected, (long) val);
+            return error;
+        }
+        if (handles[idx] && strcmp((const char*) qd_hash_key_by_handle(handles[idx]), key) != 0) {
+            snprintf(error, 200, "Key by handle for '%s' is wrong", key);
+            return error;
+        }
+    }
+
+    for (long idx = 0; idx < count; idx++) {
+        if (handles[idx]) {
+            qd_hash_remove_by_handle(hash, handles[idx]);
+            qd_hash_handle_free(handles[idx]);
+        }
+    }
+
+    if (qd_hash_size(hash) != 0)
+        return "Expected empty hash after removes";
+
+    qd_hash_free(hash);
+    return 0;
+}
+
+
+static char *test_hash_view_cache(void *context)
+{
+    //
+    // The hash of a view is cached in the iterator.  Check that it follows changes to the view
+    // and agrees with the hash of the same text in another iterator.
+    //
+    qd_iterator_t *iter  = qd_iterator_string("amqp:/mobile.address", ITER_VIEW_ADDRESS_HASH);
+    qd_iterator_t *other = qd_iterator_string("M1mobile.address", ITER_VIEW_ALL);
+
+    uint32_t hash = qd_iterator_hash_view(iter);
+    if (qd_iterator_hash_view(iter) != hash)
+        return "Repeated hash differs";
+
+    qd_iterator_annotate_phase(iter, '1');
+    if (qd_iterator_hash_view(iter) == hash)
+        return "Hash not updated for the new phase";
+    if (qd_iterator_hash_view(iter) != qd_iterator_hash_view(other))
+        return "Hash differs from that of the same text";
+    if (!qd_iterator_equal(iter, (const unsigned char*) "M1mobile.address"))
+        return "View does not match after hashing";
+
+    qd_iterator_annotate_space(iter, "space.", 6);
+    if (qd_iterator_hash_view(iter) == qd_iterator_hash_view(other))
+        return "Hash not updated for the new space";
+
+    qd_iterator_free(iter);
+    qd_iterator_free(other);
+    return 0;
+}
+
+
+static char *test_equal_annotated_near_miss(void *context)
+{
+    //
+    // Strings that differ from an annotated view in one octet, or that drop or add one, must
+    // not compare equal to it, wherever that octet falls relative to the annotation.
+    //
+    struct {const char *addr; const char *space; char phase; const char *equal; const char *differ;} cases[] = {
+    {"1abc",        0,    '0', "M01abc",      "M1abc"},
+    {"1abc",        0,    '0', "M01abc",      "M0abc"},
+    {"1abc",        0,    '0', "M01abc",      "M01ab"},
+    {"1abc",        0,    '0', "M01abc",      "M01abcd"},
+    {"abc",         0,    '1', "M1abc",       "Mabc"},
+    {"abc",         0,    '1', "M1abc",       "M0abc"},
+    {"abc",         "ns/", '0', "M0ns/abc",   "M0nsabc"},
+    {"abc",         "ns/", '0', "M0ns/abc",   "M0ns/bc"},
+    {"abc",         "ns/", '0', "M0ns/abc",   "M0ns/"},
+    {"_local/abc",  0,    '0', "Labc",        "Lbc"},
+    {"_local/abc",  0,    '0', "Labc",        "Labcd"},
+    {0, 0, 0, 0, 0}
+    };
+    int idx;
+
+    for (idx = 0; cases[idx].addr; idx++) {
+        qd_iterator_t *iter = qd_iterator_string(cases[idx].addr, ITER_VIEW_ADDRESS_HASH);
+        qd_iterator_annotate_phase(iter, cases[idx].phase);
+        if (cases[idx].space)
+            qd_iterator_annotate_space(iter, cases[idx].space, strlen(cases[idx].space));
+
+        char *error = 0;
+        if (!qd_iterator_equal(iter, (const unsigned char*) cases[idx].equal))
+            error = "does not equal";
+        else if (qd_iterator_equal(iter, (const unsigned char*) cases[idx].differ))
+            error = "equals";
+        qd_iterator_free(iter);
+
+        if (error) {
+            snprintf(fail_text, FAIL_TEXT_SIZE, "Addr '%s' %s '%s'", cases[idx].addr, error,
+                     error[0] == 'd' ? cases[idx].equal : cases[idx].differ);
+            return fail_text;
+        }
+    }
+
+    return 0;
+}
+
+
 int field_tests(void)
 {
     int result = 0;
@@ -953,6 +1098,9 @@ int field_tests(void)
     TEST_CASE(test_qd_hash_retrieve_prefix_separator_exact_match_dot_at_end_1, 0);
     TEST_CASE(test_prefix_hash, 0);
     TEST_CASE(test_prefix_hash_with_space, 0);
+    TEST_CASE(test_hash_growth, 0);
+    TEST_CASE(test_hash_view_cache, 0);
+    TEST_CASE(test_equal_annotated_near_miss, 0);
 
     return result;
 }
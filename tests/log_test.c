@@ -0,0 +1,146 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "test_case.h"
+#include "log_private.h"
+#include <qpid/dispatch/threading.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ORDER_COUNT 200
+
+static qd_log_source_t *log_source;
+static sys_mutex_t     *turn_lock;
+static sys_cond_t      *turn_cond;
+static int              turn;
+
+
+static void free_text(char **text, int count)
+{
+    for (int i = 0; i < count; i++)
+        free(text[i]);
+}
+
+
+static char* test_ring_overflow(void *context)
+{
+    static char *text[QD_LOG_RING_SIZE];
+    char        *result  = 0;
+
+    //
+    // Create this thread's ring, then hold the writer with the ring drained so that the
+    // ring fills up.
+    //
+    qd_log(log_source, QD_LOG_INFO, "start");
+    qd_log_hold(true);
+    free_text(text, qd_log_recent_text("LOG_TEST", text, QD_LOG_RING_SIZE));
+
+    uint64_t dropped = qd_log_dropped(log_source);
+    for (int i = 0; i < QD_LOG_RING_SIZE + 10; i++)
+        qd_log(log_source, QD_LOG_INFO, "overflow %d", i);
+    if (qd_log_dropped(log_source) - dropped != 10)
+        result = "Expected the entries beyond the ring to be dropped";
+    qd_log_hold(false);
+
+    //
+    // The entries that fit are kept, up to the size of the recent buffer.
+    //
+    int count = qd_log_recent_text("LOG_TEST", text, QD_LOG_RING_SIZE);
+    int last  = -1;
+    if (!result && (count < 1 || sscanf(text[count - 1], "overflow %d", &last) != 1 || last != QD_LOG_RING_SIZE - 1))
+        result = "Expected the last entry that fit in the ring to be kept";
+    for (int i = 1; !result && i < count; i++) {
+        int prev, seq;
+        if (sscanf(text[i - 1], "overflow %d", &prev) != 1 || sscanf(text[i], "overflow %d", &seq) != 1 ||
+            seq != prev + 1)
+            result = "Kept entries are out of sequence";
+    }
+    free_text(text, count);
+    return result;
+}
+
+
+//
+// Log every other entry, taking turns with the other thread.
+//
+static void *order_thread(void *context)
+{
+    int parity = (int) (long) context;
+
+    for (int i = parity; i < ORDER_COUNT; i += 2) {
+        sys_mutex_lock(turn_lock);
+        while (turn != i)
+            sys_cond_wait(turn_cond, turn_lock);
+        qd_log(log_source, QD_LOG_INFO, "order %d", i);
+        turn++;
+        sys_cond_signal_all(turn_cond);
+        sys_mutex_unlock(turn_lock);
+    }
+    return 0;
+}
+
+
+static char* test_ring_order(void *context)
+{
+    static char *text[ORDER_COUNT];
+    char        *result = 0;
+
+    //
+    // With the writer held, the entries of both threads wait on separate rings and must
+    // be merged in the order they were logged.
+    //
+    qd_log_hold(true);
+    turn = 0;
+    sys_thread_t *even = sys_thread(order_thread, (void*) 0);
+    sys_thread_t *odd  = sys_thread(order_thread, (void*) 1);
+    sys_thread_join(even);
+    sys_thread_join(odd);
+    sys_thread_free(even);
+    sys_thread_free(odd);
+    qd_log_hold(false);
+
+    int count = qd_log_recent_text("LOG_TEST", text, ORDER_COUNT);
+    if (count != ORDER_COUNT)
+        result = "Expected every entry of both threads";
+    for (int i = 0; !result && i < count; i++) {
+        int seq;
+        if (sscanf(text[i], "order %d", &seq) != 1 || seq != i)
+            result = "Entries of different threads were written out of order";
+    }
+    free_text(text, count);
+    return result;
+}
+
+
+int log_tests(void)
+{
+    int result = 0;
+
+    log_source = qd_log_source("LOG_TEST");
+    turn_lock  = sys_mutex();
+    turn_cond  = sys_cond();
+
+    TEST_CASE(test_ring_overflow, 0);
+    TEST_CASE(test_ring_order, 0);
+
+    sys_cond_free(turn_cond);
+    sys_mutex_free(turn_lock);
+    return result;
+}
@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Message-rate benchmark.  Each thread repeatedly builds a message, makes one copy per
+// outgoing link, checks every copy through the body as the forwarder does, and frees
+// them all.  Not run as part of the test suite.
+//
+//   usage: message_bench [messages-per-thread [threads [fanout]]]
+//
+
+#include "alloc.h"
+#include "bench.h"
+#include "message_private.h"
+#include <qpid/dispatch/amqp.h>
+#include <qpid/dispatch/buffer.h>
+#include <qpid/dispatch/compose.h>
+#include <qpid/dispatch/message.h>
+#include <qpid/dispatch/threading.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_FANOUT 64
+
+static int message_count = 1000000;
+static int fanout        = 1;
+
+
+static void *bench_thread(void *context)
+{
+    static const uint8_t payload[64] = {0};
+    qd_message_t *copies[MAX_FANOUT];
+
+    for (int i = 0; i < message_count; i++) {
+        qd_buffer_list_t     body;
+        qd_composed_field_t *field = qd_compose(QD_PERFORMATIVE_BODY_DATA, 0);
+        qd_compose_insert_binary(field, payload, sizeof(payload));
+        DEQ_INIT(body);
+        qd_compose_take_buffers(field, &body);
+        qd_compose_free(field);
+
+        qd_message_t *msg = qd_message();
+        qd_message_compose_1(msg, "bench/address", &body);
+        qd_message_check_depth(msg, QD_DEPTH_MESSAGE_ANNOTATIONS);
+
+        for (int j = 0; j < fanout; j++) {
+            copies[j] = qd_message_copy(msg);
+            qd_message_check_depth(copies[j], QD_DEPTH_BODY);
+        }
+        for (int j = 0; j < fanout; j++)
+            qd_message_free(copies[j]);
+        qd_message_free(msg);
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    int thread_count = 1;
+
+    message_count = bench_int_arg(argc, argv, 1, message_count);
+    thread_count  = bench_int_arg(argc, argv, 2, thread_count);
+    fanout        = bench_int_arg(argc, argv, 3, fanout);
+    if (message_count < 1 || thread_count < 1 || fanout < 0 || fanout > MAX_FANOUT)
+        return bench_usage(argv, "[messages-per-thread [threads [fanout]]]");
+
+    qd_alloc_initialize();
+
+    sys_thread_t **threads = (sys_thread_t**) calloc(thread_count, sizeof(sys_thread_t*));
+    double start = bench_now();
+    for (int i = 0; i < thread_count; i++)
+        threads[i] = sys_thread(bench_thread, 0);
+    for (int i = 0; i < thread_count; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+    double elapsed = bench_now() - start;
+    free(threads);
+
+    double total = (double) message_count * thread_count;
+    printf("%d thread(s), fanout %d: %.0f messages in %.3f s, %.0f msg/s\n",
+           thread_count, fanout, total, elapsed, total / elapsed);
+
+    qd_message_finalize();
+    qd_alloc_finalize();
+    return 0;
+}
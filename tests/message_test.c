@@ -61,6 +61,26 @@ static void set_content(qd_message_content_t *content, size_t len)
 }
 
 
+// append the next 'len' octets of the encoded message to content, as a receiver would
+static void append_content(qd_message_content_t *content, size_t offset, size_t len)
+{
+    while (len > 0) {
+        qd_buffer_t *buf = DEQ_TAIL(content->buffers);
+        if (!buf || qd_buffer_capacity(buf) == 0) {
+            buf = qd_buffer();
+            DEQ_INSERT_TAIL(content->buffers, buf);
+        }
+        size_t segment = qd_buffer_capacity(buf);
+        if (segment > len)
+            segment = len;
+        memcpy(qd_buffer_cursor(buf), buffer + offset, segment);
+        qd_buffer_insert(buf, segment);
+        offset += segment;
+        len    -= segment;
+    }
+}
+
+
 static char* test_send_to_messenger(void *context)
 {
     qd_message_t         *msg     = qd_message();
@@ -212,6 +232,60 @@ static char* test_check_multiple(void *context)
 }
 
 
+static char* test_check_partial(void *context)
+{
+    pn_message_t *pn_msg = pn_message();
+    pn_message_set_address(pn_msg, "test_addr_3");
+    pn_data_put_string(pn_message_body(pn_msg), pn_bytes(11, "test_body_3"));
+
+    size_t size = 10000;
+    int result = pn_message_encode(pn_msg, buffer, &size);
+    pn_message_free(pn_msg);
+    if (result != 0) return "Error in pn_message_encode";
+
+    qd_message_t         *msg     = qd_message();
+    qd_message_content_t *content = MSG_CONTENT(msg);
+    content->receive_complete = false;
+
+    if (qd_message_check_depth(msg, QD_DEPTH_PROPERTIES) != QD_MESSAGE_DEPTH_INCOMPLETE)
+        return "Expected INCOMPLETE for a message with no content";
+
+    //
+    // Deliver the message one octet at a time.  The check must never report the partial
+    // message as invalid and, once the properties are OK, must stay OK.
+    //
+    bool properties_ok = false;
+    for (size_t offset = 0; offset < size; offset++) {
+        append_content(content, offset, 1);
+        qd_message_depth_status_t status = qd_message_check_depth(msg, QD_DEPTH_PROPERTIES);
+        if (status == QD_MESSAGE_DEPTH_INVALID)
+            return "Partial message reported as invalid";
+        if (properties_ok && status != QD_MESSAGE_DEPTH_OK)
+            return "Properties no longer OK after more data arrived";
+        if (status == QD_MESSAGE_DEPTH_OK)
+            properties_ok = true;
+    }
+
+    if (!properties_ok) return "Properties never reported OK";
+    if (qd_message_check_depth(msg, QD_DEPTH_ALL) != QD_MESSAGE_DEPTH_INCOMPLETE)
+        return "Expected INCOMPLETE for the whole message before the end was signalled";
+
+    content->receive_complete = true;
+    if (qd_message_check_depth(msg, QD_DEPTH_ALL) != QD_MESSAGE_DEPTH_OK)
+        return "Expected OK for the completed message";
+
+    qd_iterator_t *iter = qd_message_field_iterator(msg, QD_FIELD_TO);
+    if (iter == 0) return "Expected an iterator for the 'to' field";
+    if (!qd_iterator_equal(iter, (unsigned char*) "test_addr_3"))
+        return "Mismatched 'to' field contents";
+    qd_iterator_free(iter);
+
+    qd_message_free(msg);
+
+    return 0;
+}
+
+
 static char* test_send_message_annotations(void *context)
 {
     qd_message_t         *msg     = qd_message();
@@ -292,6 +366,7 @@ int message_tests(void)
     TEST_CASE(test_receive_from_messenger, 0);
     TEST_CASE(test_message_properties, 0);
     TEST_CASE(test_check_multiple, 0);
+    TEST_CASE(test_check_partial, 0);
     TEST_CASE(test_send_message_annotations, 0);
 
     return result;
@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Annotation-parsing benchmark.  Repeatedly parses a message-annotations map like the
+// ones routers exchange, looks up the router annotations as the forwarder does, and
+// frees the parse tree.  Not run as part of the test suite.
+//
+//   usage: parse_bench [iterations]
+//
+
+#include "alloc.h"
+#include "bench.h"
+#include <qpid/dispatch/amqp.h>
+#include <qpid/dispatch/buffer.h>
+#include <qpid/dispatch/compose.h>
+#include <qpid/dispatch/parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main(int argc, char **argv)
+{
+    int iterations = bench_int_arg(argc, argv, 1, 1000000);
+    if (iterations < 1)
+        return bench_usage(argv, "[iterations]");
+
+    qd_alloc_initialize();
+
+    qd_composed_field_t *field = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
+    qd_compose_start_map(field);
+    qd_compose_insert_symbol(field, "x-opt-custom");
+    qd_compose_insert_string(field, "custom-value");
+    qd_compose_insert_symbol(field, QD_MA_INGRESS);
+    qd_compose_insert_string(field, "0/Router.A");
+    qd_compose_insert_symbol(field, QD_MA_TRACE);
+    qd_compose_start_list(field);
+    qd_compose_insert_string(field, "0/Router.A");
+    qd_compose_insert_string(field, "0/Router.B");
+    qd_compose_insert_string(field, "0/Router.C");
+    qd_compose_end_list(field);
+    qd_compose_insert_symbol(field, QD_MA_TO);
+    qd_compose_insert_string(field, "bench/address");
+    qd_compose_insert_symbol(field, QD_MA_PHASE);
+    qd_compose_insert_int(field, 1);
+    qd_compose_end_map(field);
+
+    qd_buffer_list_t buffers;
+    DEQ_INIT(buffers);
+    qd_compose_take_buffers(field, &buffers);
+    qd_compose_free(field);
+
+    //
+    // Skip the section descriptor, as the message code does.
+    //
+    int          length = 0;
+    qd_buffer_t *buf    = DEQ_HEAD(buffers);
+    while (buf) {
+        length += qd_buffer_size(buf);
+        buf = DEQ_NEXT(buf);
+    }
+    qd_iterator_t *iter = qd_iterator_buffer(DEQ_HEAD(buffers), 3, length - 3, ITER_VIEW_ALL);
+
+    int    found = 0;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        qd_iterator_reset(iter);
+        qd_parsed_field_t *ma = qd_parse(iter);
+        found += !!qd_parse_ma_value(ma, QD_MA_KEY_TRACE);
+        found += !!qd_parse_ma_value(ma, QD_MA_KEY_INGRESS);
+        found += !!qd_parse_ma_value(ma, QD_MA_KEY_TO);
+        found += !!qd_parse_ma_value(ma, QD_MA_KEY_PHASE);
+        qd_parse_free(ma);
+    }
+    double elapsed = bench_now() - start;
+
+    if (found != 4 * iterations) {
+        fprintf(stderr, "annotation lookup failed\n");
+        return 1;
+    }
+
+    printf("%d parses in %.3f s, %.0f ns/parse\n", iterations, elapsed, elapsed * 1e9 / iterations);
+
+    qd_iterator_free(iter);
+    qd_buffer_list_free_buffers(&buffers);
+    qd_alloc_finalize();
+    return 0;
+}
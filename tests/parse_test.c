@@ -318,6 +318,91 @@ static char *test_tracemask(void *context)
 }
 
 
+static char *test_router_annotations(void *context)
+{
+    static char      error[1024];
+    qd_buffer_list_t list;
+
+    qd_composed_field_t *comp = qd_compose_subfield(0);
+    qd_compose_start_map(comp);
+    qd_compose_insert_symbol(comp, "custom");
+    qd_compose_insert_string(comp, "custom-value");
+    qd_compose_insert_symbol(comp, QD_MA_TO);
+    qd_compose_insert_string(comp, "to/address");
+    qd_compose_insert_symbol(comp, QD_MA_TRACE);
+    qd_compose_start_list(comp);
+    qd_compose_insert_string(comp, "0/Router.A");
+    qd_compose_insert_string(comp, "0/Router.B");
+    qd_compose_end_list(comp);
+    qd_compose_insert_symbol(comp, "x-opt-qd.other");
+    qd_compose_insert_uint(comp, 1);
+    qd_compose_insert_symbol(comp, "x-opt-qd.tox");
+    qd_compose_insert_uint(comp, 2);
+    qd_compose_insert_symbol(comp, QD_MA_PHASE);
+    qd_compose_insert_int(comp, 7);
+    qd_compose_insert_symbol(comp, QD_MA_TO);
+    qd_compose_insert_string(comp, "second/to");
+    for (int i = 0; i < 20; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        qd_compose_insert_symbol(comp, key);
+        qd_compose_insert_int(comp, i);
+    }
+    qd_compose_end_map(comp);
+
+    DEQ_INIT(list);
+    qd_compose_take_buffers(comp, &list);
+    qd_compose_free(comp);
+    int length = 0;
+    qd_buffer_t *buf = DEQ_HEAD(list);
+    while (buf) {
+        length += qd_buffer_size(buf);
+        buf = DEQ_NEXT(buf);
+    }
+
+    qd_iterator_t     *iter = qd_iterator_buffer(DEQ_HEAD(list), 0, length, ITER_VIEW_ALL);
+    qd_parsed_field_t *pf   = qd_parse(iter);
+    char              *result = 0;
+
+    if (!qd_parse_ok(pf)) {
+        snprintf(error, sizeof(error), "Parse failed: %s", qd_parse_error(pf));
+        result = error;
+    } else if (qd_parse_sub_count(pf) != 27) {
+        snprintf(error, sizeof(error), "Expected sub-count==27, got %"PRIu32, qd_parse_sub_count(pf));
+        result = error;
+    } else if (qd_parse_ma_value(pf, QD_MA_KEY_INGRESS) != 0)
+        result = "Unexpected ingress annotation";
+    else if (!qd_parse_ma_value(pf, QD_MA_KEY_TO) ||
+             !qd_iterator_equal(qd_parse_raw(qd_parse_ma_value(pf, QD_MA_KEY_TO)), (const unsigned char*) "second/to"))
+        result = "Repeated to annotation did not take the last value";
+    else if (!qd_parse_ma_value(pf, QD_MA_KEY_TRACE) || qd_parse_sub_count(qd_parse_ma_value(pf, QD_MA_KEY_TRACE)) != 2)
+        result = "Incorrect trace annotation";
+    else if (!qd_parse_ma_value(pf, QD_MA_KEY_PHASE) || qd_parse_as_int(qd_parse_ma_value(pf, QD_MA_KEY_PHASE)) != 7)
+        result = "Incorrect phase annotation";
+    else if (qd_parse_is_router_annotation(qd_parse_sub_key(pf, 0)))
+        result = "custom key classified as a router annotation";
+    else if (!qd_parse_is_router_annotation(qd_parse_sub_key(pf, 3)) ||
+             !qd_parse_is_router_annotation(qd_parse_sub_key(pf, 4)))
+        result = "x-opt-qd. key not classified as a router annotation";
+    else if (qd_parse_as_int(qd_parse_sub_value(pf, 26)) != 19)
+        result = "Incorrect value for the last key";
+
+    if (!result) {
+        qd_parsed_field_t *dup = qd_parse_dup(pf);
+        if (!qd_parse_ma_value(dup, QD_MA_KEY_TRACE) ||
+            !qd_iterator_equal(qd_parse_raw(qd_parse_sub_value(qd_parse_ma_value(dup, QD_MA_KEY_TRACE), 1)),
+                               (const unsigned char*) "0/Router.B"))
+            result = "Incorrect trace annotation in duplicate";
+        qd_parse_free(dup);
+    }
+
+    qd_parse_free(pf);
+    qd_iterator_free(iter);
+    qd_buffer_list_free_buffers(&list);
+    return result;
+}
+
+
 int parse_tests()
 {
     int result = 0;
@@ -326,6 +411,7 @@ int parse_tests()
     TEST_CASE(test_map, 0);
     TEST_CASE(test_parser_errors, 0);
     TEST_CASE(test_tracemask, 0);
+    TEST_CASE(test_router_annotations, 0);
 
     return result;
 }
@@ -0,0 +1,304 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "test_case.h"
+#include <qpid/dispatch/router_core.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_NODES 32
+
+//
+// The routes reported by an engine, accumulated across calculations.
+//
+typedef struct {
+    int      next_hop[MAX_NODES];
+    int      cost[MAX_NODES];
+    uint64_t valid_origins[MAX_NODES];
+    bool     reported[MAX_NODES];
+} routes_t;
+
+static int  link_cost[MAX_NODES][MAX_NODES];
+static char node_id[MAX_NODES][8];
+
+
+static uint64_t mask_value(qd_bitmask_t *bm)
+{
+    uint64_t value = 0;
+    int      bit;
+    int      c;
+    for (QD_BITMASK_EACH(bm, bit, c))
+        value |= ((uint64_t) 1) << bit;
+    return value;
+}
+
+
+static void set_topology(int count, const int (*costs)[6])
+{
+    memset(link_cost, 0, sizeof(link_cost));
+    for (int i = 0; i < count; i++) {
+        sprintf(node_id[i], "R%d", i + 1);
+        for (int j = 0; j < count; j++)
+            link_cost[i][j] = costs[i][j];
+    }
+}
+
+
+static void push_link_state(qdr_path_engine_t *engine, int node, int count)
+{
+    int peers[MAX_NODES];
+    int costs[MAX_NODES];
+    int peer_count = 0;
+
+    for (int j = 0; j < count; j++)
+        if (link_cost[node][j]) {
+            peers[peer_count] = j;
+            costs[peer_count] = link_cost[node][j];
+            peer_count++;
+        }
+    qdr_path_set_link_state(engine, node, node_id[node], peer_count, peers, costs);
+}
+
+
+static void calculate(qdr_path_engine_t *engine, routes_t *routes)
+{
+    qdr_path_route_t *changed;
+    int               count = qdr_path_calculate(engine, &changed);
+
+    for (int i = 0; i < count; i++) {
+        int node = changed[i].router_maskbit;
+        routes->reported[node] = true;
+        if (changed[i].next_hop >= 0)
+            routes->next_hop[node] = changed[i].next_hop;
+        if (changed[i].cost >= 0)
+            routes->cost[node] = changed[i].cost;
+        if (changed[i].valid_origins)
+            routes->valid_origins[node] = mask_value(changed[i].valid_origins);
+    }
+}
+
+
+static void routes_init(routes_t *routes)
+{
+    for (int i = 0; i < MAX_NODES; i++) {
+        routes->next_hop[i]      = -1;
+        routes->cost[i]          = -1;
+        routes->valid_origins[i] = 0;
+        routes->reported[i]      = false;
+    }
+}
+
+
+//
+// Topologies from PathTest in router_engine_test.py.  R1 (mask bit 0) is the local
+// router unless stated otherwise.
+//
+//     +----+      +----+      +----+
+//     | R2 |------| R3 |------| R4 |
+//     +----+      +----+      +----+
+//                    |           |
+//                 +====+      +----+      +----+
+//                 | R1 |------| R5 |------| R6 |
+//                 +====+      +----+      +----+
+//
+static char* test_topology3(void *context)
+{
+    static const int costs[6][6] = {
+        {0, 0, 1, 0, 1, 0},
+        {0, 0, 1, 0, 0, 0},
+        {1, 1, 0, 1, 0, 0},
+        {0, 0, 1, 0, 1, 0},
+        {1, 0, 0, 1, 0, 1},
+        {0, 0, 0, 0, 1, 0}};
+    qdr_path_engine_t *engine = qdr_path_engine();
+    routes_t           routes;
+
+    set_topology(6, costs);
+    routes_init(&routes);
+    for (int i = 0; i < 6; i++)
+        push_link_state(engine, i, 6);
+    calculate(engine, &routes);
+
+    for (int i = 1; i < 6; i++)
+        if (!routes.reported[i]) return "Expected a route to every router";
+
+    // Neighbors (R3 and R5) are their own next hop and are not reported
+    if (routes.next_hop[1] != 2)  return "Expected R3 to be the next hop for R2";
+    if (routes.next_hop[2] != -1) return "Expected no next hop for neighbor R3";
+    if (routes.next_hop[3] != 2)  return "Expected R3 to be the next hop for R4";
+    if (routes.next_hop[4] != -1) return "Expected no next hop for neighbor R5";
+    if (routes.next_hop[5] != 4)  return "Expected R5 to be the next hop for R6";
+
+    if (routes.cost[1] != 2 || routes.cost[2] != 1 || routes.cost[5] != 2)
+        return "Unexpected cost";
+
+    if (routes.valid_origins[1] != 0x30) return "Expected R5 and R6 as valid origins for R2";
+    if (routes.valid_origins[2] != 0x30) return "Expected R5 and R6 as valid origins for R3";
+    if (routes.valid_origins[3] != 0)    return "Expected no valid origins for R4";
+    if (routes.valid_origins[4] != 0x06) return "Expected R2 and R3 as valid origins for R5";
+    if (routes.valid_origins[5] != 0x06) return "Expected R2 and R3 as valid origins for R6";
+
+    //
+    // Nothing changed, so nothing is reported.
+    //
+    qdr_path_route_t *changed;
+    if (qdr_path_calculate(engine, &changed) != 0) return "Expected no changes";
+
+    qdr_path_engine_free(engine);
+    return 0;
+}
+
+
+//
+//     +====+      +====+      +----+
+//     | R1 |--10--| R3 |--10--| R5 |
+//     +====+      +====+      +----+
+//        |           |           |
+//        1          10           1
+//        |           |           |
+//     +----+      +----+      +----+
+//     | R2 |--10--| R4 |--10--| R6 |
+//     +----+      +----+      +----+
+//
+static char* test_topology6(void *context)
+{
+    static const int costs[6][6] = {
+        {0,  1,  10, 0,  0,  0},
+        {1,  0,  0,  10, 0,  0},
+        {10, 0,  0,  10, 10, 0},
+        {0,  10, 10, 0,  0,  10},
+        {0,  0,  10, 0,  0,  1},
+        {0,  0,  0,  10, 1,  0}};
+    routes_t routes;
+
+    set_topology(6, costs);
+
+    //
+    // From R1, R6 is reached through R2.
+    //
+    qdr_path_engine_t *engine = qdr_path_engine();
+    routes_init(&routes);
+    for (int i = 0; i < 6; i++)
+        push_link_state(engine, i, 6);
+    calculate(engine, &routes);
+    if (routes.next_hop[5] != 1) return "Expected R2 to be the next hop for R6 from R1";
+    qdr_path_engine_free(engine);
+
+    //
+    // From R3 (swapped into mask bit 0), no origin reaches R6 through R3.
+    //
+    int swapped[6][6];
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 6; j++)
+            swapped[i == 0 ? 2 : i == 2 ? 0 : i][j == 0 ? 2 : j == 2 ? 0 : j] = costs[i][j];
+    set_topology(6, (const int (*)[6]) swapped);
+    strcpy(node_id[0], "R3");
+    strcpy(node_id[2], "R1");
+    engine = qdr_path_engine();
+    routes_init(&routes);
+    for (int i = 0; i < 6; i++)
+        push_link_state(engine, i, 6);
+    calculate(engine, &routes);
+    if (!routes.reported[5])          return "Expected a route to R6 from R3";
+    if (routes.valid_origins[5] != 0) return "Expected no valid origins for R6 from R3";
+    qdr_path_engine_free(engine);
+
+    return 0;
+}
+
+
+//
+// Flap links in a random mesh and check after every change that the routes
+// reported incrementally match those of a fresh engine.
+//
+static char* test_incremental(void *context)
+{
+    static char        error[100];
+    const int          count  = MAX_NODES;
+    uint32_t           seed   = 12345;
+    qdr_path_engine_t *engine = qdr_path_engine();
+    routes_t           routes;
+    routes_t           fresh_routes;
+
+#define NEXT_RANDOM(n) ((seed = seed * 1103515245 + 12345) >> 16) % (n)
+
+    memset(link_cost, 0, sizeof(link_cost));
+    for (int i = 0; i < count; i++) {
+        sprintf(node_id[i], "N%02d", (int) ((i * 7) % count));
+        for (int j = i + 1; j < count; j++)
+            if (j == i + 1 || NEXT_RANDOM(8) == 0)
+                link_cost[i][j] = link_cost[j][i] = 1 + NEXT_RANDOM(3);
+    }
+
+    routes_init(&routes);
+    for (int i = 0; i < count; i++)
+        push_link_state(engine, i, count);
+    calculate(engine, &routes);
+
+    for (int iteration = 0; iteration < 300; iteration++) {
+        int a    = NEXT_RANDOM(count);
+        int b    = NEXT_RANDOM(count);
+        int cost = NEXT_RANDOM(3) ? 1 + NEXT_RANDOM(4) : 0;
+        if (a == b)
+            continue;
+        link_cost[a][b] = cost;
+        if (NEXT_RANDOM(4))
+            link_cost[b][a] = cost;
+        push_link_state(engine, a, count);
+        push_link_state(engine, b, count);
+        calculate(engine, &routes);
+
+        qdr_path_engine_t *fresh = qdr_path_engine();
+        routes_init(&fresh_routes);
+        for (int i = 0; i < count; i++)
+            push_link_state(fresh, i, count);
+        calculate(fresh, &fresh_routes);
+        qdr_path_engine_free(fresh);
+
+        for (int i = 1; i < count; i++) {
+            if (!fresh_routes.reported[i])
+                continue;
+            if ((fresh_routes.next_hop[i] != -1 && fresh_routes.next_hop[i] != routes.next_hop[i]) ||
+                fresh_routes.cost[i] != routes.cost[i] ||
+                fresh_routes.valid_origins[i] != routes.valid_origins[i]) {
+                sprintf(error, "Route to %d differs after change %d", i, iteration);
+                qdr_path_engine_free(engine);
+                return error;
+            }
+        }
+    }
+
+#undef NEXT_RANDOM
+
+    qdr_path_engine_free(engine);
+    return 0;
+}
+
+
+int path_tests(void)
+{
+    int result = 0;
+
+    TEST_CASE(test_topology3, 0);
+    TEST_CASE(test_topology6, 0);
+    TEST_CASE(test_incremental, 0);
+
+    return result;
+}
@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "test_case.h"
+#include "dispatch_private.h"
+#include "resolver.h"
+#include "timer_private.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+//
+// Notify timers are never run here; a timer the resolver scheduled is left pending, which
+// the tests check for.  (timer_test.c stands in for the server's pending list.)
+//
+
+static bool timer_pending(qd_timer_t *timer)
+{
+    sys_mutex_lock(qd_timer_lock());
+    bool pending = timer->state == TIMER_PENDING;
+    sys_mutex_unlock(qd_timer_lock());
+    return pending;
+}
+
+
+static bool wait_pending(qd_timer_t *timer)
+{
+    for (int tries = 0; tries < 5000 && !timer_pending(timer); tries++)
+        usleep(1000);
+    return timer_pending(timer);
+}
+
+
+static char* test_cache_miss_and_hit(void *context)
+{
+    qd_resolver_t      *resolver = qd_resolver(qd_log_source("RESOLVER"));
+    qd_timer_t         *first    = qd_timer(0, 0, 0);
+    qd_timer_t         *second   = qd_timer(0, 0, 0);
+    qd_resolved_addr_t  addr;
+    char               *result   = 0;
+
+    qd_resolver_hold(resolver, true);
+    if (qd_resolver_lookup(resolver, "127.0.0.1", "5672", "IPv4", first, &addr) != QD_RESOLVE_PENDING)
+        result = "First lookup did not miss the cache";
+    qd_resolver_hold(resolver, false);
+
+    if (!result && !wait_pending(first))
+        result = "Waiting timer was not scheduled";
+
+    if (!result) {
+        if (qd_resolver_lookup(resolver, "127.0.0.1", "5672", "IPv4", second, &addr) != QD_RESOLVE_OK)
+            result = "Second lookup did not hit the cache";
+        else if (addr.addr.ss_family != AF_INET || ntohs(((struct sockaddr_in*) &addr.addr)->sin_port) != 5672)
+            result = "Wrong address was resolved";
+        else if (timer_pending(second))
+            result = "Timer was scheduled for a cache hit";
+    }
+
+    qd_resolver_free(resolver);
+    qd_timer_free(first);
+    qd_timer_free(second);
+    return result;
+}
+
+
+static char* test_negative_expiry(void *context)
+{
+    qd_resolver_t      *resolver = qd_resolver(qd_log_source("RESOLVER"));
+    qd_timer_t         *timer    = qd_timer(0, 0, 0);
+    qd_resolved_addr_t  addr;
+    char               *result   = 0;
+
+    qd_resolver_set_cache_times(resolver, 60000, 100);
+
+    if (qd_resolver_lookup(resolver, "no.such.host.invalid", "5672", 0, timer, &addr) != QD_RESOLVE_PENDING)
+        result = "Lookup did not miss the cache";
+    if (!result && !wait_pending(timer))
+        result = "Waiting timer was not scheduled";
+
+    if (!result) {
+        if (qd_resolver_lookup(resolver, "no.such.host.invalid", "5672", 0, timer, &addr) != QD_RESOLVE_FAILED)
+            result = "Failure was not cached";
+        else if (!addr.error)
+            result = "Failure has no error text";
+    }
+
+    if (!result) {
+        usleep(200000);
+        if (qd_resolver_lookup(resolver, "no.such.host.invalid", "5672", 0, timer, &addr) != QD_RESOLVE_PENDING)
+            result = "Cached failure did not expire";
+    }
+
+    qd_resolver_free(resolver);
+    qd_timer_free(timer);
+    return result;
+}
+
+
+static char* test_cancel(void *context)
+{
+    qd_resolver_t      *resolver = qd_resolver(qd_log_source("RESOLVER"));
+    qd_timer_t         *cancelled = qd_timer(0, 0, 0);
+    qd_timer_t         *waiting   = qd_timer(0, 0, 0);
+    qd_resolved_addr_t  addr;
+    char               *result    = 0;
+
+    //
+    // Both timers wait for the same lookup, which is held until one of them is cancelled.
+    //
+    qd_resolver_hold(resolver, true);
+    qd_resolver_lookup(resolver, "127.0.0.1", "5673", "IPv4", cancelled, &addr);
+    qd_resolver_lookup(resolver, "127.0.0.1", "5673", "IPv4", waiting, &addr);
+    qd_resolver_cancel(resolver, cancelled);
+    qd_resolver_hold(resolver, false);
+
+    if (!wait_pending(waiting))
+        result = "Waiting timer was not scheduled";
+    else if (timer_pending(cancelled))
+        result = "Cancelled timer was scheduled";
+
+    qd_resolver_free(resolver);
+    qd_timer_free(cancelled);
+    qd_timer_free(waiting);
+    return result;
+}
+
+
+int resolver_tests(void)
+{
+    int result = 0;
+
+    TEST_CASE(test_cache_miss_and_hit, 0);
+    TEST_CASE(test_negative_expiry, 0);
+    TEST_CASE(test_cancel, 0);
+
+    return result;
+}
@@ -0,0 +1,568 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "test_case.h"
+#include "router_core/router_core_private.h"
+#include "message_private.h"
+#include <qpid/dispatch/compose.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// These tests drive a router core directly.  The test thread plays the part of the IO
+// thread: it forwards deliveries, falling back to the core as the router node does, and
+// processes the connection when the core activates it.
+//
+
+#define MAX_RECEIVED 1000
+
+typedef struct {
+    int  seq[MAX_RECEIVED];
+    int  count;
+} received_t;
+
+static qdr_core_t       *core;
+static qdr_connection_t *conn;
+static int               activated;
+static received_t        received;
+
+static sys_mutex_t *pause_lock;
+static sys_cond_t  *pause_cond;
+static bool         core_paused;
+static bool         core_released;
+
+static bool         probe_done;
+static int          probe_mapped;
+static int          probe_mobile;
+static int          probe_pending;
+
+
+static void h_activate(void *context, qdr_connection_t *c, bool awaken)
+{
+    __atomic_store_n(&activated, 1, __ATOMIC_SEQ_CST);
+}
+
+static void h_first_attach(void *context, qdr_connection_t *c, qdr_link_t *link, qdr_terminus_t *source, qdr_terminus_t *target) {}
+static void h_second_attach(void *context, qdr_link_t *link, qdr_terminus_t *source, qdr_terminus_t *target) {}
+static void h_detach(void *context, qdr_link_t *link, qdr_error_t *error, bool first, bool close) {}
+static void h_flow(void *context, qdr_link_t *link, int credit) {}
+static void h_offer(void *context, qdr_link_t *link, int delivery_count) {}
+static void h_drained(void *context, qdr_link_t *link) {}
+static void h_drain(void *context, qdr_link_t *link, bool mode) {}
+static void h_update(void *context, qdr_delivery_t *dlv, uint64_t disp, bool settled) {}
+
+static void h_push(void *context, qdr_link_t *link)
+{
+    qdr_link_process_deliveries(core, link, MAX_RECEIVED);
+}
+
+static void h_deliver(void *context, qdr_link_t *link, qdr_delivery_t *dlv, bool settled)
+{
+    qd_message_t *msg = qdr_delivery_message(dlv);
+    ((qd_message_pvt_t*) msg)->send_complete = true;
+    if (received.count < MAX_RECEIVED)
+        received.seq[received.count++] = qd_message_get_phase_annotation(msg);
+}
+
+
+//
+// Play the IO thread until cond holds or five seconds have passed.
+//
+#define WAIT_FOR(cond) do {                                              \
+    for (int tries = 0; !(cond) && tries < 5000; tries++) {              \
+        if (__atomic_exchange_n(&activated, 0, __ATOMIC_SEQ_CST))        \
+            qdr_connection_process(conn);                                \
+        usleep(1000);                                                    \
+    }                                                                    \
+} while (0)
+
+
+static qdr_terminus_t *terminus(const char *address)
+{
+    qdr_terminus_t *term = qdr_terminus(0);
+    if (address)
+        qdr_terminus_set_address(term, address);
+    return term;
+}
+
+
+static qd_message_t *test_message(int seq)
+{
+    qd_composed_field_t *field = qd_compose(QD_PERFORMATIVE_BODY_DATA, 0);
+    qd_buffer_list_t     body;
+
+    qd_compose_insert_binary(field, (const uint8_t*) "x", 1);
+    DEQ_INIT(body);
+    qd_compose_take_buffers(field, &body);
+    qd_compose_free(field);
+
+    qd_message_t *msg = qd_message();
+    qd_message_compose_1(msg, "q", &body);
+    qd_message_set_phase_annotation(msg, seq);
+    return msg;
+}
+
+
+//
+// Send a presettled message the way the router node does: directly if possible,
+// otherwise through the core.  Returns true if it was forwarded directly.
+//
+static bool send_message(qdr_link_t *link, int seq)
+{
+    qd_message_t *msg = test_message(seq);
+    if (qdr_link_deliver_direct(link, msg, 0, 0))
+        return true;
+    qdr_link_deliver(link, msg, 0, true, 0);
+    return false;
+}
+
+
+static bool snapshot_ready(qdr_link_t *link)
+{
+    return __atomic_load_n(&core->forward_snapshot, __ATOMIC_SEQ_CST) != 0 &&
+        __atomic_load_n(&link->deliveries_to_core, __ATOMIC_SEQ_CST) == 0;
+}
+
+
+static char *check_received(int count)
+{
+    WAIT_FOR(received.count >= count);
+    if (received.count != count)
+        return "Wrong number of deliveries received";
+    for (int i = 0; i < count; i++)
+        if (received.seq[i] != i)
+            return "Deliveries received out of order";
+    return 0;
+}
+
+
+//
+// A core action that withdraws the forwarding snapshot and then holds the core thread, so
+// that no new snapshot is published until the test releases it.
+//
+static void pause_core_CT(qdr_core_t *c, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+    qdr_forward_snapshot_invalidate_CT(c);
+    sys_mutex_lock(pause_lock);
+    core_paused = true;
+    sys_cond_signal_all(pause_cond);
+    while (!core_released)
+        sys_cond_wait(pause_cond, pause_lock);
+    core_paused = false;
+    sys_cond_signal_all(pause_cond);
+    sys_mutex_unlock(pause_lock);
+}
+
+
+static void pause_core(void)
+{
+    sys_mutex_lock(pause_lock);
+    core_released = false;
+    sys_mutex_unlock(pause_lock);
+    qdr_action_enqueue(core, qdr_action(pause_core_CT, "test_pause"));
+    sys_mutex_lock(pause_lock);
+    while (!core_paused)
+        sys_cond_wait(pause_cond, pause_lock);
+    sys_mutex_unlock(pause_lock);
+}
+
+
+static void release_core(void)
+{
+    sys_mutex_lock(pause_lock);
+    core_released = true;
+    sys_cond_signal_all(pause_cond);
+    while (core_paused)
+        sys_cond_wait(pause_cond, pause_lock);
+    sys_mutex_unlock(pause_lock);
+}
+
+
+//
+// Wait until the core has processed every action enqueued so far.
+//
+static void sync_core(void)
+{
+    pause_core();
+    release_core();
+}
+
+
+static qdr_link_t *setup(qdr_link_t **out_link)
+{
+    static uint64_t management_id = 0;
+
+    received.count = 0;
+    conn = qdr_connection_opened(core, true, QDR_ROLE_NORMAL, 1, ++management_id, 0, "test", false, false, 250, 0,
+                                 qdr_connection_info(false, false, true, 0, QD_INCOMING, 0, 0, 0, 0,
+                                                     "test", 0, 0, false));
+    *out_link = qdr_link_first_attach(conn, QD_OUTGOING, terminus("q"), terminus(0), "out");
+    qdr_link_t *in_link = qdr_link_first_attach(conn, QD_INCOMING, terminus(0), terminus("q"), "in");
+
+    //
+    // Let the core take in the attaches, so that a snapshot published before them is not
+    // mistaken for one that has the new links.
+    //
+    sync_core();
+    return in_link;
+}
+
+
+static void teardown(qdr_link_t *in_link, qdr_link_t *out_link)
+{
+    qdr_link_detach(in_link, QD_CLOSED, 0);
+    qdr_link_detach(out_link, QD_CLOSED, 0);
+    qdr_connection_closed(conn);
+    sync_core();
+    conn = 0;
+}
+
+
+static char *test_direct_order(void *context)
+{
+    qdr_link_t *out_link;
+    qdr_link_t *in_link = setup(&out_link);
+    char       *result  = 0;
+    int         direct  = 0;
+
+    WAIT_FOR(snapshot_ready(in_link));
+    if (!snapshot_ready(in_link))
+        result = "No forwarding snapshot was published";
+
+    //
+    // Interleave core-bound deliveries with direct ones.  Deliveries that follow one still
+    // queued to the core must go to the core as well rather than overtake it; once the core
+    // has caught up they are forwarded directly again.
+    //
+    int seq = 0;
+    for (int batch = 0; !result && batch < 4; batch++) {
+        qdr_link_deliver(in_link, test_message(seq++), 0, true, 0);
+        for (int i = 0; i < 20; i++)
+            if (send_message(in_link, seq++))
+                direct++;
+        WAIT_FOR(snapshot_ready(in_link));
+        for (int i = 0; i < 29; i++)
+            if (send_message(in_link, seq++))
+                direct++;
+    }
+
+    if (!result && direct == 0)
+        result = "No delivery was forwarded directly";
+    if (!result)
+        result = check_received(200);
+    if (!result && __atomic_load_n(&in_link->direct_deliveries, __ATOMIC_SEQ_CST) != (uint64_t) direct)
+        result = "Direct deliveries were not counted";
+
+    teardown(in_link, out_link);
+    return result;
+}
+
+
+static char *test_direct_invalidated(void *context)
+{
+    qdr_link_t *out_link;
+    qdr_link_t *in_link = setup(&out_link);
+    char       *result  = 0;
+
+    WAIT_FOR(snapshot_ready(in_link));
+    if (!snapshot_ready(in_link))
+        result = "No forwarding snapshot was published";
+
+    for (int seq = 0; !result && seq < 10; seq++)
+        if (!send_message(in_link, seq))
+            result = "Delivery was not forwarded directly with a snapshot";
+
+    //
+    // With the snapshot withdrawn, everything must go through the core, and must still
+    // arrive after the deliveries that were forwarded directly.
+    //
+    if (!result) {
+        pause_core();
+        for (int seq = 10; !result && seq < 20; seq++)
+            if (send_message(in_link, seq))
+                result = "Delivery was forwarded directly without a snapshot";
+        release_core();
+    }
+
+    if (!result)
+        result = check_received(20);
+
+    //
+    // Once the core has caught up it publishes a new snapshot and direct forwarding resumes.
+    //
+    if (!result) {
+        WAIT_FOR(snapshot_ready(in_link));
+        if (!send_message(in_link, 20))
+            result = "Direct forwarding did not resume with a new snapshot";
+    }
+    if (!result)
+        result = check_received(21);
+
+    teardown(in_link, out_link);
+    return result;
+}
+
+
+static char *test_direct_no_route(void *context)
+{
+    qdr_link_t *out_link;
+    qdr_link_t *in_link = setup(&out_link);
+    qdr_link_t *anon    = qdr_link_first_attach(conn, QD_INCOMING, terminus(0), terminus(0), "anon");
+    char       *result  = 0;
+
+    WAIT_FOR(snapshot_ready(in_link));
+    if (!snapshot_ready(in_link))
+        result = "No forwarding snapshot was published";
+
+    //
+    // An address that is not in the snapshot is left to the core.
+    //
+    if (!result) {
+        qd_message_t  *msg  = test_message(0);
+        qd_iterator_t *addr = qd_iterator_string("nowhere", ITER_VIEW_ADDRESS_HASH);
+        if (qdr_link_deliver_direct(anon, msg, addr, 0))
+            result = "Delivery to an unknown address was forwarded directly";
+        qd_iterator_free(addr);
+        qd_message_free(msg);
+    }
+
+    //
+    // The same link forwards directly to an address that is in the snapshot.
+    //
+    if (!result) {
+        qd_message_t  *msg  = test_message(0);
+        qd_iterator_t *addr = qd_iterator_string("q", ITER_VIEW_ADDRESS_HASH);
+        if (!qdr_link_deliver_direct(anon, msg, addr, 0)) {
+            qd_iterator_free(addr);
+            qd_message_free(msg);
+            result = "Delivery to a known address was not forwarded directly";
+        }
+    }
+    if (!result)
+        result = check_received(1);
+
+    qdr_link_detach(anon, QD_CLOSED, 0);
+    teardown(in_link, out_link);
+    return result;
+}
+
+
+//
+// A core action that counts the test's mobile addresses, those of them mapped to a router
+// and the address updates still waiting to be applied.
+//
+static void probe_core_CT(qdr_core_t *c, qdr_action_t *action, bool discard)
+{
+    int router_maskbit = action->args.route_table.router_maskbit;
+    int mapped         = 0;
+    int mobile         = 0;
+
+    if (!discard) {
+        qdr_address_t *addr = DEQ_HEAD(c->addrs);
+        while (addr) {
+            if (addr->hash_handle && strncmp((const char*) qd_hash_key_by_handle(addr->hash_handle), "M0mobile.", 9) == 0) {
+                mobile++;
+                if (qd_bitmask_value(addr->rnodes, router_maskbit))
+                    mapped++;
+            }
+            addr = DEQ_NEXT(addr);
+        }
+    }
+
+    sys_mutex_lock(pause_lock);
+    probe_mapped  = mapped;
+    probe_mobile  = mobile;
+    probe_pending = DEQ_SIZE(c->address_updates);
+    probe_done    = true;
+    sys_cond_signal_all(pause_cond);
+    sys_mutex_unlock(pause_lock);
+}
+
+
+static void enqueue_probe(int router_maskbit)
+{
+    qdr_action_t *action = qdr_action(probe_core_CT, "test_probe");
+    action->args.route_table.router_maskbit = router_maskbit;
+    qdr_action_enqueue(core, action);
+}
+
+
+static void wait_probe(void)
+{
+    sys_mutex_lock(pause_lock);
+    while (!probe_done)
+        sys_cond_wait(pause_cond, pause_lock);
+    probe_done = false;
+    sys_mutex_unlock(pause_lock);
+}
+
+
+//
+// Probe the core until no address updates remain.
+//
+static void wait_updates(int router_maskbit)
+{
+    for (int tries = 0; tries < 1000; tries++) {
+        enqueue_probe(router_maskbit);
+        wait_probe();
+        if (probe_pending == 0)
+            return;
+    }
+}
+
+
+#define MOBILE_COUNT 2500
+
+static const char **mobile_hashes(void)
+{
+    static char        names[MOBILE_COUNT][32];
+    static const char *hashes[MOBILE_COUNT];
+
+    for (int i = 0; i < MOBILE_COUNT; i++) {
+        snprintf(names[i], sizeof(names[i]), "M0mobile.%d", i);
+        hashes[i] = names[i];
+    }
+    return hashes;
+}
+
+
+static char *test_address_update_slices(void *context)
+{
+    const char **hashes = mobile_hashes();
+    char        *result = 0;
+
+    qdr_core_add_router(core, "amqp:/_topo/0/R1/qdrouter", 1);
+
+    //
+    // Hold the core while the update and a probe are queued behind it.  The probe must run
+    // after the first slice, ahead of the rest of the update.
+    //
+    pause_core();
+    qdr_core_map_destinations(core, 1, MOBILE_COUNT, hashes);
+    enqueue_probe(1);
+    release_core();
+    wait_probe();
+    if (probe_mapped != QDR_ADDRESS_UPDATE_SLICE)
+        result = "The first slice did not map the expected number of addresses";
+
+    if (!result) {
+        wait_updates(1);
+        if (probe_pending != 0)
+            result = "The map update was not resumed to completion";
+        else if (probe_mapped != MOBILE_COUNT)
+            result = "Not every address was mapped";
+        else if (core->routers_by_mask_bit[1]->ref_count != MOBILE_COUNT + 3)
+            result = "Router reference count does not match the mapped addresses";
+    }
+
+    if (!result) {
+        qdr_core_unmap_destinations(core, 1, MOBILE_COUNT, hashes);
+        wait_updates(1);
+        if (probe_pending != 0)
+            result = "The unmap update was not resumed to completion";
+        else if (probe_mapped != 0)
+            result = "Not every address was unmapped";
+        else if (core->routers_by_mask_bit[1]->ref_count != 3)
+            result = "Router reference count was not released";
+    }
+
+    qdr_core_del_router(core, 1);
+    sync_core();
+    return result;
+}
+
+
+static char *test_address_update_del_router(void *context)
+{
+    const char **hashes = mobile_hashes();
+    char        *result = 0;
+
+    qdr_core_add_router(core, "amqp:/_topo/0/R2/qdrouter", 2);
+    qdr_core_add_router(core, "amqp:/_topo/0/R3/qdrouter", 3);
+
+    //
+    // Queue updates for two routers and delete the first after one slice of its update.
+    // The rest of its update is dropped, while the other router's keeps going in slices.
+    //
+    pause_core();
+    qdr_core_map_destinations(core, 2, MOBILE_COUNT, hashes);
+    qdr_core_map_destinations(core, 3, MOBILE_COUNT, hashes);
+    qdr_core_del_router(core, 2);
+    enqueue_probe(3);
+    release_core();
+    wait_probe();
+    if (core->routers_by_mask_bit[2] != 0)
+        result = "The router was not deleted";
+    else if (probe_pending != 1)
+        result = "The update for the deleted router is still pending";
+    else if (probe_mobile != QDR_ADDRESS_UPDATE_SLICE)
+        result = "The rest of the deleted router's update was applied";
+    else if (probe_mapped != 0)
+        result = "The other router's update was applied ahead of its slice";
+
+    if (!result) {
+        enqueue_probe(2);
+        wait_probe();
+        if (probe_mapped != 0)
+            result = "Addresses are still mapped to the deleted router";
+    }
+
+    if (!result) {
+        wait_updates(3);
+        if (probe_mapped != MOBILE_COUNT)
+            result = "Not every address was mapped to the remaining router";
+    }
+
+    qdr_core_del_router(core, 3);
+    sync_core();
+    return result;
+}
+
+
+int router_core_tests(qd_dispatch_t *qd)
+{
+    int result = 0;
+
+    pause_lock = sys_mutex();
+    pause_cond = sys_cond();
+    core = qdr_core(qd, QD_ROUTER_MODE_STANDALONE, "0", "core-test");
+    qdr_connection_handlers(core, 0, h_activate, h_first_attach, h_second_attach, h_detach, h_flow,
+                            h_offer, h_drained, h_drain, h_push, h_deliver, h_update);
+
+    TEST_CASE(test_direct_order, 0);
+    TEST_CASE(test_direct_invalidated, 0);
+    TEST_CASE(test_direct_no_route, 0);
+
+    qdr_core_free(core);
+
+    //
+    // Route tables are only kept by an interior router.
+    //
+    core = qdr_core(qd, QD_ROUTER_MODE_INTERIOR, "0", "core-test");
+    TEST_CASE(test_address_update_slices, 0);
+    TEST_CASE(test_address_update_del_router, 0);
+
+    qdr_core_free(core);
+    sys_cond_free(pause_cond);
+    sys_mutex_free(pause_lock);
+    return result;
+}
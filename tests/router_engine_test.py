@@ -26,6 +26,8 @@ sys.path.append(os.path.join(os.environ["SOURCE_DIR"], "python"))
 
 from qpid_dispatch_internal.router.engine import HelloProtocol, PathEngine, NodeTracker
 from qpid_dispatch_internal.router.data import LinkState, MessageHELLO, ProtocolVersion
+from qpid_dispatch_internal.router.data import MessageMAU, MessageMAR, MAU_ENCODINGS, MAU_ENCODING_FRONT_ZLIB
+from qpid_dispatch_internal.router.mobile import MobileAddressEngine, MAX_ADDRS_PER_MAU
 from qpid_dispatch.management.entity import EntityBase
 from system_test import main_module
 
@@ -96,6 +98,122 @@ class DataTest(unittest.TestCase):
         self.assertFalse(msg2.is_seen('R9'))
 
 
+    def test_mau_encoding(self):
+        addrs = ['M0reply/device-%05d' % i for i in range(2000)] + ['M0queue', 'Cbroadcast']
+        msg1 = MessageMAU(None, 'R1', 7, None, None, addrs, MAU_ENCODING_FRONT_ZLIB, 1, 3)
+        encoded = msg1.to_dict()
+        self.assertFalse('exist' in encoded)
+        self.assertTrue(isinstance(encoded['exist_data'], bytearray))
+        self.assertTrue(len(encoded['exist_data']) < sum(len(a) for a in addrs) / 4)
+
+        encoded['exist_data'] = str(encoded['exist_data'])   # Binary is received as str
+        msg2 = MessageMAU(encoded)
+        self.assertEqual(msg2.mobile_seq, 7)
+        self.assertEqual(msg2.exist_list, sorted(addrs))
+        self.assertEqual((msg2.part, msg2.parts), (1, 3))
+
+        msg3 = MessageMAU(MessageMAU(None, 'R1', 7, None, None, addrs).to_dict())
+        self.assertEqual(msg3.exist_list, addrs)
+        self.assertEqual(msg3.encoding, None)
+        self.assertEqual(msg3.parts, 1)
+
+
+    def test_mar_message(self):
+        msg1 = MessageMAR(MessageMAR(None, 'R1', 3, MAU_ENCODINGS, 5, 2).to_dict())
+        self.assertEqual(msg1.have_seq, 3)
+        self.assertEqual(msg1.encodings, MAU_ENCODINGS)
+        self.assertEqual((msg1.resume_seq, msg1.resume_part), (5, 2))
+
+        msg2 = MessageMAR({'id': 'R1', 'have_seq': 3L})   # From a router without encodings
+        self.assertEqual(msg2.encodings, [])
+        self.assertEqual(msg2.resume_seq, None)
+
+
+class MobileAddressTest(unittest.TestCase):
+    class Node(object):
+        def __init__(self):
+            self.mobile_address_sequence = 0
+            self.partial_mau             = None
+            self.requested               = False
+            self.addrs                   = None
+
+        def mobile_address_request(self):
+            self.requested = True
+
+        def overwrite_addresses(self, addrs):
+            self.addrs = addrs
+
+    class Container(object):
+        def __init__(self, _id, node):
+            self.id           = _id
+            self.sent         = []
+            self.node_tracker = self
+            self.node         = node
+
+        def send(self, dest, msg):
+            self.sent.append(msg)
+
+        def log_ma(self, level, text):
+            pass
+
+        def router_node(self, node_id):
+            return self.node
+
+    def transfer(self, msg):
+        body = msg.to_dict()
+        if 'exist_data' in body:
+            body['exist_data'] = str(body['exist_data'])
+        return msg.__class__(body)
+
+    def test_resumed_parts(self):
+        node      = self.Node()
+        sender    = self.Container('R1', None)
+        receiver  = self.Container('R2', node)
+        r1_engine = MobileAddressEngine(sender, sender)
+        r2_engine = MobileAddressEngine(receiver, receiver)
+
+        addrs = ['M0addr%d' % i for i in range(2 * MAX_ADDRS_PER_MAU + 5)]
+        r1_engine.added_addrs = list(addrs)
+        r1_engine.tick(0)
+        r1_engine.sent_deltas = {}   # Too far behind to catch up with deltas
+        sender.sent = []
+
+        r2_engine.send_mar('R1', 0)
+        r1_engine.handle_mar(self.transfer(receiver.sent.pop()), 0)
+        self.assertEqual(len(sender.sent), 3)
+
+        ##
+        ## Lose the second part.  The third is out of sequence and prompts a new request.
+        ##
+        parts, sender.sent = sender.sent, []
+        r2_engine.handle_mau(self.transfer(parts[0]), 0)
+        r2_engine.handle_mau(self.transfer(parts[2]), 0)
+        self.assertTrue(node.requested)
+        self.assertEqual(node.addrs, None)
+
+        r2_engine.send_mar('R1', node.mobile_address_sequence)
+        mar = self.transfer(receiver.sent.pop())
+        self.assertEqual((mar.resume_seq, mar.resume_part), (1, 1))
+        r1_engine.handle_mar(mar, 0)
+        self.assertEqual(len(sender.sent), 2)
+        for part in sender.sent:
+            r2_engine.handle_mau(self.transfer(part), 0)
+        self.assertEqual(sorted(node.addrs), sorted(addrs))
+        self.assertEqual(node.mobile_address_sequence, 1)
+        self.assertEqual(node.partial_mau, None)
+
+    def test_plain_request(self):
+        sender    = self.Container('R1', None)
+        r1_engine = MobileAddressEngine(sender, sender)
+        r1_engine.add_local_address('M0addr')
+        r1_engine.tick(0)
+        r1_engine.sent_deltas = {}
+        r1_engine.handle_mar(MessageMAR({'id': 'R2', 'have_seq': 0L}), 0)
+        msg = sender.sent[-1]
+        self.assertEqual(msg.encoding, None)
+        self.assertEqual(msg.to_dict()['exist'], ['M0addr'])
+
+
 class NodeTrackerTest(unittest.TestCase):
     def log(self, level, text):
         pass
@@ -27,7 +27,11 @@ int tool_tests(void);
 int timer_tests(void);
 int alloc_tests(void);
 int compose_tests(void);
+int log_tests(void);
 int policy_tests(void);
+int path_tests(void);
+int resolver_tests(void);
+int router_core_tests(qd_dispatch_t *qd);
 
 int main(int argc, char** argv)
 {
@@ -54,10 +58,14 @@ int main(int argc, char** argv)
     result += timer_tests();
     result += tool_tests();
     result += compose_tests();
+    result += log_tests();
 #if USE_MEMORY_POOL
     result += alloc_tests();
 #endif
     result += policy_tests();
+    result += path_tests();
+    result += resolver_tests();
+    result += router_core_tests(qd);
     qd_dispatch_free(qd);       // dispatch_free last.
 
     return result;
@@ -19,6 +19,7 @@
 
 #include <qpid/dispatch/buffer.h>
 #include "alloc.h"
+#include "message_private.h"
 
 int message_tests();
 int field_tests();
@@ -44,6 +45,7 @@ int main(int argc, char** argv)
     result += parse_tests();
     result += buffer_tests();
 
+    qd_message_finalize();
     qd_alloc_finalize();
     return result;
 }
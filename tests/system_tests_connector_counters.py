@@ -0,0 +1,88 @@
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+
+import unittest
+from system_test import TestCase, Qdrouterd, main_module, retry
+from qpid_dispatch.management.client import Node
+
+COUNTERS = ['connectAttempts', 'connectFailures', 'resolveFailures', 'connectionsOpened']
+
+class ConnectorCountersTest(TestCase):
+    """
+    Check the connect-rate counters of connectors to a live router, to a port nobody
+    listens on and to a host that does not resolve.
+    """
+    @classmethod
+    def setUpClass(cls):
+        super(ConnectorCountersTest, cls).setUpClass()
+        target = cls.tester.qdrouterd('connector-counters-target', Qdrouterd.Config([
+            ('router', {'mode': 'standalone', 'id': 'QDR.Target'}),
+            ('listener', {'port': cls.tester.get_port()}),
+        ]))
+        target.wait_ready()
+
+        cls.router = cls.tester.qdrouterd('connector-counters', Qdrouterd.Config([
+            ('router', {'mode': 'standalone', 'id': 'QDR.Counters'}),
+            ('listener', {'port': cls.tester.get_port()}),
+            ('connector', {'name': 'live', 'host': '127.0.0.1', 'port': target.ports[0]}),
+            ('connector', {'name': 'refused', 'host': '127.0.0.1', 'port': cls.tester.get_port()}),
+            ('connector', {'name': 'unresolved', 'host': 'no.such.host.invalid', 'port': cls.tester.get_port()}),
+        ]))
+        cls.router.wait_ready()
+
+    def counters(self, node, name):
+        results = node.query(type='org.apache.qpid.dispatch.connector',
+                             attribute_names=['name'] + COUNTERS).get_dicts()
+        for connector in results:
+            if connector['name'] == name:
+                return connector
+        return None
+
+    def wait_counters(self, name, check):
+        node = Node.connect(self.router.addresses[0])
+        try:
+            found = retry(lambda: check(self.counters(node, name)))
+            self.assertTrue(found, "%s: unexpected counters %s" % (name, self.counters(node, name)))
+            return self.counters(node, name)
+        finally:
+            node.close()
+
+    def test_live(self):
+        counters = self.wait_counters('live', lambda c: c['connectionsOpened'] == 1)
+        self.assertEqual(1, counters['connectAttempts'])
+        self.assertEqual(0, counters['connectFailures'])
+        self.assertEqual(0, counters['resolveFailures'])
+
+    def test_refused(self):
+        # The connector keeps retrying, so only require that every attempt so far failed.
+        counters = self.wait_counters('refused', lambda c: c['connectFailures'] >= 1)
+        self.assertTrue(counters['connectAttempts'] >= counters['connectFailures'])
+        self.assertEqual(0, counters['resolveFailures'])
+        self.assertEqual(0, counters['connectionsOpened'])
+
+    def test_unresolved(self):
+        # A host that does not resolve never gets as far as a socket.
+        counters = self.wait_counters('unresolved', lambda c: c['resolveFailures'] >= 1)
+        self.assertEqual(0, counters['connectAttempts'])
+        self.assertEqual(0, counters['connectFailures'])
+        self.assertEqual(0, counters['connectionsOpened'])
+
+
+if __name__ == '__main__':
+    unittest.main(main_module())
@@ -328,6 +328,25 @@ class ManagementTest(system_test.TestCase):
         response = self.node.query(type='org.apache.qpid.dispatch.connection')
         self.assertTrue(response.results)
 
+    def test_address_query_count_offset(self):
+        """Verify that pages of addresses fetched with offset and count make up the whole table"""
+        names = [r[0] for r in self.node.query(type=ADDRESS, attribute_names=['name']).results]
+        self.assertTrue(len(names) > 2)
+        paged = []
+        while len(paged) < len(names):
+            response = self.node.query(type=ADDRESS, attribute_names=['name'], offset=len(paged), count=2)
+            self.assertTrue(0 < len(response.results) <= 2)
+            paged.extend(r[0] for r in response.results)
+        self.assertEqual(names, paged)
+        self.assertEqual([], self.node.query(type=ADDRESS, offset=len(names), count=2).results)
+
+    def test_address_query_unknown_attribute(self):
+        """Verify that an unknown attribute name is answered with null in its column"""
+        response = self.node.query(type=ADDRESS, attribute_names=['name', 'nosuch', 'key'])
+        self.assertTrue(response.results)
+        for r in response.results:
+            self.assertEqual([r[0], None, r[0]], r)
+
     def test_router(self):
         """Verify router counts match entity counts"""
         entities = self.node.query().get_entities()
@@ -0,0 +1,112 @@
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+
+import unittest
+from proton import Message, Timeout
+from proton.reactor import AtMostOnce
+from proton.utils import BlockingConnection
+from system_test import TestCase, Qdrouterd, main_module, retry
+from qpid_dispatch.management.client import Node
+
+LINK_CAPACITY = 5
+MESSAGE_COUNT = 18
+
+class PresettledDropTest(TestCase):
+    """
+    Fill the outgoing queue of a receiver that grants no credit with pre-settled messages
+    and check which of them each presettledDropPolicy discards.
+    """
+    @classmethod
+    def setUpClass(cls):
+        super(PresettledDropTest, cls).setUpClass()
+        cls.routers = {}
+        for name, policy, count in [('flush', 'flush', 1),
+                                    ('dropOldest', 'dropOldest', 1),
+                                    ('dropOldest2', 'dropOldest', 2),
+                                    ('dropNewest', 'dropNewest', 1)]:
+            config = Qdrouterd.Config([
+                ('router', {'mode': 'standalone', 'id': 'QDR.%s' % name,
+                            'presettledDropPolicy': policy, 'presettledDropCount': count}),
+                ('listener', {'port': cls.tester.get_port(), 'linkCapacity': LINK_CAPACITY}),
+            ])
+            router = cls.tester.qdrouterd('presettled-drop-%s' % name, config)
+            router.wait_ready()
+            cls.routers[name] = router
+
+    def dropped_count(self, node, address):
+        results = node.query(type='org.apache.qpid.dispatch.router.link',
+                             attribute_names=['linkDir', 'owningAddr', 'droppedPresettledCount']).get_dicts()
+        for link in results:
+            if link['linkDir'] == 'out' and link['owningAddr'] and link['owningAddr'].endswith(address):
+                return link['droppedPresettledCount']
+        return None
+
+    def run_policy(self, name, expected_dropped):
+        """Return the sequence numbers received once expected_dropped messages were dropped"""
+        address = self.routers[name].addresses[0]
+        dest = 'presettled.drop'
+
+        receive_conn = BlockingConnection(address)
+        receiver = receive_conn.create_receiver(dest, credit=0)
+        send_conn = BlockingConnection(address)
+        sender = send_conn.create_sender(dest, options=AtMostOnce())
+        for seq in range(MESSAGE_COUNT):
+            sender.send(Message(body={'seq': seq}))
+
+        node = Node.connect(address)
+        dropped = retry(lambda: self.dropped_count(node, dest) == expected_dropped)
+        self.assertTrue(dropped, "%s: droppedPresettledCount is %s, expected %d" %
+                        (name, self.dropped_count(node, dest), expected_dropped))
+
+        received = []
+        try:
+            while True:
+                received.append(receiver.receive(timeout=1).body['seq'])
+                receiver.accept()
+        except Timeout:
+            pass
+
+        node.close()
+        send_conn.close()
+        receive_conn.close()
+        return received
+
+    def test_flush(self):
+        # Each overflow discards everything that was queued; the last one leaves 15 queued
+        # on its own, followed by 16 and 17.
+        self.assertEqual([15, 16, 17], self.run_policy('flush', 15))
+
+    def test_drop_oldest(self):
+        # The queue keeps the newest LINK_CAPACITY deliveries.
+        self.assertEqual(range(MESSAGE_COUNT - LINK_CAPACITY, MESSAGE_COUNT),
+                         self.run_policy('dropOldest', MESSAGE_COUNT - LINK_CAPACITY))
+
+    def test_drop_oldest_two(self):
+        # Each overflow discards the two oldest, leaving four queued; the last overflow, on 17,
+        # leaves 14 to 17.
+        self.assertEqual([14, 15, 16, 17], self.run_policy('dropOldest2', 14))
+
+    def test_drop_newest(self):
+        # The queue keeps the first LINK_CAPACITY deliveries and discards the rest as they arrive.
+        self.assertEqual(range(LINK_CAPACITY),
+                         self.run_policy('dropNewest', MESSAGE_COUNT - LINK_CAPACITY))
+
+
+if __name__ == '__main__':
+    unittest.main(main_module())
@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+//
+// Timer scheduling benchmark.  Schedules a population of timers with random durations,
+// reschedules each of them once as a heartbeat would, then runs the clock forward until
+// all have fired.  Not run as part of the test suite.
+//
+//   usage: timer_bench [timers]
+//
+
+#include "alloc.h"
+#include "bench.h"
+#include "dispatch_private.h"
+#include "timer_private.h"
+#include <qpid/dispatch/threading.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_DURATION 600000
+
+static qd_timer_list_t pending_timers;
+
+
+void qd_server_timer_pending_LH(qd_timer_t *timer)
+{
+    DEQ_INSERT_TAIL(pending_timers, timer);
+}
+
+
+void qd_server_timer_cancel_LH(qd_timer_t *timer)
+{
+    if (timer->state == TIMER_PENDING)
+        DEQ_REMOVE(pending_timers, timer);
+}
+
+
+int main(int argc, char **argv)
+{
+    int timer_count = bench_int_arg(argc, argv, 1, 100000);
+    if (timer_count < 1)
+        return bench_usage(argv, "[timers]");
+
+    qd_alloc_initialize();
+    sys_mutex_t *lock = sys_mutex();
+    qd_timer_initialize(lock);
+    DEQ_INIT(pending_timers);
+
+    qd_timer_t **timers = (qd_timer_t**) calloc(timer_count, sizeof(qd_timer_t*));
+    for (int i = 0; i < timer_count; i++)
+        timers[i] = qd_timer(0, 0, 0);
+
+    srand(1);
+    double start = bench_now();
+    for (int i = 0; i < timer_count; i++)
+        qd_timer_schedule(timers[i], 1 + rand() % MAX_DURATION);
+    double scheduled = bench_now();
+    for (int i = 0; i < timer_count; i++)
+        qd_timer_schedule(timers[i], 1 + rand() % MAX_DURATION);
+    double rescheduled = bench_now();
+
+    //
+    // Run the clock forward in one-second steps, as an idle server would.
+    //
+    long           fired = 0;
+    qd_timestamp_t clock = 1;
+    sys_mutex_lock(lock);
+    qd_timer_visit_LH(clock);
+    while (fired < timer_count && clock <= MAX_DURATION + 1000) {
+        clock += 1000;
+        qd_timer_visit_LH(clock);
+        while (!DEQ_IS_EMPTY(pending_timers)) {
+            qd_timer_t *timer = DEQ_HEAD(pending_timers);
+            DEQ_REMOVE_HEAD(pending_timers);
+            qd_timer_idle_LH(timer);
+            fired++;
+        }
+    }
+    sys_mutex_unlock(lock);
+    double finished = bench_now();
+
+    printf("%d timers: schedule %.0f ns/timer, reschedule %.0f ns/timer, expire %.0f ns/timer (%ld fired)\n",
+           timer_count,
+           (scheduled - start) * 1e9 / timer_count,
+           (rescheduled - scheduled) * 1e9 / timer_count,
+           (finished - rescheduled) * 1e9 / timer_count,
+           fired);
+
+    for (int i = 0; i < timer_count; i++)
+        qd_timer_free(timers[i]);
+    free(timers);
+    qd_timer_finalize();
+    sys_mutex_free(lock);
+    qd_alloc_finalize();
+    return fired == timer_count ? 0 : 1;
+}
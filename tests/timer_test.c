@@ -364,6 +364,66 @@ static char* test_big(void *context)
 }
 
 
+static int advance(long msec)
+{
+    sys_mutex_lock(lock);
+    time_value += msec - 1;
+    qd_timer_visit_LH(time_value++);
+    sys_mutex_unlock(lock);
+
+    int count = 0;
+    while (fire_head())
+        count++;
+    return count;
+}
+
+
+static char* test_long(void *context)
+{
+    while(fire_head());
+    fire_mask = 0;
+
+    //
+    // Durations that land in several levels of the timer wheel, plus a canceled timer
+    //
+    qd_timer_schedule(timers[0], 70);
+    qd_timer_schedule(timers[1], 4100);
+    qd_timer_schedule(timers[2], 300000);
+    qd_timer_schedule(timers[3], 20000000);
+    qd_timer_schedule(timers[4], 5000);
+    qd_timer_cancel(timers[4]);
+
+    sys_mutex_lock(lock);
+    qd_timestamp_t next = qd_timer_next_duration_LH();
+    sys_mutex_unlock(lock);
+    if (next < 1 || next > 70) return "Incorrect next duration";
+
+    if (advance(69) != 0)       return "Fired before 70";
+    if (advance(1) != 1)        return "Failed to fire at 70";
+    if (advance(4029) != 0)     return "Fired before 4100";
+    if (advance(1) != 1)        return "Failed to fire at 4100";
+    if (fire_mask != 3)         return "Incorrect fire mask 3";
+    if (advance(295899) != 0)   return "Fired before 300000";
+    if (advance(1) != 1)        return "Failed to fire at 300000";
+
+    sys_mutex_lock(lock);
+    next = qd_timer_next_duration_LH();
+    sys_mutex_unlock(lock);
+    if (next < 1 || next > 19700000) return "Incorrect long next duration";
+
+    if (advance(19699999) != 0) return "Fired before 20000000";
+    if (advance(1) != 1)        return "Failed to fire at 20000000";
+    if (fire_mask != 15)        return "Incorrect fire mask 15";
+
+    sys_mutex_lock(lock);
+    next = qd_timer_next_duration_LH();
+    sys_mutex_unlock(lock);
+    if (next != -1) return "Expected no scheduled timers";
+
+    return 0;
+}
+
+
 int timer_tests(void)
 {
     int result = 0;
@@ -400,6 +460,7 @@ int timer_tests(void)
     TEST_CASE(test_two_duplicate, 0);
     TEST_CASE(test_separated, 0);
     TEST_CASE(test_big, 0);
+    TEST_CASE(test_long, 0);
 
     int i;
     for (i = 0; i < 16; i++)
@@ -300,12 +300,95 @@ static char* test_bitmask(void *context)
     if (count != 4)  return "Expected count to be 4";
     if (total != 82) return "Expected bit-number total to be 82";
 
+    //
+    // Setting a bit while the first set bit is unknown must not hide lower bits.
+    //
+    qd_bitmask_clear_all(bm);
+    qd_bitmask_set_bit(bm, 2);
+    qd_bitmask_set_bit(bm, 3);
+    qd_bitmask_clear_bit(bm, 2);
+    qd_bitmask_set_bit(bm, 50);
+    if (!qd_bitmask_first_set(bm, &num)) return "Expected first set bit (3)";
+    if (num != 3)                        return "Expected first set bit to be 3";
+
+    qd_bitmask_free(bm);
+
+    return 0;
+}
+
+
+static char* test_bitmask_sparse(void *context)
+{
+    qd_bitmask_t *bm;
+    int           width = qd_bitmask_width();
+    int           bits[4] = {0, 63, 64, width - 1};
+    int           num;
+    int           c;
+    int           count;
+
+    if (width % 64 != 0) return "Expected width to be a multiple of 64";
+
+    //
+    // Iterate over bits at word boundaries with empty words in between.
+    //
+    bm = qd_bitmask(0);
+    for (int i = 3; i >= 0; i--)
+        qd_bitmask_set_bit(bm, bits[i]);
+
+    count = 0;
+    for (QD_BITMASK_EACH(bm, num, c)) {
+        if (count == 4 || num != bits[count]) return "Unexpected bit in iteration";
+        count++;
+    }
+    if (count != 4) return "Expected count to be 4";
+
+    qd_bitmask_clear_bit(bm, 0);
+    qd_bitmask_clear_bit(bm, 63);
+    qd_bitmask_clear_bit(bm, 64);
+    if (!qd_bitmask_first_set(bm, &num)) return "Expected first set bit";
+    if (num != width - 1)                return "Expected first set bit to be the last bit";
+
+    qd_bitmask_free(bm);
+
+    //
+    // A full mask visits every bit.
+    //
+    bm = qd_bitmask(1);
+    count = 0;
+    for (QD_BITMASK_EACH(bm, num, c)) {
+        if (num != count) return "Unexpected bit in full iteration";
+        count++;
+    }
+    if (count != width) return "Expected every bit in full iteration";
+
     qd_bitmask_free(bm);
 
     return 0;
 }
 
 
+static char* test_bitmask_width(void *context)
+{
+    qd_bitmask_t *bm    = qd_bitmask(0);
+    int           width = qd_bitmask_width();
+    char         *result = 0;
+
+    //
+    // Once bitmasks exist their width can't change, but setting it again is harmless.
+    //
+    if (qd_bitmask_set_width(width) != QD_ERROR_NONE)
+        result = "Expected the current width to be accepted";
+    else if (qd_bitmask_set_width(width + 64) != QD_ERROR_CONFIG)
+        result = "Expected a new width to be refused";
+    else if (qd_bitmask_width() != width)
+        result = "Expected the width to be unchanged";
+
+    qd_error_clear();
+    qd_bitmask_free(bm);
+    return result;
+}
+
+
 int tool_tests(void)
 {
     int result = 0;
@@ -314,6 +397,8 @@ int tool_tests(void)
     TEST_CASE(test_deq_basic2, 0);
     TEST_CASE(test_deq_multi, 0);
     TEST_CASE(test_bitmask, 0);
+    TEST_CASE(test_bitmask_sparse, 0);
+    TEST_CASE(test_bitmask_width, 0);
 
     return result;
 }